@@ -4,9 +4,15 @@
 
 #include "math.c"
 #include "hash_map.c"
+#include "jobs.c"
 
 #include "collision.c"
+#include "broadphase.c"
+#include "controller.c"
 #include "entities.c"
+#include "scheduler.c"
+#include "simulation.c"
+#include "input.c"
 #include "ui.c"
 #include "immediate_ui.c"
 
@@ -37,8 +43,8 @@
 	void CameraMoveForward(Camera *camera, float distance, bool moveInWorldPlane);
 #endif
 
-void update_editor_camera(Camera *camera) {
-	Vector2 mousePositionDelta = GetMouseDelta();
+void update_editor_camera(Camera *camera, const InputFrame* input) {
+	Vector2 mousePositionDelta = input->mouse_delta;
 
 	int mode = CAMERA_FREE;
 
@@ -48,10 +54,10 @@ void update_editor_camera(Camera *camera) {
 	bool rotateUp = false;
 
 	// Camera speeds based on frame time
-	float cameraMoveSpeed = CAMERA_MOVE_SPEED*GetFrameTime();
-	float cameraRotationSpeed = CAMERA_ROTATION_SPEED*GetFrameTime();
-	float cameraPanSpeed = CAMERA_PAN_SPEED*GetFrameTime();
-	float cameraOrbitalSpeed = CAMERA_ORBITAL_SPEED*GetFrameTime();
+	float cameraMoveSpeed = CAMERA_MOVE_SPEED*input->delta_seconds;
+	float cameraRotationSpeed = CAMERA_ROTATION_SPEED*input->delta_seconds;
+	float cameraPanSpeed = CAMERA_PAN_SPEED*input->delta_seconds;
+	float cameraOrbitalSpeed = CAMERA_ORBITAL_SPEED*input->delta_seconds;
 
 	if (mode == CAMERA_CUSTOM) {}
 	else if (mode == CAMERA_ORBITAL) {
@@ -63,17 +69,17 @@ void update_editor_camera(Camera *camera) {
 	}
 	else {
 		// Camera rotation
-		if (IsKeyDown(KEY_DOWN)) CameraPitch(camera, -cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
-		if (IsKeyDown(KEY_UP)) CameraPitch(camera, cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
-		if (IsKeyDown(KEY_RIGHT)) CameraYaw(camera, -cameraRotationSpeed, rotateAroundTarget);
-		if (IsKeyDown(KEY_LEFT)) CameraYaw(camera, cameraRotationSpeed, rotateAroundTarget);
-		if (IsKeyDown(KEY_Q)) CameraRoll(camera, -cameraRotationSpeed);
-		if (IsKeyDown(KEY_E)) CameraRoll(camera, cameraRotationSpeed);
+		if (input_key_down(input, INPUT_KEY_DOWN)) CameraPitch(camera, -cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
+		if (input_key_down(input, INPUT_KEY_UP)) CameraPitch(camera, cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
+		if (input_key_down(input, INPUT_KEY_RIGHT)) CameraYaw(camera, -cameraRotationSpeed, rotateAroundTarget);
+		if (input_key_down(input, INPUT_KEY_LEFT)) CameraYaw(camera, cameraRotationSpeed, rotateAroundTarget);
+		if (input_key_down(input, INPUT_KEY_Q)) CameraRoll(camera, -cameraRotationSpeed);
+		if (input_key_down(input, INPUT_KEY_E)) CameraRoll(camera, cameraRotationSpeed);
 
 		// Camera movement
 		// Camera pan (for CAMERA_FREE)
-		if ((mode == CAMERA_FREE) && (IsMouseButtonDown(MOUSE_BUTTON_MIDDLE))) {
-			const Vector2 mouseDelta = GetMouseDelta();
+		if ((mode == CAMERA_FREE) && (input_key_down(input, INPUT_KEY_MOUSE_MIDDLE))) {
+			const Vector2 mouseDelta = input->mouse_delta;
 			if (mouseDelta.x > 0.0f) CameraMoveRight(camera, cameraPanSpeed, moveInWorldPlane);
 			if (mouseDelta.x < 0.0f) CameraMoveRight(camera, -cameraPanSpeed, moveInWorldPlane);
 			if (mouseDelta.y > 0.0f) CameraMoveUp(camera, -cameraPanSpeed);
@@ -81,30 +87,30 @@ void update_editor_camera(Camera *camera) {
 		}
 		else {
 			// Mouse support
-			if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+			if (input_key_down(input, INPUT_KEY_MOUSE_RIGHT)) {
 				CameraYaw(camera, -mousePositionDelta.x*CAMERA_MOUSE_MOVE_SENSITIVITY, rotateAroundTarget);
 				CameraPitch(camera, -mousePositionDelta.y*CAMERA_MOUSE_MOVE_SENSITIVITY, lockView, rotateAroundTarget, rotateUp);
 			}
 		}
 
 		// Keyboard support
-		if (IsKeyDown(KEY_W)) CameraMoveForward(camera, cameraMoveSpeed, moveInWorldPlane);
-		if (IsKeyDown(KEY_A)) CameraMoveRight(camera, -cameraMoveSpeed, moveInWorldPlane);
-		if (IsKeyDown(KEY_S)) CameraMoveForward(camera, -cameraMoveSpeed, moveInWorldPlane);
-		if (IsKeyDown(KEY_D)) CameraMoveRight(camera, cameraMoveSpeed, moveInWorldPlane);
+		if (input_key_down(input, INPUT_KEY_W)) CameraMoveForward(camera, cameraMoveSpeed, moveInWorldPlane);
+		if (input_key_down(input, INPUT_KEY_A)) CameraMoveRight(camera, -cameraMoveSpeed, moveInWorldPlane);
+		if (input_key_down(input, INPUT_KEY_S)) CameraMoveForward(camera, -cameraMoveSpeed, moveInWorldPlane);
+		if (input_key_down(input, INPUT_KEY_D)) CameraMoveRight(camera, cameraMoveSpeed, moveInWorldPlane);
 
 		if (mode == CAMERA_FREE) {
-			if (IsKeyDown(KEY_SPACE)) CameraMoveUp(camera, cameraMoveSpeed);
-			if (IsKeyDown(KEY_LEFT_SHIFT)) CameraMoveUp(camera, -cameraMoveSpeed);
+			if (input_key_down(input, INPUT_KEY_SPACE)) CameraMoveUp(camera, cameraMoveSpeed);
+			if (input_key_down(input, INPUT_KEY_LEFT_SHIFT)) CameraMoveUp(camera, -cameraMoveSpeed);
 		}
 	}
 
 	if ((mode == CAMERA_THIRD_PERSON) || (mode == CAMERA_ORBITAL) || (mode == CAMERA_FREE))
 	{
 		// Zoom target distance
-		CameraMoveToTarget(camera, -GetMouseWheelMove());
-		if (IsKeyPressed(KEY_KP_SUBTRACT)) CameraMoveToTarget(camera, 2.0f);
-		if (IsKeyPressed(KEY_KP_ADD)) CameraMoveToTarget(camera, -2.0f);
+		CameraMoveToTarget(camera, -input->mouse_wheel);
+		if (input_key_pressed(input, INPUT_KEY_KP_SUBTRACT)) CameraMoveToTarget(camera, 2.0f);
+		if (input_key_pressed(input, INPUT_KEY_KP_ADD)) CameraMoveToTarget(camera, -2.0f);
 	}
 }
 
@@ -116,15 +122,21 @@ Transform default_transform() {
 	};
 }
 
-void draw_model(ModelID model_id, const Model* model_prefabs, Transform model_transform) {
+/* Draws with a precomputed world matrix (see entity_store_update_hierarchy) */
+void draw_model(ModelID model_id, const Model* model_prefabs, Matrix world_matrix) {
 	if (model_id == MODEL_NONE) { return; }
 
-	DrawModelEx(model_prefabs[model_id], model_transform.translation, VECTOR3_UP, 0.0f, model_transform.scale, WHITE);
+	Model model = model_prefabs[model_id];
+	model.transform = MatrixMultiply(model.transform, world_matrix);
+	DrawModel(model, VECTOR3_ZERO, 1.0f, WHITE);
 }
 
 void editor_draw_ui() {
-	Arena strings_arena = {0};
-	Arena ui_arena = {0};
+	/* Everything here only lives for the frame */
+	TempArena strings_scratch = scratch_begin(NULL, 0);
+	Arena* strings_arena = strings_scratch.arena;
+	TempArena ui_scratch = scratch_begin(&strings_arena, 1);
+	Arena* ui_arena = ui_scratch.arena;
 	UICommandContext context = {0};
 	UIRegionParameters params = {
 		.background_color = SKYBLUE,
@@ -137,25 +149,25 @@ void editor_draw_ui() {
 
 	Rectangle screen_rect = { .height = GetScreenHeight(), .width = GetScreenWidth(), .x = 0.0f, .y = 0.0f };
 	
-	imui_region_begin(&ui_arena, &context, screen_rect, IMDIR_VERTICAL, (UIRegionParameters){.vertical_spacing = 15.0f, .horizontal_spacing = 15.0f});
+	imui_region_begin(ui_arena, &context, screen_rect, IMDIR_VERTICAL, (UIRegionParameters){.vertical_spacing = 15.0f, .horizontal_spacing = 15.0f});
 
-		imui_draw_fps(&ui_arena, &context);
+		imui_draw_fps(ui_arena, &context);
 
 		Rectangle panel_rect = { .height = 320.0f, .width = 320.0f, .x = 15.0f, .y = 45.0f };
 
-		imui_region_begin(&ui_arena, &context, panel_rect, IMDIR_VERTICAL, params);
-			imui_draw_text(&ui_arena, &context, (String) {"Objects", sizeof("Objects")}, RAYWHITE, 1.0f, 16.0f);
+		imui_region_begin(ui_arena, &context, panel_rect, IMDIR_VERTICAL, params);
+			imui_draw_text(ui_arena, &context, (String) {"Objects", sizeof("Objects")}, RAYWHITE, 1.0f, 16.0f);
 
-			imui_draw_padding(&ui_arena, &context, 5);
+			imui_draw_padding(ui_arena, &context, 5);
 
-			StringArray models = fs_get_files_in_dir(&strings_arena, (String) {"assets/models", sizeof("assets/models") - 1});
+			StringArray models = fs_get_files_in_dir(strings_arena, (String) {"assets/models", sizeof("assets/models") - 1});
 			String model_postfix = {.str = ".obj", .length = sizeof(".obj") - 1};
 
 			for (int i = 0; i < models.len; i++) {
 				String current = models.strings[i];
 
 				if (string_ends_with(current, model_postfix)) {
-					imui_draw_button(&ui_arena, &context,
+					imui_draw_button(ui_arena, &context,
 						current,
 						Fade(SKYBLUE, 0.5f),  /* Default color */
 						Fade(BLUE, 0.5f),     /* Hover color */
@@ -164,33 +176,167 @@ void editor_draw_ui() {
 						5.0f,                  /* Internal padding */
 						(Vector2) { panel_rect.width - ((float)params.horizontal_spacing * 2), 0.0f}
 					);
-					imui_draw_padding(&ui_arena, &context, 5);
+					imui_draw_padding(ui_arena, &context, 5);
 				}
 			}
-		imui_region_end(&ui_arena, &context);
+		imui_region_end(ui_arena, &context);
 
-	imui_region_end(&ui_arena, &context);
+	imui_region_end(ui_arena, &context);
 
 	imui_context_render(context);
-	arena_free(&ui_arena);
-	arena_free(&strings_arena);
+	scratch_end(ui_scratch);
+	scratch_end(strings_scratch);
 }
 
+/* Toggled with F3 in the editor */
+global bool editor_show_memory_overlay = false;
+
+/**
+* Formats a byte count into a short human readable string. The result lives in raylib's TextFormat buffer,
+* so it's only valid until the next few TextFormat calls.
+*/
+const char* editor_format_bytes(i64 bytes) {
+	if (bytes >= (1LL << 30)) { return TextFormat("%.1fG", (f64)bytes / (f64)(1LL << 30)); }
+	if (bytes >= (1LL << 20)) { return TextFormat("%.1fM", (f64)bytes / (f64)(1LL << 20)); }
+	if (bytes >= (1LL << 10)) { return TextFormat("%.1fK", (f64)bytes / (f64)(1LL << 10)); }
+	return TextFormat("%lldB", bytes);
+}
+
+/**
+* Draws every arena in the registry with its reserved, committed and allocated bytes (current / peak),
+* and how many commit/decommit syscalls it has made. Dead arenas are greyed out, so an arena that
+* stays white after its owner should have freed it is a leak.
+*/
+void editor_draw_memory_overlay() {
+	const int font_size = 10;
+	const int line_height = 14;
+	const int width = 620;
+	int x = GetScreenWidth() - width - 10;
+	int y = 10;
+	int height = (arena_registry.slot_count + 3) * line_height + 10;
+
+	DrawRectangle(x, y, width, height, Fade(BLACK, 0.7f));
+	DrawRectangleLines(x, y, width, height, RAYWHITE);
+
+	int line_y = y + 5;
+	DrawText(TextFormat("Arenas: %d   commits: %llu   decommits: %llu", arena_registry.slot_count, arena_registry.total_commit_calls, arena_registry.total_decommit_calls), x + 5, line_y, font_size, RAYWHITE);
+	line_y += line_height;
+
+	DrawText("name",                 x + 5,   line_y, font_size, LIGHTGRAY);
+	DrawText("reserved",             x + 150, line_y, font_size, LIGHTGRAY);
+	DrawText("committed / peak",     x + 225, line_y, font_size, LIGHTGRAY);
+	DrawText("allocated / peak",     x + 345, line_y, font_size, LIGHTGRAY);
+	DrawText("commits / decommits",  x + 465, line_y, font_size, LIGHTGRAY);
+	line_y += line_height;
+
+	for (int i = 0; i < arena_registry.slot_count; i++) {
+		ArenaStats stats = arena_registry.slots[i];
+		Color color = stats.is_live ? RAYWHITE : GRAY;
+
+		/* Each TextFormat call reuses a ring of buffers, so draw each column before formatting the next */
+		DrawText(stats.name, x + 5, line_y, font_size, color);
+		DrawText(editor_format_bytes(stats.reserved_bytes), x + 150, line_y, font_size, color);
+		DrawText(editor_format_bytes(stats.committed_bytes), x + 225, line_y, font_size, color);
+		DrawText(editor_format_bytes(stats.peak_committed_bytes), x + 285, line_y, font_size, color);
+		DrawText(editor_format_bytes(stats.allocated_bytes), x + 345, line_y, font_size, color);
+		DrawText(editor_format_bytes(stats.peak_allocated_bytes), x + 405, line_y, font_size, color);
+		DrawText(TextFormat("%llu / %llu", stats.commit_calls, stats.decommit_calls), x + 465, line_y, font_size, color);
+		line_y += line_height;
+	}
+}
+
+/* Toggled with F4 in the editor */
+global bool editor_show_spacial_hash_overlay = false;
+
+/**
+* The spacial hash's cell width and what the tuner picked it from, and how many cells hold how many entries.
+* Each histogram row is a power of two range of entry counts, the bar is its share of the occupied cells.
+*/
+void editor_draw_spacial_hash_overlay(const FrameState* state) {
+	const int font_size = 10;
+	const int line_height = 14;
+	const int width = 360;
+	const int bar_width = 200;
+	int height = (SPACIAL_HASH_HISTOGRAM_SIZE + 5) * line_height + 10;
+	int x = 10;
+	int y = GetScreenHeight() - height - 10;
+
+	const SpacialHash* spacial_hash = &state->spacial_hash;
+	const SpacialHashTuner* tuner = &state->spacial_hash_tuner;
+	if (spacial_hash->cells == NULL) { return; }
+
+	i64 buckets[SPACIAL_HASH_HISTOGRAM_SIZE];
+	collision_spacial_hash_occupancy_histogram(spacial_hash, buckets);
+	i64 occupied = 0;
+	for (int i = 1; i < SPACIAL_HASH_HISTOGRAM_SIZE; i++) { occupied += buckets[i]; }
+
+	DrawRectangle(x, y, width, height, Fade(BLACK, 0.7f));
+	DrawRectangleLines(x, y, width, height, RAYWHITE);
+
+	int line_y = y + 5;
+	DrawText(TextFormat("Spacial hash (%s): cell %.2f   %d x %d cells   %d slots",
+		(spacial_hash->mode == SPACIAL_HASH_DENSE) ? "dense" : "sparse", (f64)spacial_hash->cell_width,
+		spacial_hash->x_axis_cell_count, spacial_hash->z_axis_cell_count, spacial_hash->slot_count), x + 5, line_y, font_size, RAYWHITE);
+	line_y += line_height;
+	DrawText(TextFormat("tuned %.2f from median extent %.2f, %.3f triangles / unit^2 (%d sampled)",
+		(f64)tuner->tuning.cell_width, (f64)tuner->tuning.median_triangle_extent, (f64)tuner->tuning.triangle_density, tuner->tuning.sampled_triangle_count), x + 5, line_y, font_size, LIGHTGRAY);
+	line_y += line_height;
+	DrawText(TextFormat("online: %.2f entries / query cell   %llu queries pending   %d retunes",
+		(f64)tuner->entries_per_cell, tuner->stats.query_count, tuner->retune_count), x + 5, line_y, font_size, LIGHTGRAY);
+	line_y += line_height;
+	DrawText(TextFormat("empty cells %lld   occupied %lld", buckets[0], occupied), x + 5, line_y, font_size, LIGHTGRAY);
+	line_y += line_height;
+
+	for (int i = 1; i < SPACIAL_HASH_HISTOGRAM_SIZE; i++) {
+		int low = 1 << (i - 1);
+		const char* label = (i == SPACIAL_HASH_HISTOGRAM_SIZE - 1) ? TextFormat("%d+", low)
+			: (low == 1) ? "1" : TextFormat("%d-%d", low, (low * 2) - 1);
+		DrawText(label, x + 5, line_y, font_size, RAYWHITE);
+
+		f32 share = (occupied > 0) ? (f32)buckets[i] / (f32)occupied : 0.0f;
+		DrawRectangle(x + 70, line_y + 1, (int)(share * bar_width), font_size - 2, SKYBLUE);
+		DrawText(TextFormat("%lld", buckets[i]), x + 75 + bar_width, line_y, font_size, RAYWHITE);
+		line_y += line_height;
+	}
+}
+
+/**
+* Tick rate, how many steps the drawn frame ran and how often the spiral of death guard kicked in.
+* Also how long the simulation thread took for the drawn frame, and how long the main thread waited on it.
+*/
+void editor_draw_simulation_stats(const FixedStepClock* clock, const FrameState* state, u64 wait_ns) {
+	const int font_size = 10;
+	int x = 10;
+	int y = 30;
+
+	DrawText(TextFormat("sim %.0f Hz   steps %d   avg %.2f   alpha %.2f",
+		1.0 / (f64)fixed_step_clock_step_seconds(clock), state->steps, (f64)clock->steps_per_frame_average, (f64)state->alpha),
+		x, y, font_size, RAYWHITE);
+	DrawText(TextFormat("clamped frames %llu   dropped %.1fms", clock->clamped_frame_count, (f64)clock->dropped_ns / 1e6),
+		x, y + 14, font_size, (clock->clamped_frame_count > 0) ? ORANGE : RAYWHITE);
+	DrawText(TextFormat("sim thread %.2fms   waited %.2fms", (f64)state->produce_ns / 1e6, (f64)wait_ns / 1e6),
+		x, y + 28, font_size, RAYWHITE);
+}
+
+/* Draws a frame the simulation published. render_matrices are its interpolated world matrices, see entity_snapshot_interpolate. */
 void editor_loop(
 	Camera*               main_camera,
-	StaticObjectArray     static_objects,
+	const FrameState*     state,
+	const Matrix*         render_matrices,
 	const Model*          model_prefabs,
-	TriangleColliderArray optional_render_colliders,
-	SpacialHash           optional_render_spacial_hash
+	const FixedStepClock* clock,
+	u64                   pipeline_wait_ns
 ) {
-	update_editor_camera(main_camera);
+	const EntitySnapshot* entities = &state->entities;
+	TriangleColliderArray optional_render_colliders = state->colliders;
+	SpacialHash optional_render_spacial_hash = state->spacial_hash;
+
 	BeginDrawing();
 		ClearBackground(BLACK);
 
 		BeginMode3D(*main_camera);
-			for (int i = 0; i < static_objects.len; i++) {
-				StaticObject current_object = static_objects.objects[i];
-				draw_model(current_object.id, model_prefabs, current_object.transform);
+			for (int i = 0; i < entities->count; i++) {
+				draw_model(entities->visible_model_ids[i], model_prefabs, render_matrices[i]);
 			}
 
 			for (int i = 0; i < optional_render_colliders.length; i++) {
@@ -203,17 +349,17 @@ void editor_loop(
 			if (optional_render_spacial_hash.cells != NULL) {
 				SpacialHash spacial_hash = optional_render_spacial_hash;
 
-				for (int z = 0; z < spacial_hash.z_axis_cell_count; z++) {
-					for (int x = 0; x < spacial_hash.x_axis_cell_count; x++) {
-						if (spacial_hash.cells[(spacial_hash.x_axis_cell_count * z) + x].list != NULL) {
-							Vector3 position = {
-								.x = x * spacial_hash.cell_width + spacial_hash.world_bounding_box.min.x + (spacial_hash.cell_width / 2.0f),
-								.y = 0,
-								.z = z * spacial_hash.cell_width + spacial_hash.world_bounding_box.min.z + (spacial_hash.cell_width / 2.0f)
-							};
-		
-							DrawCubeWires(position, spacial_hash.cell_width, 100.0f, spacial_hash.cell_width, LIGHTGRAY);
-						}
+				/* Only the slots, so a sparse hash over a huge world doesn't walk every empty cell */
+				for (int slot = 0; slot < spacial_hash.slot_count; slot++) {
+					if (spacial_hash.cells[slot].count > 0) {
+						SpaceCellKey key = collision_spacial_hash_slot_key(&spacial_hash, slot);
+						Vector3 position = {
+							.x = key.x * spacial_hash.cell_width + spacial_hash.world_bounding_box.min.x + (spacial_hash.cell_width / 2.0f),
+							.y = 0,
+							.z = key.z * spacial_hash.cell_width + spacial_hash.world_bounding_box.min.z + (spacial_hash.cell_width / 2.0f)
+						};
+
+						DrawCubeWires(position, spacial_hash.cell_width, 100.0f, spacial_hash.cell_width, LIGHTGRAY);
 					}
 				}
 				
@@ -239,12 +385,44 @@ void editor_loop(
 		#endif
 
 		test_example();
+
+		if (editor_show_memory_overlay) { editor_draw_memory_overlay(); }
+		if (editor_show_spacial_hash_overlay) { editor_draw_spacial_hash_overlay(state); }
+
+		editor_draw_simulation_stats(clock, state, pipeline_wait_ns);
 	EndDrawing();
 }
 
 #ifndef REGION_DONT_CARE
-void update_game_camera(Camera* camera) {
-	Vector2 mousePositionDelta = GetMouseDelta();
+/* Units per second, the player doesn't speed up while falling */
+#define GAME_PLAYER_FALL_SPEED 10.0f
+#define GAME_PLAYER_RADIUS 0.4f
+#define GAME_PLAYER_HEIGHT 1.8f
+
+/* WASD walks the player relative to where the camera looks, and the camera follows it */
+void update_game_player(Camera* camera, const InputFrame* input, CharacterController* player, const SpacialHash* spacial_hash) {
+	Vector3 forward = Vector3Subtract(camera->target, camera->position);
+	forward.y = 0.0f;
+	forward = (Vector3LengthSqr(forward) > EPSILON) ? Vector3Normalize(forward) : VECTOR3_FORWARD;
+	Vector3 right = Vector3CrossProduct(forward, VECTOR3_UP);
+
+	Vector3 walk = VECTOR3_ZERO;
+	if (input_key_down(input, INPUT_KEY_W)) walk = Vector3Add(walk, forward);
+	if (input_key_down(input, INPUT_KEY_S)) walk = Vector3Subtract(walk, forward);
+	if (input_key_down(input, INPUT_KEY_D)) walk = Vector3Add(walk, right);
+	if (input_key_down(input, INPUT_KEY_A)) walk = Vector3Subtract(walk, right);
+	if (Vector3LengthSqr(walk) > EPSILON) { walk = Vector3Scale(Vector3Normalize(walk), CAMERA_MOVE_SPEED * input->delta_seconds); }
+	walk.y = -GAME_PLAYER_FALL_SPEED * input->delta_seconds;
+
+	Vector3 from = player->position;
+	character_controller_move(player, spacial_hash, walk);
+	Vector3 moved = Vector3Subtract(player->position, from);
+	camera->position = Vector3Add(camera->position, moved);
+	camera->target = Vector3Add(camera->target, moved);
+}
+
+void update_game_camera(Camera* camera, const InputFrame* input) {
+	Vector2 mousePositionDelta = input->mouse_delta;
 
 	#ifdef UNUSED
 		bool moveInWorldPlane = true;
@@ -255,43 +433,38 @@ void update_game_camera(Camera* camera) {
 	bool rotateUp = false;
 
 	// Camera speeds based on frame time
-	float cameraRotationSpeed = CAMERA_ROTATION_SPEED*GetFrameTime();
+	float cameraRotationSpeed = CAMERA_ROTATION_SPEED*input->delta_seconds;
 
 	#ifdef UNUSED
-		float cameraMoveSpeed = CAMERA_MOVE_SPEED*GetFrameTime();
-		float cameraPanSpeed = CAMERA_PAN_SPEED*GetFrameTime();
-		float cameraOrbitalSpeed = CAMERA_ORBITAL_SPEED*GetFrameTime();
+		float cameraMoveSpeed = CAMERA_MOVE_SPEED*input->delta_seconds;
+		float cameraPanSpeed = CAMERA_PAN_SPEED*input->delta_seconds;
+		float cameraOrbitalSpeed = CAMERA_ORBITAL_SPEED*input->delta_seconds;
 	#endif
 
 	// Camera rotation
-	if (IsKeyDown(KEY_DOWN)) CameraPitch(camera, -cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
-	if (IsKeyDown(KEY_UP)) CameraPitch(camera, cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
-	if (IsKeyDown(KEY_RIGHT)) CameraYaw(camera, -cameraRotationSpeed, rotateAroundTarget);
-	if (IsKeyDown(KEY_LEFT)) CameraYaw(camera, cameraRotationSpeed, rotateAroundTarget);
-	if (IsKeyDown(KEY_Q)) CameraRoll(camera, -cameraRotationSpeed);
-	if (IsKeyDown(KEY_E)) CameraRoll(camera, cameraRotationSpeed);
+	if (input_key_down(input, INPUT_KEY_DOWN)) CameraPitch(camera, -cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
+	if (input_key_down(input, INPUT_KEY_UP)) CameraPitch(camera, cameraRotationSpeed, lockView, rotateAroundTarget, rotateUp);
+	if (input_key_down(input, INPUT_KEY_RIGHT)) CameraYaw(camera, -cameraRotationSpeed, rotateAroundTarget);
+	if (input_key_down(input, INPUT_KEY_LEFT)) CameraYaw(camera, cameraRotationSpeed, rotateAroundTarget);
+	if (input_key_down(input, INPUT_KEY_Q)) CameraRoll(camera, -cameraRotationSpeed);
+	if (input_key_down(input, INPUT_KEY_E)) CameraRoll(camera, cameraRotationSpeed);
 
 	// Mouse support
-	if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+	if (input_key_down(input, INPUT_KEY_MOUSE_RIGHT)) {
 		CameraYaw(camera, -mousePositionDelta.x*CAMERA_MOUSE_MOVE_SENSITIVITY, rotateAroundTarget);
 		CameraPitch(camera, -mousePositionDelta.y*CAMERA_MOUSE_MOVE_SENSITIVITY, lockView, rotateAroundTarget, rotateUp);
 	}
 
-	// Keyboard support
-	if (IsKeyDown(KEY_W)) camera->position = Vector3Add(camera->target, VECTOR3_FORWARD);
-	if (IsKeyDown(KEY_A)) camera->position = Vector3Add(camera->target, VECTOR3_LEFT);
-	if (IsKeyDown(KEY_S)) camera->position = Vector3Add(camera->target, VECTOR3_BACKWARD);
-	if (IsKeyDown(KEY_D)) camera->position = Vector3Add(camera->target, VECTOR3_RIGHT);
-
-	CameraMoveToTarget(camera, -GetMouseWheelMove());
-	if (IsKeyPressed(KEY_KP_SUBTRACT)) CameraMoveToTarget(camera, 2.0f);
-	if (IsKeyPressed(KEY_KP_ADD)) CameraMoveToTarget(camera, -2.0f);
+	CameraMoveToTarget(camera, -input->mouse_wheel);
+	if (input_key_pressed(input, INPUT_KEY_KP_SUBTRACT)) CameraMoveToTarget(camera, 2.0f);
+	if (input_key_pressed(input, INPUT_KEY_KP_ADD)) CameraMoveToTarget(camera, -2.0f);
 }
 
-void main_game_loop(Camera* main_camera) {
+void main_game_loop(Camera* main_camera, const InputFrame* input, CharacterController* player, const SpacialHash* spacial_hash) {
 	DrawCube(main_camera->target, 0.5f, 0.5f, 0.5f, PURPLE);
 	DrawCubeWires(main_camera->target, 0.5f, 0.5f, 0.5f, DARKPURPLE);
-	update_game_camera(main_camera);
+	update_game_camera(main_camera, input);
+	update_game_player(main_camera, input, player, spacial_hash);
 
 	BeginDrawing();
 		DrawFPS(15, 15);
@@ -354,49 +527,290 @@ void initialize_models(Model* model_prefabs, int model_count) {
 }
 
 /**
-* Static objects will be initialized on scene load. This is a temporary function for test purposes.
+* Entities will be created on scene load. This is a temporary function for test purposes.
 */
-StaticObjectArray test_initialize_static_objects(Arena* static_object_data) {
-	int object_count = 3;
-	StaticObject* object_array = arena_alloc(static_object_data, sizeof(*object_array) * object_count);
-
-	object_array[0] = (StaticObject) {
-		.id = MODEL_BOX,
+void test_initialize_entities(EntityStore* store) {
+	Entity entity = {
+		.collider_model_id = MODEL_BOX,
+		.visible_model_id = MODEL_BOX,
 		.layer = MASK_STATIC_GEOMETRY,
 		.transform = default_transform(),
 	};
-	object_array[0].transform.translation = (Vector3) {2.0f, 0.0f, 0.0f};
+	entity.transform.translation = (Vector3) {2.0f, 0.0f, 0.0f};
+	entity_create(store, entity);
+
+	entity.transform.translation = (Vector3) {0.0f, 0.0f, -3.0f};
+	entity.transform.scale = (Vector3) {1.0f, 2.0f, 1.0f};
+	entity_create(store, entity);
 
-	object_array[1] = (StaticObject) {
-		.id = MODEL_BOX,
+	entity = (Entity) {
+		.collider_model_id = MODEL_TORUS,
+		.visible_model_id = MODEL_TORUS,
 		.layer = MASK_STATIC_GEOMETRY,
 		.transform = default_transform(),
 	};
-	
-	object_array[1].transform.translation = (Vector3) {0.0f, 0.0f, -3.0f};
-	object_array[1].transform.scale = (Vector3) {1.0f, 2.0f, 1.0f};
-	
-	object_array[2] = (StaticObject) {
-		.id = MODEL_TORUS,
+	entity.entity_type = ENTITY_TYPE_SPINNER;
+	entity.transform.translation = (Vector3) {-15.0f,-3.0f,-3.0f,};
+	EntityHandle torus = entity_create(store, entity);
+
+	/* Rides along with the torus */
+	entity = (Entity) {
+		.collider_model_id = MODEL_BOX,
+		.visible_model_id = MODEL_BOX,
 		.layer = MASK_STATIC_GEOMETRY,
 		.transform = default_transform(),
+		.parent = torus,
 	};
+	entity.transform.translation = (Vector3) {0.0f, 3.0f, 0.0f};
+	entity.transform.scale = (Vector3) {0.5f, 0.5f, 0.5f};
+	entity_create(store, entity);
+}
 
-	object_array[2].transform.translation = (Vector3) {-15.0f,-3.0f,-3.0f,};
+/* Radians per second for ENTITY_TYPE_SPINNER */
+#define SIM_SPINNER_SPEED 1.5f
 
-	return (StaticObjectArray) {
-		.objects = object_array,
-		.len = object_count
-	};
+/**
+* Everything the simulation thread works with (see FramePipeline in simulation.c). Nothing else touches the entity store.
+*
+* The step scheduler runs once per fixed step, zero or more times a frame. The publish scheduler runs once at the end
+* of every frame and builds what gets drawn into the frame state's arena.
+*/
+typedef struct EditorSimulation {
+	EntityStore* entities;
+	const Model* model_prefabs;
+	f32 step_seconds;
+
+	/* The frame state being produced */
+	FrameState* state;
+
+	SystemScheduler step_scheduler;
+	SystemScheduler publish_scheduler;
+
+	/* Picks the spacial hash's cell width, and keeps adjusting it from the queries made against it */
+	SpacialHashTuner spacial_hash_tuner;
+} EditorSimulation;
+
+/**
+* Everything the main thread's systems share while drawing a frame.
+*/
+typedef struct EditorFrame {
+	Camera* camera;
+	const Model* model_prefabs;
+	const FixedStepClock* clock;
+	const FramePipeline* pipeline;
+
+	/* Swapped in every frame */
+	const InputFrame* input;
+	FrameState* state;
+	const Matrix* render_matrices;
+	/* Nothing gets drawn, see AfterhoursOptions */
+	bool headless;
+} EditorFrame;
+
+void editor_spinner_system(void* user_data) {
+	EditorSimulation* simulation = user_data;
+	EntityStore* store = simulation->entities;
+	Quaternion turn = QuaternionFromAxisAngle(VECTOR3_UP, SIM_SPINNER_SPEED * simulation->step_seconds);
+
+	for (int i = 0; i < store->count; i++) {
+		if (store->entity_types[i] != ENTITY_TYPE_SPINNER) continue;
+
+		Transform transform = store->transforms[i];
+		transform.rotation = QuaternionNormalize(QuaternionMultiply(transform.rotation, turn));
+		entity_set_transform(store, store->handles[i], transform);
+	}
+}
+
+void editor_hierarchy_system(void* user_data) {
+	EditorSimulation* simulation = user_data;
+	entity_store_update_hierarchy(simulation->entities);
+}
+
+void editor_collider_system(void* user_data) {
+	EditorSimulation* simulation = user_data;
+	FrameState* state = simulation->state;
+	state->colliders = entity_collider_loop(&state->arena, simulation->entities, simulation->model_prefabs, &state->collider_bounds);
+}
+
+void editor_spacial_hash_system(void* user_data) {
+	EditorSimulation* simulation = user_data;
+	FrameState* state = simulation->state;
+	/**
+	* The main thread queries the newest complete state while this one is produced, so each state counts its own queries.
+	* This state was handed back by frame_pipeline_swap, nothing queries its old hash anymore.
+	*/
+	collision_spacial_hash_tuner_collect(&simulation->spacial_hash_tuner, &state->spacial_hash_query_stats);
+	collision_spacial_hash_tuner_update(&simulation->spacial_hash_tuner);
+	state->spacial_hash = collision_spacial_hash_create_tuned(&state->arena, &simulation->spacial_hash_tuner, state->colliders, state->collider_bounds);
+	state->spacial_hash.query_stats = &state->spacial_hash_query_stats;
+	state->spacial_hash_tuner = simulation->spacial_hash_tuner;
+}
+
+/* FrameProduceProc, runs on the simulation thread */
+void editor_simulate_frame(void* user_data, FrameState* state) {
+	EditorSimulation* simulation = user_data;
+	simulation->state = state;
+
+	for (int step = 0; step < state->steps; step++) {
+		scheduler_run(&simulation->step_scheduler);
+	}
+	scheduler_run(&simulation->publish_scheduler);
+	state->entities = entity_snapshot_take(&state->arena, simulation->entities);
+}
+
+void editor_camera_system(void* user_data) {
+	EditorFrame* frame = user_data;
+	update_editor_camera(frame->camera, frame->input);
+}
+
+void editor_interpolate_system(void* user_data) {
+	EditorFrame* frame = user_data;
+	frame->render_matrices = entity_snapshot_interpolate(&frame->state->entities, frame->state->alpha);
+}
+
+void editor_draw_system(void* user_data) {
+	EditorFrame* frame = user_data;
+	editor_loop(frame->camera, frame->state, frame->render_matrices, frame->model_prefabs, frame->clock, frame->pipeline->last_wait_ns);
+}
+
+void editor_add_simulation_systems(EditorSimulation* simulation) {
+	scheduler_add_system(&simulation->step_scheduler, (System) {
+		.name = "spinners",
+		.proc = editor_spinner_system,
+		.user_data = simulation,
+		.reads = COMPONENT_ENTITY_TYPE,
+		.writes = COMPONENT_TRANSFORM,
+	});
+	scheduler_add_system(&simulation->step_scheduler, (System) {
+		.name = "transform_hierarchy",
+		.proc = editor_hierarchy_system,
+		.user_data = simulation,
+		.reads = COMPONENT_TRANSFORM,
+		.writes = COMPONENT_HIERARCHY | COMPONENT_WORLD_MATRIX,
+	});
+
+	scheduler_add_system(&simulation->publish_scheduler, (System) {
+		.name = "collider_build",
+		.proc = editor_collider_system,
+		.user_data = simulation,
+		.reads = COMPONENT_WORLD_MATRIX | COMPONENT_COLLIDER_MODEL | COMPONENT_LAYER,
+		.writes = COMPONENT_TRIANGLE_COLLIDERS,
+	});
+	scheduler_add_system(&simulation->publish_scheduler, (System) {
+		.name = "spacial_hash",
+		.proc = editor_spacial_hash_system,
+		.user_data = simulation,
+		.reads = COMPONENT_TRIANGLE_COLLIDERS,
+		.writes = COMPONENT_SPACIAL_HASH,
+	});
+}
+
+/* Runs once per frame on the main thread, drawing the newest state the simulation published */
+void editor_add_render_systems(SystemScheduler* scheduler, EditorFrame* frame) {
+	scheduler_add_system(scheduler, (System) {
+		.name = "editor_camera",
+		.proc = editor_camera_system,
+		.user_data = frame,
+		.writes = COMPONENT_CAMERA,
+	});
+	scheduler_add_system(scheduler, (System) {
+		.name = "interpolate",
+		.proc = editor_interpolate_system,
+		.user_data = frame,
+		.reads = COMPONENT_TRANSFORM | COMPONENT_HIERARCHY | COMPONENT_WORLD_MATRIX,
+		.writes = COMPONENT_RENDER_MATRIX,
+	});
+	if (frame->headless) return;
+
+	scheduler_add_system(scheduler, (System) {
+		.name = "editor_draw",
+		.proc = editor_draw_system,
+		.user_data = frame,
+		.reads = COMPONENT_ALL,
+		.flags = SYSTEM_FLAG_MAIN_THREAD,
+	});
+}
+
+/* Address space only, per frame state and there are FRAME_STATE_COUNT of them. Touched densely every frame, so they get huge pages. */
+#define FRAME_STATE_ARENA_RESERVATION (1024ULL * 1024 * 1024)
+/* Address space only. A replay is loaded whole, so this is the biggest recording that can be played. */
+#define REPLAY_ARENA_RESERVATION      (1024ULL * 1024 * 1024)
+
+typedef struct FrameTraceEntry {
+	/* From after polling input to the end of the frame. With a window that includes waiting for SetTargetFPS. */
+	u64 frame_ns;
+	int steps;
+} FrameTraceEntry;
+
+/* About 19 hours at 60 fps, later frames aren't traced. The trace array doubles in place up to exactly this. */
+#define FRAME_TRACE_MAX_FRAMES        (1 << 22)
+#define FRAME_TRACE_ARENA_RESERVATION ((u64)FRAME_TRACE_MAX_FRAMES * sizeof(FrameTraceEntry))
+
+/* Per frame timings of a session, for comparing runs of the same recording */
+typedef struct FrameTrace {
+	FrameTraceEntry* frames;
+	int length;
+	int capacity;
+} FrameTrace;
+
+typedef struct AfterhoursOptions {
+	const char* record_path; /* Writes every frame's input to this file */
+	const char* replay_path; /* Plays this recording instead of reading input, then exits */
+	const char* trace_path;  /* Writes frame times as CSV on exit */
+	bool headless;           /* No window and no drawing. Needs replay_path, there would be no input otherwise. */
+
+	/* Optional, frame times get appended here instead of the trace written to trace_path. Grows in trace_arena. */
+	FrameTrace* trace;
+	Arena* trace_arena;
+} AfterhoursOptions;
+
+/* afterhours.exe [--record path] [--replay path] [--trace path] [--headless] */
+AfterhoursOptions afterhours_parse_args(int argc, char** argv) {
+	AfterhoursOptions options = {0};
+	for (int i = 1; i < argc; i++) {
+		String arg = string_null_to_length_terminated(argv[i]);
+		bool has_value = (i + 1 < argc);
+
+		if      (has_value && string_eq(arg, string_null_to_length_terminated("--record"))) { options.record_path = argv[++i]; }
+		else if (has_value && string_eq(arg, string_null_to_length_terminated("--replay"))) { options.replay_path = argv[++i]; }
+		else if (has_value && string_eq(arg, string_null_to_length_terminated("--trace")))  { options.trace_path  = argv[++i]; }
+		else if (string_eq(arg, string_null_to_length_terminated("--headless")))            { options.headless    = true; }
+		else {
+			printf("Unknown or incomplete argument: %s\n", argv[i]);
+		}
+	}
+	return options;
 }
 
-int afterhours_main(void) {
+bool afterhours_write_trace(const char* path, const FrameTrace* trace) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) return false;
+
+	fprintf(file, "frame,frame_ns,steps\n");
+	for (int i = 0; i < trace->length; i++) {
+		fprintf(file, "%d,%llu,%d\n", i, (unsigned long long)trace->frames[i].frame_ns, trace->frames[i].steps);
+	}
+	fclose(file);
+	return true;
+}
+
+int afterhours_main(AfterhoursOptions options) {
 	const int screenWidth = 1600;
 	const int screenHeight = 900;
 
-	InitWindow(screenWidth, screenHeight, "Afterengine");
-	SetTargetFPS(60);
-	SetExitKey(0); /* Disables ESC = exit */
+	if (options.headless && options.replay_path == NULL) {
+		printf("--headless needs --replay\n");
+		return 1;
+	}
+
+	if (options.headless) {
+		/* Every model load would warn about the missing GPU */
+		SetTraceLogLevel(LOG_ERROR);
+	} else {
+		InitWindow(screenWidth, screenHeight, "Afterengine");
+		SetTargetFPS(60);
+		SetExitKey(0); /* Disables ESC = exit */
+	}
 
 
 	Camera3D main_camera = { 
@@ -408,23 +822,94 @@ int afterhours_main(void) {
 	};
 
 	loop_mode = GAMELOOP_EDITOR;
+	/* Walks around in GAMELOOP_GAME, standing where the camera looks */
+	CharacterController player = character_controller_create(main_camera.target, GAME_PLAYER_RADIUS, GAME_PLAYER_HEIGHT, MASK_STATIC_GEOMETRY);
 
 	/* The arena brothers */
-	Arena scene_arena = {0};         /* Stores all data related to the current scene. Static objects, lighting data, etc. Mainly things that don't change. */
-	Arena collider_data_arena = {0}; /* Stores all collider data for the current frame. Gets reset every frame. */
-	Arena model_data_arena = {0};    /* Stores all loadable models preloaded for future use */
-
+	/* Stores all loadable models preloaded for future use */
+	Arena model_data_arena = { .name = "model_data" };
+	/* The recording being replayed */
+	Arena replay_arena = { .name = "replay", .total_reserved_bytes = REPLAY_ARENA_RESERVATION };
+	/* Frame times, only with --trace. Nothing else goes in it, so the trace grows in place. */
+	Arena trace_arena_storage = { .name = "trace", .total_reserved_bytes = FRAME_TRACE_ARENA_RESERVATION };
+
+	/* Without a window raylib still loads the meshes, it just can't upload them */
 	int model_count = (int)MODEL_ID_COUNT;
 	Model* model_prefabs = arena_alloc(&model_data_arena, sizeof(*model_prefabs) * model_count);
 	initialize_models(model_prefabs, model_count);
 
-	StaticObjectArray so_array = test_initialize_static_objects(&scene_arena);
+	InputReplay replay = {0};
+	if (options.replay_path != NULL && !input_replay_open(&replay, &replay_arena, options.replay_path)) {
+		printf("Could not read input recording %s\n", options.replay_path);
+		options.replay_path = NULL;
+		if (options.headless) return 1;
+	}
+	InputRecorder recorder = {0};
+	if (options.record_path != NULL && !input_recorder_open(&recorder, options.record_path)) {
+		printf("Could not open %s for recording\n", options.record_path);
+	}
+	FrameTrace local_trace = {0};
+	FrameTrace* trace = (options.trace != NULL) ? options.trace : &local_trace;
+	Arena* trace_arena = (options.trace_arena != NULL) ? options.trace_arena : &trace_arena_storage;
+	bool tracing = (options.trace != NULL || options.trace_path != NULL);
+
+	EntityStore entities;
+	entity_store_init(&entities);
+	test_initialize_entities(&entities);
+	/* The first frame draws before any step has run */
+	entity_store_update_hierarchy(&entities);
+
+	/* The simulation ticks at its own rate, independent of SetTargetFPS */
+	FixedStepClock sim_clock = fixed_step_clock_create(SIM_DEFAULT_TICK_RATE, SIM_DEFAULT_MAX_STEPS_PER_FRAME);
+
+	job_system_init(0);
+
+	EditorSimulation simulation = {
+		.entities = &entities,
+		.model_prefabs = model_prefabs,
+		.step_seconds = fixed_step_clock_step_seconds(&sim_clock),
+	};
+	scheduler_init(&simulation.step_scheduler);
+	scheduler_init(&simulation.publish_scheduler);
+	editor_add_simulation_systems(&simulation);
+
+	/* The frame states are the per-frame arenas. They hold this frame's colliders and the snapshot that gets drawn. */
+	FramePipeline pipeline;
+	frame_pipeline_start(&pipeline, FRAME_STATE_ARENA_RESERVATION, editor_simulate_frame, &simulation);
+
+	EditorFrame editor_frame = {
+		.camera = &main_camera,
+		.model_prefabs = model_prefabs,
+		.clock = &sim_clock,
+		.pipeline = &pipeline,
+		.headless = options.headless,
+	};
+	SystemScheduler render_scheduler;
+	scheduler_init(&render_scheduler);
+	editor_add_render_systems(&render_scheduler, &editor_frame);
+
+	u64 session_start = platform_dependent_time_nanoseconds();
+	u64 previous_time = 0;
 
-	while (!WindowShouldClose()) {
-		arena_restore(&collider_data_arena, 0);
+	for (;;) {
+		if (!options.headless && WindowShouldClose()) break;
 
-		if (IsKeyPressed(KEY_ESCAPE)) EnableCursor();
-		if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_P)) {
+		/* Everything below only looks at input, never at raylib's input functions */
+		InputFrame frame_input;
+		if (options.replay_path != NULL) {
+			if (!input_replay_next(&replay, &frame_input)) break;
+		} else {
+			frame_input = input_poll(platform_dependent_time_nanoseconds() - session_start, previous_time);
+		}
+		if (recorder.file != NULL) { input_recorder_write(&recorder, &frame_input); }
+		previous_time = frame_input.time_ns;
+		const InputFrame* input = &frame_input;
+		u64 frame_start = platform_dependent_time_nanoseconds();
+
+		if (input_key_pressed(input, INPUT_KEY_ESCAPE) && !options.headless) EnableCursor();
+		if (input_key_pressed(input, INPUT_KEY_F3)) { editor_show_memory_overlay = !editor_show_memory_overlay; }
+		if (input_key_pressed(input, INPUT_KEY_F4)) { editor_show_spacial_hash_overlay = !editor_show_spacial_hash_overlay; }
+		if (input_key_down(input, INPUT_KEY_LEFT_CONTROL) && input_key_pressed(input, INPUT_KEY_P)) {
 			if (loop_mode == GAMELOOP_GAME) {
 				loop_mode = GAMELOOP_EDITOR;
 				main_camera.projection = CAMERA_PERSPECTIVE;
@@ -432,28 +917,57 @@ int afterhours_main(void) {
 				loop_mode = GAMELOOP_GAME;
 				main_camera.projection = CAMERA_PERSPECTIVE;
 				main_camera.position = (Vector3){ 10.0f, 10.0f, 10.0f }; // Camera position
+				player = character_controller_create(main_camera.target, GAME_PLAYER_RADIUS, GAME_PLAYER_HEIGHT, MASK_STATIC_GEOMETRY);
 			}
 		}
+		int steps = 0;
 		if (loop_mode == GAMELOOP_EDITOR) {
-			TriangleColliderArray static_colliders = static_object_loop(&collider_data_arena, so_array, model_prefabs);
-			SpacialHash collider_spacial_hash = collision_spacial_hash_create(&collider_data_arena, static_colliders);
-			editor_loop(
-				&main_camera,
-				so_array,
-				model_prefabs,
-				static_colliders,
-				collider_spacial_hash
-			);
+			/* Recorded time, so a replay runs exactly the steps the recording did */
+			steps = fixed_step_clock_advance(&sim_clock, input->time_ns);
+			/* Simulates the next frame in the background while this one gets drawn */
+			editor_frame.input = input;
+			editor_frame.state = frame_pipeline_swap(&pipeline, steps, fixed_step_clock_alpha(&sim_clock));
+			scheduler_run(&render_scheduler);
 		} else {
-			main_game_loop(&main_camera);
+			/* The game doesn't swap frames. A frame still in flight goes into the other state, so nothing else touches this one. */
+			const SpacialHash* spacial_hash = &pipeline.states[pipeline.completed].spacial_hash;
+			if (!options.headless) {
+				main_game_loop(&main_camera, input, &player, spacial_hash);
+			} else {
+				update_game_camera(&main_camera, input);
+				update_game_player(&main_camera, input, &player, spacial_hash);
+			}
+		}
+
+		if (tracing && trace->length < FRAME_TRACE_MAX_FRAMES) {
+			*arena_array_push(trace_arena, trace->frames, trace->length, trace->capacity) = (FrameTraceEntry) {
+				.frame_ns = platform_dependent_time_nanoseconds() - frame_start,
+				.steps = steps,
+			};
 		}
-		
 	}
 
 	// De-Initialization
 	//--------------------------------------------------------------------------------------
-	CloseWindow();		// Close window and OpenGL context
+	if (options.trace_path != NULL && !afterhours_write_trace(options.trace_path, trace)) {
+		printf("Could not write frame trace to %s\n", options.trace_path);
+	}
+	input_recorder_close(&recorder);
+
+	scheduler_destroy(&render_scheduler);
+	frame_pipeline_stop(&pipeline);
+	scheduler_destroy(&simulation.publish_scheduler);
+	scheduler_destroy(&simulation.step_scheduler);
+	job_system_shutdown();
+	entity_store_free(&entities);
+	arena_free(&model_data_arena);
+	arena_free(&replay_arena);
+	arena_free(&trace_arena_storage);
+
+	if (!options.headless) {
+		CloseWindow();		// Close window and OpenGL context
+	}
 	//--------------------------------------------------------------------------------------
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -13,5 +13,6 @@
 	#endif
 
 	#include "math.h"
+	#include "entities.h"
 	#include "collision.h"
 #endif
\ No newline at end of file
@@ -0,0 +1,2006 @@
+/**
+* Headless benchmark suite.
+*
+* Nothing in here opens a window or touches the GPU, so it runs on CI machines without a display.
+* Synthetic scenes are generated from a seed, so two runs with the same arguments time the same work.
+*
+* Usage: bench.exe [--objects N] [--terrain-tiles N] [--extent F] [--iterations N]
+*                  [--rays N] [--dynamic N] [--hash-keys N] [--allocs N] [--commit-granularity BYTES] [--seed N] [--threads N]
+*                  [--format json|csv] [--output path] [--replay path] [--trace path]
+*
+* Every benchmark reports min/median/p99/mean in nanoseconds per iteration, along with the
+* number of items (triangles, rays, keys...) processed per iteration. Memory heavy benchmarks also report
+* commit syscalls, page faults and dTLB misses per iteration where the platform exposes them.
+*
+* Job system benchmarks run once per thread count (1, 2, 4... up to --threads) and are suffixed with it,
+* so scaling can be read straight off the results.
+*
+* --replay plays an input recording of the editor (see input.c) headless and reports its frame times as replay_frame,
+* one sample per frame. --trace also writes that frame time trace out as CSV, for diffing two builds frame by frame.
+*/
+#include "afterhours.c"
+
+#include <string.h>
+
+typedef enum BenchOutputFormat {
+	BENCH_FORMAT_JSON,
+	BENCH_FORMAT_CSV,
+} BenchOutputFormat;
+
+typedef struct BenchConfig {
+	int object_count;       /* Boxes scattered over the world (12 triangles each) */
+	int terrain_tile_count; /* Terrain tiles laid out in a square (BENCH_TERRAIN_TILE_QUADS^2 * 2 triangles each) */
+	f32 world_extent;       /* Boxes are scattered over [-extent, extent] on X and Z */
+	int iterations;
+	int ray_count;
+	int dynamic_count;      /* Moving colliders for the broadphase benchmarks */
+	int hash_key_count;
+	int arena_alloc_count;
+	i64 commit_granularity; /* Zero uses the arena default */
+	u32 seed;
+	int max_threads;        /* Zero uses every logical core */
+
+	BenchOutputFormat format;
+	char* output_path;      /* NULL writes to stdout */
+	char* replay_path;      /* NULL skips the replay benchmark */
+	char* trace_path;
+} BenchConfig;
+
+/**
+* Extra named values attached to a result. For things that aren't timings (cell counts, bytes, etc.)
+*/
+typedef struct BenchCounter {
+	const char* name;
+	f64 value;
+} BenchCounter;
+
+#define BENCH_MAX_COUNTERS 12
+
+typedef struct BenchResult {
+	const char* name;
+	int items;
+	int iterations;
+
+	u64 min_ns;
+	u64 median_ns;
+	u64 p99_ns;
+	u64 mean_ns;
+
+	BenchCounter counters[BENCH_MAX_COUNTERS];
+	int counter_count;
+} BenchResult;
+
+#define BENCH_MAX_RESULTS 96
+
+typedef struct BenchReport {
+	BenchResult results[BENCH_MAX_RESULTS];
+	int result_count;
+} BenchReport;
+
+#define BENCH_TERRAIN_TILE_QUADS 16
+#define BENCH_TERRAIN_QUAD_WIDTH 1.0f
+
+/* Enough for a few million triangles worth of colliders and list nodes */
+#define BENCH_ARENA_RESERVATION (1ULL << 32)
+
+/* Prefab slots for the synthetic models. Indexed the same way as ModelID indexes model_prefabs. */
+typedef enum BenchModelID {
+	BENCH_MODEL_NONE = 0,
+	BENCH_MODEL_BOX,
+	BENCH_MODEL_TERRAIN_TILE,
+
+	BENCH_MODEL_COUNT
+} BenchModelID;
+
+#ifndef REGION_BENCH_UTILITIES
+
+/* xorshift32. Deterministic across platforms, unlike rand(). */
+u32 bench_random_u32(u32* state) {
+	u32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Uniform float in [min, max] */
+f32 bench_random_f32(u32* state, f32 min, f32 max) {
+	f32 unit = (f32)(bench_random_u32(state) & 0xFFFFFF) / (f32)0xFFFFFF;
+	return min + (unit * (max - min));
+}
+
+int bench_compare_u64(const void* a, const void* b) {
+	u64 lhs = *(const u64*)a;
+	u64 rhs = *(const u64*)b;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+* Sorts the samples in place and appends the summary to the report.
+* Returns the new result so counters can be attached to it.
+*/
+BenchResult* bench_record(BenchReport* report, const char* name, u64* samples, int sample_count, int items) {
+	ASSERT(sample_count > 0);
+	if (NEVER(report->result_count >= BENCH_MAX_RESULTS)) { return &report->results[BENCH_MAX_RESULTS - 1]; }
+
+	qsort(samples, sample_count, sizeof(*samples), bench_compare_u64);
+
+	u64 total = 0;
+	for (int i = 0; i < sample_count; i++) { total += samples[i]; }
+
+	/* Nearest-rank percentile */
+	int p99_index = (int)math_f32_ceiling(0.99f * (f32)sample_count) - 1;
+	p99_index = MIN2(MAX2(p99_index, 0), sample_count - 1);
+
+	BenchResult* result = &report->results[report->result_count++];
+	*result = (BenchResult) {
+		.name = name,
+		.items = items,
+		.iterations = sample_count,
+		.min_ns = samples[0],
+		.median_ns = samples[sample_count / 2],
+		.p99_ns = samples[p99_index],
+		.mean_ns = total / (u64)sample_count,
+		.counter_count = 0,
+	};
+	return result;
+}
+
+/* Result names have to outlive the report, so formatted ones go into the bench arena */
+const char* bench_format_name(Arena* arena, const char* prefix, int value) {
+	int length = snprintf(NULL, 0, "%s%d", prefix, value);
+	char* name = arena_alloc(arena, length + 1);
+	snprintf(name, length + 1, "%s%d", prefix, value);
+	return name;
+}
+
+void bench_result_add_counter(BenchResult* result, const char* name, f64 value) {
+	if (NEVER(result->counter_count >= BENCH_MAX_COUNTERS)) { return; }
+
+	result->counters[result->counter_count++] = (BenchCounter) { .name = name, .value = value };
+}
+
+void bench_write_report(FILE* out, const BenchConfig* config, const BenchReport* report) {
+	if (config->format == BENCH_FORMAT_CSV) {
+		fprintf(out, "name,items,iterations,min_ns,median_ns,p99_ns,mean_ns,counters\n");
+
+		for (int i = 0; i < report->result_count; i++) {
+			const BenchResult* r = &report->results[i];
+			fprintf(out, "%s,%d,%d,%llu,%llu,%llu,%llu,", r->name, r->items, r->iterations, r->min_ns, r->median_ns, r->p99_ns, r->mean_ns);
+
+			/* Counters are packed into one column as name=value pairs so the column count stays fixed */
+			for (int c = 0; c < r->counter_count; c++) {
+				fprintf(out, "%s%s=%.17g", (c > 0) ? ";" : "", r->counters[c].name, r->counters[c].value);
+			}
+			fprintf(out, "\n");
+		}
+
+		/* Second table, separated by a blank line */
+		fprintf(out, "\narena,live,reserved_bytes,committed_bytes,peak_committed_bytes,peak_allocated_bytes,commit_calls,decommit_calls\n");
+		for (int i = 0; i < arena_registry.slot_count; i++) {
+			const ArenaStats* a = &arena_registry.slots[i];
+			fprintf(out, "%s,%d,%lld,%lld,%lld,%lld,%llu,%llu\n",
+				a->name, a->is_live ? 1 : 0, a->reserved_bytes, a->committed_bytes, a->peak_committed_bytes, a->peak_allocated_bytes, a->commit_calls, a->decommit_calls
+			);
+		}
+		return;
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"config\": {\n");
+	fprintf(out, "\t\t\"objects\": %d,\n", config->object_count);
+	fprintf(out, "\t\t\"terrain_tiles\": %d,\n", config->terrain_tile_count);
+	fprintf(out, "\t\t\"extent\": %g,\n", config->world_extent);
+	fprintf(out, "\t\t\"iterations\": %d,\n", config->iterations);
+	fprintf(out, "\t\t\"rays\": %d,\n", config->ray_count);
+	fprintf(out, "\t\t\"dynamic\": %d,\n", config->dynamic_count);
+	fprintf(out, "\t\t\"hash_keys\": %d,\n", config->hash_key_count);
+	fprintf(out, "\t\t\"allocs\": %d,\n", config->arena_alloc_count);
+	fprintf(out, "\t\t\"commit_granularity\": %lld,\n", config->commit_granularity);
+	fprintf(out, "\t\t\"seed\": %u,\n", config->seed);
+	fprintf(out, "\t\t\"threads\": %d\n", config->max_threads);
+	fprintf(out, "\t},\n");
+
+	fprintf(out, "\t\"results\": [\n");
+	for (int i = 0; i < report->result_count; i++) {
+		const BenchResult* r = &report->results[i];
+		fprintf(out, "\t\t{\"name\": \"%s\", \"items\": %d, \"iterations\": %d, \"min_ns\": %llu, \"median_ns\": %llu, \"p99_ns\": %llu, \"mean_ns\": %llu",
+			r->name, r->items, r->iterations, r->min_ns, r->median_ns, r->p99_ns, r->mean_ns
+		);
+
+		if (r->counter_count > 0) {
+			fprintf(out, ", \"counters\": {");
+			for (int c = 0; c < r->counter_count; c++) {
+				fprintf(out, "%s\"%s\": %.17g", (c > 0) ? ", " : "", r->counters[c].name, r->counters[c].value);
+			}
+			fprintf(out, "}");
+		}
+
+		fprintf(out, "}%s\n", (i + 1 < report->result_count) ? "," : "");
+	}
+	fprintf(out, "\t],\n");
+
+	fprintf(out, "\t\"arenas\": {\n");
+	fprintf(out, "\t\t\"total_commit_calls\": %llu,\n", arena_registry.total_commit_calls);
+	fprintf(out, "\t\t\"total_decommit_calls\": %llu,\n", arena_registry.total_decommit_calls);
+	fprintf(out, "\t\t\"entries\": [\n");
+	for (int i = 0; i < arena_registry.slot_count; i++) {
+		const ArenaStats* a = &arena_registry.slots[i];
+		fprintf(out, "\t\t\t{\"name\": \"%s\", \"live\": %s, \"reserved_bytes\": %lld, \"committed_bytes\": %lld, \"peak_committed_bytes\": %lld, \"peak_allocated_bytes\": %lld, \"commit_calls\": %llu, \"decommit_calls\": %llu}%s\n",
+			a->name, a->is_live ? "true" : "false", a->reserved_bytes, a->committed_bytes, a->peak_committed_bytes, a->peak_allocated_bytes, a->commit_calls, a->decommit_calls,
+			(i + 1 < arena_registry.slot_count) ? "," : ""
+		);
+	}
+	fprintf(out, "\t\t]\n");
+	fprintf(out, "\t}\n");
+	fprintf(out, "}\n");
+}
+
+bool bench_arg_is(char* arg, const char* name) {
+	return string_eq(string_null_to_length_terminated(arg), string_null_to_length_terminated((char*)name));
+}
+
+BenchConfig bench_parse_args(int argc, char** argv) {
+	BenchConfig config = {
+		.object_count = 2000,
+		.terrain_tile_count = 16,
+		.world_extent = 200.0f,
+		.iterations = 50,
+		.ray_count = 10000,
+		.dynamic_count = 4096,
+		.hash_key_count = 50000,
+		.arena_alloc_count = 100000,
+		.commit_granularity = 0,
+		.seed = 0x5EED1234,
+		.max_threads = 0,
+		.format = BENCH_FORMAT_JSON,
+		.output_path = NULL,
+	};
+
+	for (int i = 1; i < argc; i++) {
+		bool has_value = (i + 1 < argc);
+		char* value = has_value ? argv[i + 1] : NULL;
+
+		if      (has_value && bench_arg_is(argv[i], "--objects"))       { config.object_count       = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--terrain-tiles")) { config.terrain_tile_count = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--extent"))        { config.world_extent       = (f32)atof(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--iterations"))    { config.iterations         = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--rays"))          { config.ray_count          = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--dynamic"))       { config.dynamic_count      = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--hash-keys"))     { config.hash_key_count     = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--allocs"))        { config.arena_alloc_count  = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--commit-granularity")) { config.commit_granularity = atoll(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--seed"))          { config.seed               = (u32)strtoul(value, NULL, 0); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--threads"))       { config.max_threads        = atoi(value); i++; }
+		else if (has_value && bench_arg_is(argv[i], "--output"))        { config.output_path        = value; i++; }
+		else if (has_value && bench_arg_is(argv[i], "--replay"))        { config.replay_path        = value; i++; }
+		else if (has_value && bench_arg_is(argv[i], "--trace"))         { config.trace_path         = value; i++; }
+		else if (has_value && bench_arg_is(argv[i], "--format")) {
+			config.format = bench_arg_is(value, "csv") ? BENCH_FORMAT_CSV : BENCH_FORMAT_JSON;
+			i++;
+		}
+		else {
+			fprintf(stderr, "Unknown or incomplete argument: %s\n", argv[i]);
+		}
+	}
+
+	/* xorshift gets stuck on zero */
+	if (config.seed == 0) { config.seed = 1; }
+	if (config.iterations < 1) { config.iterations = 1; }
+	if (config.max_threads <= 0) { config.max_threads = platform_dependent_cpu_count(); }
+	config.max_threads = MIN2(config.max_threads, JOB_MAX_WORKERS);
+
+	return config;
+}
+
+#endif
+
+#ifndef REGION_SYSTEM_COUNTERS
+
+/**
+* Process wide counters sampled around a benchmark. Negative values mean the counter isn't available
+* (no perf events permission, a VM without a PMU, or not Linux).
+*/
+typedef struct BenchSystemCounters {
+	u64 commit_calls;
+	i64 page_faults;
+	i64 dtlb_misses;
+} BenchSystemCounters;
+
+#ifdef linux
+	#include <linux/perf_event.h>
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+
+	global int bench_dtlb_fd = -1;
+	global bool bench_dtlb_opened = false;
+
+	i64 bench_read_dtlb_misses(void) {
+		if (!bench_dtlb_opened) {
+			bench_dtlb_opened = true;
+
+			struct perf_event_attr attr = {0};
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_DTLB
+				| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			/* This thread, any CPU */
+			bench_dtlb_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+
+		if (bench_dtlb_fd < 0) { return -1; }
+
+		u64 count = 0;
+		if (read(bench_dtlb_fd, &count, sizeof(count)) != sizeof(count)) { return -1; }
+		return (i64)count;
+	}
+
+	i64 bench_read_page_faults(void) {
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) { return -1; }
+		return (i64)usage.ru_minflt + (i64)usage.ru_majflt;
+	}
+#else
+	i64 bench_read_dtlb_misses(void) { return -1; }
+	i64 bench_read_page_faults(void) { return -1; }
+#endif
+
+BenchSystemCounters bench_system_counters_read(void) {
+	return (BenchSystemCounters) {
+		.commit_calls = arena_registry.total_commit_calls,
+		.page_faults = bench_read_page_faults(),
+		.dtlb_misses = bench_read_dtlb_misses(),
+	};
+}
+
+/**
+* Adds the per-iteration change in commit syscalls, page faults and dTLB misses to the result.
+* Counters that aren't available are left out.
+*/
+void bench_result_add_system_deltas(BenchResult* result, BenchSystemCounters before, BenchSystemCounters after, int iterations) {
+	bench_result_add_counter(result, "commit_calls_per_iteration", (f64)(after.commit_calls - before.commit_calls) / iterations);
+
+	if (before.page_faults >= 0 && after.page_faults >= 0) {
+		bench_result_add_counter(result, "page_faults_per_iteration", (f64)(after.page_faults - before.page_faults) / iterations);
+	}
+	if (before.dtlb_misses >= 0 && after.dtlb_misses >= 0) {
+		bench_result_add_counter(result, "dtlb_misses_per_iteration", (f64)(after.dtlb_misses - before.dtlb_misses) / iterations);
+	}
+}
+
+#endif
+
+#ifndef REGION_SYNTHETIC_SCENES
+
+void bench_mesh_push_triangle(Mesh* mesh, Vector3 v1, Vector3 v2, Vector3 v3) {
+	float* out = &mesh->vertices[mesh->vertexCount * 3];
+	out[0] = v1.x; out[1] = v1.y; out[2] = v1.z;
+	out[3] = v2.x; out[4] = v2.y; out[5] = v2.z;
+	out[6] = v3.x; out[7] = v3.y; out[8] = v3.z;
+
+	mesh->vertexCount += 3;
+	mesh->triangleCount += 1;
+}
+
+/* A unit cube as an unindexed triangle soup, matching what LoadModel gives us for Cube.obj */
+Mesh bench_create_box_mesh(Arena* model_arena) {
+	Mesh mesh = {0};
+	mesh.vertices = arena_alloc(model_arena, sizeof(float) * 3 * 36);
+
+	Vector3 c[8];
+	for (int i = 0; i < 8; i++) {
+		c[i] = (Vector3) {
+			(i & 1) ? 0.5f : -0.5f,
+			(i & 2) ? 0.5f : -0.5f,
+			(i & 4) ? 0.5f : -0.5f,
+		};
+	}
+
+	/* Two triangles per face */
+	int faces[6][4] = {
+		{0, 1, 3, 2}, {4, 6, 7, 5}, /* -Z, +Z */
+		{0, 4, 5, 1}, {2, 3, 7, 6}, /* -Y, +Y */
+		{0, 2, 6, 4}, {1, 5, 7, 3}, /* -X, +X */
+	};
+
+	for (int f = 0; f < 6; f++) {
+		bench_mesh_push_triangle(&mesh, c[faces[f][0]], c[faces[f][1]], c[faces[f][2]]);
+		bench_mesh_push_triangle(&mesh, c[faces[f][0]], c[faces[f][2]], c[faces[f][3]]);
+	}
+
+	return mesh;
+}
+
+/* A rolling heightfield patch, so the grid has long sloped triangles like real terrain */
+Mesh bench_create_terrain_tile_mesh(Arena* model_arena) {
+	int quads = BENCH_TERRAIN_TILE_QUADS;
+	f32 w = BENCH_TERRAIN_QUAD_WIDTH;
+
+	Mesh mesh = {0};
+	mesh.vertices = arena_alloc(model_arena, sizeof(float) * 3 * 6 * quads * quads);
+
+	for (int z = 0; z < quads; z++) {
+		for (int x = 0; x < quads; x++) {
+			Vector3 p[4];
+			for (int corner = 0; corner < 4; corner++) {
+				f32 px = (f32)(x + (corner & 1)) * w;
+				f32 pz = (f32)(z + (corner >> 1)) * w;
+				p[corner] = (Vector3) { px, sinf(px * 0.3f) * cosf(pz * 0.2f) * 2.0f, pz };
+			}
+			bench_mesh_push_triangle(&mesh, p[0], p[2], p[1]);
+			bench_mesh_push_triangle(&mesh, p[1], p[2], p[3]);
+		}
+	}
+
+	return mesh;
+}
+
+Model bench_create_model(Arena* model_arena, Mesh mesh) {
+	Model model = {0};
+	model.meshCount = 1;
+	model.meshes = arena_alloc(model_arena, sizeof(*model.meshes));
+	model.meshes[0] = mesh;
+	return model;
+}
+
+/* Indexed by BenchModelID */
+Model* bench_create_model_prefabs(Arena* model_arena) {
+	Model* model_prefabs = arena_alloc(model_arena, sizeof(*model_prefabs) * BENCH_MODEL_COUNT);
+	model_prefabs[BENCH_MODEL_NONE] = (Model) {0};
+	model_prefabs[BENCH_MODEL_BOX] = bench_create_model(model_arena, bench_create_box_mesh(model_arena));
+	model_prefabs[BENCH_MODEL_TERRAIN_TILE] = bench_create_model(model_arena, bench_create_terrain_tile_mesh(model_arena));
+	return model_prefabs;
+}
+
+/* The static objects of a scene as entities */
+void bench_create_entities(EntityStore* entities, StaticObjectArray scene) {
+	for (int i = 0; i < scene.len; i++) {
+		entity_create(entities, (Entity) {
+			.transform = scene.objects[i].transform,
+			.collider_model_id = scene.objects[i].id,
+			.visible_model_id = scene.objects[i].id,
+			.layer = scene.objects[i].layer,
+		});
+	}
+	entity_store_update_hierarchy(entities);
+}
+
+/**
+* Builds the static objects for a scene: a square of terrain tiles centered on the origin and boxes scattered over it.
+*/
+StaticObjectArray bench_create_scene(Arena* scene_arena, const BenchConfig* config, u32* rng) {
+	int object_count = config->object_count + config->terrain_tile_count;
+	StaticObject* objects = arena_alloc(scene_arena, sizeof(*objects) * object_count);
+
+	int tiles_per_row = (int)math_f32_ceiling(sqrtf((f32)config->terrain_tile_count));
+	f32 tile_width = BENCH_TERRAIN_TILE_QUADS * BENCH_TERRAIN_QUAD_WIDTH;
+	f32 terrain_origin = -(tiles_per_row * tile_width) / 2.0f;
+
+	int i = 0;
+	for (int tile = 0; tile < config->terrain_tile_count; tile++, i++) {
+		objects[i] = (StaticObject) {
+			.id = (ModelID)BENCH_MODEL_TERRAIN_TILE,
+			.layer = MASK_STATIC_GEOMETRY,
+			.transform = {
+				.translation = { terrain_origin + (tile % tiles_per_row) * tile_width, 0.0f, terrain_origin + (tile / tiles_per_row) * tile_width },
+				.rotation = QuaternionIdentity(),
+				.scale = { 1.0f, 1.0f, 1.0f },
+			},
+		};
+	}
+
+	for (int box = 0; box < config->object_count; box++, i++) {
+		f32 extent = config->world_extent;
+		objects[i] = (StaticObject) {
+			.id = (ModelID)BENCH_MODEL_BOX,
+			.layer = MASK_STATIC_GEOMETRY,
+			.transform = {
+				.translation = { bench_random_f32(rng, -extent, extent), bench_random_f32(rng, 0.0f, 10.0f), bench_random_f32(rng, -extent, extent) },
+				.rotation = QuaternionFromAxisAngle(VECTOR3_UP, bench_random_f32(rng, 0.0f, 2.0f * PI)),
+				.scale = { bench_random_f32(rng, 0.5f, 4.0f), bench_random_f32(rng, 0.5f, 4.0f), bench_random_f32(rng, 0.5f, 4.0f) },
+			},
+		};
+	}
+
+	return (StaticObjectArray) { .objects = objects, .len = object_count };
+}
+
+#endif
+
+#ifndef REGION_BENCHMARKS
+
+/**
+* Times count allocations of the given sizes, iterations times. Each allocation gets one byte written,
+* so page faults and TLB misses from first touching the memory are part of the measurement.
+*
+* With recycle set the same arena is restored to zero between iterations (the per-frame collider arena case),
+* otherwise a fresh arena built from the template is used each time, so the cost of committing is measured too.
+*/
+BenchResult* bench_arena_alloc_variant(
+	BenchReport* report,
+	const char* name,
+	u64* samples,
+	const BenchConfig* config,
+	const u32* sizes,
+	int count,
+	Arena arena_template,
+	bool recycle
+) {
+	BenchSystemCounters before = bench_system_counters_read();
+
+	Arena arena = arena_template;
+	for (int it = 0; it < config->iterations; it++) {
+		if (recycle) {
+			arena_restore(&arena, 0);
+		} else {
+			arena = arena_template;
+		}
+
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count; i++) {
+			u8* ptr = arena_alloc(&arena, sizes[i]);
+			ASSERT(ptr != NULL);
+			*ptr = 0;
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+
+		if (!recycle) { arena_free(&arena); }
+	}
+	if (recycle) { arena_free(&arena); }
+
+	BenchResult* result = bench_record(report, name, samples, config->iterations, count);
+	bench_result_add_system_deltas(result, before, bench_system_counters_read(), config->iterations);
+	return result;
+}
+
+/**
+* How arena_alloc committed before commits grew geometrically, for comparison: every allocation that crosses the
+* committed size commits everything from the base up to the next page again. Only its commits are counted in the
+* arena registry, so commit_calls_per_iteration compares.
+*/
+typedef struct BenchPageStepArena {
+	u8* bytes;
+	i64 first_unallocated_byte;
+	i64 total_committed_bytes;
+} BenchPageStepArena;
+
+void* bench_page_step_alloc(BenchPageStepArena* arena, u64 byte_count) {
+	i64 push_to = align_forward(byte_count + arena->first_unallocated_byte, DEFAULT_MEMORY_ALIGNMENT);
+	u64 total_committed_bytes = round_to_page_size((u64)push_to);
+
+	if (push_to >= arena->total_committed_bytes) {
+		if (platform_dependent_mem_commit(arena->bytes, total_committed_bytes) == NULL) {
+			return NULL;
+		}
+		__atomic_fetch_add(&arena_registry.total_commit_calls, 1, __ATOMIC_RELAXED);
+	}
+
+	void* ret = arena->bytes + arena->first_unallocated_byte;
+	arena->first_unallocated_byte = push_to;
+	arena->total_committed_bytes = total_committed_bytes;
+	return ret;
+}
+
+/* bench_arena_alloc_variant for BenchPageStepArena, with a fresh reservation each iteration */
+BenchResult* bench_page_step_alloc_variant(BenchReport* report, const char* name, u64* samples, const BenchConfig* config, const u32* sizes, int count, u64 reservation) {
+	BenchSystemCounters before = bench_system_counters_read();
+
+	for (int it = 0; it < config->iterations; it++) {
+		BenchPageStepArena arena = { .bytes = platform_dependent_mem_reserve(reservation) };
+		ASSERT(arena.bytes != NULL);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count; i++) {
+			u8* ptr = bench_page_step_alloc(&arena, sizes[i]);
+			ASSERT(ptr != NULL);
+			*ptr = 0;
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+
+		platform_dependent_mem_release(arena.bytes, reservation);
+	}
+
+	BenchResult* result = bench_record(report, name, samples, config->iterations, count);
+	bench_result_add_system_deltas(result, before, bench_system_counters_read(), config->iterations);
+	return result;
+}
+
+void bench_arena_alloc(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	int count = config->arena_alloc_count;
+	if (count <= 0) { return; }
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	u32* sizes = arena_alloc(bench_arena, sizeof(*sizes) * count);
+	for (int i = 0; i < count; i++) { sizes[i] = 16 + (bench_random_u32(rng) % 241); }
+
+	/* Worst case size of a single iteration, plus alignment padding */
+	i64 reservation = (i64)round_to_page_size((u64)count * (256 + DEFAULT_MEMORY_ALIGNMENT));
+
+	Arena fresh = {
+		.name = "bench_alloc_fresh",
+		.total_reserved_bytes = reservation,
+		.commit_granularity = config->commit_granularity,
+	};
+	bench_arena_alloc_variant(report, "arena_alloc", samples, config, sizes, count, fresh, false);
+
+	Arena recycled = {
+		.name = "bench_alloc_recycled",
+		.total_reserved_bytes = reservation,
+		.commit_granularity = config->commit_granularity,
+	};
+	bench_arena_alloc_variant(report, "arena_alloc_recycled", samples, config, sizes, count, recycled, true);
+
+	/* Arenas as they committed before geometric growth, the baseline the others are compared against */
+	bench_page_step_alloc_variant(report, "arena_alloc_page_steps", samples, config, sizes, count, (u64)reservation);
+
+	/* Still geometric growth, but in multiples of a page instead of ARENA_DEFAULT_COMMIT_GRANULARITY */
+	Arena page_granularity = {
+		.name = "bench_alloc_page_granularity",
+		.total_reserved_bytes = reservation,
+		.commit_granularity = PAGE_SIZE,
+	};
+	bench_arena_alloc_variant(report, "arena_alloc_page_granularity", samples, config, sizes, count, page_granularity, false);
+
+	Arena huge_pages = {
+		.name = "bench_alloc_huge_pages",
+		.total_reserved_bytes = reservation,
+		.flags = ARENA_FLAG_HUGE_PAGES,
+	};
+	bench_arena_alloc_variant(report, "arena_alloc_huge_pages", samples, config, sizes, count, huge_pages, false);
+}
+
+/**
+* Pool churn: fill the pool, then free and reallocate a random half, the way entities and streamed assets come and go.
+*/
+void bench_pool(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	int count = config->arena_alloc_count;
+	if (count <= 0) { return; }
+
+	typedef struct BenchPoolItem { Transform transform; int model_id; } BenchPoolItem;
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	BenchPoolItem** items = arena_alloc(bench_arena, sizeof(*items) * count);
+	u32* order = arena_alloc(bench_arena, sizeof(*order) * count);
+	for (int i = 0; i < count; i++) { order[i] = bench_random_u32(rng) % (u32)count; }
+
+	Pool pool = { .arena = { .name = "bench_pool", .total_reserved_bytes = BENCH_ARENA_RESERVATION } };
+	pool_init_typed(&pool, BenchPoolItem, POOL_FLAG_GENERATIONS);
+
+	for (int i = 0; i < count; i++) { items[i] = pool_alloc_typed(&pool, BenchPoolItem); }
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count / 2; i++) {
+			u32 victim = order[i];
+			pool_free(&pool, items[victim]);
+			items[victim] = pool_alloc_typed(&pool, BenchPoolItem);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "pool_free_alloc", samples, config->iterations, count / 2);
+
+	pool_destroy(&pool);
+}
+
+/**
+* Entity churn: fill the store, then destroy and recreate a random half through their handles.
+*/
+void bench_entity_store(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	int count = config->arena_alloc_count;
+	if (count <= 0) { return; }
+	if (count > ENTITY_MAX_COUNT) { count = ENTITY_MAX_COUNT; }
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	EntityHandle* handles = arena_alloc(bench_arena, sizeof(*handles) * count);
+	u32* order = arena_alloc(bench_arena, sizeof(*order) * count);
+	for (int i = 0; i < count; i++) { order[i] = bench_random_u32(rng) % (u32)count; }
+
+	EntityStore store;
+	entity_store_init(&store);
+
+	Entity entity = { .collider_model_id = (ModelID)BENCH_MODEL_BOX, .layer = MASK_STATIC_GEOMETRY, .transform = default_transform() };
+	for (int i = 0; i < count; i++) { handles[i] = entity_create(&store, entity); }
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count / 2; i++) {
+			u32 victim = order[i];
+			entity_destroy(&store, handles[victim]);
+			handles[victim] = entity_create(&store, entity);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "entity_destroy_create", samples, config->iterations, count / 2);
+
+	entity_store_free(&store);
+
+	/* Hierarchy update over a 4-ary tree, so depth grows with log(count) */
+	entity_store_init(&store);
+	for (int i = 0; i < count; i++) {
+		entity.parent = (i == 0) ? ENTITY_HANDLE_NONE : handles[(i - 1) / 4];
+		entity.transform.rotation = QuaternionFromAxisAngle(VECTOR3_UP, bench_random_f32(rng, 0.0f, 2.0f * PI));
+		handles[i] = entity_create(&store, entity);
+	}
+	entity_store_update_hierarchy(&store);
+
+	/* Moving the root dirties everything */
+	for (int it = 0; it < config->iterations; it++) {
+		entity_set_transform(&store, handles[0], entity.transform);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		entity_store_update_hierarchy(&store);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* all_result = bench_record(report, "entity_hierarchy_update_all", samples, config->iterations, count);
+	bench_result_add_counter(all_result, "depths", store.depth_count);
+
+	/* One percent of the entities move, mostly leaves */
+	for (int it = 0; it < config->iterations; it++) {
+		for (int i = 0; i < count / 100; i++) {
+			entity_set_transform(&store, handles[order[i]], entity.transform);
+		}
+
+		u64 start = platform_dependent_time_nanoseconds();
+		entity_store_update_hierarchy(&store);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "entity_hierarchy_update_1_percent", samples, config->iterations, count);
+
+	/* Rendering between two steps, blending whatever the last 1 percent update moved */
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		const Matrix* render_matrices = entity_store_interpolate(&store, 0.5f);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		/* With under 100 entities nothing moved, and the world matrices are returned as they are */
+		ASSERT(render_matrices == ((count >= 100) ? store.render_matrices : store.world_matrices));
+	}
+	bench_record(report, "entity_interpolate_1_percent", samples, config->iterations, count);
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		entity_store_update_hierarchy(&store);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "entity_hierarchy_update_clean", samples, config->iterations, count);
+
+	entity_store_free(&store);
+}
+
+/**
+* How full the grid is. bounding_rect_entries is how many entries there would be if every triangle went into
+* every cell of its XZ bounding rectangle, for comparison with what the rasterized insert actually makes.
+*/
+void bench_spacial_hash_add_counters(BenchResult* result, const SpacialHash* spacial_hash, TriangleColliderArray colliders) {
+	int cell_count = spacial_hash->slot_count;
+	int occupied_cells = 0;
+	int cell_entries = 0;
+	for (int i = 0; i < cell_count; i++) {
+		if (spacial_hash->cells[i].count > 0) { occupied_cells++; }
+		cell_entries += spacial_hash->cells[i].count;
+	}
+
+	f64 bounding_rect_entries = 0.0;
+	f32 cell_width = spacial_hash->cell_width;
+	Vector3 grid_min = spacial_hash->world_bounding_box.min;
+	for (int i = 0; i < colliders.length; i++) {
+		TriangleCollider tri = colliders.colliders[i];
+		int min_x = (int)math_f32_floor((MIN3(tri.vert_1.x, tri.vert_2.x, tri.vert_3.x) - grid_min.x) / cell_width);
+		int max_x = (int)math_f32_floor((MAX3(tri.vert_1.x, tri.vert_2.x, tri.vert_3.x) - grid_min.x) / cell_width);
+		int min_z = (int)math_f32_floor((MIN3(tri.vert_1.z, tri.vert_2.z, tri.vert_3.z) - grid_min.z) / cell_width);
+		int max_z = (int)math_f32_floor((MAX3(tri.vert_1.z, tri.vert_2.z, tri.vert_3.z) - grid_min.z) / cell_width);
+		bounding_rect_entries += (f64)(max_x - min_x + 1) * (f64)(max_z - min_z + 1);
+	}
+
+	bench_result_add_counter(result, "cells", cell_count);
+	bench_result_add_counter(result, "occupied_cells", occupied_cells);
+	bench_result_add_counter(result, "cell_entries", cell_entries);
+	bench_result_add_counter(result, "bounding_rect_entries", bounding_rect_entries);
+	bench_result_add_counter(result, "entries_per_triangle", (f64)cell_entries / (f64)MAX2(colliders.length, 1));
+}
+
+/* Rays over the whole grid. Half are ground probes straight down, half go in random directions. */
+void bench_create_rays(Vector3* origins, Vector3* directions, int ray_count, BoundingBox world_bound, u32* rng) {
+	for (int i = 0; i < ray_count; i++) {
+		origins[i] = (Vector3) {
+			bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+			world_bound.max.y + 1.0f,
+			bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+		};
+
+		if (i & 1) {
+			directions[i] = VECTOR3_DOWN;
+		} else {
+			directions[i] = Vector3Normalize((Vector3) {
+				bench_random_f32(rng, -1.0f, 1.0f),
+				bench_random_f32(rng, -1.0f, -0.05f),
+				bench_random_f32(rng, -1.0f, 1.0f),
+			});
+		}
+	}
+}
+
+/* Casts every ray iterations times, returns how many hit in the last round */
+int bench_cast_rays(const SpacialHash* spacial_hash, const Vector3* origins, const Vector3* directions, int ray_count, u64* samples, int iterations) {
+	int hits = 0;
+	for (int it = 0; it < iterations; it++) {
+		hits = 0;
+
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < ray_count; i++) {
+			RaycastHit hit = collision_raycast(spacial_hash, MASK_ALL, origins[i], directions[i], 1000.0f);
+			hits += (hit.collider != NULL);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	return hits;
+}
+
+/**
+* Builds the hash with the cell width collision_spacial_hash_tune picks and casts the rays through it, for comparison
+* with the default width. names are for the build and the raycasts.
+*/
+void bench_tuned_collision(BenchReport* report, Arena* collider_data_arena, const BenchConfig* config, u64* samples, TriangleColliderArray colliders, BoundingBox world_bound, SpacialHashMode mode, const Vector3* origins, const Vector3* directions, const char* names[2]) {
+	u64 hash_start = arena_save(collider_data_arena);
+
+	SpacialHashTuner tuner = { .mode = mode };
+	SpacialHash spacial_hash = {0};
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(collider_data_arena, hash_start);
+		tuner.cell_width = 0.0f;
+
+		u64 start = platform_dependent_time_nanoseconds();
+		spacial_hash = collision_spacial_hash_create_tuned(collider_data_arena, &tuner, colliders, world_bound);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* hash_result = bench_record(report, names[0], samples, config->iterations, colliders.length);
+	bench_spacial_hash_add_counters(hash_result, &spacial_hash, colliders);
+	bench_result_add_counter(hash_result, "bytes", (f64)(arena_save(collider_data_arena) - hash_start));
+	bench_result_add_counter(hash_result, "cell_width", tuner.cell_width);
+	bench_result_add_counter(hash_result, "median_triangle_extent", tuner.tuning.median_triangle_extent);
+	bench_result_add_counter(hash_result, "triangle_density", tuner.tuning.triangle_density);
+
+	if (config->ray_count > 0) {
+		int hits = bench_cast_rays(&spacial_hash, origins, directions, config->ray_count, samples, config->iterations);
+		BenchResult* ray_result = bench_record(report, names[1], samples, config->iterations, config->ray_count);
+		bench_result_add_counter(ray_result, "hits", hits);
+		bench_result_add_counter(ray_result, "entries_per_cell", (f64)tuner.stats.entry_count / (f64)MAX2(tuner.stats.cell_count, 1));
+		bench_result_add_counter(ray_result, "cells_per_ray", (f64)tuner.stats.cell_count / (f64)MAX2(tuner.stats.query_count, 1));
+	}
+
+	arena_restore(collider_data_arena, hash_start);
+}
+
+/**
+* The same ground probes from random points over the grid, three ways: a raycast straight down, collision_ground_height_batch,
+* and collision_ground_height_batch with the heightmap if there is one. Every probe starts at probe_height.
+*/
+void bench_ground_probes(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng, const SpacialHash* spacial_hash, const GroundHeightmap* heightmap, f32 probe_height, const char* names[3]) {
+	int probe_count = config->ray_count;
+	if (probe_count <= 0) { return; }
+
+	Vector3* probes = arena_alloc(bench_arena, sizeof(*probes) * probe_count);
+	GroundHit* hits = arena_alloc(bench_arena, sizeof(*hits) * probe_count);
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	BoundingBox world_bound = spacial_hash->world_bounding_box;
+	for (int i = 0; i < probe_count; i++) {
+		probes[i] = (Vector3) {
+			bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+			probe_height,
+			bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+		};
+	}
+
+	int hit_count = 0;
+	for (int it = 0; it < config->iterations; it++) {
+		hit_count = 0;
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < probe_count; i++) {
+			hit_count += (collision_raycast(spacial_hash, MASK_ALL, probes[i], VECTOR3_DOWN, 1000.0f).collider != NULL);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* result = bench_record(report, names[0], samples, config->iterations, probe_count);
+	bench_result_add_counter(result, "hits", hit_count);
+
+	for (int variant = 1; variant < 3; variant++) {
+		if (variant == 2 && heightmap == NULL) { break; }
+
+		for (int it = 0; it < config->iterations; it++) {
+			u64 start = platform_dependent_time_nanoseconds();
+			collision_ground_height_batch(spacial_hash, (variant == 2) ? heightmap : NULL, probes, probe_count, MASK_ALL, hits);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+
+		hit_count = 0;
+		for (int i = 0; i < probe_count; i++) { hit_count += (hits[i].collider != NULL); }
+		result = bench_record(report, names[variant], samples, config->iterations, probe_count);
+		bench_result_add_counter(result, "hits", hit_count);
+	}
+}
+
+/* How far a moving collider gets per step, and how big they are */
+#define BENCH_DYNAMIC_STEP_DISTANCE 0.05f
+#define BENCH_DYNAMIC_RADIUS 0.5f
+
+DynamicShape bench_dynamic_shape(int index, Vector3 position) {
+	switch (index % 3) {
+		case 0:  return dynamic_shape_sphere(position, BENCH_DYNAMIC_RADIUS);
+		case 1:  return dynamic_shape_capsule(position, Vector3Add(position, (Vector3) {0.0f, 1.0f, 0.0f}), BENCH_DYNAMIC_RADIUS);
+		default: return dynamic_shape_aabb((BoundingBox) { Vector3SubtractValue(position, BENCH_DYNAMIC_RADIUS), Vector3AddValue(position, BENCH_DYNAMIC_RADIUS) });
+	}
+}
+
+/**
+* Players and enemies walking around the static scene. Updating after everything took a small step is the case
+* the incremental sort is for, updating after everything teleported is its worst case (it falls back to qsort).
+*/
+void bench_dynamic_colliders(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng, const SpacialHash* spacial_hash, BoundingBox world_bound) {
+	int count = config->dynamic_count;
+	if (count <= 0) { return; }
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	Vector3* positions = arena_alloc(bench_arena, sizeof(*positions) * count);
+	Vector3* velocities = arena_alloc(bench_arena, sizeof(*velocities) * count);
+
+	DynamicColliderSet set;
+	dynamic_colliders_init(&set, count);
+	for (int i = 0; i < count; i++) {
+		positions[i] = (Vector3) {
+			bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+			bench_random_f32(rng, world_bound.min.y, world_bound.min.y + 3.0f),
+			bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+		};
+		f32 angle = bench_random_f32(rng, 0.0f, 2.0f * PI);
+		velocities[i] = (Vector3) { cosf(angle) * BENCH_DYNAMIC_STEP_DISTANCE, 0.0f, sinf(angle) * BENCH_DYNAMIC_STEP_DISTANCE };
+
+		dynamic_collider_add(&set, (DynamicCollider) {
+			.shape = bench_dynamic_shape(i, positions[i]),
+			.layer = (i % 8 == 0) ? MASK_PLAYER : MASK_ENEMIES,
+			.collide_mask = (i % 8 == 0) ? MASK_ALL : (MASK_PLAYER | MASK_STATIC_GEOMETRY),
+		});
+	}
+	dynamic_colliders_update(&set);
+
+	/* dynamic_colliders_update after a step */
+	int sort_moves = 0;
+	for (int it = 0; it < config->iterations; it++) {
+		for (int i = 0; i < count; i++) {
+			positions[i] = Vector3Add(positions[i], velocities[i]);
+			dynamic_collider_set_shape(&set, i, bench_dynamic_shape(i, positions[i]));
+		}
+
+		u64 start = platform_dependent_time_nanoseconds();
+		dynamic_colliders_update(&set);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		sort_moves = set.last_sort_moves;
+	}
+	BenchResult* coherent_result = bench_record(report, "dynamic_colliders_update", samples, config->iterations, count);
+	bench_result_add_counter(coherent_result, "sort_moves", sort_moves);
+
+	/* dynamic_colliders_find_pairs */
+	u64 pairs_start = arena_save(bench_arena);
+	int pair_count = 0;
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(bench_arena, pairs_start);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		pair_count = dynamic_colliders_find_pairs(bench_arena, &set).length;
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* pairs_result = bench_record(report, "dynamic_colliders_find_pairs", samples, config->iterations, count);
+	bench_result_add_counter(pairs_result, "pairs", pair_count);
+
+	/* dynamic_colliders_find_static_pairs against the scene */
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(bench_arena, pairs_start);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		pair_count = dynamic_colliders_find_static_pairs(bench_arena, &set, spacial_hash).length;
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	arena_restore(bench_arena, pairs_start);
+	BenchResult* static_result = bench_record(report, "dynamic_colliders_find_static_pairs", samples, config->iterations, count);
+	bench_result_add_counter(static_result, "pairs", pair_count);
+
+	/* dynamic_colliders_update after everything teleported */
+	bool fell_back = false;
+	for (int it = 0; it < config->iterations; it++) {
+		for (int i = 0; i < count; i++) {
+			positions[i].x = bench_random_f32(rng, world_bound.min.x, world_bound.max.x);
+			positions[i].z = bench_random_f32(rng, world_bound.min.z, world_bound.max.z);
+			dynamic_collider_set_shape(&set, i, bench_dynamic_shape(i, positions[i]));
+		}
+
+		u64 start = platform_dependent_time_nanoseconds();
+		dynamic_colliders_update(&set);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		fell_back = set.last_sort_fell_back;
+	}
+	BenchResult* teleport_result = bench_record(report, "dynamic_colliders_update_teleport", samples, config->iterations, count);
+	bench_result_add_counter(teleport_result, "fell_back", fell_back);
+
+	dynamic_colliders_free(&set);
+}
+
+/* Character sized capsules, and how far they move per sweep */
+#define BENCH_SWEEP_RADIUS 0.4f
+#define BENCH_SWEEP_HEIGHT 1.8f
+#define BENCH_SWEEP_DISTANCE 1.0f
+
+/* As many sweeps as rays, short ones from anywhere in the scene like characters moving around in it */
+void bench_sweeps(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng, u64* samples, const SpacialHash* spacial_hash, BoundingBox world_bound) {
+	CapsuleSweep* sweeps = arena_alloc(bench_arena, sizeof(*sweeps) * config->ray_count);
+	SweepHit* hits = arena_alloc(bench_arena, sizeof(*hits) * config->ray_count);
+	for (int i = 0; i < config->ray_count; i++) {
+		Vector3 start = {
+			bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+			bench_random_f32(rng, 0.5f, 10.0f),
+			bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+		};
+		f32 angle = bench_random_f32(rng, 0.0f, 2.0f * PI);
+		sweeps[i] = (CapsuleSweep) {
+			.start = start,
+			.end = Vector3Add(start, (Vector3) {0.0f, BENCH_SWEEP_HEIGHT - 2.0f * BENCH_SWEEP_RADIUS, 0.0f}),
+			.radius = BENCH_SWEEP_RADIUS,
+			.motion = { cosf(angle) * BENCH_SWEEP_DISTANCE, -0.2f * BENCH_SWEEP_DISTANCE, sinf(angle) * BENCH_SWEEP_DISTANCE },
+		};
+	}
+
+	const char* names[2] = { "collision_sweep_capsule", "collision_sweep_sphere" };
+	for (int variant = 0; variant < 2; variant++) {
+		/* The spheres are the capsules' bottom ends */
+		if (variant == 1) {
+			for (int i = 0; i < config->ray_count; i++) { sweeps[i].end = sweeps[i].start; }
+		}
+
+		for (int it = 0; it < config->iterations; it++) {
+			u64 start = platform_dependent_time_nanoseconds();
+			collision_sweep_capsule_batch(spacial_hash, MASK_ALL, sweeps, config->ray_count, hits);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		int hit_count = 0;
+		for (int i = 0; i < config->ray_count; i++) { hit_count += (hits[i].collider != NULL); }
+
+		/* Once more, counting what the sweeps looked at */
+		SpacialHashQueryStats stats = {0};
+		SpacialHash counted_hash = *spacial_hash;
+		counted_hash.query_stats = &stats;
+		collision_sweep_capsule_batch(&counted_hash, MASK_ALL, sweeps, config->ray_count, hits);
+
+		BenchResult* result = bench_record(report, names[variant], samples, config->iterations, config->ray_count);
+		bench_result_add_counter(result, "hits", hit_count);
+		bench_result_add_counter(result, "cells_per_sweep", (f64)stats.cell_count / (f64)MAX2(stats.query_count, 1));
+		bench_result_add_counter(result, "triangles_per_sweep", (f64)stats.entry_count / (f64)MAX2(stats.query_count, 1));
+	}
+}
+
+/* Half the size of the overlap query boxes, and the radius of the spheres */
+#define BENCH_OVERLAP_EXTENT 2.0f
+/* Frustums cover far more than a box, there's one for every this many boxes */
+#define BENCH_OVERLAP_FRUSTUM_RATIO 16
+#define BENCH_OVERLAP_FAR_PLANE 40.0f
+#define BENCH_OVERLAP_MAX_ENTITIES 4096
+
+/**
+* As many AABB and sphere overlap queries as rays, from anywhere in the scene, and fewer frustums looking at it from
+* above. The AABBs run again without triangle stamps, to see what testing triangles once per cell they're in costs.
+*/
+void bench_overlaps(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng, u64* samples, const SpacialHash* spacial_hash, BoundingBox world_bound) {
+	int entity_capacity = 1;
+	for (int i = 0; i < spacial_hash->collider_count; i++) {
+		entity_capacity = MAX2(entity_capacity, (int)entity_handle_index(spacial_hash->colliders[i].entity_id) + 1);
+	}
+	OverlapStamps stamps = collision_overlap_stamps_create(bench_arena, spacial_hash->collider_count, entity_capacity);
+	OverlapStamps entity_stamps_only = collision_overlap_stamps_create(bench_arena, 0, entity_capacity);
+	EntityHandle* entities = arena_alloc(bench_arena, sizeof(*entities) * BENCH_OVERLAP_MAX_ENTITIES);
+
+	/* Near the ground, where most of the scene is */
+	Vector3* centers = arena_alloc(bench_arena, sizeof(*centers) * config->ray_count);
+	for (int i = 0; i < config->ray_count; i++) {
+		centers[i] = (Vector3) {
+			bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+			bench_random_f32(rng, world_bound.min.y, MIN2(world_bound.min.y + 4.0f * BENCH_OVERLAP_EXTENT, world_bound.max.y)),
+			bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+		};
+	}
+	int frustum_count = MAX2(config->ray_count / BENCH_OVERLAP_FRUSTUM_RATIO, 1);
+	Frustum* frustums = arena_alloc(bench_arena, sizeof(*frustums) * frustum_count);
+	for (int i = 0; i < frustum_count; i++) {
+		Vector3 eye = { centers[i].x, world_bound.max.y + 5.0f, centers[i].z };
+		Vector3 target = { centers[i].x + bench_random_f32(rng, -20.0f, 20.0f), world_bound.min.y, centers[i].z + bench_random_f32(rng, -20.0f, 20.0f) };
+		Matrix projection = MatrixPerspective(60.0 * DEG2RAD, 16.0 / 9.0, 0.1, BENCH_OVERLAP_FAR_PLANE);
+		frustums[i] = math_frustum_from_matrix(MatrixMultiply(MatrixLookAt(eye, target, VECTOR3_UP), projection));
+	}
+
+	const char* names[4] = { "collision_overlap_aabb", "collision_overlap_aabb_entity_stamps_only", "collision_overlap_sphere", "collision_overlap_frustum" };
+	for (int variant = 0; variant < 4; variant++) {
+		int query_count = (variant == 3) ? frustum_count : config->ray_count;
+		OverlapStamps* variant_stamps = (variant == 1) ? &entity_stamps_only : &stamps;
+		SpacialHashQueryStats stats = {0};
+		SpacialHash counted_hash = *spacial_hash;
+		u64 found = 0;
+
+		/* The last iteration counts what the queries looked at */
+		for (int it = 0; it <= config->iterations; it++) {
+			counted_hash.query_stats = (it == config->iterations) ? &stats : NULL;
+			found = 0;
+
+			u64 start = platform_dependent_time_nanoseconds();
+			for (int i = 0; i < query_count; i++) {
+				Vector3 extents = { BENCH_OVERLAP_EXTENT, BENCH_OVERLAP_EXTENT, BENCH_OVERLAP_EXTENT };
+				BoundingBox box = { Vector3Subtract(centers[i], extents), Vector3Add(centers[i], extents) };
+				switch (variant) {
+					case 0: case 1: found += (u64)collision_overlap_aabb(&counted_hash, variant_stamps, MASK_ALL, box, entities, BENCH_OVERLAP_MAX_ENTITIES); break;
+					case 2: found += (u64)collision_overlap_sphere(&counted_hash, variant_stamps, MASK_ALL, centers[i], BENCH_OVERLAP_EXTENT, entities, BENCH_OVERLAP_MAX_ENTITIES); break;
+					case 3: found += (u64)collision_overlap_frustum(&counted_hash, variant_stamps, MASK_ALL, &frustums[i], entities, BENCH_OVERLAP_MAX_ENTITIES); break;
+				}
+			}
+			if (it < config->iterations) { samples[it] = platform_dependent_time_nanoseconds() - start; }
+		}
+
+		BenchResult* result = bench_record(report, names[variant], samples, config->iterations, query_count);
+		bench_result_add_counter(result, "entities_per_query", (f64)found / (f64)query_count);
+		bench_result_add_counter(result, "cells_per_query", (f64)stats.cell_count / (f64)MAX2(stats.query_count, 1));
+		bench_result_add_counter(result, "triangles_per_query", (f64)stats.entry_count / (f64)MAX2(stats.query_count, 1));
+	}
+}
+
+void bench_collision(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	Arena model_arena = { .name = "model_data" };
+	Arena scene_arena = { .name = "scene" };
+	Arena collider_data_arena = { .name = "collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&scene_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	StaticObjectArray scene = bench_create_scene(&scene_arena, config, rng);
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+
+	/* static_object_loop, with the bounding box coming out of it for free */
+	TriangleColliderArray colliders = {0};
+	BoundingBox generated_bound = {0};
+	BenchSystemCounters before = bench_system_counters_read();
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(&collider_data_arena, 0);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		colliders = static_object_loop(&collider_data_arena, scene, model_prefabs, &generated_bound);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* loop_result = bench_record(report, "static_object_loop", samples, config->iterations, colliders.length);
+	bench_result_add_system_deltas(loop_result, before, bench_system_counters_read(), config->iterations);
+
+	/* entity_collider_loop, the same scene stored as entities */
+	{
+		EntityStore entities;
+		entity_store_init(&entities);
+		bench_create_entities(&entities, scene);
+
+		before = bench_system_counters_read();
+		for (int it = 0; it < config->iterations; it++) {
+			arena_restore(&collider_data_arena, 0);
+
+			u64 start = platform_dependent_time_nanoseconds();
+			colliders = entity_collider_loop(&collider_data_arena, &entities, model_prefabs, &generated_bound);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		BenchResult* entity_result = bench_record(report, "entity_collider_loop", samples, config->iterations, colliders.length);
+		bench_result_add_system_deltas(entity_result, before, bench_system_counters_read(), config->iterations);
+
+		entity_store_free(&entities);
+	}
+
+	/* The colliders from the last iteration stay alive below this point for the rest of the benchmarks */
+	u64 colliders_end = arena_save(&collider_data_arena);
+
+	/* collision_get_world_bounding_box */
+	BoundingBox world_bound = {0};
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		world_bound = collision_get_world_bounding_box(colliders);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "collision_get_world_bounding_box", samples, config->iterations, colliders.length);
+	ASSERT(Vector3Equals(world_bound.min, generated_bound.min) && Vector3Equals(world_bound.max, generated_bound.max));
+
+	/* collision_spacial_hash_create */
+	SpacialHash spacial_hash = {0};
+	before = bench_system_counters_read();
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(&collider_data_arena, colliders_end);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		spacial_hash = collision_spacial_hash_create(&collider_data_arena, colliders);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* hash_result = bench_record(report, "collision_spacial_hash_create", samples, config->iterations, colliders.length);
+	bench_result_add_system_deltas(hash_result, before, bench_system_counters_read(), config->iterations);
+	bench_spacial_hash_add_counters(hash_result, &spacial_hash, colliders);
+	bench_result_add_counter(hash_result, "bytes", (f64)(arena_save(&collider_data_arena) - colliders_end));
+
+	/* collision_raycast */
+	if (config->ray_count > 0) {
+		Vector3* origins = arena_alloc(bench_arena, sizeof(*origins) * config->ray_count);
+		Vector3* directions = arena_alloc(bench_arena, sizeof(*directions) * config->ray_count);
+		bench_create_rays(origins, directions, config->ray_count, world_bound, rng);
+
+		int hits = bench_cast_rays(&spacial_hash, origins, directions, config->ray_count, samples, config->iterations);
+		BenchResult* ray_result = bench_record(report, "collision_raycast", samples, config->iterations, config->ray_count);
+		bench_result_add_counter(ray_result, "hits", hits);
+
+		/* Nothing in the scene is an enemy, so this is all rejecting cells and triangles by their layer */
+		hits = 0;
+		for (int it = 0; it < config->iterations; it++) {
+			hits = 0;
+			u64 start = platform_dependent_time_nanoseconds();
+			for (int i = 0; i < config->ray_count; i++) {
+				hits += (collision_raycast(&spacial_hash, MASK_ENEMIES, origins[i], directions[i], 1000.0f).collider != NULL);
+			}
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		ASSERT(hits == 0);
+		bench_record(report, "collision_raycast_enemies", samples, config->iterations, config->ray_count);
+
+		const char* tuned_names[2] = { "collision_spacial_hash_create_tuned", "collision_raycast_tuned" };
+		bench_tuned_collision(report, &collider_data_arena, config, samples, colliders, world_bound, SPACIAL_HASH_DENSE, origins, directions, tuned_names);
+
+		bench_sweeps(report, bench_arena, config, rng, samples, &spacial_hash, world_bound);
+		bench_overlaps(report, bench_arena, config, rng, samples, &spacial_hash, world_bound);
+	}
+
+	bench_dynamic_colliders(report, bench_arena, config, rng, &spacial_hash, world_bound);
+
+	arena_free(&collider_data_arena);
+	arena_free(&scene_arena);
+	arena_free(&model_arena);
+}
+
+/* How much bench_terrain_collision stretches terrain tiles, so their triangles are wider than a cell */
+#define BENCH_COARSE_TERRAIN_SCALE 6.0f
+
+/* Heightmap resolution for the terrain ground probes */
+#define BENCH_HEIGHTMAP_SAMPLES_PER_CELL 4
+
+/**
+* Terrain on its own, with long sloped triangles turned away from the grid axes, like ramps and low detail
+* heightfields. This is where inserting triangles into their whole bounding rectangle hurts the most.
+*/
+void bench_terrain_collision(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	if (config->terrain_tile_count <= 0) { return; }
+
+	Arena model_arena = { .name = "terrain_model_data" };
+	Arena collider_data_arena = { .name = "terrain_collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+
+	int tiles_per_row = (int)math_f32_ceiling(sqrtf((f32)config->terrain_tile_count));
+	f32 tile_width = BENCH_TERRAIN_TILE_QUADS * BENCH_TERRAIN_QUAD_WIDTH * BENCH_COARSE_TERRAIN_SCALE;
+	Quaternion rotation = QuaternionFromAxisAngle(VECTOR3_UP, PI / 6.0f);
+	StaticObject* objects = arena_alloc(bench_arena, sizeof(*objects) * config->terrain_tile_count);
+	for (int tile = 0; tile < config->terrain_tile_count; tile++) {
+		Vector3 offset = { (tile % tiles_per_row) * tile_width, 0.0f, (tile / tiles_per_row) * tile_width };
+		objects[tile] = (StaticObject) {
+			.id = (ModelID)BENCH_MODEL_TERRAIN_TILE,
+			.layer = MASK_STATIC_GEOMETRY,
+			.transform = {
+				.translation = Vector3RotateByQuaternion(offset, rotation),
+				.rotation = rotation,
+				.scale = { BENCH_COARSE_TERRAIN_SCALE, BENCH_COARSE_TERRAIN_SCALE, BENCH_COARSE_TERRAIN_SCALE },
+			},
+		};
+	}
+
+	BoundingBox world_bound = {0};
+	TriangleColliderArray colliders = static_object_loop(&collider_data_arena, (StaticObjectArray) { .objects = objects, .len = config->terrain_tile_count }, model_prefabs, &world_bound);
+	u64 colliders_end = arena_save(&collider_data_arena);
+
+	SpacialHash spacial_hash = {0};
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(&collider_data_arena, colliders_end);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		spacial_hash = collision_spacial_hash_create_with_bounds(&collider_data_arena, colliders, world_bound);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* hash_result = bench_record(report, "collision_spacial_hash_create_terrain", samples, config->iterations, colliders.length);
+	bench_spacial_hash_add_counters(hash_result, &spacial_hash, colliders);
+
+	if (config->ray_count > 0) {
+		Vector3* origins = arena_alloc(bench_arena, sizeof(*origins) * config->ray_count);
+		Vector3* directions = arena_alloc(bench_arena, sizeof(*directions) * config->ray_count);
+		bench_create_rays(origins, directions, config->ray_count, world_bound, rng);
+
+		int hits = bench_cast_rays(&spacial_hash, origins, directions, config->ray_count, samples, config->iterations);
+		BenchResult* ray_result = bench_record(report, "collision_raycast_terrain", samples, config->iterations, config->ray_count);
+		bench_result_add_counter(ray_result, "hits", hits);
+
+		const char* tuned_names[2] = { "collision_spacial_hash_create_terrain_tuned", "collision_raycast_terrain_tuned" };
+		bench_tuned_collision(report, &collider_data_arena, config, samples, colliders, world_bound, SPACIAL_HASH_DENSE, origins, directions, tuned_names);
+	}
+
+	/* Static terrain is where a heightmap makes sense, built once up front */
+	u64 start = platform_dependent_time_nanoseconds();
+	GroundHeightmap heightmap = collision_ground_heightmap_create(&collider_data_arena, &spacial_hash, MASK_ALL, BENCH_HEIGHTMAP_SAMPLES_PER_CELL);
+	samples[0] = platform_dependent_time_nanoseconds() - start;
+	bench_record(report, "collision_ground_heightmap_create_terrain", samples, 1, heightmap.x_count * heightmap.z_count);
+
+	const char* probe_names[3] = { "collision_raycast_down_terrain", "collision_ground_height_terrain", "collision_ground_heightmap_terrain" };
+	bench_ground_probes(report, bench_arena, config, rng, &spacial_hash, &heightmap, world_bound.max.y + 1.0f, probe_names);
+
+	arena_free(&collider_data_arena);
+	arena_free(&model_arena);
+}
+
+/* Floors stacked by bench_multistorey_collision, and how far apart they are */
+#define BENCH_STOREY_COUNT 16
+#define BENCH_STOREY_HEIGHT 6.0f
+
+/**
+* A tower of terrain floors on top of each other, so every column holds many triangles at different heights,
+* like a multi-storey level. Rays start between two floors and mostly point down, like ground probes.
+*/
+void bench_multistorey_collision(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	int tiles_per_floor = config->terrain_tile_count / 4;
+	if (tiles_per_floor <= 0) { return; }
+
+	Arena model_arena = { .name = "multistorey_model_data" };
+	Arena collider_data_arena = { .name = "multistorey_collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+
+	int tiles_per_row = (int)math_f32_ceiling(sqrtf((f32)tiles_per_floor));
+	f32 tile_width = BENCH_TERRAIN_TILE_QUADS * BENCH_TERRAIN_QUAD_WIDTH;
+	int object_count = tiles_per_floor * BENCH_STOREY_COUNT;
+	StaticObject* objects = arena_alloc(bench_arena, sizeof(*objects) * object_count);
+	for (int i = 0; i < object_count; i++) {
+		int floor = i / tiles_per_floor;
+		int tile = i % tiles_per_floor;
+		objects[i] = (StaticObject) {
+			.id = (ModelID)BENCH_MODEL_TERRAIN_TILE,
+			.layer = MASK_STATIC_GEOMETRY,
+			.transform = {
+				.translation = { (tile % tiles_per_row) * tile_width, floor * BENCH_STOREY_HEIGHT, (tile / tiles_per_row) * tile_width },
+				.rotation = QuaternionIdentity(),
+				.scale = { 1.0f, 1.0f, 1.0f },
+			},
+		};
+	}
+
+	BoundingBox world_bound = {0};
+	TriangleColliderArray colliders = static_object_loop(&collider_data_arena, (StaticObjectArray) { .objects = objects, .len = object_count }, model_prefabs, &world_bound);
+	u64 colliders_end = arena_save(&collider_data_arena);
+
+	SpacialHash spacial_hash = {0};
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(&collider_data_arena, colliders_end);
+
+		u64 start = platform_dependent_time_nanoseconds();
+		spacial_hash = collision_spacial_hash_create_with_bounds(&collider_data_arena, colliders, world_bound);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* hash_result = bench_record(report, "collision_spacial_hash_create_multistorey", samples, config->iterations, colliders.length);
+	bench_spacial_hash_add_counters(hash_result, &spacial_hash, colliders);
+
+	if (config->ray_count > 0) {
+		Vector3* origins = arena_alloc(bench_arena, sizeof(*origins) * config->ray_count);
+		Vector3* directions = arena_alloc(bench_arena, sizeof(*directions) * config->ray_count);
+		bench_create_rays(origins, directions, config->ray_count, world_bound, rng);
+		for (int i = 0; i < config->ray_count; i++) {
+			origins[i].y = ((f32)(bench_random_u32(rng) % BENCH_STOREY_COUNT) + 0.5f) * BENCH_STOREY_HEIGHT;
+		}
+
+		int hits = bench_cast_rays(&spacial_hash, origins, directions, config->ray_count, samples, config->iterations);
+		BenchResult* ray_result = bench_record(report, "collision_raycast_multistorey", samples, config->iterations, config->ray_count);
+		bench_result_add_counter(ray_result, "hits", hits);
+
+		const char* tuned_names[2] = { "collision_spacial_hash_create_multistorey_tuned", "collision_raycast_multistorey_tuned" };
+		bench_tuned_collision(report, &collider_data_arena, config, samples, colliders, world_bound, SPACIAL_HASH_DENSE, origins, directions, tuned_names);
+	}
+
+	/* Probes from the middle of the tower, so half the floors are above them */
+	const char* probe_names[3] = { "collision_raycast_down_multistorey", "collision_ground_height_multistorey", NULL };
+	bench_ground_probes(report, bench_arena, config, rng, &spacial_hash, NULL, (BENCH_STOREY_COUNT / 2 + 0.5f) * BENCH_STOREY_HEIGHT, probe_names);
+
+	arena_free(&collider_data_arena);
+	arena_free(&model_arena);
+}
+
+/* How far apart bench_sparse_collision puts its two islands, on both X and Z */
+#define BENCH_ISLAND_DISTANCE 2000.0f
+
+/**
+* Two islands of terrain far apart, like an open world with a few places in it. A dense grid stores every empty cell
+* of the ocean between them, a sparse one only the cells the islands touch. Rays start over either island.
+*/
+void bench_sparse_collision(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	int tiles_per_island = config->terrain_tile_count / 4;
+	if (tiles_per_island <= 0) { return; }
+
+	Arena model_arena = { .name = "sparse_model_data" };
+	Arena collider_data_arena = { .name = "sparse_collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+
+	int tiles_per_row = (int)math_f32_ceiling(sqrtf((f32)tiles_per_island));
+	f32 tile_width = BENCH_TERRAIN_TILE_QUADS * BENCH_TERRAIN_QUAD_WIDTH;
+	int object_count = tiles_per_island * 2;
+	StaticObject* objects = arena_alloc(bench_arena, sizeof(*objects) * object_count);
+	for (int i = 0; i < object_count; i++) {
+		int tile = i % tiles_per_island;
+		f32 island_offset = (i < tiles_per_island) ? 0.0f : BENCH_ISLAND_DISTANCE;
+		objects[i] = (StaticObject) {
+			.id = (ModelID)BENCH_MODEL_TERRAIN_TILE,
+			.layer = MASK_STATIC_GEOMETRY,
+			.transform = {
+				.translation = { island_offset + (tile % tiles_per_row) * tile_width, 0.0f, island_offset + (tile / tiles_per_row) * tile_width },
+				.rotation = QuaternionIdentity(),
+				.scale = { 1.0f, 1.0f, 1.0f },
+			},
+		};
+	}
+
+	BoundingBox world_bound = {0};
+	TriangleColliderArray colliders = static_object_loop(&collider_data_arena, (StaticObjectArray) { .objects = objects, .len = object_count }, model_prefabs, &world_bound);
+	u64 colliders_end = arena_save(&collider_data_arena);
+
+	Vector3* origins = NULL;
+	Vector3* directions = NULL;
+	if (config->ray_count > 0) {
+		origins = arena_alloc(bench_arena, sizeof(*origins) * config->ray_count);
+		directions = arena_alloc(bench_arena, sizeof(*directions) * config->ray_count);
+		BoundingBox island_bound = { world_bound.min, { world_bound.min.x + tiles_per_row * tile_width, world_bound.max.y, world_bound.min.z + tiles_per_row * tile_width } };
+		bench_create_rays(origins, directions, config->ray_count, island_bound, rng);
+		for (int i = 1; i < config->ray_count; i += 2) {
+			origins[i].x += BENCH_ISLAND_DISTANCE;
+			origins[i].z += BENCH_ISLAND_DISTANCE;
+		}
+	}
+
+	local_persistent const char* create_names[2] = { "collision_spacial_hash_create_islands_dense", "collision_spacial_hash_create_islands_sparse" };
+	local_persistent const char* ray_names[2] = { "collision_raycast_islands_dense", "collision_raycast_islands_sparse" };
+	int dense_hits = -1;
+	for (int mode = SPACIAL_HASH_DENSE; mode <= SPACIAL_HASH_SPARSE; mode++) {
+		SpacialHash spacial_hash = {0};
+		for (int it = 0; it < config->iterations; it++) {
+			arena_restore(&collider_data_arena, colliders_end);
+
+			u64 start = platform_dependent_time_nanoseconds();
+			spacial_hash = collision_spacial_hash_create_with_mode(&collider_data_arena, colliders, world_bound, (SpacialHashMode)mode);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		BenchResult* hash_result = bench_record(report, create_names[mode], samples, config->iterations, colliders.length);
+		bench_spacial_hash_add_counters(hash_result, &spacial_hash, colliders);
+		bench_result_add_counter(hash_result, "bytes", (f64)(arena_save(&collider_data_arena) - colliders_end));
+
+		if (config->ray_count > 0) {
+			int hits = bench_cast_rays(&spacial_hash, origins, directions, config->ray_count, samples, config->iterations);
+			BenchResult* ray_result = bench_record(report, ray_names[mode], samples, config->iterations, config->ray_count);
+			bench_result_add_counter(ray_result, "hits", hits);
+
+			/* Both modes hold the same cells, so they have to agree on every ray */
+			ASSERT(dense_hits < 0 || hits == dense_hits);
+			dense_hits = hits;
+		}
+	}
+
+	if (config->ray_count > 0) {
+		arena_restore(&collider_data_arena, colliders_end);
+		const char* tuned_names[2] = { "collision_spacial_hash_create_islands_sparse_tuned", "collision_raycast_islands_sparse_tuned" };
+		bench_tuned_collision(report, &collider_data_arena, config, samples, colliders, world_bound, SPACIAL_HASH_SPARSE, origins, directions, tuned_names);
+	}
+
+	arena_free(&collider_data_arena);
+	arena_free(&model_arena);
+}
+
+void bench_hash_map(BenchReport* report, Arena* bench_arena, const BenchConfig* config) {
+	int count = config->hash_key_count;
+	if (count <= 0) { return; }
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+
+	String* keys = arena_alloc(bench_arena, sizeof(*keys) * count);
+	int* values = arena_alloc(bench_arena, sizeof(*values) * count);
+	for (int i = 0; i < count; i++) {
+		char buffer[32];
+		int length = snprintf(buffer, sizeof(buffer), "entity_%08d", i);
+		keys[i] = string_copy(bench_arena, (String) { .str = buffer, .length = length });
+		values[i] = i;
+	}
+
+	Arena hash_arena = { .name = "hash" };
+	arena_init(&hash_arena, BENCH_ARENA_RESERVATION);
+
+	/* Keep the load factor at 1/4 so the quadratic probe always finds a slot */
+	HashMap map = {0};
+	for (int it = 0; it < config->iterations; it++) {
+		arena_restore(&hash_arena, 0);
+		map = (HashMap) { .table_size = (u64)count * 4 };
+
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count; i++) {
+			hash_push(&map, &hash_arena, keys[i].str, keys[i].length, &values[i]);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "hash_push", samples, config->iterations, count);
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int i = 0; i < count; i++) {
+			void* value = hash_get(map, keys[i].str, keys[i].length);
+			ASSERT(value == &values[i]);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	bench_record(report, "hash_get", samples, config->iterations, count);
+
+	arena_free(&hash_arena);
+}
+
+#define BENCH_BATCH_MATH_POINTS (1 << 16)
+
+/* The batch math against its plain C twin, on the same points */
+void bench_batch_math(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	Vector3* points = arena_alloc(bench_arena, sizeof(*points) * BENCH_BATCH_MATH_POINTS);
+	Vector3* transformed = arena_alloc(bench_arena, sizeof(*transformed) * BENCH_BATCH_MATH_POINTS);
+	for (int i = 0; i < BENCH_BATCH_MATH_POINTS; i++) {
+		points[i] = (Vector3) { bench_random_f32(rng, -100.0f, 100.0f), bench_random_f32(rng, -10.0f, 10.0f), bench_random_f32(rng, -100.0f, 100.0f) };
+	}
+	Matrix matrix = math_transform_to_matrix((Transform) {
+		.translation = (Vector3) {1.0f, 2.0f, 3.0f},
+		.rotation = QuaternionFromAxisAngle(VECTOR3_UP, 0.5f),
+		.scale = (Vector3) {1.0f, 1.0f, 1.0f},
+	});
+
+	f32 checksum = 0.0f;
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		math_batch_transform_points_scalar(transformed, points, BENCH_BATCH_MATH_POINTS, matrix);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += transformed[it % BENCH_BATCH_MATH_POINTS].x;
+	}
+	BenchResult* scalar_transform = bench_record(report, "batch_transform_points_scalar", samples, config->iterations, BENCH_BATCH_MATH_POINTS);
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		math_batch_transform_points(transformed, points, BENCH_BATCH_MATH_POINTS, matrix);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += transformed[it % BENCH_BATCH_MATH_POINTS].x;
+	}
+	BenchResult* simd_transform = bench_record(report, "batch_transform_points", samples, config->iterations, BENCH_BATCH_MATH_POINTS);
+	bench_result_add_counter(simd_transform, "speedup", (f64)scalar_transform->median_ns / (f64)MAX2(simd_transform->median_ns, 1));
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		BoundingBox box = math_batch_aabb_scalar(points, BENCH_BATCH_MATH_POINTS);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += box.min.x;
+	}
+	BenchResult* scalar_aabb = bench_record(report, "batch_aabb_scalar", samples, config->iterations, BENCH_BATCH_MATH_POINTS);
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		BoundingBox box = math_batch_aabb(points, BENCH_BATCH_MATH_POINTS);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += box.min.x;
+	}
+	BenchResult* simd_aabb = bench_record(report, "batch_aabb", samples, config->iterations, BENCH_BATCH_MATH_POINTS);
+	bench_result_add_counter(simd_aabb, "speedup", (f64)scalar_aabb->median_ns / (f64)MAX2(simd_aabb->median_ns, 1));
+
+	/* The points three at a time as triangles, swept by a capsule */
+	int triangle_count = BENCH_BATCH_MATH_POINTS / 3;
+	const Vector3** triangles = arena_alloc(bench_arena, sizeof(*triangles) * triangle_count);
+	f32* times = arena_alloc(bench_arena, sizeof(*times) * triangle_count);
+	for (int i = 0; i < triangle_count; i++) { triangles[i] = &points[3 * i]; }
+	Vector3 capsule_start = { 0.0f, -1.0f, 0.0f };
+	Vector3 capsule_end = { 0.0f, 1.0f, 0.0f };
+	Vector3 motion = { 10.0f, 0.0f, 5.0f };
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		math_batch_sweep_capsule_triangles_scalar(times, capsule_start, capsule_end, 0.5f, motion, triangles, triangle_count);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += times[it % triangle_count];
+	}
+	BenchResult* scalar_sweep = bench_record(report, "batch_sweep_capsule_scalar", samples, config->iterations, triangle_count);
+
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		math_batch_sweep_capsule_triangles(times, capsule_start, capsule_end, 0.5f, motion, triangles, triangle_count);
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+		checksum += times[it % triangle_count];
+	}
+	BenchResult* simd_sweep = bench_record(report, "batch_sweep_capsule", samples, config->iterations, triangle_count);
+	bench_result_add_counter(simd_sweep, "speedup", (f64)scalar_sweep->median_ns / (f64)MAX2(simd_sweep->median_ns, 1));
+
+	/* Keeps the loops from being optimized away */
+	if (checksum == 12345.0f) { printf(" "); }
+}
+
+#endif
+
+#define BENCH_PARALLEL_FOR_COUNT (1 << 20)
+#define BENCH_PARALLEL_FOR_GRAIN_SIZE 4096
+#define BENCH_EMPTY_JOB_COUNT 10000
+
+typedef struct BenchKernel {
+	const f32* input;
+	f32* output;
+} BenchKernel;
+
+/* Enough math per element that the loop is compute bound rather than bandwidth bound */
+void bench_kernel_range(void* user_data, int start, int end) {
+	BenchKernel* kernel = user_data;
+	for (int i = start; i < end; i++) {
+		f32 x = kernel->input[i];
+		kernel->output[i] = sqrtf(x) * sinf(x) + cosf(x * 0.5f);
+	}
+}
+
+void bench_empty_job(void* user_data) {
+	(void)user_data;
+}
+
+/* Doubles, but always ends on max_threads itself */
+int bench_next_thread_count(int threads, int max_threads) {
+	if (threads < max_threads && threads * 2 > max_threads) {
+		return max_threads;
+	}
+	return threads * 2;
+}
+
+/**
+* Job system scalability. Each workload runs with 1, 2, 4... threads up to config->max_threads,
+* and reports its speedup over the single threaded run.
+*/
+void bench_jobs(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	Arena model_arena = { .name = "model_data" };
+	Arena scene_arena = { .name = "scene" };
+	Arena collider_data_arena = { .name = "collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&scene_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	EntityStore entities;
+	entity_store_init(&entities);
+	bench_create_entities(&entities, bench_create_scene(&scene_arena, config, rng));
+
+	BenchKernel kernel = {
+		.input = arena_alloc(bench_arena, sizeof(f32) * BENCH_PARALLEL_FOR_COUNT),
+		.output = arena_alloc(bench_arena, sizeof(f32) * BENCH_PARALLEL_FOR_COUNT),
+	};
+	for (int i = 0; i < BENCH_PARALLEL_FOR_COUNT; i++) {
+		((f32*)kernel.input)[i] = bench_random_f32(rng, 0.0f, 100.0f);
+	}
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	u64 single_thread_ns[3] = {0};
+
+	for (int threads = 1; threads <= config->max_threads; threads = bench_next_thread_count(threads, config->max_threads)) {
+		job_system_init(threads);
+
+		/* parallel_for over a compute bound kernel */
+		for (int it = 0; it < config->iterations; it++) {
+			u64 start = platform_dependent_time_nanoseconds();
+			parallel_for(BENCH_PARALLEL_FOR_COUNT, BENCH_PARALLEL_FOR_GRAIN_SIZE, bench_kernel_range, &kernel);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		BenchResult* kernel_result = bench_record(report, bench_format_name(bench_arena, "parallel_for_threads_", threads), samples, config->iterations, BENCH_PARALLEL_FOR_COUNT);
+
+		/* Submitting and waiting on empty jobs, so this is pure scheduling overhead */
+		for (int it = 0; it < config->iterations; it++) {
+			u64 start = platform_dependent_time_nanoseconds();
+			JobCounter counter = {0};
+			for (int i = 0; i < BENCH_EMPTY_JOB_COUNT; i++) {
+				job_submit(bench_empty_job, NULL, &counter);
+			}
+			job_counter_wait(&counter);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		BenchResult* submit_result = bench_record(report, bench_format_name(bench_arena, "job_submit_threads_", threads), samples, config->iterations, BENCH_EMPTY_JOB_COUNT);
+
+		/* entity_collider_loop over the bench scene */
+		int triangle_count = 0;
+		for (int it = 0; it < config->iterations; it++) {
+			arena_restore(&collider_data_arena, 0);
+
+			u64 start = platform_dependent_time_nanoseconds();
+			triangle_count = entity_collider_loop(&collider_data_arena, &entities, model_prefabs, NULL).length;
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+		}
+		BenchResult* collider_result = bench_record(report, bench_format_name(bench_arena, "entity_collider_loop_threads_", threads), samples, config->iterations, triangle_count);
+
+		u64 stolen = 0;
+		for (int i = 0; i < job_system.worker_count; i++) { stolen += job_system.workers[i].jobs_stolen; }
+
+		BenchResult* results[3] = { kernel_result, submit_result, collider_result };
+		for (int r = 0; r < 3; r++) {
+			if (threads == 1) { single_thread_ns[r] = results[r]->median_ns; }
+			bench_result_add_counter(results[r], "threads", threads);
+			bench_result_add_counter(results[r], "speedup", (f64)single_thread_ns[r] / (f64)MAX2(results[r]->median_ns, 1));
+		}
+		bench_result_add_counter(submit_result, "jobs_stolen", (f64)stolen);
+
+		job_system_shutdown();
+	}
+
+	entity_store_free(&entities);
+	arena_free(&collider_data_arena);
+	arena_free(&scene_arena);
+	arena_free(&model_arena);
+}
+
+/* Agents moved every frame, and how far they walk in one */
+#define BENCH_CHARACTER_COUNT 1000
+#define BENCH_CHARACTER_STEP_DISTANCE 0.09f
+#define BENCH_CHARACTER_GRAVITY_STEP 0.1f
+#define BENCH_CHARACTER_SPAWN_ATTEMPTS 64
+
+/**
+* A frame of character_controllers_move for BENCH_CHARACTER_COUNT agents walking around the bench scene, with 1, 2,
+* 4... threads like bench_jobs. Every thread count starts from the same agents, dropped onto the ground beforehand.
+*/
+void bench_character_controllers(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	Arena model_arena = { .name = "model_data" };
+	Arena scene_arena = { .name = "scene" };
+	Arena collider_data_arena = { .name = "collider_data" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&scene_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&collider_data_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	BoundingBox world_bound = {0};
+	TriangleColliderArray colliders = static_object_loop(&collider_data_arena, bench_create_scene(&scene_arena, config, rng), model_prefabs, &world_bound);
+	SpacialHash spacial_hash = collision_spacial_hash_create(&collider_data_arena, colliders);
+
+	CharacterController* spawned = arena_alloc(bench_arena, sizeof(*spawned) * BENCH_CHARACTER_COUNT);
+	CharacterController* controllers = arena_alloc(bench_arena, sizeof(*controllers) * BENCH_CHARACTER_COUNT);
+	Vector3* motions = arena_alloc(bench_arena, sizeof(*motions) * BENCH_CHARACTER_COUNT);
+	Vector3* drops = arena_alloc(bench_arena, sizeof(*drops) * BENCH_CHARACTER_COUNT);
+	for (int i = 0; i < BENCH_CHARACTER_COUNT; i++) {
+		/* Somewhere above something to stand on */
+		Vector3 spawn = {0};
+		for (int attempt = 0; attempt < BENCH_CHARACTER_SPAWN_ATTEMPTS; attempt++) {
+			spawn = (Vector3) {
+				bench_random_f32(rng, world_bound.min.x, world_bound.max.x),
+				world_bound.max.y + 1.0f,
+				bench_random_f32(rng, world_bound.min.z, world_bound.max.z),
+			};
+			if (collision_ground_height(&spacial_hash, spawn.x, spawn.z, spawn.y, MASK_STATIC_GEOMETRY).collider != NULL) { break; }
+		}
+		spawned[i] = character_controller_create(spawn, BENCH_SWEEP_RADIUS, BENCH_SWEEP_HEIGHT, MASK_STATIC_GEOMETRY);
+		f32 angle = bench_random_f32(rng, 0.0f, 2.0f * PI);
+		motions[i] = (Vector3) { cosf(angle) * BENCH_CHARACTER_STEP_DISTANCE, -BENCH_CHARACTER_GRAVITY_STEP, sinf(angle) * BENCH_CHARACTER_STEP_DISTANCE };
+		drops[i] = (Vector3) { 0.0f, world_bound.min.y - world_bound.max.y - 2.0f, 0.0f };
+	}
+	/* Onto whatever is below them */
+	character_controllers_move(spawned, drops, BENCH_CHARACTER_COUNT, &spacial_hash);
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	u64 single_thread_ns = 0;
+
+	for (int threads = 1; threads <= config->max_threads; threads = bench_next_thread_count(threads, config->max_threads)) {
+		job_system_init(threads);
+		for (int i = 0; i < BENCH_CHARACTER_COUNT; i++) { controllers[i] = spawned[i]; }
+
+		u64 sweeps = 0;
+		int grounded = 0;
+		int stepped = 0;
+		for (int it = 0; it < config->iterations; it++) {
+			u64 start = platform_dependent_time_nanoseconds();
+			character_controllers_move(controllers, motions, BENCH_CHARACTER_COUNT, &spacial_hash);
+			samples[it] = platform_dependent_time_nanoseconds() - start;
+
+			for (int i = 0; i < BENCH_CHARACTER_COUNT; i++) {
+				sweeps += (u64)controllers[i].sweep_count;
+				grounded += controllers[i].grounded;
+				stepped += controllers[i].stepped;
+			}
+		}
+
+		BenchResult* result = bench_record(report, bench_format_name(bench_arena, "character_controllers_move_threads_", threads), samples, config->iterations, BENCH_CHARACTER_COUNT);
+		if (threads == 1) { single_thread_ns = result->median_ns; }
+		f64 moves = (f64)BENCH_CHARACTER_COUNT * (f64)config->iterations;
+		bench_result_add_counter(result, "threads", threads);
+		bench_result_add_counter(result, "speedup", (f64)single_thread_ns / (f64)MAX2(result->median_ns, 1));
+		bench_result_add_counter(result, "sweeps_per_move", (f64)sweeps / moves);
+		bench_result_add_counter(result, "grounded", (f64)grounded / moves);
+		bench_result_add_counter(result, "stepped", (f64)stepped / moves);
+
+		job_system_shutdown();
+	}
+
+	arena_free(&collider_data_arena);
+	arena_free(&scene_arena);
+	arena_free(&model_arena);
+}
+
+#define BENCH_PIPELINE_FRAMES 16
+
+typedef struct BenchPipelineSim {
+	EntityStore* entities;
+	const Model* model_prefabs;
+} BenchPipelineSim;
+
+/* FrameProduceProc. Every entity turns a little each step, then the frame's colliders and snapshot get built. */
+void bench_pipeline_produce(void* user_data, FrameState* state) {
+	BenchPipelineSim* sim = user_data;
+	EntityStore* store = sim->entities;
+	Quaternion turn = QuaternionFromAxisAngle(VECTOR3_UP, 0.01f);
+
+	for (int step = 0; step < state->steps; step++) {
+		for (int i = 0; i < store->count; i++) {
+			Transform transform = store->transforms[i];
+			transform.rotation = QuaternionMultiply(transform.rotation, turn);
+			entity_set_transform(store, store->handles[i], transform);
+		}
+		entity_store_update_hierarchy(store);
+	}
+	state->colliders = entity_collider_loop(&state->arena, store, sim->model_prefabs, NULL);
+	state->entities = entity_snapshot_take(&state->arena, store);
+}
+
+/* Stand-in for drawing, roughly as heavy as building the colliders: every collider vertex goes through a view projection */
+f32 bench_pipeline_render(FrameState* state) {
+	const Matrix* render_matrices = entity_snapshot_interpolate(&state->entities, state->alpha);
+	Matrix view_projection = MatrixMultiply(MatrixLookAt((Vector3) {10.0f, 10.0f, 10.0f}, VECTOR3_ZERO, VECTOR3_UP), MatrixPerspective(0.8, 16.0 / 9.0, 0.1, 1000.0));
+
+	f32 checksum = 0.0f;
+	for (int i = 0; i < state->entities.count; i++) {
+		checksum += render_matrices[i].m12;
+	}
+	for (int i = 0; i < state->colliders.length; i++) {
+		TriangleCollider tri = state->colliders.colliders[i];
+		checksum += Vector3Transform(tri.vert_1, view_projection).z;
+		checksum += Vector3Transform(tri.vert_2, view_projection).z;
+		checksum += Vector3Transform(tri.vert_3, view_projection).z;
+	}
+	return checksum;
+}
+
+/**
+* Frames of simulating two steps and drawing, once back to back on one thread and once through the FramePipeline.
+* With both halves about equally expensive the pipelined run should approach twice the throughput, given a spare core.
+*/
+void bench_pipeline(BenchReport* report, Arena* bench_arena, const BenchConfig* config, u32* rng) {
+	Arena model_arena = { .name = "model_data" };
+	Arena scene_arena = { .name = "scene" };
+	arena_init(&model_arena, BENCH_ARENA_RESERVATION);
+	arena_init(&scene_arena, BENCH_ARENA_RESERVATION);
+
+	Model* model_prefabs = bench_create_model_prefabs(&model_arena);
+	EntityStore entities;
+	entity_store_init(&entities);
+	bench_create_entities(&entities, bench_create_scene(&scene_arena, config, rng));
+	BenchPipelineSim sim = { .entities = &entities, .model_prefabs = model_prefabs };
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * config->iterations);
+	volatile f32 sink = 0.0f;
+
+	/* Serial, the way the editor used to run */
+	FrameState serial_state = { .arena = { .name = "bench_frame_state" }, .steps = 2, .alpha = 0.5f };
+	arena_init(&serial_state.arena, BENCH_ARENA_RESERVATION);
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int frame = 0; frame < BENCH_PIPELINE_FRAMES; frame++) {
+			arena_restore(&serial_state.arena, 0);
+			bench_pipeline_produce(&sim, &serial_state);
+			sink += bench_pipeline_render(&serial_state);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* serial_result = bench_record(report, "frames_serial", samples, config->iterations, BENCH_PIPELINE_FRAMES);
+	arena_free(&serial_state.arena);
+
+	/* Pipelined, simulating the next frame while this one is drawn */
+	FramePipeline pipeline;
+	frame_pipeline_start(&pipeline, BENCH_ARENA_RESERVATION, bench_pipeline_produce, &sim);
+	for (int it = 0; it < config->iterations; it++) {
+		u64 start = platform_dependent_time_nanoseconds();
+		for (int frame = 0; frame < BENCH_PIPELINE_FRAMES; frame++) {
+			FrameState* state = frame_pipeline_swap(&pipeline, 2, 0.5f);
+			sink += bench_pipeline_render(state);
+		}
+		samples[it] = platform_dependent_time_nanoseconds() - start;
+	}
+	BenchResult* pipelined_result = bench_record(report, "frames_pipelined", samples, config->iterations, BENCH_PIPELINE_FRAMES);
+	bench_result_add_counter(pipelined_result, "speedup", (f64)serial_result->median_ns / (f64)MAX2(pipelined_result->median_ns, 1));
+	frame_pipeline_stop(&pipeline);
+	(void)sink;
+
+	entity_store_free(&entities);
+	arena_free(&scene_arena);
+	arena_free(&model_arena);
+}
+
+/**
+* Plays an editor input recording without a window, once. Every frame is a sample, so p99 catches the spikes.
+* The same recording always runs the same simulation steps on the same frames, so two builds are directly comparable.
+*/
+void bench_replay(BenchReport* report, Arena* bench_arena, const BenchConfig* config) {
+	FrameTrace trace = {0};
+	AfterhoursOptions options = {
+		.replay_path = config->replay_path,
+		.trace_path = config->trace_path,
+		.headless = true,
+		.trace = &trace,
+		.trace_arena = bench_arena,
+	};
+	if (afterhours_main(options) != 0 || trace.length == 0) {
+		fprintf(stderr, "Could not replay %s\n", config->replay_path);
+		return;
+	}
+
+	u64* samples = arena_alloc(bench_arena, sizeof(*samples) * trace.length);
+	int total_steps = 0;
+	for (int i = 0; i < trace.length; i++) {
+		samples[i] = trace.frames[i].frame_ns;
+		total_steps += trace.frames[i].steps;
+	}
+	BenchResult* result = bench_record(report, "replay_frame", samples, trace.length, 1);
+	bench_result_add_counter(result, "frames", trace.length);
+	bench_result_add_counter(result, "steps", total_steps);
+}
+
+int main(int argc, char** argv) {
+	BenchConfig config = bench_parse_args(argc, argv);
+	u32 rng = config.seed;
+
+	Arena bench_arena = { .name = "bench" };
+	arena_init(&bench_arena, BENCH_ARENA_RESERVATION);
+
+	BenchReport* report = arena_alloc(&bench_arena, sizeof(*report));
+	report->result_count = 0;
+
+	bench_arena_alloc(report, &bench_arena, &config, &rng);
+	bench_pool(report, &bench_arena, &config, &rng);
+	bench_entity_store(report, &bench_arena, &config, &rng);
+	bench_collision(report, &bench_arena, &config, &rng);
+	bench_terrain_collision(report, &bench_arena, &config, &rng);
+	bench_multistorey_collision(report, &bench_arena, &config, &rng);
+	bench_sparse_collision(report, &bench_arena, &config, &rng);
+	bench_hash_map(report, &bench_arena, &config);
+	bench_batch_math(report, &bench_arena, &config, &rng);
+	bench_jobs(report, &bench_arena, &config, &rng);
+	bench_character_controllers(report, &bench_arena, &config, &rng);
+	bench_pipeline(report, &bench_arena, &config, &rng);
+	if (config.replay_path != NULL) {
+		bench_replay(report, &bench_arena, &config);
+	}
+
+	FILE* out = stdout;
+	if (config.output_path != NULL) {
+		out = fopen(config.output_path, "w");
+		if (out == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", config.output_path);
+			return 1;
+		}
+	}
+
+	bench_write_report(out, &config, report);
+
+	if (out != stdout) { fclose(out); }
+	arena_free(&bench_arena);
+
+	return 0;
+}
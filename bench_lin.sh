@@ -0,0 +1,8 @@
+gcc bench.c -o bench.exe \
+  -g3 -O2 \
+  -Wall -Wextra -Wpedantic \
+  -I libs/include \
+  libs/lib/linux/libraylib.a \
+  -lm -lpthread -ldl -lrt -lX11
+
+./bench.exe "$@"
\ No newline at end of file
@@ -0,0 +1,8 @@
+gcc bench.c -o bench.exe \
+  -g3 -O2 \
+  -Wall -Wextra -Wpedantic \
+  -I libs/include \
+  libs/lib/windows/libraylib.a \
+  -lm -lpthread -ldl -lgdi32 -lwinmm
+
+./bench.exe "$@"
\ No newline at end of file
@@ -0,0 +1,357 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Broadphase for colliders that move: players, enemies, projectiles. Static triangles go into a SpacialHash that
+* gets built once, these move every step, so they live in one array sorted by the left (min x) edge of their
+* bounding boxes instead.
+*
+* Things only move a little between steps, so the array stays nearly sorted and insertion sort puts it back in order
+* in close to linear time. Finding pairs sweeps the array once: a box can only overlap the ones that start before it
+* ends on X, and only those get their Y and Z checked (sort and sweep).
+*
+* DynamicColliderSet set;
+* dynamic_colliders_init(&set, 1024);
+*     int id = dynamic_collider_add(&set, (DynamicCollider) { .shape = dynamic_shape_sphere(position, 0.5f), ... });
+*     dynamic_collider_set_shape(&set, id, dynamic_shape_sphere(new_position, 0.5f));
+*     dynamic_colliders_update(&set);
+*     DynamicPairArray pairs = dynamic_colliders_find_pairs(frame_arena, &set);
+* dynamic_colliders_free(&set);
+*/
+
+#define DYNAMIC_FREE_LIST_END -1
+
+/* How many places on average a proxy may move while re-sorting, before the whole array is qsorted instead */
+#define DYNAMIC_INSERTION_SORT_MOVES 32
+
+typedef enum DynamicShapeType {
+	DYNAMIC_SHAPE_SPHERE,
+	DYNAMIC_SHAPE_CAPSULE,
+	DYNAMIC_SHAPE_AABB,
+} DynamicShapeType;
+
+typedef struct DynamicShape {
+	DynamicShapeType type;
+	/* Sphere: the center is a. Capsule: the segment from a to b. AABB: a is the min corner, b the max corner. */
+	Vector3 a;
+	Vector3 b;
+	/* Spheres and capsules only */
+	f32 radius;
+} DynamicShape;
+
+typedef struct DynamicCollider {
+	DynamicShape shape;
+	/* The layers it's on, and the layers it wants pairs with. Two colliders pair when either one wants the other. */
+	LayerMask layer;
+	LayerMask collide_mask;
+	EntityHandle entity_id;
+} DynamicCollider;
+
+/* A collider's bounding box in the sorted array, with what the sweep needs so it doesn't have to look the collider up */
+typedef struct DynamicProxy {
+	BoundingBox box;
+	/* -1 once the collider is removed, until the next update drops it */
+	int id;
+	LayerMask layer;
+	LayerMask collide_mask;
+} DynamicProxy;
+
+/* Two colliders whose boxes overlap, a < b */
+typedef struct DynamicPair {
+	int a;
+	int b;
+} DynamicPair;
+
+typedef struct DynamicPairArray {
+	int length;
+	int capacity;
+	DynamicPair* pairs;
+} DynamicPairArray;
+
+/* A collider and a static triangle from a SpacialHash whose boxes overlap */
+typedef struct DynamicStaticPair {
+	int id;
+	TriangleCollider* triangle;
+} DynamicStaticPair;
+
+typedef struct DynamicStaticPairArray {
+	int length;
+	int capacity;
+	DynamicStaticPair* pairs;
+} DynamicStaticPairArray;
+
+typedef struct DynamicColliderSet {
+	Arena arena;
+	int max_count;
+
+	/* Indexed by id. For free ids proxy_indices holds the next free id instead. */
+	DynamicCollider* colliders;
+	int* proxy_indices;
+	/* Ids handed out so far, free or not */
+	int id_count;
+	int free_head;
+	int live_count;
+
+	/* Sorted by box.min.x after dynamic_colliders_update. Anything added, moved or removed since unsorts it. */
+	DynamicProxy* proxies;
+	int proxy_count;
+	bool unsorted;
+
+	/* What the last update did */
+	int last_sort_moves;
+	bool last_sort_fell_back;
+} DynamicColliderSet;
+
+DynamicShape dynamic_shape_sphere(Vector3 center, f32 radius) {
+	return (DynamicShape) { .type = DYNAMIC_SHAPE_SPHERE, .a = center, .b = center, .radius = radius };
+}
+
+DynamicShape dynamic_shape_capsule(Vector3 a, Vector3 b, f32 radius) {
+	return (DynamicShape) { .type = DYNAMIC_SHAPE_CAPSULE, .a = a, .b = b, .radius = radius };
+}
+
+DynamicShape dynamic_shape_aabb(BoundingBox box) {
+	return (DynamicShape) { .type = DYNAMIC_SHAPE_AABB, .a = box.min, .b = box.max, .radius = 0.0f };
+}
+
+BoundingBox dynamic_shape_bounds(DynamicShape shape) {
+	/* A sphere is a capsule from its center to its center, and a box is a capsule without a radius between its corners */
+	Vector3 radius = { shape.radius, shape.radius, shape.radius };
+	return (BoundingBox) {
+		.min = Vector3Subtract(Vector3Min(shape.a, shape.b), radius),
+		.max = Vector3Add(Vector3Max(shape.a, shape.b), radius),
+	};
+}
+
+bool dynamic_boxes_overlap_internal(BoundingBox a, BoundingBox b) {
+	return a.min.x <= b.max.x && b.min.x <= a.max.x
+		&& a.min.y <= b.max.y && b.min.y <= a.max.y
+		&& a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+/* Room for max_count colliders at once, all allocated up front */
+void dynamic_colliders_init(DynamicColliderSet* set, int max_count) {
+	NEVER(max_count <= 0);
+
+	*set = (DynamicColliderSet) {
+		.arena = { .name = "dynamic_colliders" },
+		.max_count = max_count,
+		.free_head = DYNAMIC_FREE_LIST_END,
+	};
+	set->colliders = arena_alloc(&set->arena, sizeof(*set->colliders) * max_count);
+	set->proxy_indices = arena_alloc(&set->arena, sizeof(*set->proxy_indices) * max_count);
+	set->proxies = arena_alloc(&set->arena, sizeof(*set->proxies) * max_count);
+}
+
+void dynamic_colliders_free(DynamicColliderSet* set) {
+	arena_free(&set->arena);
+	*set = (DynamicColliderSet) { .free_head = DYNAMIC_FREE_LIST_END };
+}
+
+/* Drops the proxies of removed colliders, keeping the order of the rest */
+void dynamic_colliders_compact_internal(DynamicColliderSet* set) {
+	int kept = 0;
+	for (int i = 0; i < set->proxy_count; i++) {
+		if (set->proxies[i].id < 0) { continue; }
+		set->proxies[kept] = set->proxies[i];
+		set->proxy_indices[set->proxies[kept].id] = kept;
+		kept++;
+	}
+	set->proxy_count = kept;
+}
+
+/* Returns the new collider's id, or -1 if the set is full. Ids of removed colliders get reused. */
+int dynamic_collider_add(DynamicColliderSet* set, DynamicCollider collider) {
+	if (NEVER(set->live_count >= set->max_count)) { return -1; }
+
+	/* Removed colliders keep their proxy until the next update, make room if they're what's in the way */
+	if (set->proxy_count >= set->max_count) {
+		dynamic_colliders_compact_internal(set);
+	}
+
+	int id;
+	if (set->free_head != DYNAMIC_FREE_LIST_END) {
+		id = set->free_head;
+		set->free_head = set->proxy_indices[id];
+	} else {
+		id = set->id_count++;
+	}
+
+	set->colliders[id] = collider;
+	set->proxy_indices[id] = set->proxy_count;
+	set->proxies[set->proxy_count++] = (DynamicProxy) {
+		.box = dynamic_shape_bounds(collider.shape),
+		.id = id,
+		.layer = collider.layer,
+		.collide_mask = collider.collide_mask,
+	};
+	set->live_count++;
+	set->unsorted = true;
+	return id;
+}
+
+bool dynamic_collider_is_live_internal(const DynamicColliderSet* set, int id) {
+	if (id < 0 || id >= set->id_count) { return false; }
+
+	int proxy_index = set->proxy_indices[id];
+	return proxy_index >= 0 && proxy_index < set->proxy_count && set->proxies[proxy_index].id == id;
+}
+
+void dynamic_collider_remove(DynamicColliderSet* set, int id) {
+	if (NEVER(!dynamic_collider_is_live_internal(set, id))) { return; }
+
+	set->proxies[set->proxy_indices[id]].id = -1;
+	set->proxy_indices[id] = set->free_head;
+	set->free_head = id;
+	set->live_count--;
+	set->unsorted = true;
+}
+
+/* Moves or reshapes a collider. Its new box is in the set right away, but pairs need a dynamic_colliders_update first. */
+void dynamic_collider_set_shape(DynamicColliderSet* set, int id, DynamicShape shape) {
+	if (NEVER(!dynamic_collider_is_live_internal(set, id))) { return; }
+
+	set->colliders[id].shape = shape;
+	set->proxies[set->proxy_indices[id]].box = dynamic_shape_bounds(shape);
+	set->unsorted = true;
+}
+
+int dynamic_compare_proxies_internal(const void* a, const void* b) {
+	f32 min_x_a = ((const DynamicProxy*)a)->box.min.x;
+	f32 min_x_b = ((const DynamicProxy*)b)->box.min.x;
+	return (min_x_a > min_x_b) - (min_x_a < min_x_b);
+}
+
+/**
+* Puts the proxies back in order after colliders were added, moved or removed. Since last step's order is almost
+* right, insertion sort only moves the few that overtook a neighbour. Teleports and big batches of new colliders
+* can make that quadratic, so once the moves run past DYNAMIC_INSERTION_SORT_MOVES per proxy qsort finishes instead.
+*/
+void dynamic_colliders_update(DynamicColliderSet* set) {
+	set->last_sort_moves = 0;
+	set->last_sort_fell_back = false;
+	if (!set->unsorted) { return; }
+
+	dynamic_colliders_compact_internal(set);
+
+	DynamicProxy* proxies = set->proxies;
+	int moves_left = set->proxy_count * DYNAMIC_INSERTION_SORT_MOVES;
+	for (int i = 1; i < set->proxy_count; i++) {
+		DynamicProxy proxy = proxies[i];
+		int j = i - 1;
+		while (j >= 0 && proxies[j].box.min.x > proxy.box.min.x) {
+			proxies[j + 1] = proxies[j];
+			j--;
+		}
+		proxies[j + 1] = proxy;
+
+		int moves = i - 1 - j;
+		set->last_sort_moves += moves;
+		moves_left -= moves;
+		if (moves_left < 0) {
+			qsort(proxies, set->proxy_count, sizeof(*proxies), dynamic_compare_proxies_internal);
+			set->last_sort_fell_back = true;
+			break;
+		}
+	}
+
+	for (int i = 0; i < set->proxy_count; i++) {
+		set->proxy_indices[proxies[i].id] = i;
+	}
+	set->unsorted = false;
+}
+
+/* Every pair of colliders whose boxes overlap and where either one's collide_mask has the other's layer. Allocates into arena. */
+DynamicPairArray dynamic_colliders_find_pairs(Arena* arena, const DynamicColliderSet* set) {
+	DynamicPairArray pairs = {0};
+	if (NEVER(set->unsorted)) { return pairs; }
+
+	const DynamicProxy* proxies = set->proxies;
+	for (int i = 0; i < set->proxy_count; i++) {
+		const DynamicProxy* proxy = &proxies[i];
+
+		/* Sorted by min x, so the first one starting past this one's end ends the sweep for it */
+		for (int j = i + 1; j < set->proxy_count && proxies[j].box.min.x <= proxy->box.max.x; j++) {
+			const DynamicProxy* other = &proxies[j];
+			if (!((proxy->layer & other->collide_mask) || (other->layer & proxy->collide_mask))) { continue; }
+			if (proxy->box.min.y > other->box.max.y || other->box.min.y > proxy->box.max.y) { continue; }
+			if (proxy->box.min.z > other->box.max.z || other->box.min.z > proxy->box.max.z) { continue; }
+
+			DynamicPair* pair = arena_array_push(arena, pairs.pairs, pairs.length, pairs.capacity);
+			pair->a = MIN2(proxy->id, other->id);
+			pair->b = MAX2(proxy->id, other->id);
+		}
+	}
+	return pairs;
+}
+
+int dynamic_compare_static_pairs_internal(const void* a, const void* b) {
+	const TriangleCollider* triangle_a = ((const DynamicStaticPair*)a)->triangle;
+	const TriangleCollider* triangle_b = ((const DynamicStaticPair*)b)->triangle;
+	return (triangle_a > triangle_b) - (triangle_a < triangle_b);
+}
+
+/**
+* Every static triangle in spacial_hash whose box overlaps a collider's box, on a layer in the collider's collide_mask.
+* Only the cells under each box are looked at, and only the entries in them at the box's heights. A triangle can be
+* in several of those cells, so a collider that covers more than one has its pairs sorted and deduplicated.
+* The pairs of each collider are next to each other. Allocates into arena.
+*/
+DynamicStaticPairArray dynamic_colliders_find_static_pairs(Arena* arena, const DynamicColliderSet* set, const SpacialHash* spacial_hash) {
+	DynamicStaticPairArray pairs = {0};
+	if (spacial_hash->cells == NULL) { return pairs; }
+
+	f32 cell_width = spacial_hash->cell_width;
+	Vector3 grid_min = spacial_hash->world_bounding_box.min;
+
+	for (int i = 0; i < set->proxy_count; i++) {
+		const DynamicProxy* proxy = &set->proxies[i];
+		if (proxy->id < 0 || proxy->collide_mask == MASK_NO_COLLISIONS) { continue; }
+		BoundingBox box = proxy->box;
+
+		int min_x = MAX2((int)math_f32_floor((box.min.x - grid_min.x) / cell_width), 0);
+		int min_z = MAX2((int)math_f32_floor((box.min.z - grid_min.z) / cell_width), 0);
+		int max_x = MIN2((int)math_f32_floor((box.max.x - grid_min.x) / cell_width), spacial_hash->x_axis_cell_count - 1);
+		int max_z = MIN2((int)math_f32_floor((box.max.z - grid_min.z) / cell_width), spacial_hash->z_axis_cell_count - 1);
+		int first_pair = pairs.length;
+
+		for (int z = min_z; z <= max_z; z++) {
+			for (int x = min_x; x <= max_x; x++) {
+				const SpaceCell* cell = collision_spacial_hash_get_cell(spacial_hash, x, z);
+				if (cell == NULL || !(cell->mask & proxy->collide_mask)) { continue; }
+
+				int first; int end;
+				collision_space_cell_range(cell, box.min.y, box.max.y, &first, &end);
+				for (int e = first; e < end; e++) {
+					const ColliderColumnEntry* entry = &cell->entries[e];
+					if (entry->max_y < box.min.y || entry->min_y > box.max.y || !(entry->mask & proxy->collide_mask)) { continue; }
+
+					TriangleCollider* tri = entry->collider;
+					if (MAX3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) < box.min.x || MIN3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) > box.max.x) { continue; }
+					if (MAX3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) < box.min.z || MIN3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) > box.max.z) { continue; }
+
+					DynamicStaticPair* pair = arena_array_push(arena, pairs.pairs, pairs.length, pairs.capacity);
+					*pair = (DynamicStaticPair) { .id = proxy->id, .triangle = tri };
+				}
+			}
+		}
+
+		int pair_count = pairs.length - first_pair;
+		if (pair_count > 1 && (max_x > min_x || max_z > min_z)) {
+			DynamicStaticPair* collider_pairs = &pairs.pairs[first_pair];
+			qsort(collider_pairs, pair_count, sizeof(*collider_pairs), dynamic_compare_static_pairs_internal);
+
+			int unique = 1;
+			for (int p = 1; p < pair_count; p++) {
+				if (collider_pairs[p].triangle != collider_pairs[unique - 1].triangle) {
+					collider_pairs[unique++] = collider_pairs[p];
+				}
+			}
+			pairs.length = first_pair + unique;
+		}
+	}
+	return pairs;
+}
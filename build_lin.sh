@@ -5,4 +5,4 @@ gcc main.c -o afterhours.exe \
   libs/lib/linux/libraylib.a \
   -lm -lpthread -ldl -lrt -lX11
 
-./afterhours.exe
\ No newline at end of file
+./afterhours.exe "$@"
\ No newline at end of file
@@ -5,4 +5,4 @@ gcc main.c -o afterhours.exe \
   libs/lib/windows/libraylib.a \
   -lm -lpthread -ldl -lgdi32 -lwinmm
 
-./afterhours.exe
\ No newline at end of file
+./afterhours.exe "$@"
\ No newline at end of file
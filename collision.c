@@ -14,47 +14,49 @@
 	#include "afterhours.h"
 #endif
 
+/* Triangles per parallel_for chunk in collision_get_world_bounding_box */
+#define COLLISION_BOUNDS_GRAIN_SIZE 4096
+
+typedef struct CollisionBoundsJob {
+	const TriangleCollider* colliders;
+	BoundingBox* chunk_bounds;
+} CollisionBoundsJob;
+
+void collision_bounds_range_internal(void* user_data, int start, int end) {
+	CollisionBoundsJob* job = user_data;
+	job->chunk_bounds[start / COLLISION_BOUNDS_GRAIN_SIZE] = math_batch_aabb_triangles(&job->colliders[start].vert_1, sizeof(TriangleCollider), end - start);
+}
+
 /**
 * Returns the bounding box for all active colliders.
 *
-* Returns an empty box (all zero) if there are no active colliders.
+* A SIMD min/max over the vertices (see math_batch_aabb_triangles), split into chunks over the job system.
+* Returns an empty box (min +INFINITY, max -INFINITY) if there are no colliders.
+*
+* The collider loops can return the same box while they generate the colliders, which skips this pass entirely.
 */
 BoundingBox collision_get_world_bounding_box(TriangleColliderArray colliders) {
-	BoundingBox world_bounding_box = {0};
-
-	for (int i = 0; i < colliders.length; i++) {
-		TriangleCollider collider = colliders.colliders[i];
-
-		/* Vertex 1 */
-		if (collider.vert_1.x > world_bounding_box.max.x) { world_bounding_box.max.x = collider.vert_1.x; }
-		if (collider.vert_1.x < world_bounding_box.min.x) { world_bounding_box.min.x = collider.vert_1.x; }
-
-		if (collider.vert_1.y > world_bounding_box.max.y) { world_bounding_box.max.y = collider.vert_1.y; }
-		if (collider.vert_1.y < world_bounding_box.min.y) { world_bounding_box.min.y = collider.vert_1.y; }
-
-		if (collider.vert_1.z > world_bounding_box.max.z) { world_bounding_box.max.z = collider.vert_1.z; }
-		if (collider.vert_1.z < world_bounding_box.min.z) { world_bounding_box.min.z = collider.vert_1.z; }
-
-		/* Vertex 2 */
-		if (collider.vert_2.x > world_bounding_box.max.x) { world_bounding_box.max.x = collider.vert_2.x; }
-		if (collider.vert_2.x < world_bounding_box.min.x) { world_bounding_box.min.x = collider.vert_2.x; }
-
-		if (collider.vert_2.y > world_bounding_box.max.y) { world_bounding_box.max.y = collider.vert_2.y; }
-		if (collider.vert_2.y < world_bounding_box.min.y) { world_bounding_box.min.y = collider.vert_2.y; }
-
-		if (collider.vert_2.z > world_bounding_box.max.z) { world_bounding_box.max.z = collider.vert_2.z; }
-		if (collider.vert_2.z < world_bounding_box.min.z) { world_bounding_box.min.z = collider.vert_2.z; }
-
-		/* Vertex 3 */
-		if (collider.vert_3.x > world_bounding_box.max.x) { world_bounding_box.max.x = collider.vert_3.x; }
-		if (collider.vert_3.x < world_bounding_box.min.x) { world_bounding_box.min.x = collider.vert_3.x; }
+	if (colliders.length == 0) {
+		return math_aabb_empty();
+	}
+	if (colliders.length <= COLLISION_BOUNDS_GRAIN_SIZE) {
+		return math_batch_aabb_triangles(&colliders.colliders[0].vert_1, sizeof(TriangleCollider), colliders.length);
+	}
 
-		if (collider.vert_3.y > world_bounding_box.max.y) { world_bounding_box.max.y = collider.vert_3.y; }
-		if (collider.vert_3.y < world_bounding_box.min.y) { world_bounding_box.min.y = collider.vert_3.y; }
+	TempArena scratch = scratch_begin(NULL, 0);
+	int chunk_count = (colliders.length + COLLISION_BOUNDS_GRAIN_SIZE - 1) / COLLISION_BOUNDS_GRAIN_SIZE;
+	CollisionBoundsJob job = {
+		.colliders = colliders.colliders,
+		.chunk_bounds = arena_alloc(scratch.arena, sizeof(*job.chunk_bounds) * chunk_count),
+	};
+	parallel_for(colliders.length, COLLISION_BOUNDS_GRAIN_SIZE, collision_bounds_range_internal, &job);
 
-		if (collider.vert_3.z > world_bounding_box.max.z) { world_bounding_box.max.z = collider.vert_3.z; }
-		if (collider.vert_3.z < world_bounding_box.min.z) { world_bounding_box.min.z = collider.vert_3.z; }
+	BoundingBox world_bounding_box = math_aabb_empty();
+	for (int i = 0; i < chunk_count; i++) {
+		world_bounding_box = math_aabb_merge(world_bounding_box, job.chunk_bounds[i]);
 	}
+
+	scratch_end(scratch);
 	return world_bounding_box;
 }
 
@@ -68,7 +70,7 @@ RaycastHit collision_raycast(
 ) {
 	RaycastHit rc_hit = (RaycastHit) {
 		.collider = NULL,
-		.entity_id = 0,
+		.entity_id = ENTITY_HANDLE_NONE,
 		.point = VECTOR3_INFINITY,
 	};
 	f32 current_displacement = INFINITY;
@@ -156,56 +158,389 @@ Vector3 collision_ray_intersection_with_aabb(
 }
 
 
-#ifdef UNUSED
-RaycastHit collision_raycast(
+/* Queries run on any thread, so they add to the stats atomically, once each */
+void collision_query_stats_add_internal(SpacialHashQueryStats* stats, u64 cell_count, u64 entry_count) {
+	__atomic_add_fetch(&stats->query_count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->cell_count, cell_count, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->entry_count, entry_count, __ATOMIC_RELAXED);
+}
+
+/* How much height intervals grow in collision_raycast, so rounding never skips a triangle the ray touches */
+#define COLLISION_HEIGHT_SLACK 0.001f
+
+/**
+* Casts a ray through the spacial hash and returns the closest triangle hit within raycast_length.
+*
+* Only the cells the ray passes over (in XZ) are visited, walking them in order from the start point.
+* The walk stops as soon as a hit is known to be closer than anything in the remaining cells.
+* Within a cell only the triangles at the heights the ray covers there are tested (see collision_space_cell_range).
+*
+* Returns a hit with a NULL collider (and point at infinity) if nothing was hit.
+* Also returns how many occupied cells it visited and how many triangles it tested in them, for query_stats.
+*/
+RaycastHit collision_raycast_internal(
 	const SpacialHash* spacial_hash,
 	LayerMask layer_mask,
 	Vector3 start_point,
 	Vector3 direction,
-	float raycast_length
+	float raycast_length,
+	u64* out_cells_visited,
+	u64* out_entries_tested
 ) {
 	RaycastHit rc_hit = (RaycastHit) {
 		.collider = NULL,
-		.entity_id = 0,
+		.entity_id = ENTITY_HANDLE_NONE,
 		.point = VECTOR3_INFINITY,
 	};
-	f32 current_displacement = INFINITY;
 
-	int x; int z;
+	if (spacial_hash->cells == NULL) { return rc_hit; }
+	if (NEVER(Vector3Equals(direction, VECTOR3_ZERO))) { return rc_hit; }
+
+	direction = Vector3Normalize(direction);
+
+	f32 cell_width = spacial_hash->cell_width;
+	f32 grid_min_x = spacial_hash->world_bounding_box.min.x;
+	f32 grid_min_z = spacial_hash->world_bounding_box.min.z;
+	f32 grid_max_x = grid_min_x + (cell_width * spacial_hash->x_axis_cell_count);
+	f32 grid_max_z = grid_min_z + (cell_width * spacial_hash->z_axis_cell_count);
+
+	/**
+	* Clip the ray to the grid (slab test). Nothing exists outside of it. Clipping to the height range too stops a ray
+	* that missed everything as soon as it's below the world, instead of walking empty cells to the edge of the grid.
+	*/
+	f32 t_enter = 0.0f;
+	f32 t_exit = raycast_length;
+
+	if (direction.x != 0.0f) {
+		f32 t_a = (grid_min_x - start_point.x) / direction.x;
+		f32 t_b = (grid_max_x - start_point.x) / direction.x;
+		t_enter = MAX2(t_enter, MIN2(t_a, t_b));
+		t_exit  = MIN2(t_exit,  MAX2(t_a, t_b));
+	} else if (start_point.x < grid_min_x || start_point.x > grid_max_x) {
+		return rc_hit;
+	}
+
+	if (direction.z != 0.0f) {
+		f32 t_a = (grid_min_z - start_point.z) / direction.z;
+		f32 t_b = (grid_max_z - start_point.z) / direction.z;
+		t_enter = MAX2(t_enter, MIN2(t_a, t_b));
+		t_exit  = MIN2(t_exit,  MAX2(t_a, t_b));
+	} else if (start_point.z < grid_min_z || start_point.z > grid_max_z) {
+		return rc_hit;
+	}
+
+	if (direction.y != 0.0f) {
+		f32 t_a = (spacial_hash->world_bounding_box.min.y - COLLISION_HEIGHT_SLACK - start_point.y) / direction.y;
+		f32 t_b = (spacial_hash->world_bounding_box.max.y + COLLISION_HEIGHT_SLACK - start_point.y) / direction.y;
+		t_enter = MAX2(t_enter, MIN2(t_a, t_b));
+		t_exit  = MIN2(t_exit,  MAX2(t_a, t_b));
+	} else if (start_point.y < spacial_hash->world_bounding_box.min.y || start_point.y > spacial_hash->world_bounding_box.max.y) {
+		return rc_hit;
+	}
+
+	if (t_enter > t_exit) { return rc_hit; }
+
+	/* Walk the cells (Amanatides & Woo). t_next_* is the distance at which the ray crosses into the next column/row. */
+	f32 entry_x = start_point.x + (direction.x * t_enter);
+	f32 entry_z = start_point.z + (direction.z * t_enter);
+
+	int x = (int)math_f32_floor((entry_x - grid_min_x) / cell_width);
+	int z = (int)math_f32_floor((entry_z - grid_min_z) / cell_width);
+
+	/* Float error on the boundary can push the entry cell one out of range */
+	x = MIN2(MAX2(x, 0), spacial_hash->x_axis_cell_count - 1);
+	z = MIN2(MAX2(z, 0), spacial_hash->z_axis_cell_count - 1);
+
+	int step_x = (direction.x > 0.0f) ? 1 : -1;
+	int step_z = (direction.z > 0.0f) ? 1 : -1;
+
+	f32 t_delta_x = (direction.x != 0.0f) ? (cell_width / math_f32_abs(direction.x)) : INFINITY;
+	f32 t_delta_z = (direction.z != 0.0f) ? (cell_width / math_f32_abs(direction.z)) : INFINITY;
+
+	f32 t_next_x = (direction.x != 0.0f)
+		? ((grid_min_x + (cell_width * (x + (step_x > 0)))) - start_point.x) / direction.x
+		: INFINITY;
+	f32 t_next_z = (direction.z != 0.0f)
+		? ((grid_min_z + (cell_width * (z + (step_z > 0)))) - start_point.z) / direction.z
+		: INFINITY;
+
+	f32 closest_t = INFINITY;
+	f32 t_cell_enter = t_enter;
+
+	/* Cells are sorted by height, walk them away from the start so a hit cuts off the rest of the cell */
+	bool walk_down = (direction.y < 0.0f);
+
+	u64 cells_visited = 0;
+	u64 entries_tested = 0;
+
+	while (true) {
+		const SpaceCell* cell = collision_spacial_hash_get_cell(spacial_hash, x, z);
+		f32 t_cell_exit = MIN2(t_next_x, t_next_z);
+
+		/* A closer hit over this cell can only be at the heights the ray passes through over it */
+		f32 y_near = start_point.y + (direction.y * t_cell_enter);
+		f32 y_far = start_point.y + (direction.y * MIN3(t_cell_exit, t_exit, closest_t));
+		f32 y_low = MIN2(y_near, y_far) - COLLISION_HEIGHT_SLACK;
+		f32 y_high = MAX2(y_near, y_far) + COLLISION_HEIGHT_SLACK;
+
+		int first = 0; int end = 0;
+		if (cell != NULL && (cell->mask & layer_mask)) {
+			collision_space_cell_range(cell, y_low, y_high, &first, &end);
+			cells_visited++;
+		}
 
-	int cell_index = (z * spacial_hash->x_axis_cell_count) + x;
-	SpaceCell cell = spacial_hash->cells[cell_index];
-	ColliderColumnList* list = cell.list;
+		for (int i = first; i < end; i++) {
+			const ColliderColumnEntry* entry = &cell->entries[walk_down ? (first + end - 1 - i) : i];
 
-	/* Check all triangles in the spacial hash cell */
-	while (list != NULL) {
-		TriangleCollider col = *list->collider;
+			/* Everything after this in the walk is entirely above or below the heights left */
+			if (walk_down ? (entry->max_y_so_far < y_low) : (entry->min_y > y_high)) { break; }
+			if (entry->max_y < y_low || entry->min_y > y_high) { continue; }
 
-		if (list->collider->mask & layer_mask) {
-			Vector3 intersection_point = math_line_triangle_intersection(
-				col.vert_1, col.vert_2, col.vert_3,
-				start_point,
-				direction.x, direction.y, direction.z
-			);
-			Vector3 displacement_vec = Vector3Subtract(intersection_point, start_point);
-			f32 displacement = Vector3Length(displacement_vec);
+			if (entry->mask & layer_mask) {
+				TriangleCollider* col = entry->collider;
+				entries_tested++;
+				f32 t = math_ray_triangle_distance(col->vert_1, col->vert_2, col->vert_3, start_point, direction);
 
-			if (displacement < raycast_length && displacement < current_displacement) {
-				rc_hit.collider = list->collider;
-				rc_hit.point = intersection_point;
-				rc_hit.entity_id = col.entity_id;
+				if (t <= raycast_length && t < closest_t) {
+					closest_t = t;
+					rc_hit.collider = col;
 
-				current_displacement = displacement;
+					f32 y_hit = start_point.y + (direction.y * t);
+					if (walk_down) { y_low = y_hit - COLLISION_HEIGHT_SLACK; } else { y_high = y_hit + COLLISION_HEIGHT_SLACK; }
+				}
 			}
 		}
-		list = list->next;
+
+		/* Triangles span several cells, so a hit found here might lie further along. It's only final once we've passed it. */
+		if (closest_t <= t_cell_exit || t_cell_exit > t_exit) { break; }
+		t_cell_enter = t_cell_exit;
+
+		if (t_next_x < t_next_z) {
+			x += step_x;
+			t_next_x += t_delta_x;
+		} else {
+			z += step_z;
+			t_next_z += t_delta_z;
+		}
+
+		if (x < 0 || x >= spacial_hash->x_axis_cell_count) { break; }
+		if (z < 0 || z >= spacial_hash->z_axis_cell_count) { break; }
 	}
+
+	*out_cells_visited = cells_visited;
+	*out_entries_tested = entries_tested;
+
+	if (rc_hit.collider != NULL) {
+		rc_hit.point = Vector3Add(start_point, Vector3Scale(direction, closest_t));
+		rc_hit.entity_id = rc_hit.collider->entity_id;
+	}
+
 	return rc_hit;
 }
+
+RaycastHit collision_raycast(
+	const SpacialHash* spacial_hash,
+	LayerMask layer_mask,
+	Vector3 start_point,
+	Vector3 direction,
+	float raycast_length
+) {
+	/* Rays that miss the grid entirely count as queries that visited nothing */
+	u64 cells_visited = 0;
+	u64 entries_tested = 0;
+	RaycastHit rc_hit = collision_raycast_internal(spacial_hash, layer_mask, start_point, direction, raycast_length, &cells_visited, &entries_tested);
+
+	if (spacial_hash->query_stats != NULL) {
+		collision_query_stats_add_internal(spacial_hash->query_stats, cells_visited, entries_tested);
+	}
+	return rc_hit;
+}
+
+
+/* Fraction of a cell the rasterized extent of a triangle grows by in collision_spacial_hash_insert_array */
+#define COLLISION_RASTER_SLACK 0.0001f
+
+/* How many places on average an entry may move while insertion sorting a cell, before it gets qsorted instead */
+#define COLLISION_INSERTION_SORT_MOVES 16
+
+/* A triangle the rasterizer put into a cell, before the cells are built */
+typedef struct CollisionCellPair {
+	SpaceCellKey cell;
+	int collider_index;
+} CollisionCellPair;
+
+#ifndef REGION_SPARSE_CELLS
+/* Slots a sparse hash starts with. It doubles whenever more than half of them are in use. */
+#define COLLISION_SPARSE_MIN_SLOTS 64
+
+/* Mixes both coordinates, so the neighbouring cells that usually get filled together spread over the table */
+u32 collision_cell_hash_internal(int x, int z) {
+	u32 hash = ((u32)x * 0x9E3779B1u) ^ ((u32)z * 0x85EBCA77u);
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 12;
+	return hash;
+}
+
+/* Returns the slot holding (x, z), or the empty slot where it would go. Linear probing, the table is never full. */
+int collision_sparse_find_slot_internal(const SpacialHash* spacial_hash, int x, int z) {
+	u32 slot_mask = (u32)spacial_hash->slot_count - 1;
+	u32 slot = collision_cell_hash_internal(x, z) & slot_mask;
+	while (true) {
+		SpaceCellKey key = spacial_hash->keys[slot];
+		if (key.x < 0 || (key.x == x && key.z == z)) { return (int)slot; }
+		slot = (slot + 1) & slot_mask;
+	}
+}
+
+SpaceCell collision_space_cell_empty_internal(void) {
+	return (SpaceCell) { .count = 0, .min_y = INFINITY, .max_y = -INFINITY, .mask = MASK_NO_COLLISIONS, .entries = NULL };
+}
+
+/* Moves every cell into a new table of slot_count slots. The old table is left behind in the arena. */
+void collision_sparse_rehash_internal(Arena* collider_data_arena, SpacialHash* spacial_hash, int slot_count) {
+	SpaceCellKey* old_keys = spacial_hash->keys;
+	SpaceCell* old_cells = spacial_hash->cells;
+	int old_slot_count = spacial_hash->slot_count;
+
+	spacial_hash->slot_count = slot_count;
+	spacial_hash->keys = arena_alloc(collider_data_arena, sizeof(*spacial_hash->keys) * slot_count);
+	spacial_hash->cells = arena_alloc(collider_data_arena, sizeof(*spacial_hash->cells) * slot_count);
+	for (int i = 0; i < slot_count; i++) {
+		spacial_hash->keys[i] = (SpaceCellKey) { .x = -1, .z = -1 };
+		spacial_hash->cells[i] = collision_space_cell_empty_internal();
+	}
+
+	for (int i = 0; i < old_slot_count; i++) {
+		if (old_keys[i].x < 0) { continue; }
+
+		int slot = collision_sparse_find_slot_internal(spacial_hash, old_keys[i].x, old_keys[i].z);
+		spacial_hash->keys[slot] = old_keys[i];
+		spacial_hash->cells[slot] = old_cells[i];
+	}
+}
+
+/* Finds the slot of (x, z), claiming one if the cell is new */
+int collision_sparse_claim_slot_internal(Arena* collider_data_arena, SpacialHash* spacial_hash, int x, int z) {
+	if ((spacial_hash->occupied_slot_count + 1) * 2 > spacial_hash->slot_count) {
+		collision_sparse_rehash_internal(collider_data_arena, spacial_hash, spacial_hash->slot_count * 2);
+	}
+
+	int slot = collision_sparse_find_slot_internal(spacial_hash, x, z);
+	if (spacial_hash->keys[slot].x < 0) {
+		spacial_hash->keys[slot] = (SpaceCellKey) { .x = x, .z = z };
+		spacial_hash->occupied_slot_count++;
+	}
+	return slot;
+}
 #endif
 
+const SpaceCell* collision_spacial_hash_get_cell(const SpacialHash* spacial_hash, int x, int z) {
+	if (spacial_hash->cells == NULL) { return NULL; }
+	if (x < 0 || x >= spacial_hash->x_axis_cell_count) { return NULL; }
+	if (z < 0 || z >= spacial_hash->z_axis_cell_count) { return NULL; }
+
+	if (spacial_hash->mode == SPACIAL_HASH_DENSE) {
+		return &spacial_hash->cells[(spacial_hash->x_axis_cell_count * z) + x];
+	}
+
+	int slot = collision_sparse_find_slot_internal(spacial_hash, x, z);
+	return (spacial_hash->keys[slot].x < 0) ? NULL : &spacial_hash->cells[slot];
+}
 
+SpaceCellKey collision_spacial_hash_slot_key(const SpacialHash* spacial_hash, int slot) {
+	if (spacial_hash->mode == SPACIAL_HASH_DENSE) {
+		return (SpaceCellKey) { .x = slot % spacial_hash->x_axis_cell_count, .z = slot / spacial_hash->x_axis_cell_count };
+	}
+	return spacial_hash->keys[slot];
+}
+
+int collision_compare_column_entries_internal(const void* a, const void* b) {
+	f32 min_y_a = ((const ColliderColumnEntry*)a)->min_y;
+	f32 min_y_b = ((const ColliderColumnEntry*)b)->min_y;
+	return (min_y_a > min_y_b) - (min_y_a < min_y_b);
+}
+
+/* Sorts a cell by min_y and fills in max_y_so_far, the cell's height range and its layers */
+void collision_space_cell_sort_internal(SpaceCell* cell) {
+	ColliderColumnEntry* entries = cell->entries;
+
+	/**
+	 * Insertion sort, since colliders usually come nearly in order already (floor by floor) and most cells are small.
+	 * A cell too far out of order runs out of moves and qsort finishes it instead.
+	 */
+	int moves_left = cell->count * COLLISION_INSERTION_SORT_MOVES;
+	for (int i = 1; i < cell->count; i++) {
+		ColliderColumnEntry entry = entries[i];
+		int j = i - 1;
+		while (j >= 0 && entries[j].min_y > entry.min_y) {
+			entries[j + 1] = entries[j];
+			j--;
+			moves_left--;
+		}
+		entries[j + 1] = entry;
+
+		if (moves_left < 0) {
+			qsort(entries, cell->count, sizeof(*entries), collision_compare_column_entries_internal);
+			break;
+		}
+	}
+
+	f32 max_y_so_far = -INFINITY;
+	LayerMask mask = MASK_NO_COLLISIONS;
+	for (int i = 0; i < cell->count; i++) {
+		max_y_so_far = MAX2(max_y_so_far, entries[i].max_y);
+		entries[i].max_y_so_far = max_y_so_far;
+		mask |= entries[i].mask;
+	}
+	cell->min_y = (cell->count > 0) ? entries[0].min_y : INFINITY;
+	cell->max_y = max_y_so_far;
+	cell->mask = mask;
+}
+
+/**
+* Binary searches the two ends of the range. Entries after *end start above max_y, and every entry before *first
+* ends below min_y, because max_y_so_far says so. Entries in between can still miss the interval on their own.
+*/
+void collision_space_cell_range(const SpaceCell* cell, f32 min_y, f32 max_y, int* first, int* end) {
+	*first = 0;
+	*end = 0;
+	if (cell->count == 0 || max_y < cell->min_y || min_y > cell->max_y) { return; }
+
+	/* First entry starting above max_y */
+	int low = 0;
+	int high = cell->count;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (cell->entries[middle].min_y <= max_y) { low = middle + 1; } else { high = middle; }
+	}
+	*end = low;
+
+	/* First entry where something up to it reaches min_y */
+	low = 0;
+	high = *end;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (cell->entries[middle].max_y_so_far < min_y) { low = middle + 1; } else { high = middle; }
+	}
+	*first = low;
+}
+
+/**
+* Inserts every triangle into the cells its XZ footprint touches, then rebuilds the cells that got anything so they
+* stay sorted. The rebuilt cells get new entry arrays in collider_data_arena, the old ones are left behind.
+*/
 void collision_spacial_hash_insert_array(Arena* collider_data_arena, SpacialHash* spacial_hash, TriangleColliderArray collider_array) {
+	TempArena scratch = scratch_begin(&collider_data_arena, 1);
+
+	CollisionCellPair* pairs = NULL;
+	int pair_count = 0;
+	int pair_capacity = 0;
+	if (!arena_array_reserve(scratch.arena, pairs, pair_count, pair_capacity, collider_array.length * 2)) {
+		scratch_end(scratch);
+		return;
+	}
+
 	for (int i = 0; i < collider_array.length; i++) {
 		/* Inserts each collider triangle into the spacial hash */
 		TriangleCollider tri = collider_array.colliders[i];
@@ -254,45 +589,938 @@ void collision_spacial_hash_insert_array(Arena* collider_data_arena, SpacialHash
 		}
 
 
-		/* Iterate the cells, test if they're within the triangle, insert. */
-		/* TODO: Actually insert a triangle test. */
+		/**
+		 * Rasterize the triangle's XZ footprint a row of cells at a time, so only the cells it touches get it, instead of
+		 * every cell in the bounding rectangle, which floods long diagonal triangles into cells they never touch.
+		 *
+		 * With the vertices sorted by z, the long edge (low to high) is one side of the triangle in every row and the two
+		 * short edges are the other. The part of the triangle inside a row is a convex polygon whose corners are where
+		 * those sides cross the row's edges, plus the middle vertex if it's inside, so those give the x extent.
+		 *
+		 * A footprint one cell wide or deep touches every cell of its rectangle, so those skip straight to inserting.
+		 */
+		bool rasterize = (max_cell_x > min_cell_x) && (max_cell_z > min_cell_z);
+
+		Vector3 low = tri.vert_1;
+		Vector3 middle = tri.vert_2;
+		Vector3 high = tri.vert_3;
+		if (low.z > middle.z) { Vector3 swap = low; low = middle; middle = swap; }
+		if (middle.z > high.z) { Vector3 swap = middle; middle = high; high = swap; }
+		if (low.z > middle.z) { Vector3 swap = low; low = middle; middle = swap; }
+
+		/* How far x moves per unit of z along each edge. Rasterized triangles always span some z on the long edge. */
+		f32 long_slope = 0.0f;
+		f32 low_slope = 0.0f;
+		f32 high_slope = 0.0f;
+		if (rasterize) {
+			long_slope = (high.x - low.x) / (high.z - low.z);
+			low_slope = (middle.z > low.z) ? (middle.x - low.x) / (middle.z - low.z) : 0.0f;
+			high_slope = (high.z > middle.z) ? (high.x - middle.x) / (high.z - middle.z) : 0.0f;
+		}
+
+		f32 grid_min_x = spacial_hash->world_bounding_box.min.x;
+		f32 grid_min_z = spacial_hash->world_bounding_box.min.z;
+		f32 inverse_cell_width = 1.0f / cell_width;
+		/* Grows extents slightly so rounding never drops a cell the triangle touches */
+		f32 slack = cell_width * COLLISION_RASTER_SLACK;
+
+		/* Where the two sides cross the bottom of the current row, which is where they crossed the top of the last one */
+		f32 bottom_long_x = low.x;
+		f32 bottom_short_x = low.x;
+
 		for (int z = min_cell_z; z <= max_cell_z; z++) {
-			for (int x = min_cell_x; x <= max_cell_x; x++) {
-				ColliderColumnList* list_node = arena_alloc(collider_data_arena, sizeof(*list_node));
+			int row_min_cell_x = min_cell_x;
+			int row_max_cell_x = max_cell_x;
+
+			if (rasterize) {
+				f32 bottom_z = (z == min_cell_z) ? low.z : grid_min_z + cell_width * z;
+				f32 top_z = (z == max_cell_z) ? high.z : grid_min_z + cell_width * (z + 1);
+
+				f32 top_long_x = low.x + (top_z - low.z) * long_slope;
+				f32 top_short_x = (top_z < middle.z)
+					? low.x + (top_z - low.z) * low_slope
+					: middle.x + (top_z - middle.z) * high_slope;
+
+				f32 row_min_x = MIN2(MIN2(bottom_long_x, top_long_x), MIN2(bottom_short_x, top_short_x));
+				f32 row_max_x = MAX2(MAX2(bottom_long_x, top_long_x), MAX2(bottom_short_x, top_short_x));
+				if (bottom_z <= middle.z && middle.z <= top_z) {
+					row_min_x = MIN2(row_min_x, middle.x);
+					row_max_x = MAX2(row_max_x, middle.x);
+				}
+				bottom_long_x = top_long_x;
+				bottom_short_x = top_short_x;
+
+				/* Truncating works as flooring here, only values just below zero differ and min_cell_x clamps those anyway */
+				row_min_cell_x = MAX2((int)((row_min_x - slack - grid_min_x) * inverse_cell_width), min_cell_x);
+				row_max_cell_x = MIN2((int)((row_max_x + slack - grid_min_x) * inverse_cell_width), max_cell_x);
+			}
 
-				/* TODO: Make relative pointer */
-				list_node->collider = &collider_array.colliders[i];
-				list_node->next = spacial_hash->cells[(spacial_hash->x_axis_cell_count * z) + x].list;
+			int row_cell_count = row_max_cell_x - row_min_cell_x + 1;
+			if (row_cell_count <= 0) { continue; }
 
-				spacial_hash->cells[(spacial_hash->x_axis_cell_count * z) + x].list = list_node;
+			CollisionCellPair* row_pairs = arena_array_push_n(scratch.arena, pairs, pair_count, pair_capacity, row_cell_count);
+			if (row_pairs == NULL) { continue; }
+			for (int x = 0; x < row_cell_count; x++) {
+				row_pairs[x] = (CollisionCellPair) {
+					.cell = { .x = row_min_cell_x + x, .z = z },
+					.collider_index = i,
+				};
 			}
 		}
 	}
+
+	/* Which slot each pair goes into. A sparse hash first claims every new cell, since growing moves cells between slots. */
+	int* pair_slots = arena_alloc(scratch.arena, sizeof(*pair_slots) * MAX2(pair_count, 1));
+	if (spacial_hash->mode == SPACIAL_HASH_DENSE) {
+		for (int i = 0; i < pair_count; i++) {
+			pair_slots[i] = (spacial_hash->x_axis_cell_count * pairs[i].cell.z) + pairs[i].cell.x;
+		}
+	} else {
+		for (int i = 0; i < pair_count; i++) {
+			collision_sparse_claim_slot_internal(collider_data_arena, spacial_hash, pairs[i].cell.x, pairs[i].cell.z);
+		}
+		for (int i = 0; i < pair_count; i++) {
+			pair_slots[i] = collision_sparse_find_slot_internal(spacial_hash, pairs[i].cell.x, pairs[i].cell.z);
+		}
+	}
+
+	/* Counting sort the pairs into one block of entries. A cell that gets anything moves its old entries in front of the new ones. */
+	int cell_count = spacial_hash->slot_count;
+	int* added_counts = arena_alloc(scratch.arena, sizeof(*added_counts) * cell_count);
+	for (int i = 0; i < cell_count; i++) {
+		added_counts[i] = 0;
+	}
+	for (int i = 0; i < pair_count; i++) {
+		added_counts[pair_slots[i]]++;
+	}
+
+	int entry_count = 0;
+	for (int i = 0; i < cell_count; i++) {
+		if (added_counts[i] > 0) { entry_count += spacial_hash->cells[i].count + added_counts[i]; }
+	}
+
+	ColliderColumnEntry* entries = arena_alloc(collider_data_arena, sizeof(*entries) * MAX2(entry_count, 1));
+	int next_entry = 0;
+	for (int i = 0; i < cell_count; i++) {
+		if (added_counts[i] == 0) { continue; }
+
+		SpaceCell* cell = &spacial_hash->cells[i];
+		for (int j = 0; j < cell->count; j++) {
+			entries[next_entry + j] = cell->entries[j];
+		}
+		cell->entries = &entries[next_entry];
+		next_entry += cell->count + added_counts[i];
+	}
+
+	for (int i = 0; i < pair_count; i++) {
+		TriangleCollider* collider = &collider_array.colliders[pairs[i].collider_index];
+		SpaceCell* cell = &spacial_hash->cells[pair_slots[i]];
+
+		/* TODO: Make relative pointer */
+		cell->entries[cell->count++] = (ColliderColumnEntry) {
+			.min_y = MIN3(collider->vert_1.y, collider->vert_2.y, collider->vert_3.y),
+			.max_y = MAX3(collider->vert_1.y, collider->vert_2.y, collider->vert_3.y),
+			.mask = collider->mask,
+			.collider = collider,
+		};
+	}
+
+	/* The box's height range has to keep holding everything, raycasts clip to it */
+	for (int i = 0; i < cell_count; i++) {
+		if (added_counts[i] == 0) { continue; }
+
+		collision_space_cell_sort_internal(&spacial_hash->cells[i]);
+		spacial_hash->world_bounding_box.min.y = MIN2(spacial_hash->world_bounding_box.min.y, spacial_hash->cells[i].min_y);
+		spacial_hash->world_bounding_box.max.y = MAX2(spacial_hash->world_bounding_box.max.y, spacial_hash->cells[i].max_y);
+	}
+
+	scratch_end(scratch);
 }
 
 /**
-* Constructs the spacial hash for all colliders
+* Constructs the spacial hash for all colliders, with a grid covering world_bound.
+* world_bound must hold every collider. An empty box (no colliders) makes a grid of one cell at the origin.
+*
+* A dense grid allocates every cell of the box up front. A sparse one only ever allocates the cells something
+* touches (and the free slots of its table), so two islands far apart don't pay for the ocean in between.
 */
-SpacialHash collision_spacial_hash_create(Arena* collider_data_arena, TriangleColliderArray static_colliders) {
-	BoundingBox world_bound = collision_get_world_bounding_box(static_colliders);
+SpacialHash collision_spacial_hash_create_with_cell_width(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode, f32 cell_width) {
+	NEVER(!(cell_width > 0.0f));
+	if (world_bound.min.x > world_bound.max.x) {
+		world_bound = (BoundingBox) {0};
+	}
+
 	SpacialHash spacial_hash = (SpacialHash) {
-		.cell_width = DEFAULT_CELL_WIDTH,
+		.cell_width = cell_width,
 		.world_bounding_box = world_bound,
+		.mode = mode,
+		.keys = NULL,
 		.cells = NULL,
-		.x_axis_cell_count = ((world_bound.max.x - world_bound.min.x) / DEFAULT_CELL_WIDTH) + 1,
-		.z_axis_cell_count = ((world_bound.max.z - world_bound.min.z) / DEFAULT_CELL_WIDTH) + 1
+		.x_axis_cell_count = ((world_bound.max.x - world_bound.min.x) / cell_width) + 1,
+		.z_axis_cell_count = ((world_bound.max.z - world_bound.min.z) / cell_width) + 1,
+		.colliders = static_colliders.colliders,
+		.collider_count = static_colliders.length,
 	};
 
-	spacial_hash.cells = arena_alloc(collider_data_arena, sizeof(*spacial_hash.cells) * spacial_hash.x_axis_cell_count * spacial_hash.z_axis_cell_count);
+	if (mode == SPACIAL_HASH_DENSE) {
+		spacial_hash.slot_count = spacial_hash.x_axis_cell_count * spacial_hash.z_axis_cell_count;
+		spacial_hash.cells = arena_alloc(collider_data_arena, sizeof(*spacial_hash.cells) * spacial_hash.slot_count);
 
-	/* Are you a real gridcel? */
-	for (int z = 0; z < spacial_hash.z_axis_cell_count; z++) {
-		for (int x = 0; x < spacial_hash.x_axis_cell_count; x++) {
-			spacial_hash.cells[(spacial_hash.x_axis_cell_count * z) + x] = (SpaceCell) { .list = NULL };
+		/* Are you a real gridcel? */
+		for (int i = 0; i < spacial_hash.slot_count; i++) {
+			spacial_hash.cells[i] = collision_space_cell_empty_internal();
 		}
+	} else {
+		collision_sparse_rehash_internal(collider_data_arena, &spacial_hash, COLLISION_SPARSE_MIN_SLOTS);
 	}
 
 	collision_spacial_hash_insert_array(collider_data_arena, &spacial_hash, static_colliders);
 
 	return spacial_hash;
-}
\ No newline at end of file
+}
+
+SpacialHash collision_spacial_hash_create_with_mode(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode) {
+	return collision_spacial_hash_create_with_cell_width(collider_data_arena, static_colliders, world_bound, mode, DEFAULT_CELL_WIDTH);
+}
+
+SpacialHash collision_spacial_hash_create_with_bounds(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound) {
+	return collision_spacial_hash_create_with_mode(collider_data_arena, static_colliders, world_bound, SPACIAL_HASH_DENSE);
+}
+
+/**
+* Constructs the spacial hash for all colliders
+*/
+SpacialHash collision_spacial_hash_create(Arena* collider_data_arena, TriangleColliderArray static_colliders) {
+	return collision_spacial_hash_create_with_bounds(collider_data_arena, static_colliders, collision_get_world_bounding_box(static_colliders));
+}
+
+#ifndef REGION_CELL_WIDTH_TUNING
+/* How many triangles collision_spacial_hash_tune looks at, spread evenly over the array */
+#define COLLISION_TUNE_SAMPLE_COUNT 1024
+
+/* Cell width as a multiple of the median triangle extent */
+#define COLLISION_TUNE_EXTENT_SCALE 1.0f
+
+/* Most cells a dense grid gets per triangle */
+#define COLLISION_TUNE_DENSE_CELLS_PER_TRIANGLE 8
+
+#define COLLISION_TUNE_MIN_CELL_WIDTH 0.25f
+
+/* Triangles tested per query cell the online tuner steers towards */
+#define COLLISION_TUNE_TARGET_ENTRIES_PER_CELL 1.5f
+
+/* Queries the online tuner waits for before it trusts the numbers */
+#define COLLISION_TUNE_MIN_QUERIES 256
+
+/* The online tuner leaves the width alone unless it would change by more than this fraction */
+#define COLLISION_TUNE_HYSTERESIS 0.2f
+
+/* How far the online tuner may move away from the width tuned from the triangles, either way */
+#define COLLISION_TUNE_MAX_DRIFT 4.0f
+
+int collision_compare_f32_internal(const void* a, const void* b) {
+	f32 value_a = *(const f32*)a;
+	f32 value_b = *(const f32*)b;
+	return (value_a > value_b) - (value_a < value_b);
+}
+
+/* The narrowest cells that keep a dense grid over world_bound under COLLISION_TUNE_DENSE_CELLS_PER_TRIANGLE */
+f32 collision_tune_min_cell_width_internal(int collider_count, BoundingBox world_bound, SpacialHashMode mode) {
+	if (mode != SPACIAL_HASH_DENSE || world_bound.min.x > world_bound.max.x) { return COLLISION_TUNE_MIN_CELL_WIDTH; }
+
+	f32 area = (world_bound.max.x - world_bound.min.x) * (world_bound.max.z - world_bound.min.z);
+	f32 max_cells = (f32)MAX2(collider_count, 1) * COLLISION_TUNE_DENSE_CELLS_PER_TRIANGLE;
+	return MAX2(sqrtf(area / max_cells), COLLISION_TUNE_MIN_CELL_WIDTH);
+}
+
+SpacialHashTuning collision_spacial_hash_tune(TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode) {
+	SpacialHashTuning tuning = {
+		.cell_width = DEFAULT_CELL_WIDTH,
+		.median_triangle_extent = 0.0f,
+		.triangle_density = 0.0f,
+		.sampled_triangle_count = 0,
+	};
+	if (static_colliders.length == 0 || world_bound.min.x > world_bound.max.x) { return tuning; }
+
+	/* Strided samples are plenty for a median, and keep this cheap next to the build itself */
+	f32 extents[COLLISION_TUNE_SAMPLE_COUNT];
+	int stride = MAX2(static_colliders.length / COLLISION_TUNE_SAMPLE_COUNT, 1);
+	int sample_count = 0;
+	for (int i = 0; i < static_colliders.length && sample_count < COLLISION_TUNE_SAMPLE_COUNT; i += stride) {
+		TriangleCollider tri = static_colliders.colliders[i];
+		f32 width = MAX3(tri.vert_1.x, tri.vert_2.x, tri.vert_3.x) - MIN3(tri.vert_1.x, tri.vert_2.x, tri.vert_3.x);
+		f32 depth = MAX3(tri.vert_1.z, tri.vert_2.z, tri.vert_3.z) - MIN3(tri.vert_1.z, tri.vert_2.z, tri.vert_3.z);
+		extents[sample_count++] = MAX2(width, depth);
+	}
+	qsort(extents, sample_count, sizeof(*extents), collision_compare_f32_internal);
+
+	f32 area = MAX2((world_bound.max.x - world_bound.min.x) * (world_bound.max.z - world_bound.min.z), 1.0f);
+	tuning.median_triangle_extent = extents[sample_count / 2];
+	tuning.triangle_density = (f32)static_colliders.length / area;
+	tuning.sampled_triangle_count = sample_count;
+
+	f32 min_cell_width = collision_tune_min_cell_width_internal(static_colliders.length, world_bound, mode);
+	f32 cell_width = tuning.median_triangle_extent * COLLISION_TUNE_EXTENT_SCALE;
+	/* Cells as wide as big triangles hold several of them each, which made terrain raycasts slower than the default width */
+	if (cell_width > DEFAULT_CELL_WIDTH) {
+		cell_width = sqrtf(cell_width * DEFAULT_CELL_WIDTH);
+	}
+	tuning.cell_width = MAX2(cell_width, min_cell_width);
+	return tuning;
+}
+
+SpacialHash collision_spacial_hash_create_tuned(Arena* collider_data_arena, SpacialHashTuner* tuner, TriangleColliderArray static_colliders, BoundingBox world_bound) {
+	if (!(tuner->cell_width > 0.0f)) {
+		tuner->tuning = collision_spacial_hash_tune(static_colliders, world_bound, tuner->mode);
+		tuner->cell_width = tuner->tuning.cell_width;
+	}
+
+	/* The world can grow after tuning, a dense grid still has to stay small */
+	f32 cell_width = MAX2(tuner->cell_width, collision_tune_min_cell_width_internal(static_colliders.length, world_bound, tuner->mode));
+	SpacialHash spacial_hash = collision_spacial_hash_create_with_cell_width(collider_data_arena, static_colliders, world_bound, tuner->mode, cell_width);
+	spacial_hash.query_stats = &tuner->stats;
+	return spacial_hash;
+}
+
+/* Queries count in with relaxed atomics, so reading and resetting is done the same way */
+void collision_spacial_hash_tuner_collect(SpacialHashTuner* tuner, SpacialHashQueryStats* stats) {
+	tuner->stats.query_count += __atomic_exchange_n(&stats->query_count, 0, __ATOMIC_RELAXED);
+	tuner->stats.cell_count += __atomic_exchange_n(&stats->cell_count, 0, __ATOMIC_RELAXED);
+	tuner->stats.entry_count += __atomic_exchange_n(&stats->entry_count, 0, __ATOMIC_RELAXED);
+}
+
+/**
+* Once cells are wider than the triangles in them, the triangles a query tests per cell grow with the area of a cell,
+* so the width moves by the square root of how far off the target that is. Each update moves it at most by half
+* or double, and never further than COLLISION_TUNE_MAX_DRIFT from where tuning from the triangles started.
+*/
+bool collision_spacial_hash_tuner_update(SpacialHashTuner* tuner) {
+	SpacialHashQueryStats stats = tuner->stats;
+	if (stats.query_count < COLLISION_TUNE_MIN_QUERIES || stats.cell_count == 0 || !(tuner->cell_width > 0.0f)) { return false; }
+	tuner->stats = (SpacialHashQueryStats) {0};
+
+	tuner->entries_per_cell = (f32)stats.entry_count / (f32)stats.cell_count;
+	f32 scale = sqrtf(COLLISION_TUNE_TARGET_ENTRIES_PER_CELL / MAX2(tuner->entries_per_cell, 0.01f));
+	scale = MIN2(MAX2(scale, 0.5f), 2.0f);
+	if (math_f32_abs(scale - 1.0f) <= COLLISION_TUNE_HYSTERESIS) { return false; }
+
+	f32 cell_width = tuner->cell_width * scale;
+	cell_width = MIN2(MAX2(cell_width, tuner->tuning.cell_width / COLLISION_TUNE_MAX_DRIFT), tuner->tuning.cell_width * COLLISION_TUNE_MAX_DRIFT);
+	cell_width = MAX2(cell_width, COLLISION_TUNE_MIN_CELL_WIDTH);
+	if (cell_width == tuner->cell_width) { return false; }
+
+	tuner->cell_width = cell_width;
+	tuner->retune_count++;
+	return true;
+}
+
+void collision_spacial_hash_occupancy_histogram(const SpacialHash* spacial_hash, i64 out_buckets[SPACIAL_HASH_HISTOGRAM_SIZE]) {
+	for (int i = 0; i < SPACIAL_HASH_HISTOGRAM_SIZE; i++) {
+		out_buckets[i] = 0;
+	}
+
+	i64 occupied = 0;
+	for (int slot = 0; slot < spacial_hash->slot_count; slot++) {
+		int count = spacial_hash->cells[slot].count;
+		if (count == 0) { continue; }
+
+		/* 1 goes into bucket 1, 2-3 into 2, 4-7 into 3... */
+		int bucket = 1;
+		while (bucket < SPACIAL_HASH_HISTOGRAM_SIZE - 1 && count >= (2 << (bucket - 1))) { bucket++; }
+		out_buckets[bucket]++;
+		occupied++;
+	}
+	out_buckets[0] = ((i64)spacial_hash->x_axis_cell_count * (i64)spacial_hash->z_axis_cell_count) - occupied;
+}
+#endif
+
+#ifndef REGION_GROUND_HEIGHT
+/* How many triangles collision_ground_height hands to math_batch_vertical_line_triangles at a time */
+#define COLLISION_GROUND_BATCH 8
+
+/**
+* Walks the cell down from y_from a batch of triangles at a time. Once everything left ends below the best height
+* found so far nothing else can beat it, which max_y_so_far tells without looking at the rest.
+*/
+GroundHit collision_ground_height(const SpacialHash* spacial_hash, f32 x, f32 z, f32 y_from, LayerMask layer_mask) {
+	GroundHit hit = (GroundHit) {
+		.height = -INFINITY,
+		.entity_id = ENTITY_HANDLE_NONE,
+		.collider = NULL,
+	};
+
+	int cell_x = (int)math_f32_floor((x - spacial_hash->world_bounding_box.min.x) / spacial_hash->cell_width);
+	int cell_z = (int)math_f32_floor((z - spacial_hash->world_bounding_box.min.z) / spacial_hash->cell_width);
+	const SpaceCell* cell = collision_spacial_hash_get_cell(spacial_hash, cell_x, cell_z);
+	if (cell == NULL || !(cell->mask & layer_mask)) {
+		if (spacial_hash->query_stats != NULL) { collision_query_stats_add_internal(spacial_hash->query_stats, 0, 0); }
+		return hit;
+	}
+	f32 y_limit = y_from + COLLISION_HEIGHT_SLACK;
+
+	int first; int end;
+	collision_space_cell_range(cell, -INFINITY, y_limit, &first, &end);
+
+	const Vector3* triangles[COLLISION_GROUND_BATCH];
+	TriangleCollider* batch_colliders[COLLISION_GROUND_BATCH];
+	f32 heights[COLLISION_GROUND_BATCH];
+
+	u64 entries_tested = 0;
+	int i = end - 1;
+	while (i >= first && cell->entries[i].max_y_so_far >= hit.height) {
+		int batch_count = 0;
+		for (; i >= first && batch_count < COLLISION_GROUND_BATCH; i--) {
+			const ColliderColumnEntry* entry = &cell->entries[i];
+			if (entry->max_y_so_far < hit.height) { break; }
+			if (entry->max_y < hit.height || !(entry->mask & layer_mask)) { continue; }
+
+			triangles[batch_count] = &entry->collider->vert_1;
+			batch_colliders[batch_count] = entry->collider;
+			batch_count++;
+		}
+
+		math_batch_vertical_line_triangles(heights, x, z, triangles, batch_count);
+		entries_tested += batch_count;
+		for (int j = 0; j < batch_count; j++) {
+			if (heights[j] <= y_limit && heights[j] > hit.height) {
+				hit.height = heights[j];
+				hit.collider = batch_colliders[j];
+			}
+		}
+	}
+
+	if (spacial_hash->query_stats != NULL) {
+		collision_query_stats_add_internal(spacial_hash->query_stats, 1, entries_tested);
+	}
+
+	if (hit.collider != NULL) {
+		hit.entity_id = hit.collider->entity_id;
+	}
+	return hit;
+}
+
+/* Steeper than this between two samples is taken as a ledge, which interpolating would smear out */
+#define COLLISION_HEIGHTMAP_MAX_SLOPE 2.0f
+
+/**
+* Interpolates the four samples around (x, z). Returns false when the heightmap can't answer well: off its edges,
+* next to a sample with nothing under it or a ledge, or when y_from is below any of the four, where it could be
+* under an overhang.
+*/
+bool collision_ground_heightmap_sample_internal(const GroundHeightmap* heightmap, f32 x, f32 y_from, f32 z, GroundHit* out_hit) {
+	f32 grid_x = (x - heightmap->min_x) / heightmap->spacing;
+	f32 grid_z = (z - heightmap->min_z) / heightmap->spacing;
+	int sample_x = (int)math_f32_floor(grid_x);
+	int sample_z = (int)math_f32_floor(grid_z);
+	if (sample_x < 0 || sample_x + 1 >= heightmap->x_count) { return false; }
+	if (sample_z < 0 || sample_z + 1 >= heightmap->z_count) { return false; }
+
+	int index = (heightmap->x_count * sample_z) + sample_x;
+	f32 height_00 = heightmap->heights[index];
+	f32 height_10 = heightmap->heights[index + 1];
+	f32 height_01 = heightmap->heights[index + heightmap->x_count];
+	f32 height_11 = heightmap->heights[index + heightmap->x_count + 1];
+
+	f32 lowest = MIN2(MIN2(height_00, height_10), MIN2(height_01, height_11));
+	f32 highest = MAX2(MAX2(height_00, height_10), MAX2(height_01, height_11));
+	if (lowest == -INFINITY || y_from < highest) { return false; }
+	if (highest - lowest > heightmap->spacing * COLLISION_HEIGHTMAP_MAX_SLOPE) { return false; }
+
+	f32 blend_x = grid_x - (f32)sample_x;
+	f32 blend_z = grid_z - (f32)sample_z;
+	f32 height_0 = height_00 + ((height_10 - height_00) * blend_x);
+	f32 height_1 = height_01 + ((height_11 - height_01) * blend_x);
+
+	/* The nearest sample's triangle stands in for the one actually under the point */
+	int nearest = index + (blend_x >= 0.5f) + ((blend_z >= 0.5f) ? heightmap->x_count : 0);
+	out_hit->height = height_0 + ((height_1 - height_0) * blend_z);
+	out_hit->collider = heightmap->colliders[nearest];
+	out_hit->entity_id = out_hit->collider->entity_id;
+	return true;
+}
+
+void collision_ground_height_batch(const SpacialHash* spacial_hash, const GroundHeightmap* heightmap, const Vector3* probes, int probe_count, LayerMask layer_mask, GroundHit* out_hits) {
+	bool use_heightmap = (heightmap != NULL) && (heightmap->heights != NULL) && (heightmap->mask == layer_mask);
+
+	for (int i = 0; i < probe_count; i++) {
+		Vector3 probe = probes[i];
+		if (use_heightmap && collision_ground_heightmap_sample_internal(heightmap, probe.x, probe.y, probe.z, &out_hits[i])) { continue; }
+
+		out_hits[i] = collision_ground_height(spacial_hash, probe.x, probe.z, probe.y, layer_mask);
+	}
+}
+
+/**
+* The samples line up with the cell corners, plus samples_per_cell - 1 in between. Heights between samples are
+* interpolated, so it's for terrain that's smooth at that spacing. Build it once for static terrain and keep it.
+*/
+GroundHeightmap collision_ground_heightmap_create(Arena* arena, const SpacialHash* spacial_hash, LayerMask layer_mask, int samples_per_cell) {
+	if (NEVER(samples_per_cell <= 0)) { samples_per_cell = 1; }
+	if (spacial_hash->cells == NULL) { return (GroundHeightmap) {0}; }
+
+	GroundHeightmap heightmap = (GroundHeightmap) {
+		.mask = layer_mask,
+		.spacing = spacial_hash->cell_width / (f32)samples_per_cell,
+		.min_x = spacial_hash->world_bounding_box.min.x,
+		.min_z = spacial_hash->world_bounding_box.min.z,
+		.x_count = (spacial_hash->x_axis_cell_count * samples_per_cell) + 1,
+		.z_count = (spacial_hash->z_axis_cell_count * samples_per_cell) + 1,
+	};
+
+	int sample_count = heightmap.x_count * heightmap.z_count;
+	heightmap.heights = arena_alloc(arena, sizeof(*heightmap.heights) * sample_count);
+	heightmap.colliders = arena_alloc(arena, sizeof(*heightmap.colliders) * sample_count);
+
+	for (int z = 0; z < heightmap.z_count; z++) {
+		for (int x = 0; x < heightmap.x_count; x++) {
+			f32 sample_x = heightmap.min_x + (heightmap.spacing * (f32)x);
+			f32 sample_z = heightmap.min_z + (heightmap.spacing * (f32)z);
+
+			/* The last row and column sit on the far edge of the grid, look them up in the cells just inside */
+			f32 lookup_x = MIN2(sample_x, heightmap.min_x + (spacial_hash->cell_width * (f32)spacial_hash->x_axis_cell_count) - COLLISION_HEIGHT_SLACK);
+			f32 lookup_z = MIN2(sample_z, heightmap.min_z + (spacial_hash->cell_width * (f32)spacial_hash->z_axis_cell_count) - COLLISION_HEIGHT_SLACK);
+
+			GroundHit hit = collision_ground_height(spacial_hash, lookup_x, lookup_z, INFINITY, layer_mask);
+			heightmap.heights[(heightmap.x_count * z) + x] = hit.height;
+			heightmap.colliders[(heightmap.x_count * z) + x] = hit.collider;
+		}
+	}
+
+	return heightmap;
+}
+#endif
+
+#ifndef REGION_SWEEPS
+/* How many triangles a sweep hands to math_batch_sweep_capsule_triangles at a time */
+#define COLLISION_SWEEP_BATCH 16
+
+/* Slots in the set of triangles a sweep already gathered, a power of two */
+#define COLLISION_SWEEP_SEEN_SLOTS 64
+
+/**
+* The x range of the swept capsule's footprint over the rows of cells between z_low and z_high. Seen from above the
+* capsule's segment sweeps a convex quad (points), and the capsule is that grown by its radius. Returns false if it
+* doesn't reach the rows.
+*/
+bool collision_sweep_row_extent_internal(const Vector3 points[4], f32 radius, f32 z_low, f32 z_high, f32* out_x_low, f32* out_x_high) {
+	z_low -= radius;
+	z_high += radius;
+
+	/* The quad's corners between the two lines and every crossing of the lines, by any pair of corners */
+	f32 x_low = INFINITY;
+	f32 x_high = -INFINITY;
+	for (int i = 0; i < 4; i++) {
+		if (points[i].z >= z_low && points[i].z <= z_high) {
+			x_low = MIN2(x_low, points[i].x);
+			x_high = MAX2(x_high, points[i].x);
+		}
+		for (int j = i + 1; j < 4; j++) {
+			f32 lines[2] = { z_low, z_high };
+			for (int line = 0; line < 2; line++) {
+				f32 z_i = points[i].z - lines[line];
+				f32 z_j = points[j].z - lines[line];
+				if ((z_i < 0.0f) == (z_j < 0.0f)) { continue; }
+
+				f32 x = points[i].x + (points[j].x - points[i].x) * (z_i / (z_i - z_j));
+				x_low = MIN2(x_low, x);
+				x_high = MAX2(x_high, x);
+			}
+		}
+	}
+
+	*out_x_low = x_low - radius;
+	*out_x_high = x_high + radius;
+	return x_low <= x_high;
+}
+
+/**
+* Whether a capsule that starts out touching a triangle moves further into it. The narrow phase decides that for
+* each part of the triangle on its own, which can disagree with the closest points when it's in deep.
+*/
+bool collision_sweep_moves_in_internal(Vector3 start, Vector3 end, Vector3 motion, const TriangleCollider* collider) {
+	Vector3 segment_point; Vector3 triangle_point;
+	math_closest_points_segment_triangle(start, end, collider->vert_1, collider->vert_2, collider->vert_3, &segment_point, &triangle_point);
+
+	Vector3 away = Vector3Subtract(segment_point, triangle_point);
+	return Vector3LengthSqr(away) <= EPSILON * EPSILON || Vector3DotProduct(away, motion) < 0.0f;
+}
+
+/**
+* Whether the sweep already gathered the triangle from another cell, and remembers it if not. seen is an open addressed
+* set of COLLISION_SWEEP_SEEN_SLOTS. It's kept at most half full, past that triangles just get tested again.
+*/
+bool collision_sweep_seen_internal(TriangleCollider** seen, int* seen_count, TriangleCollider* collider) {
+	u32 slot = ((u32)((u64)collider / sizeof(TriangleCollider)) * 2654435761u) & (COLLISION_SWEEP_SEEN_SLOTS - 1);
+	while (seen[slot] != NULL) {
+		if (seen[slot] == collider) { return true; }
+		slot = (slot + 1) & (COLLISION_SWEEP_SEEN_SLOTS - 1);
+	}
+	if (*seen_count < COLLISION_SWEEP_SEEN_SLOTS / 2) {
+		seen[slot] = collider;
+		(*seen_count)++;
+	}
+	return false;
+}
+
+/* Runs the gathered triangles through the narrow phase and keeps the earliest hit */
+void collision_sweep_flush_internal(
+	Vector3 start, Vector3 end, f32 radius, Vector3 motion,
+	const Vector3** triangles, TriangleCollider** colliders, int count,
+	f32* best_time, TriangleCollider** best_collider
+) {
+	f32 times[COLLISION_SWEEP_BATCH];
+	math_batch_sweep_capsule_triangles(times, start, end, radius, motion, triangles, count);
+	for (int i = 0; i < count; i++) {
+		if (times[i] == 0.0f && !collision_sweep_moves_in_internal(start, end, motion, colliders[i])) { continue; }
+		if (times[i] < *best_time) {
+			*best_time = times[i];
+			*best_collider = colliders[i];
+		}
+	}
+}
+
+/**
+* Visits every cell under the swept capsule's footprint, one row at a time. In each cell only the entries at the
+* heights the sweep covers are looked at, and only the triangles whose bounding box reaches the sweep's go through
+* the narrow phase, once each even when they're in several of the cells.
+*/
+SweepHit collision_sweep_capsule_internal(
+	const SpacialHash* spacial_hash,
+	LayerMask layer_mask,
+	Vector3 start,
+	Vector3 end,
+	f32 radius,
+	Vector3 motion,
+	u64* out_cells_visited,
+	u64* out_entries_tested
+) {
+	SweepHit hit = (SweepHit) {
+		.time = 1.0f,
+		.point = VECTOR3_INFINITY,
+		.normal = VECTOR3_ZERO,
+		.entity_id = ENTITY_HANDLE_NONE,
+		.collider = NULL,
+	};
+	*out_cells_visited = 0;
+	*out_entries_tested = 0;
+	if (spacial_hash->cells == NULL) { return hit; }
+
+	Vector3 points[4] = { start, end, Vector3Add(start, motion), Vector3Add(end, motion) };
+	Vector3 padding = { radius + COLLISION_HEIGHT_SLACK, radius + COLLISION_HEIGHT_SLACK, radius + COLLISION_HEIGHT_SLACK };
+	BoundingBox swept = {
+		.min = Vector3Subtract(Vector3Min(Vector3Min(points[0], points[1]), Vector3Min(points[2], points[3])), padding),
+		.max = Vector3Add(Vector3Max(Vector3Max(points[0], points[1]), Vector3Max(points[2], points[3])), padding),
+	};
+	if (swept.max.y < spacial_hash->world_bounding_box.min.y || swept.min.y > spacial_hash->world_bounding_box.max.y) { return hit; }
+
+	f32 cell_width = spacial_hash->cell_width;
+	f32 grid_min_x = spacial_hash->world_bounding_box.min.x;
+	f32 grid_min_z = spacial_hash->world_bounding_box.min.z;
+	int min_z = MAX2((int)math_f32_floor((swept.min.z - grid_min_z) / cell_width), 0);
+	int max_z = MIN2((int)math_f32_floor((swept.max.z - grid_min_z) / cell_width), spacial_hash->z_axis_cell_count - 1);
+
+	const Vector3* triangles[COLLISION_SWEEP_BATCH];
+	TriangleCollider* batch_colliders[COLLISION_SWEEP_BATCH];
+	int batch_count = 0;
+	f32 best_time = INFINITY;
+	TriangleCollider* best_collider = NULL;
+
+	/* On the stack, sweeps run on any thread and most only gather a handful of triangles */
+	TriangleCollider* seen[COLLISION_SWEEP_SEEN_SLOTS] = {0};
+	int seen_count = 0;
+
+	for (int z = min_z; z <= max_z; z++) {
+		f32 row_low = grid_min_z + (f32)z * cell_width;
+		f32 x_low; f32 x_high;
+		if (!collision_sweep_row_extent_internal(points, radius + COLLISION_HEIGHT_SLACK, row_low, row_low + cell_width, &x_low, &x_high)) { continue; }
+
+		int min_x = MAX2((int)math_f32_floor((x_low - grid_min_x) / cell_width), 0);
+		int max_x = MIN2((int)math_f32_floor((x_high - grid_min_x) / cell_width), spacial_hash->x_axis_cell_count - 1);
+		for (int x = min_x; x <= max_x; x++) {
+			const SpaceCell* cell = collision_spacial_hash_get_cell(spacial_hash, x, z);
+			if (cell == NULL || !(cell->mask & layer_mask)) { continue; }
+			(*out_cells_visited)++;
+
+			int first; int end_entry;
+			collision_space_cell_range(cell, swept.min.y, swept.max.y, &first, &end_entry);
+			for (int i = first; i < end_entry; i++) {
+				const ColliderColumnEntry* entry = &cell->entries[i];
+				if (entry->max_y < swept.min.y || entry->min_y > swept.max.y || !(entry->mask & layer_mask)) { continue; }
+
+				TriangleCollider* tri = entry->collider;
+				if (MAX3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) < swept.min.x || MIN3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) > swept.max.x) { continue; }
+				if (MAX3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) < swept.min.z || MIN3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) > swept.max.z) { continue; }
+				if (collision_sweep_seen_internal(seen, &seen_count, tri)) { continue; }
+
+				triangles[batch_count] = &tri->vert_1;
+				batch_colliders[batch_count] = tri;
+				batch_count++;
+				if (batch_count == COLLISION_SWEEP_BATCH) {
+					collision_sweep_flush_internal(start, end, radius, motion, triangles, batch_colliders, batch_count, &best_time, &best_collider);
+					*out_entries_tested += batch_count;
+					batch_count = 0;
+				}
+			}
+		}
+	}
+	if (batch_count > 0) {
+		collision_sweep_flush_internal(start, end, radius, motion, triangles, batch_colliders, batch_count, &best_time, &best_collider);
+		*out_entries_tested += batch_count;
+	}
+
+	if (best_collider == NULL) { return hit; }
+
+	/* The contact is where the capsule and the triangle are closest when they touch */
+	Vector3 segment_point; Vector3 triangle_point;
+	math_closest_points_segment_triangle(
+		Vector3Add(start, Vector3Scale(motion, best_time)),
+		Vector3Add(end, Vector3Scale(motion, best_time)),
+		best_collider->vert_1, best_collider->vert_2, best_collider->vert_3,
+		&segment_point, &triangle_point
+	);
+
+	Vector3 normal = Vector3Subtract(segment_point, triangle_point);
+	f32 length = Vector3Length(normal);
+	if (length > EPSILON) {
+		normal = Vector3Scale(normal, 1.0f / length);
+	} else {
+		/* Already going through it, push back out against the motion */
+		normal = Vector3Normalize(Vector3CrossProduct(
+			Vector3Subtract(best_collider->vert_2, best_collider->vert_1),
+			Vector3Subtract(best_collider->vert_3, best_collider->vert_1)
+		));
+		if (Vector3DotProduct(normal, motion) > 0.0f) { normal = Vector3Negate(normal); }
+	}
+
+	hit.time = best_time;
+	hit.point = triangle_point;
+	hit.normal = normal;
+	hit.collider = best_collider;
+	hit.entity_id = best_collider->entity_id;
+	return hit;
+}
+
+SweepHit collision_sweep_capsule(const SpacialHash* spacial_hash, LayerMask layer_mask, Vector3 start, Vector3 end, f32 radius, Vector3 motion) {
+	u64 cells_visited = 0;
+	u64 entries_tested = 0;
+	SweepHit hit = collision_sweep_capsule_internal(spacial_hash, layer_mask, start, end, radius, motion, &cells_visited, &entries_tested);
+
+	if (spacial_hash->query_stats != NULL) {
+		collision_query_stats_add_internal(spacial_hash->query_stats, cells_visited, entries_tested);
+	}
+	return hit;
+}
+
+SweepHit collision_sweep_sphere(const SpacialHash* spacial_hash, LayerMask layer_mask, Vector3 center, f32 radius, Vector3 motion) {
+	return collision_sweep_capsule(spacial_hash, layer_mask, center, center, radius, motion);
+}
+
+void collision_sweep_capsule_batch(const SpacialHash* spacial_hash, LayerMask layer_mask, const CapsuleSweep* sweeps, int sweep_count, SweepHit* out_hits) {
+	for (int i = 0; i < sweep_count; i++) {
+		const CapsuleSweep* sweep = &sweeps[i];
+		out_hits[i] = collision_sweep_capsule(spacial_hash, layer_mask, sweep->start, sweep->end, sweep->radius, sweep->motion);
+	}
+}
+#endif
+
+#ifndef REGION_OVERLAPS
+typedef enum OverlapShapeType {
+	OVERLAP_SHAPE_AABB,
+	OVERLAP_SHAPE_SPHERE,
+	OVERLAP_SHAPE_FRUSTUM,
+} OverlapShapeType;
+
+typedef struct OverlapShape {
+	OverlapShapeType type;
+	/* Everything the shape touches is inside it */
+	BoundingBox bounds;
+	Vector3 center;
+	f32 radius;
+	const Frustum* frustum;
+} OverlapShape;
+
+OverlapStamps collision_overlap_stamps_create(Arena* arena, int triangle_capacity, int entity_capacity) {
+	OverlapStamps stamps = {
+		.stamp = 0,
+		.triangles = arena_alloc(arena, sizeof(u32) * (u64)triangle_capacity),
+		.triangle_capacity = triangle_capacity,
+		.entities = arena_alloc(arena, sizeof(u32) * (u64)entity_capacity),
+		.entity_capacity = entity_capacity,
+	};
+	for (int i = 0; i < triangle_capacity; i++) { stamps.triangles[i] = 0; }
+	for (int i = 0; i < entity_capacity; i++) { stamps.entities[i] = 0; }
+	return stamps;
+}
+
+/* Starts a query. Once every 2^32 queries the stamp wraps around, and everything stamped before has to be cleared. */
+void collision_overlap_stamps_next_internal(OverlapStamps* stamps) {
+	stamps->stamp++;
+	if (stamps->stamp != 0) { return; }
+
+	for (int i = 0; i < stamps->triangle_capacity; i++) { stamps->triangles[i] = 0; }
+	for (int i = 0; i < stamps->entity_capacity; i++) { stamps->entities[i] = 0; }
+	stamps->stamp = 1;
+}
+
+bool collision_overlap_shape_box_internal(const OverlapShape* shape, BoundingBox box) {
+	switch (shape->type) {
+		case OVERLAP_SHAPE_AABB: return true;
+		case OVERLAP_SHAPE_SPHERE: {
+			Vector3 closest = Vector3Clamp(shape->center, box.min, box.max);
+			return Vector3DistanceSqr(closest, shape->center) <= shape->radius * shape->radius;
+		}
+		case OVERLAP_SHAPE_FRUSTUM: return math_frustum_aabb_overlap(shape->frustum, box);
+	}
+	return true;
+}
+
+bool collision_overlap_shape_triangle_internal(const OverlapShape* shape, const TriangleCollider* tri) {
+	switch (shape->type) {
+		case OVERLAP_SHAPE_AABB: return math_triangle_aabb_overlap(tri->vert_1, tri->vert_2, tri->vert_3, shape->bounds);
+		case OVERLAP_SHAPE_SPHERE: {
+			Vector3 closest = math_closest_point_triangle(shape->center, tri->vert_1, tri->vert_2, tri->vert_3);
+			return Vector3DistanceSqr(closest, shape->center) <= shape->radius * shape->radius;
+		}
+		case OVERLAP_SHAPE_FRUSTUM: return math_frustum_triangle_overlap(shape->frustum, tri->vert_1, tri->vert_2, tri->vert_3);
+	}
+	return false;
+}
+
+/**
+* Visits the cells under the shape's bounds, skipping the ones whose contents can't touch the shape. In each, only the
+* entries at the heights the bounds cover are looked at. A triangle gets tested the first time it turns up, and its
+* entity reported the first time one of its triangles touches, stamps keep track of both.
+* With out_triangles set it reports the triangles themselves instead, entity or not, and leaves out_entities alone.
+*/
+int collision_overlap_internal(
+	const SpacialHash* spacial_hash,
+	OverlapStamps* stamps,
+	LayerMask layer_mask,
+	const OverlapShape* shape,
+	EntityHandle* out_entities,
+	TriangleCollider** out_triangles,
+	int max_results
+) {
+	collision_overlap_stamps_next_internal(stamps);
+	u32 stamp = stamps->stamp;
+	int found = 0;
+	u64 cells_visited = 0;
+	u64 entries_tested = 0;
+
+	BoundingBox bounds = shape->bounds;
+	BoundingBox world = spacial_hash->world_bounding_box;
+	if (spacial_hash->cells != NULL && bounds.max.y >= world.min.y && bounds.min.y <= world.max.y) {
+		/* Clamped to the grid, a frustum with its far plane at infinity has infinite bounds */
+
+		f32 cell_width = spacial_hash->cell_width;
+		int min_x = MAX2((int)math_f32_floor((MAX2(bounds.min.x, world.min.x) - world.min.x) / cell_width), 0);
+		int min_z = MAX2((int)math_f32_floor((MAX2(bounds.min.z, world.min.z) - world.min.z) / cell_width), 0);
+		int max_x = MIN2((int)math_f32_floor((MIN2(bounds.max.x, world.max.x) - world.min.x) / cell_width), spacial_hash->x_axis_cell_count - 1);
+		int max_z = MIN2((int)math_f32_floor((MIN2(bounds.max.z, world.max.z) - world.min.z) / cell_width), spacial_hash->z_axis_cell_count - 1);
+
+		for (int z = min_z; z <= max_z; z++) {
+			for (int x = min_x; x <= max_x; x++) {
+				const SpaceCell* cell = collision_spacial_hash_get_cell(spacial_hash, x, z);
+				if (cell == NULL || !(cell->mask & layer_mask)) { continue; }
+				if (cell->max_y < bounds.min.y || cell->min_y > bounds.max.y) { continue; }
+
+				BoundingBox cell_box = {
+					.min = { world.min.x + (f32)x * cell_width, cell->min_y, world.min.z + (f32)z * cell_width },
+					.max = { world.min.x + (f32)(x + 1) * cell_width, cell->max_y, world.min.z + (f32)(z + 1) * cell_width },
+				};
+				if (!collision_overlap_shape_box_internal(shape, cell_box)) { continue; }
+				cells_visited++;
+
+				int first; int end;
+				collision_space_cell_range(cell, bounds.min.y, bounds.max.y, &first, &end);
+				for (int i = first; i < end; i++) {
+					const ColliderColumnEntry* entry = &cell->entries[i];
+					if (entry->max_y < bounds.min.y || entry->min_y > bounds.max.y || !(entry->mask & layer_mask)) { continue; }
+
+					TriangleCollider* tri = entry->collider;
+					u32 entity_index = entity_handle_index(tri->entity_id);
+					if (out_triangles == NULL) {
+						if (tri->entity_id == ENTITY_HANDLE_NONE) { continue; }
+						if (NEVER(entity_index >= (u32)stamps->entity_capacity)) { continue; }
+						if (stamps->entities[entity_index] == stamp) { continue; }
+					}
+
+					i64 triangle_index = tri - spacial_hash->colliders;
+					if (spacial_hash->colliders != NULL && triangle_index >= 0 && triangle_index < MIN2(spacial_hash->collider_count, stamps->triangle_capacity)) {
+						if (stamps->triangles[triangle_index] == stamp) { continue; }
+						stamps->triangles[triangle_index] = stamp;
+					}
+
+					if (MAX3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) < bounds.min.x || MIN3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x) > bounds.max.x) { continue; }
+					if (MAX3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) < bounds.min.z || MIN3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) > bounds.max.z) { continue; }
+					entries_tested++;
+					if (!collision_overlap_shape_triangle_internal(shape, tri)) { continue; }
+
+					if (out_triangles != NULL) {
+						if (found < max_results) { out_triangles[found] = tri; }
+						found++;
+						continue;
+					}
+					stamps->entities[entity_index] = stamp;
+					if (found < max_results) { out_entities[found] = tri->entity_id; }
+					found++;
+				}
+			}
+		}
+	}
+
+	if (spacial_hash->query_stats != NULL) {
+		collision_query_stats_add_internal(spacial_hash->query_stats, cells_visited, entries_tested);
+	}
+	return found;
+}
+
+/* What the public overlap queries look for, the shapes are the same for entities and triangles */
+OverlapShape collision_overlap_sphere_shape_internal(Vector3 center, f32 radius) {
+	Vector3 extents = { radius, radius, radius };
+	return (OverlapShape) {
+		.type = OVERLAP_SHAPE_SPHERE,
+		.bounds = { Vector3Subtract(center, extents), Vector3Add(center, extents) },
+		.center = center,
+		.radius = radius,
+	};
+}
+
+OverlapShape collision_overlap_frustum_shape_internal(const Frustum* frustum) {
+	return (OverlapShape) {
+		.type = OVERLAP_SHAPE_FRUSTUM,
+		.bounds = math_frustum_bounds(frustum),
+		.frustum = frustum,
+	};
+}
+
+int collision_overlap_aabb(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, BoundingBox box, EntityHandle* out_entities, int max_entities) {
+	OverlapShape shape = { .type = OVERLAP_SHAPE_AABB, .bounds = box };
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, out_entities, NULL, max_entities);
+}
+
+int collision_overlap_sphere(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, Vector3 center, f32 radius, EntityHandle* out_entities, int max_entities) {
+	OverlapShape shape = collision_overlap_sphere_shape_internal(center, radius);
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, out_entities, NULL, max_entities);
+}
+
+int collision_overlap_frustum(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, const Frustum* frustum, EntityHandle* out_entities, int max_entities) {
+	OverlapShape shape = collision_overlap_frustum_shape_internal(frustum);
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, out_entities, NULL, max_entities);
+}
+
+int collision_overlap_aabb_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, BoundingBox box, TriangleCollider** out_triangles, int max_triangles) {
+	OverlapShape shape = { .type = OVERLAP_SHAPE_AABB, .bounds = box };
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, NULL, out_triangles, max_triangles);
+}
+
+int collision_overlap_sphere_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, Vector3 center, f32 radius, TriangleCollider** out_triangles, int max_triangles) {
+	OverlapShape shape = collision_overlap_sphere_shape_internal(center, radius);
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, NULL, out_triangles, max_triangles);
+}
+
+int collision_overlap_frustum_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, const Frustum* frustum, TriangleCollider** out_triangles, int max_triangles) {
+	OverlapShape shape = collision_overlap_frustum_shape_internal(frustum);
+	return collision_overlap_internal(spacial_hash, stamps, layer_mask, &shape, NULL, out_triangles, max_triangles);
+}
+#endif
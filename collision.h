@@ -14,7 +14,7 @@ typedef enum LayerMask {
 
 typedef struct TriangleCollider {
 	LayerMask mask;
-	int entity_id;
+	EntityHandle entity_id;
 
 	Vector3 vert_1;
 	Vector3 vert_2;
@@ -23,51 +23,313 @@ typedef struct TriangleCollider {
 
 typedef struct TriangleColliderArray {
 	int length;
+	int capacity;
 	TriangleCollider* colliders;
 } TriangleColliderArray;
 
-typedef struct ColliderColumnList {
-	struct ColliderColumnList* next;
+/**
+ * One triangle in a cell. max_y_so_far is the highest max_y of this entry and every one before it in the cell.
+ * mask is a copy of the collider's, so queries can skip other layers without loading the triangle.
+ */
+typedef struct ColliderColumnEntry {
+	f32 min_y;
+	f32 max_y;
+	f32 max_y_so_far;
+	LayerMask mask;
 	struct TriangleCollider* collider;
-} ColliderColumnList;
+} ColliderColumnEntry;
 
 /**
- * Represents one unsorted vertical cell of colliders
+ * Represents one vertical cell of colliders, sorted bottom to top by their lowest point.
+ * Both min_y and max_y_so_far only grow along the cell, so the entries overlapping a height interval can be binary searched.
  */
 typedef struct SpaceCell {
-	ColliderColumnList* list; 
+	int count;
+	/* Lowest and highest point of anything in the cell. Empty cells have min_y +INFINITY and max_y -INFINITY. */
+	f32 min_y;
+	f32 max_y;
+	/* Every layer in the cell OR'd together, queries for other layers skip the whole cell */
+	LayerMask mask;
+	ColliderColumnEntry* entries;
 } SpaceCell;
 
+typedef enum SpacialHashMode {
+	/* A cell for every spot in the world bounding box */
+	SPACIAL_HASH_DENSE,
+	/* Only the occupied cells, in an open addressed table keyed by their coordinates. For worlds that are mostly empty. */
+	SPACIAL_HASH_SPARSE,
+} SpacialHashMode;
+
+/* Coordinates of a cell, counted from the corner of the world bounding box. x is -1 for unused slots of a sparse hash. */
+typedef struct SpaceCellKey {
+	int x;
+	int z;
+} SpaceCellKey;
+
+/**
+ * What queries did in a hash, added up by every collision_raycast and collision_ground_height that uses it.
+ * cell_count only counts cells with something in them, entry_count the triangles tested in those.
+ */
+typedef struct SpacialHashQueryStats {
+	u64 query_count;
+	u64 cell_count;
+	u64 entry_count;
+} SpacialHashQueryStats;
+
 typedef struct SpacialHash {
 	f32 cell_width;
 	int x_axis_cell_count;
 	int z_axis_cell_count;
+	/* The grid covers its XZ extent. Its height range grows to hold whatever gets inserted. */
 	BoundingBox world_bounding_box;
+	SpacialHashMode mode;
+
+	/**
+	 * Dense hashes have a slot for every cell, a row of x at a time. Sparse ones have a power of two table of slots
+	 * where keys says which cell is in which slot. Either way every slot is a valid, possibly empty, cell.
+	 */
+	int slot_count;
+	/* Sparse only, how many slots hold a cell */
+	int occupied_slot_count;
+	struct SpaceCellKey* keys;
 	struct SpaceCell* cells;
+
+	/**
+	 * The array the hash was created from, so queries can keep something per triangle by its index in it.
+	 * Triangles added later with collision_spacial_hash_insert_array aren't in it.
+	 */
+	struct TriangleCollider* colliders;
+	int collider_count;
+
+	/* Optional, queries count into it when it's set (see SpacialHashTuner) */
+	SpacialHashQueryStats* query_stats;
 } SpacialHash;
 
+/* The cell width collision_spacial_hash_tune picked, and what it picked it from */
+typedef struct SpacialHashTuning {
+	f32 cell_width;
+	/* Median of the larger XZ side of the triangles' bounding rectangles */
+	f32 median_triangle_extent;
+	/* Triangles per square unit of the world bounding box's XZ extent */
+	f32 triangle_density;
+	int sampled_triangle_count;
+} SpacialHashTuning;
+
+/**
+ * Online tuning. Hashes built with collision_spacial_hash_create_tuned count their queries into stats, and
+ * collision_spacial_hash_tuner_update moves cell_width towards a steady number of triangles per query cell.
+ * The first build tunes from the triangles (see collision_spacial_hash_tune).
+ */
+typedef struct SpacialHashTuner {
+	SpacialHashMode mode;
+	/* 0 until the first build */
+	f32 cell_width;
+	SpacialHashTuning tuning;
+
+	SpacialHashQueryStats stats;
+	/* Measured when cell_width was last updated */
+	f32 entries_per_cell;
+	int retune_count;
+} SpacialHashTuner;
+
+/* Buckets of collision_spacial_hash_occupancy_histogram */
+#define SPACIAL_HASH_HISTOGRAM_SIZE 10
+
 typedef struct RaycastHit {
-	i64 entity_id;
+	EntityHandle entity_id;
 	Vector3 point;
 	TriangleCollider* collider;
 } RaycastHit;
 
+typedef struct GroundHit {
+	/* -INFINITY if there's no ground below */
+	f32 height;
+	EntityHandle entity_id;
+	TriangleCollider* collider;
+} GroundHit;
+
+/* Where a swept shape first touched something. The collider is NULL, and time 1, if it got all the way. */
+typedef struct SweepHit {
+	/* How far along the motion it got, in [0, 1] */
+	f32 time;
+	/* Where it touched, on the triangle */
+	Vector3 point;
+	/* Unit length, away from the triangle towards the shape */
+	Vector3 normal;
+	EntityHandle entity_id;
+	TriangleCollider* collider;
+} SweepHit;
+
+/* A capsule from start to end moving along motion, for collision_sweep_capsule_batch. A sphere is a capsule with start == end. */
+typedef struct CapsuleSweep {
+	Vector3 start;
+	Vector3 end;
+	f32 radius;
+	Vector3 motion;
+} CapsuleSweep;
+
+/**
+ * What overlap queries have seen, so triangles in several cells get tested once and entities with many triangles get
+ * reported once. Something was seen by the current query when its stamp is the query's, so nothing gets cleared
+ * between queries. Not thread safe, every thread needs its own.
+ */
+typedef struct OverlapStamps {
+	u32 stamp;
+	/* By index in the hash's colliders array */
+	u32* triangles;
+	int triangle_capacity;
+	/* By entity_handle_index */
+	u32* entities;
+	int entity_capacity;
+} OverlapStamps;
+
+/**
+ * The highest surface of some colliders, sampled on a regular grid ahead of time.
+ * It has no idea about overhangs or ledges, so it only answers for points above everything around them, on ground
+ * that isn't too steep (see collision_ground_height_batch).
+ */
+typedef struct GroundHeightmap {
+	LayerMask mask;
+	f32 spacing;
+	f32 min_x;
+	f32 min_z;
+	int x_count;
+	int z_count;
+	/* -INFINITY where there's nothing */
+	f32* heights;
+	TriangleCollider** colliders;
+} GroundHeightmap;
+
 /* Default width of cells in the spacial hash */
 #define DEFAULT_CELL_WIDTH 3.0f
 
-/* Returns the bounding box for all active colliders. Returns an empty box (all zero) if there are no active colliders. */
+/* Returns the bounding box for all active colliders. Returns an empty box (min +INFINITY, max -INFINITY) if there are no active colliders. */
 BoundingBox collision_get_world_bounding_box(TriangleColliderArray static_colliders);
 
-/* Inserts an array of triangle colliders into a spacial hash. Allocates internal spacial_hash structure into the collider data arena. */
+/**
+ * Inserts an array of triangle colliders into a spacial hash. Allocates internal spacial_hash structure into the collider data arena.
+ * The hash copies each collider's mask, so changing a mask afterwards needs the hash rebuilt.
+ */
 void collision_spacial_hash_insert_array(Arena* collider_data_arena, SpacialHash* spacial_hash, TriangleColliderArray collider_array);
 
+/* Finds the entries of a cell that can overlap the height interval [min_y, max_y]. Nothing outside [*first, *end) does. */
+void collision_space_cell_range(const SpaceCell* cell, f32 min_y, f32 max_y, int* first, int* end);
+
+/* The cell at (x, z), or NULL if it's outside the grid. Sparse hashes also return NULL for cells with nothing in them. */
+const SpaceCell* collision_spacial_hash_get_cell(const SpacialHash* spacial_hash, int x, int z);
+
+/* Which cell a slot holds */
+SpaceCellKey collision_spacial_hash_slot_key(const SpacialHash* spacial_hash, int slot);
+
 /* Constructs the spacial hash for all colliders */
 SpacialHash collision_spacial_hash_create(Arena* collider_data_arena, TriangleColliderArray static_colliders);
 
+/* Same as collision_spacial_hash_create, with the bounding box already known (from the collider loops) */
+SpacialHash collision_spacial_hash_create_with_bounds(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound);
+
+/* Same as collision_spacial_hash_create_with_bounds, in either mode. Both give the same query results. */
+SpacialHash collision_spacial_hash_create_with_mode(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode);
+
+/* Same as collision_spacial_hash_create_with_mode with cells cell_width wide */
+SpacialHash collision_spacial_hash_create_with_cell_width(Arena* collider_data_arena, TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode, f32 cell_width);
+
+/**
+ * Picks a cell width from the sizes of the triangles. Cells end up about as wide as a typical triangle, so most
+ * triangles touch a few cells and most cells hold a few triangles. A dense grid never gets more than a few cells
+ * per triangle, so a few small triangles in a big world don't allocate millions of empty cells. Triangles bigger than
+ * DEFAULT_CELL_WIDTH get cells between the two, the geometric mean of their size and the default.
+ */
+SpacialHashTuning collision_spacial_hash_tune(TriangleColliderArray static_colliders, BoundingBox world_bound, SpacialHashMode mode);
+
+/**
+ * Builds a hash with the tuner's cell width (tuning it first if it hasn't been), whose queries count into the tuner.
+ * A hash that other threads query while the tuner updates should count into its own stats instead, collected later.
+ */
+SpacialHash collision_spacial_hash_create_tuned(Arena* collider_data_arena, SpacialHashTuner* tuner, TriangleColliderArray static_colliders, BoundingBox world_bound);
+
+/* Adds stats to what the tuner looks at on its next update, and resets them */
+void collision_spacial_hash_tuner_collect(SpacialHashTuner* tuner, SpacialHashQueryStats* stats);
+
+/**
+ * Picks a new cell width from the queries since the last update. Returns true if it changed, then the hash should be
+ * rebuilt with collision_spacial_hash_create_tuned. Must not run while something queries a hash built with the tuner.
+ */
+bool collision_spacial_hash_tuner_update(SpacialHashTuner* tuner);
+
+/**
+ * Counts cells by how many entries they hold: empty cells in bucket 0, then 1, 2-3, 4-7 and so on,
+ * with everything from 2^(SPACIAL_HASH_HISTOGRAM_SIZE - 2) up in the last bucket. Empty cells of sparse hashes count too.
+ */
+void collision_spacial_hash_occupancy_histogram(const SpacialHash* spacial_hash, i64 out_buckets[SPACIAL_HASH_HISTOGRAM_SIZE]);
+
+/* Returns the closest triangle hit by the ray within raycast_length. The collider is NULL if nothing was hit. */
 RaycastHit collision_raycast(
 	const SpacialHash* spacial_hash,
 	LayerMask layer_mask,
 	Vector3 start_point,
 	Vector3 direction,
 	float raycast_length
-);
\ No newline at end of file
+);
+
+/**
+ * The highest surface at or below y_from, straight down from (x, z). Only looks at the one cell (x, z) is in,
+ * so it's much cheaper than a raycast down. The collider is NULL and height is -INFINITY if there's nothing below.
+ */
+GroundHit collision_ground_height(const SpacialHash* spacial_hash, f32 x, f32 z, f32 y_from, LayerMask layer_mask);
+
+/**
+ * collision_ground_height for many probes at once, each probe being (x, y_from, z). heightmap is optional, probes above
+ * everything in it are answered from it when its mask is layer_mask.
+ */
+void collision_ground_height_batch(const SpacialHash* spacial_hash, const GroundHeightmap* heightmap, const Vector3* probes, int probe_count, LayerMask layer_mask, GroundHit* out_hits);
+
+/* Samples the highest surface of the colliders in layer_mask samples_per_cell times along each side of every cell. Allocates into arena. */
+GroundHeightmap collision_ground_heightmap_create(Arena* arena, const SpacialHash* spacial_hash, LayerMask layer_mask, int samples_per_cell);
+
+/**
+ * Moves a capsule from start to end with radius along motion, and returns where it first touches a triangle in layer_mask.
+ * Only the cells the swept capsule passes over are visited. A capsule already touching a triangle only stops on it when
+ * motion goes further in, so something resting on the ground can still slide along it or lift off.
+ */
+SweepHit collision_sweep_capsule(const SpacialHash* spacial_hash, LayerMask layer_mask, Vector3 start, Vector3 end, f32 radius, Vector3 motion);
+
+/* collision_sweep_capsule for a sphere */
+SweepHit collision_sweep_sphere(const SpacialHash* spacial_hash, LayerMask layer_mask, Vector3 center, f32 radius, Vector3 motion);
+
+/* collision_sweep_capsule for many capsules or spheres at once */
+void collision_sweep_capsule_batch(const SpacialHash* spacial_hash, LayerMask layer_mask, const CapsuleSweep* sweeps, int sweep_count, SweepHit* out_hits);
+
+/**
+ * Stamps for entity indices below entity_capacity, and hashes of up to triangle_capacity colliders. Allocates into arena.
+ * Bigger hashes still work, their triangles may just get tested more than once.
+ */
+OverlapStamps collision_overlap_stamps_create(Arena* arena, int triangle_capacity, int entity_capacity);
+
+/**
+ * Every entity with a triangle in layer_mask that touches box. Writes the first max_entities of them to out_entities,
+ * each only once, and returns how many there are in total. Triangles without an entity, like static scenery, are left out,
+ * collision_overlap_aabb_triangles finds those.
+ */
+int collision_overlap_aabb(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, BoundingBox box, EntityHandle* out_entities, int max_entities);
+
+/* collision_overlap_aabb for a sphere */
+int collision_overlap_sphere(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, Vector3 center, f32 radius, EntityHandle* out_entities, int max_entities);
+
+/**
+ * collision_overlap_aabb for a frustum, for culling. Like math_frustum_triangle_overlap it can include triangles just
+ * off its edges, but never misses one inside it.
+ */
+int collision_overlap_frustum(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, const Frustum* frustum, EntityHandle* out_entities, int max_entities);
+
+/**
+ * Every triangle in layer_mask that touches box, with an entity or without. Writes the first max_triangles of them to
+ * out_triangles and returns how many there are in total. The stamps only need a triangle_capacity, each triangle of the
+ * hash's colliders array is found once. Triangles inserted later, or past triangle_capacity, can turn up once per cell.
+ */
+int collision_overlap_aabb_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, BoundingBox box, TriangleCollider** out_triangles, int max_triangles);
+
+/* collision_overlap_aabb_triangles for a sphere */
+int collision_overlap_sphere_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, Vector3 center, f32 radius, TriangleCollider** out_triangles, int max_triangles);
+
+/* collision_overlap_aabb_triangles for a frustum, with the same slack as collision_overlap_frustum */
+int collision_overlap_frustum_triangles(const SpacialHash* spacial_hash, OverlapStamps* stamps, LayerMask layer_mask, const Frustum* frustum, TriangleCollider** out_triangles, int max_triangles);
@@ -100,6 +100,11 @@ typedef u64 rawptr;
 */
 #define global static
 
+/**
+* For global variables that every thread gets its own copy of.
+*/
+#define thread_global static _Thread_local
+
 #ifndef DISABLE_ASSSERTIONS
 	#include <stdlib.h>
 	#include <stdio.h>
@@ -142,22 +147,60 @@ typedef u64 rawptr;
 	*/
 	#define ALWAYS(x) (!(x)) ? assertion_failure(__LINE__, __FILE__, ASSERTION_FUNCTION, #x), (x) : (x)
 
+#else
+	/* Nothing gets checked, NEVER and ALWAYS still pass their condition on to the code handling it */
+	#define ASSERT(x)
+	#define NEVER(x) (x)
+	#define ALWAYS(x) (x)
 #endif
 
 bool is_power_of_two(int x) {
 	return (x & (x - 1)) == 0;
 }
 
+typedef enum ArenaFlags {
+	ARENA_FLAG_NONE = 0,
+
+	/**
+	* Reserves 2 MiB aligned address space, commits in 2 MiB steps and asks the OS to back it with huge pages.
+	* Cuts TLB misses on large, densely used arenas. Only Linux (transparent huge pages) honours the hint.
+	*/
+	ARENA_FLAG_HUGE_PAGES = (1 << 0),
+} ArenaFlags;
+
+/**
+* Arenas can be zero initialized. Everything below is optional and only read when the arena is first used:
+*
+*     Arena scene_arena = { .name = "scene", .total_reserved_bytes = 256 MiB, .flags = ARENA_FLAG_HUGE_PAGES };
+*
+* The name is only used for memory accounting. A zero reservation uses DEFAULT_MEMORY_RESERVATION,
+* and a zero commit granularity uses ARENA_DEFAULT_COMMIT_GRANULARITY.
+*/
 typedef struct Arena {
 	void* bytes;
 	i64 total_reserved_bytes;
 	i64 first_unallocated_byte;
 	i64 total_committed_bytes;
+
+	/* Committed memory grows geometrically, but always in multiples of this */
+	i64 commit_granularity;
+	ArenaFlags flags;
+
+	const char* name;
+	/* Slot in the arena registry, plus one. Zero means unregistered. */
+	int registry_slot;
 } Arena;
 
 #define DEFAULT_MEMORY_ALIGNMENT (2*(sizeof(void*)))
 #define PAGE_SIZE 4096
 #define DEFAULT_MEMORY_RESERVATION (PAGE_SIZE*1024)
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+/* Smallest step committed memory grows by. Small enough not to matter for tiny arenas. */
+#define ARENA_DEFAULT_COMMIT_GRANULARITY (PAGE_SIZE*16)
+
+/* Commits double in size up to this step, then grow linearly, so huge arenas don't overshoot by hundreds of MiB */
+#define ARENA_MAX_COMMIT_STEP (64*1024*1024)
 
 /**
 * Aligns the given value to alignment
@@ -192,12 +235,27 @@ void* platform_dependent_mem_commit(void* commit_at, u64 commit_size);
 */
 void platform_dependent_mem_decommit(void* addr, u64 decommit_size);
 
+/**
+* Decommits the memory and gives the address space back. addr must be the start of a reservation.
+*/
+void platform_dependent_mem_release(void* addr, u64 reservation_size);
+
+/**
+* Like platform_dependent_mem_reserve, but the returned address is a multiple of alignment.
+*/
+void* platform_dependent_mem_reserve_aligned(u64 reservation_size, u64 alignment);
+
+/**
+* Hints that the reserved range should be backed by huge pages once committed. Does nothing where unsupported.
+*/
+void platform_dependent_mem_advise_huge_pages(void* addr, u64 size);
+
 #ifdef linux
 	#include <sys/mman.h>
 
 	void* platform_dependent_mem_reserve(u64 reservation_size) {
 		void* reservation = mmap(NULL, reservation_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-		return reservation;
+		return (reservation == MAP_FAILED) ? NULL : reservation;
 	}
 
 	void* platform_dependent_mem_commit(void* commit_at, u64 commit_size) {
@@ -215,6 +273,33 @@ void platform_dependent_mem_decommit(void* addr, u64 decommit_size);
 		/* Pages can be reclaimed */
 		madvise(addr, decommit_size, MADV_DONTNEED);
 	}
+
+	void platform_dependent_mem_release(void* addr, u64 reservation_size) {
+		munmap(addr, reservation_size);
+	}
+
+	void* platform_dependent_mem_reserve_aligned(u64 reservation_size, u64 alignment) {
+		/* Over-reserve, then trim the unaligned head and the leftover tail */
+		u8* reservation = platform_dependent_mem_reserve(reservation_size + alignment);
+		if (reservation == NULL) { return NULL; }
+
+		u8* aligned = (u8*)(((rawptr)reservation + (alignment - 1)) & ~((rawptr)alignment - 1));
+		u64 head = (u64)(aligned - reservation);
+		u64 tail = alignment - head;
+
+		if (head > 0) { munmap(reservation, head); }
+		if (tail > 0) { munmap(aligned + reservation_size, tail); }
+
+		return aligned;
+	}
+
+	void platform_dependent_mem_advise_huge_pages(void* addr, u64 size) {
+		#ifdef MADV_HUGEPAGE
+			madvise(addr, size, MADV_HUGEPAGE);
+		#else
+			(void)addr; (void)size;
+		#endif
+	}
 #endif
 
 #ifdef _WIN32
@@ -228,35 +313,428 @@ void platform_dependent_mem_decommit(void* addr, u64 decommit_size);
 	}
 
 	void platform_dependent_mem_decommit(void* addr, u64 decommit_size) {
-		(void)decommit_size; /* This is only needed on linux */
+		VirtualFree(addr, decommit_size, MEM_DECOMMIT);
+	}
+
+	void platform_dependent_mem_release(void* addr, u64 reservation_size) {
+		(void)reservation_size; /* This is only needed on linux */
 
 		VirtualFree(addr, 0, MEM_RELEASE);
 	}
+
+	void* platform_dependent_mem_reserve_aligned(u64 reservation_size, u64 alignment) {
+		/* Reservations are only 64 KiB aligned, so find an aligned spot in a larger one, then reserve exactly that */
+		u8* probe = platform_dependent_mem_reserve(reservation_size + alignment);
+		if (probe == NULL) { return NULL; }
+
+		u8* aligned = (u8*)(((rawptr)probe + (alignment - 1)) & ~((rawptr)alignment - 1));
+		VirtualFree(probe, 0, MEM_RELEASE);
+
+		/* Another thread can take the range in between. Fall back to an unaligned reservation if so. */
+		void* reservation = VirtualAlloc(aligned, reservation_size, MEM_RESERVE, PAGE_READWRITE);
+		return (reservation != NULL) ? reservation : platform_dependent_mem_reserve(reservation_size);
+	}
+
+	void platform_dependent_mem_advise_huge_pages(void* addr, u64 size) {
+		/* Large pages on Windows need SeLockMemoryPrivilege and must be committed up front. Not worth it here. */
+		(void)addr; (void)size;
+	}
+#endif
+
+/**
+* Returns a monotonic timestamp in nanoseconds. Only the difference between two timestamps is meaningful.
+*
+* Unlike raylib's GetTime(), this works without a window, so headless code (bench.c) can use it.
+*/
+u64 platform_dependent_time_nanoseconds(void);
+
+#ifdef linux
+	#include <time.h>
+
+	u64 platform_dependent_time_nanoseconds(void) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		return ((u64)now.tv_sec * 1000000000ULL) + (u64)now.tv_nsec;
+	}
+#endif
+
+#ifdef _WIN32
+	#include <profileapi.h>
+
+	u64 platform_dependent_time_nanoseconds(void) {
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&counter);
+
+		/* Split to avoid overflowing the multiplication on long uptimes */
+		u64 seconds   = (u64)(counter.QuadPart / frequency.QuadPart);
+		u64 remainder = (u64)(counter.QuadPart % frequency.QuadPart);
+
+		return (seconds * 1000000000ULL) + ((remainder * 1000000000ULL) / (u64)frequency.QuadPart);
+	}
+#endif
+
+#ifndef REGION_PLATFORM_THREADS
+/**
+* Threads and semaphores. Just enough to run worker pools, everything else is built from atomics on top.
+*
+* The PlatformThread is handed to the new thread, so it must stay alive (and not move) until it is joined.
+*/
+typedef void PlatformThreadProc(void* user_data);
+
+#ifdef linux
+	#include <pthread.h>
+	#include <semaphore.h>
+	#include <sched.h>
+	#include <unistd.h>
+
+	typedef struct PlatformThread {
+		pthread_t handle;
+		PlatformThreadProc* proc;
+		void* user_data;
+	} PlatformThread;
+
+	typedef struct PlatformSemaphore {
+		sem_t handle;
+	} PlatformSemaphore;
+
+	void* platform_dependent_thread_start_internal(void* thread) {
+		PlatformThread* self = thread;
+		self->proc(self->user_data);
+		return NULL;
+	}
+
+	bool platform_dependent_thread_create(PlatformThread* thread, PlatformThreadProc* proc, void* user_data) {
+		thread->proc = proc;
+		thread->user_data = user_data;
+		return pthread_create(&thread->handle, NULL, platform_dependent_thread_start_internal, thread) == 0;
+	}
+
+	void platform_dependent_thread_join(PlatformThread* thread) {
+		pthread_join(thread->handle, NULL);
+	}
+
+	void platform_dependent_thread_yield(void) {
+		sched_yield();
+	}
+
+	/* Logical cores, including hyperthreads */
+	int platform_dependent_cpu_count(void) {
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		return (count > 0) ? (int)count : 1;
+	}
+
+	void platform_dependent_semaphore_init(PlatformSemaphore* semaphore, int initial_count) {
+		sem_init(&semaphore->handle, 0, (unsigned)initial_count);
+	}
+
+	void platform_dependent_semaphore_destroy(PlatformSemaphore* semaphore) {
+		sem_destroy(&semaphore->handle);
+	}
+
+	void platform_dependent_semaphore_wait(PlatformSemaphore* semaphore) {
+		/* Signals interrupt the wait, just go back to waiting */
+		while (sem_wait(&semaphore->handle) != 0) {}
+	}
+
+	void platform_dependent_semaphore_post(PlatformSemaphore* semaphore, int count) {
+		for (int i = 0; i < count; i++) { sem_post(&semaphore->handle); }
+	}
+#endif
+
+#ifdef _WIN32
+	#include <processthreadsapi.h>
+	#include <synchapi.h>
+	#include <sysinfoapi.h>
+
+	typedef struct PlatformThread {
+		HANDLE handle;
+		PlatformThreadProc* proc;
+		void* user_data;
+	} PlatformThread;
+
+	typedef struct PlatformSemaphore {
+		HANDLE handle;
+	} PlatformSemaphore;
+
+	DWORD WINAPI platform_dependent_thread_start_internal(LPVOID thread) {
+		PlatformThread* self = thread;
+		self->proc(self->user_data);
+		return 0;
+	}
+
+	bool platform_dependent_thread_create(PlatformThread* thread, PlatformThreadProc* proc, void* user_data) {
+		thread->proc = proc;
+		thread->user_data = user_data;
+		thread->handle = CreateThread(NULL, 0, platform_dependent_thread_start_internal, thread, 0, NULL);
+		return thread->handle != NULL;
+	}
+
+	void platform_dependent_thread_join(PlatformThread* thread) {
+		WaitForSingleObject(thread->handle, INFINITE);
+		CloseHandle(thread->handle);
+	}
+
+	void platform_dependent_thread_yield(void) {
+		SwitchToThread();
+	}
+
+	int platform_dependent_cpu_count(void) {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+	}
+
+	void platform_dependent_semaphore_init(PlatformSemaphore* semaphore, int initial_count) {
+		semaphore->handle = CreateSemaphoreA(NULL, initial_count, 0x7FFFFFFF, NULL);
+	}
+
+	void platform_dependent_semaphore_destroy(PlatformSemaphore* semaphore) {
+		CloseHandle(semaphore->handle);
+	}
+
+	void platform_dependent_semaphore_wait(PlatformSemaphore* semaphore) {
+		WaitForSingleObject(semaphore->handle, INFINITE);
+	}
+
+	void platform_dependent_semaphore_post(PlatformSemaphore* semaphore, int count) {
+		if (count > 0) { ReleaseSemaphore(semaphore->handle, count, NULL); }
+	}
+#endif
+#endif
+
+#ifndef REGION_ARENA_REGISTRY
+
+/**
+* Memory accounting for a single arena. The registry keeps one of these per live arena,
+* so we can see how much each one reserves, commits and peaks at, and catch arenas that are never freed.
+*/
+typedef struct ArenaStats {
+	const char* name;
+	bool is_live;
+
+	i64 reserved_bytes;
+	i64 committed_bytes;
+	i64 allocated_bytes;
+
+	i64 peak_committed_bytes;
+	i64 peak_allocated_bytes;
+
+	u64 commit_calls;
+	u64 decommit_calls;
+
+	/* How many times an arena with this name has been initialized into this slot */
+	u64 lifetimes;
+} ArenaStats;
+
+#define ARENA_REGISTRY_CAPACITY 128
+
+typedef struct ArenaRegistry {
+	ArenaStats slots[ARENA_REGISTRY_CAPACITY];
+	int slot_count;
+
+	/* Totals across every arena ever registered, including freed ones */
+	u64 total_commit_calls;
+	u64 total_decommit_calls;
+	u64 dropped_registrations;
+
+	/* Arenas can be created on any thread. Only slot assignment needs the lock, since each arena has one owner. */
+	u8 lock;
+} ArenaRegistry;
+
+global ArenaRegistry arena_registry;
+
+#define ARENA_UNNAMED "(unnamed)"
+
+void arena_registry_lock_acquire(void) {
+	while (__atomic_test_and_set(&arena_registry.lock, __ATOMIC_ACQUIRE)) {}
+}
+
+void arena_registry_lock_release(void) {
+	__atomic_clear(&arena_registry.lock, __ATOMIC_RELEASE);
+}
+
+bool arena_registry_names_match(const char* name_1, const char* name_2) {
+	int i = 0;
+	while (name_1[i] != '\0' && name_1[i] == name_2[i]) { i++; }
+	return name_1[i] == name_2[i];
+}
+
+/**
+* Finds a slot for the arena. A dead slot with the same name is reused first, so an arena that is recreated
+* every frame (UI arenas) keeps one entry and its peak across lifetimes.
+*
+* Returns zero if the registry is full. The arena still works, it just isn't tracked.
+*/
+int arena_registry_register(Arena* arena) {
+	const char* name = (arena->name != NULL) ? arena->name : ARENA_UNNAMED;
+
+	arena_registry_lock_acquire();
+
+	int free_slot = -1;
+	int same_name_slot = -1;
+
+	for (int i = 0; i < arena_registry.slot_count; i++) {
+		ArenaStats* stats = &arena_registry.slots[i];
+		if (stats->is_live) { continue; }
+
+		if (free_slot < 0) { free_slot = i; }
+		if (arena_registry_names_match(stats->name, name)) {
+			same_name_slot = i;
+			break;
+		}
+	}
+
+	/* Dead slots of other arenas are only recycled once the registry is full, so their history stays visible */
+	int slot = same_name_slot;
+	if (slot < 0 && arena_registry.slot_count < ARENA_REGISTRY_CAPACITY) {
+		slot = arena_registry.slot_count++;
+	}
+	if (slot < 0) {
+		slot = free_slot;
+	}
+
+	if (slot < 0) {
+		arena_registry.dropped_registrations++;
+		arena_registry_lock_release();
+		return 0;
+	}
+
+	ArenaStats* stats = &arena_registry.slots[slot];
+	if (slot != same_name_slot) {
+		*stats = (ArenaStats) {0};
+	}
+
+	stats->name = name;
+	stats->is_live = true;
+	stats->reserved_bytes = arena->total_reserved_bytes;
+	stats->committed_bytes = 0;
+	stats->allocated_bytes = 0;
+	stats->lifetimes++;
+
+	arena_registry_lock_release();
+
+	return slot + 1;
+}
+
+ArenaStats* arena_stats(Arena* arena) {
+	if (arena->registry_slot <= 0) { return NULL; }
+	return &arena_registry.slots[arena->registry_slot - 1];
+}
+
+void arena_stats_note_commit(Arena* arena) {
+	__atomic_fetch_add(&arena_registry.total_commit_calls, 1, __ATOMIC_RELAXED);
+
+	ArenaStats* stats = arena_stats(arena);
+	if (stats == NULL) { return; }
+
+	stats->commit_calls++;
+	stats->committed_bytes = arena->total_committed_bytes;
+	if (stats->committed_bytes > stats->peak_committed_bytes) {
+		stats->peak_committed_bytes = stats->committed_bytes;
+	}
+}
+
+void arena_stats_note_decommit(Arena* arena) {
+	__atomic_fetch_add(&arena_registry.total_decommit_calls, 1, __ATOMIC_RELAXED);
+
+	ArenaStats* stats = arena_stats(arena);
+	if (stats == NULL) { return; }
+
+	stats->decommit_calls++;
+	stats->committed_bytes = arena->total_committed_bytes;
+}
+
+void arena_stats_note_allocation(Arena* arena) {
+	ArenaStats* stats = arena_stats(arena);
+	if (stats == NULL) { return; }
+
+	stats->allocated_bytes = arena->first_unallocated_byte;
+	if (stats->allocated_bytes > stats->peak_allocated_bytes) {
+		stats->peak_allocated_bytes = stats->allocated_bytes;
+	}
+}
+
 #endif
 
 void arena_init(Arena* arena, u64 reservation_size) {
-	arena->bytes = platform_dependent_mem_reserve(reservation_size);
+	if (arena->flags & ARENA_FLAG_HUGE_PAGES) {
+		reservation_size = align_forward(reservation_size, HUGE_PAGE_SIZE);
+		arena->bytes = platform_dependent_mem_reserve_aligned(reservation_size, HUGE_PAGE_SIZE);
+
+		if (arena->bytes != NULL) {
+			platform_dependent_mem_advise_huge_pages(arena->bytes, reservation_size);
+		}
+	} else {
+		arena->bytes = platform_dependent_mem_reserve(reservation_size);
+	}
+
 	arena->total_reserved_bytes = reservation_size;
 	arena->first_unallocated_byte = 0;
+	arena->total_committed_bytes = 0;
+
+	if (arena->bytes != NULL) {
+		arena->registry_slot = arena_registry_register(arena);
+	}
 }
 
 u64 round_to_page_size(u64 input) {
 	return (input + (PAGE_SIZE - (input % PAGE_SIZE)));
 }
 
+/**
+* Commits enough memory past the end of what is already committed to fit required_bytes.
+*
+* Commits grow geometrically (doubling, capped at ARENA_MAX_COMMIT_STEP) in multiples of the commit granularity,
+* so a stream of small allocations costs O(log n) syscalls instead of one per page. Only the new range is committed.
+* Committed memory is never given back by arena_restore, so a per-frame arena settles after its first few frames.
+*
+* Returns false if the OS refused.
+*/
+bool arena_commit_internal(Arena* arena, i64 required_bytes) {
+	i64 granularity = arena->commit_granularity;
+	if (granularity <= 0) {
+		granularity = (arena->flags & ARENA_FLAG_HUGE_PAGES) ? HUGE_PAGE_SIZE : ARENA_DEFAULT_COMMIT_GRANULARITY;
+	}
+
+	i64 committed = arena->total_committed_bytes;
+	i64 step = (committed < ARENA_MAX_COMMIT_STEP) ? committed : ARENA_MAX_COMMIT_STEP;
+
+	i64 target = (committed + step > required_bytes) ? committed + step : required_bytes;
+	target = ((target + granularity - 1) / granularity) * granularity;
+	target = align_forward(target, PAGE_SIZE);
+	if (target > arena->total_reserved_bytes) { target = arena->total_reserved_bytes; }
+
+	void* commit_at = (void*)((rawptr)arena->bytes + committed);
+	if (platform_dependent_mem_commit(commit_at, target - committed) == NULL) {
+		return false;
+	}
+
+	arena->total_committed_bytes = target;
+	arena_stats_note_commit(arena);
+
+	return true;
+}
+
 void* arena_alloc(Arena* arena, u64 byte_count) {
 	if (NEVER(arena == NULL)) return NULL;
 
 	if (arena->bytes == NULL) {
-		arena_init(arena, DEFAULT_MEMORY_RESERVATION);
+		u64 reservation = (arena->total_reserved_bytes > 0) ? (u64)arena->total_reserved_bytes : DEFAULT_MEMORY_RESERVATION;
+		arena_init(arena, reservation);
+
+		if (NEVER(arena->bytes == NULL)) return NULL;
 	}
 
 	i64 push_to = align_forward(byte_count + arena->first_unallocated_byte, DEFAULT_MEMORY_ALIGNMENT);
 
-	u64 total_committed_bytes = round_to_page_size((u64)push_to);
+	/* Out of address space. Reserve more up front. */
+	if (NEVER(push_to > arena->total_reserved_bytes)) return NULL;
 
-	if (push_to >= arena->total_committed_bytes) {
-		if (platform_dependent_mem_commit(arena->bytes, total_committed_bytes) == NULL) {
+	if (push_to > arena->total_committed_bytes) {
+		if (!arena_commit_internal(arena, push_to)) {
 			return NULL;
 		}
 	}
@@ -264,7 +742,8 @@ void* arena_alloc(Arena* arena, u64 byte_count) {
 	/* Pointer arithmetic on void pointers are technically undefined behavior */
 	void* ret = (void*)((rawptr)arena->bytes + arena->first_unallocated_byte);
 	arena->first_unallocated_byte = push_to;
-	arena->total_committed_bytes = total_committed_bytes;
+
+	arena_stats_note_allocation(arena);
 
 	return ret;
 }
@@ -282,17 +761,485 @@ u64 arena_save(Arena* arena) {
 */
 void arena_restore(Arena* arena, u64 position) {
 	arena->first_unallocated_byte = position;
+	arena_stats_note_allocation(arena);
 }
 
 /**
 * Completely frees the arena, decommitting the pages and unreserving the address space.
+*
+* Only the configuration (name, reservation size, flags, commit granularity) survives, so the arena can be reused as if it were new.
 */
 void arena_free(Arena* arena) {
 	if (arena->bytes == NULL) return;
 	
-	platform_dependent_mem_decommit(arena->bytes, arena->total_reserved_bytes);
+	platform_dependent_mem_release(arena->bytes, arena->total_reserved_bytes);
+
+	arena->total_committed_bytes = 0;
+	arena->first_unallocated_byte = 0;
+	arena_stats_note_decommit(arena);
+	arena_stats_note_allocation(arena);
+
+	ArenaStats* stats = arena_stats(arena);
+	if (stats != NULL) { stats->is_live = false; }
+
+	*arena = (Arena) {
+		.name = arena->name,
+		.total_reserved_bytes = arena->total_reserved_bytes,
+		.flags = arena->flags,
+		.commit_granularity = arena->commit_granularity,
+	};
+}
+
+/**
+* Returns true if ptr (of size bytes) is the most recent allocation in the arena, meaning it can grow in place.
+*/
+bool arena_is_top_allocation(Arena* arena, void* ptr, u64 size) {
+	if (ptr == NULL || arena->bytes == NULL) return false;
+
+	rawptr end = (rawptr)ptr + align_forward(size, DEFAULT_MEMORY_ALIGNMENT);
+	return end == (rawptr)arena->bytes + (rawptr)arena->first_unallocated_byte;
+}
+
+/**
+* Grows or shrinks the most recent allocation in place. Returns false (and changes nothing) if ptr isn't
+* the top allocation or the arena can't fit it.
+*/
+bool arena_resize_in_place(Arena* arena, void* ptr, u64 old_size, u64 new_size) {
+	if (!arena_is_top_allocation(arena, ptr, old_size)) return false;
+
+	u64 start = (rawptr)ptr - (rawptr)arena->bytes;
+	u64 previous_top = arena->first_unallocated_byte;
+
+	arena_restore(arena, start);
+	if (arena_alloc(arena, new_size) == NULL) {
+		arena_restore(arena, previous_top);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* Resizes an allocation. Grows in place when ptr is the top allocation, otherwise allocates a new block and copies
+* min(old_size, new_size) bytes over; the old block is simply abandoned, as with anything else in an arena.
+*
+* Returns NULL if the arena is out of space, in which case ptr is still valid.
+*/
+void* arena_realloc(Arena* arena, void* ptr, u64 old_size, u64 new_size) {
+	if (arena_resize_in_place(arena, ptr, old_size, new_size)) return ptr;
+
+	u8* new_ptr = arena_alloc(arena, new_size);
+	if (new_ptr == NULL) return NULL;
+
+	u64 copy_size = (old_size < new_size) ? old_size : new_size;
+	const u8* old_bytes = ptr;
+	for (u64 i = 0; i < copy_size; i++) { new_ptr[i] = old_bytes[i]; }
+
+	return new_ptr;
+}
+
+#ifndef REGION_ARENA_ARRAYS
+
+/**
+* Growable arrays backed by an arena. Any items pointer with an int length and an int capacity works:
+*
+* TriangleColliderArray array = {0};
+* arena_array_reserve(&arena, array.colliders, array.length, array.capacity, expected_count);
+*
+* TriangleCollider* tri = arena_array_push(&arena, array.colliders, array.length, array.capacity);
+*
+* Growth happens in place while the array is the most recent allocation in its arena, so building one list at a time
+* never copies. If something else was allocated on top in between, the items move to a new block and the old one is
+* abandoned. Hence, never hold pointers into an array across a push.
+*
+* When the arena runs out, capacity is left as it was. Reserving then evaluates to false and pushes return NULL
+* without adding anything.
+*/
+#define ARENA_ARRAY_MIN_CAPACITY 8
+
+/* Returns the items, wherever they are now. If they can't grow they're returned as they were, and capacity stays the same. */
+void* arena_array_grow_internal(Arena* arena, void* items, int length, int* capacity, int wanted_capacity, u64 item_size) {
+	if (wanted_capacity <= *capacity) return items;
+
+	/* Doubling keeps pushes amortized O(1) when we have to relocate */
+	int new_capacity = *capacity * 2;
+	if (new_capacity < wanted_capacity) { new_capacity = wanted_capacity; }
+	if (new_capacity < ARENA_ARRAY_MIN_CAPACITY) { new_capacity = ARENA_ARRAY_MIN_CAPACITY; }
+
+	u64 old_size = (u64)*capacity * item_size;
+	u64 new_size = (u64)new_capacity * item_size;
+
+	if (items != NULL && arena_resize_in_place(arena, items, old_size, new_size)) {
+		*capacity = new_capacity;
+		return items;
+	}
+
+	u8* new_items = arena_alloc(arena, new_size);
+	if (NEVER(new_items == NULL)) return items;
+
+	const u8* old_bytes = items;
+	u64 copy_size = (u64)length * item_size;
+	for (u64 i = 0; i < copy_size; i++) { new_items[i] = old_bytes[i]; }
+
+	*capacity = new_capacity;
+	return new_items;
+}
+
+/**
+* Makes sure the array has room for at least wanted_capacity items without further allocations. False if it couldn't grow.
+* wanted_capacity is evaluated again after growing, so it can't depend on capacity.
+*/
+#define arena_array_reserve(arena, items, length, capacity, wanted_capacity) \
+	(((items) = arena_array_grow_internal((arena), (items), (length), &(capacity), (wanted_capacity), sizeof(*(items)))), (capacity) >= (wanted_capacity))
+
+/* Appends one uninitialized item and returns a pointer to it, or NULL if the array couldn't grow */
+#define arena_array_push(arena, items, length, capacity) \
+	(arena_array_reserve((arena), (items), (length), (capacity), (length) + 1) ? &(items)[(length)++] : NULL)
+
+/* Appends count uninitialized items and returns a pointer to the first, or NULL if the array couldn't grow */
+#define arena_array_push_n(arena, items, length, capacity, count) \
+	(arena_array_reserve((arena), (items), (length), (capacity), (length) + (count)) ? ((length) += (count), &(items)[(length) - (count)]) : NULL)
+
+#endif
+
+/**
+* A scoped region of an arena. Everything allocated between temp_arena_begin and temp_arena_end is thrown away at the end.
+*
+* TempArena temp = temp_arena_begin(&some_arena);
+*     void* data = arena_alloc(temp.arena, 1024);
+* temp_arena_end(temp);
+*/
+typedef struct TempArena {
+	Arena* arena;
+	u64 position;
+} TempArena;
+
+TempArena temp_arena_begin(Arena* arena) {
+	return (TempArena) {
+		.arena = arena,
+		.position = arena_save(arena),
+	};
+}
+
+void temp_arena_end(TempArena temp) {
+	arena_restore(temp.arena, temp.position);
+}
+
+#ifndef REGION_SCRATCH_ARENAS
+
+/**
+* Every thread has its own small set of scratch arenas for temporary allocations, so functions never need to
+* borrow (and fragment) the caller's arena for their working memory.
+*
+* A function that takes an output arena and also wants scratch memory passes the output arena as a conflict.
+* If the caller's arena is itself one of this thread's scratch arenas, we hand out a different one, so the
+* scratch and the result never interleave:
+*
+* StringArray do_thing(Arena* out_arena) {
+*     TempArena scratch = scratch_begin(&out_arena, 1);
+*         char* temporary = arena_alloc(scratch.arena, 256);
+*         StringArray result = ...allocated in out_arena...
+*     scratch_end(scratch);
+*     return result;
+* }
+*
+* Two is enough as long as a function takes at most one output arena. Worker threads should call
+* scratch_thread_release before exiting, otherwise their scratch arenas show up as leaks.
+*/
+#define SCRATCH_ARENA_COUNT 2
+
+/* Only address space. Pages are committed as they're touched. */
+#define SCRATCH_ARENA_RESERVATION (256ULL * 1024 * 1024)
+
+thread_global Arena scratch_arenas[SCRATCH_ARENA_COUNT];
+
+/**
+* Returns a scratch arena for this thread that isn't any of the conflicting arenas.
+* conflicts can be NULL if conflict_count is zero.
+*/
+TempArena scratch_begin(Arena** conflicts, int conflict_count) {
+	for (int i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+		Arena* candidate = &scratch_arenas[i];
+
+		bool is_conflicting = false;
+		for (int j = 0; j < conflict_count; j++) {
+			if (conflicts[j] == candidate) {
+				is_conflicting = true;
+				break;
+			}
+		}
+		if (is_conflicting) { continue; }
+
+		if (candidate->bytes == NULL) {
+			candidate->name = (i == 0) ? "scratch_0" : "scratch_1";
+			arena_init(candidate, SCRATCH_ARENA_RESERVATION);
+		}
+
+		return temp_arena_begin(candidate);
+	}
+
+	ASSERT(!"Every scratch arena conflicts. Raise SCRATCH_ARENA_COUNT.");
+	return (TempArena) {0};
+}
+
+void scratch_end(TempArena scratch) {
+	temp_arena_end(scratch);
+}
+
+/**
+* Frees the calling thread's scratch arenas.
+*/
+void scratch_thread_release(void) {
+	for (int i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+		arena_free(&scratch_arenas[i]);
+	}
 }
 
+#endif
+
+#ifndef REGION_POOL_ALLOCATOR
+
+/**
+* Fixed-size pool allocator for things with a per-object lifetime (loaded models, streamed chunks, entities...)
+*
+* Slots are carved out of the pool's own arena one after another, so they are contiguous and each has a stable index.
+* Freed slots go on an intrusive free list (the link lives in the slot itself) and are handed out again first,
+* so alloc and free are both O(1) and never fragment anything.
+*
+* Pool model_pool = { .arena = { .name = "models" } };
+* pool_init_typed(&model_pool, Model, POOL_FLAG_GENERATIONS);
+*
+*     Model* model = pool_alloc_typed(&model_pool, Model);
+*     PoolHandle handle = pool_handle(&model_pool, model);
+*     ...
+*     pool_free(&model_pool, model);
+*     pool_get(&model_pool, handle); <- NULL, the handle is stale
+*/
+typedef enum PoolFlags {
+	POOL_FLAG_NONE = 0,
+
+	/* Each slot gets a generation counter, bumped on free, so PoolHandles to freed slots are detected */
+	POOL_FLAG_GENERATIONS = (1 << 0),
+
+	/* Freed slots are filled with POOL_POISON_BYTE and checked when reused, to catch writes after free. Always on with DEBUG. */
+	POOL_FLAG_POISON = (1 << 1),
+} PoolFlags;
+
+#define POOL_POISON_BYTE 0xDD
+
+/**
+* Refers to a slot in a specific lifetime. The zero handle is never valid.
+*/
+typedef struct PoolHandle {
+	u32 index;
+	u32 generation;
+} PoolHandle;
+
+/* Lives at the start of a slot, only with POOL_FLAG_GENERATIONS. Padded to keep the item aligned. */
+typedef struct PoolSlotHeader {
+	u32 generation;
+	u32 is_live;
+	u64 padding;
+} PoolSlotHeader;
+
+/* Lives in the item part of a free slot */
+typedef struct PoolFreeSlot {
+	struct PoolFreeSlot* next;
+} PoolFreeSlot;
+
+typedef struct Pool {
+	/* Configure the name/reservation/flags before pool_init if needed. Owned by the pool. */
+	Arena arena;
+
+	u64 item_size;
+	u64 slot_stride;
+	u64 header_size;
+	PoolFlags flags;
+
+	PoolFreeSlot* free_list;
+	u32 slot_count;
+	u32 live_count;
+	/* Most slots ever carved, across pool_reset calls */
+	u32 slot_high_water;
+} Pool;
+
+#define pool_init_typed(pool, Type, flags) pool_init((pool), sizeof(Type), (flags))
+#define pool_alloc_typed(pool, Type) ((Type*)pool_alloc(pool))
+#define pool_get_typed(pool, Type, handle) ((Type*)pool_get((pool), (handle)))
+
+void pool_init(Pool* pool, u64 item_size, PoolFlags flags) {
+	#ifdef DEBUG
+		flags |= POOL_FLAG_POISON;
+	#endif
+
+	/* Free slots need to fit the link */
+	if (item_size < sizeof(PoolFreeSlot)) { item_size = sizeof(PoolFreeSlot); }
+
+	pool->item_size = item_size;
+	pool->header_size = (flags & POOL_FLAG_GENERATIONS) ? sizeof(PoolSlotHeader) : 0;
+	/* Keeps consecutive arena allocations back to back, which the slot indices rely on */
+	pool->slot_stride = align_forward(pool->header_size + item_size, DEFAULT_MEMORY_ALIGNMENT);
+	pool->flags = flags;
+	pool->free_list = NULL;
+	pool->slot_count = 0;
+	pool->live_count = 0;
+	pool->slot_high_water = 0;
+}
+
+PoolSlotHeader* pool_header_internal(Pool* pool, void* item) {
+	return (PoolSlotHeader*)((rawptr)item - pool->header_size);
+}
+
+u32 pool_index_internal(Pool* pool, void* item) {
+	return (u32)(((rawptr)item - pool->header_size - (rawptr)pool->arena.bytes) / pool->slot_stride);
+}
+
+void* pool_item_at_internal(Pool* pool, u32 index) {
+	return (void*)((rawptr)pool->arena.bytes + ((u64)index * pool->slot_stride) + pool->header_size);
+}
+
+/**
+* Returns a zeroed item, or NULL if the pool's arena is out of space.
+*/
+void* pool_alloc(Pool* pool) {
+	if (NEVER(pool->slot_stride == 0)) return NULL; /* pool_init wasn't called */
+
+	u8* item;
+
+	if (pool->free_list != NULL) {
+		PoolFreeSlot* slot = pool->free_list;
+		pool->free_list = slot->next;
+		item = (u8*)slot;
+
+		if (pool->flags & POOL_FLAG_POISON) {
+			/* Everything past the link should still be poison */
+			for (u64 i = sizeof(PoolFreeSlot); i < pool->item_size; i++) {
+				if (NEVER((u8)item[i] != (u8)POOL_POISON_BYTE)) { break; }
+			}
+		}
+	} else {
+		u8* slot = arena_alloc(&pool->arena, pool->slot_stride);
+		if (slot == NULL) { return NULL; }
+
+		item = slot + pool->header_size;
+
+		/* Slots carved before a pool_reset already have a generation, which has to keep counting up */
+		bool is_new_slot = (pool->slot_count >= pool->slot_high_water);
+		pool->slot_count++;
+
+		if (is_new_slot) {
+			pool->slot_high_water = pool->slot_count;
+
+			if (pool->flags & POOL_FLAG_GENERATIONS) {
+				/* Generations start at one so the zero handle is never valid */
+				*(PoolSlotHeader*)slot = (PoolSlotHeader) { .generation = 1, .is_live = false };
+			}
+		}
+	}
+
+	if (pool->flags & POOL_FLAG_GENERATIONS) {
+		PoolSlotHeader* header = pool_header_internal(pool, item);
+		ASSERT(!header->is_live);
+		header->is_live = true;
+	}
+
+	for (u64 i = 0; i < pool->item_size; i++) { item[i] = 0; }
+
+	pool->live_count++;
+	return item;
+}
+
+void pool_free(Pool* pool, void* item) {
+	if (item == NULL) return;
+
+	if (pool->flags & POOL_FLAG_GENERATIONS) {
+		PoolSlotHeader* header = pool_header_internal(pool, item);
+
+		/* Double free */
+		if (NEVER(!header->is_live)) return;
+
+		header->is_live = false;
+		header->generation++;
+		if (header->generation == 0) { header->generation = 1; }
+	}
+
+	if (pool->flags & POOL_FLAG_POISON) {
+		u8* bytes = item;
+		for (u64 i = 0; i < pool->item_size; i++) { bytes[i] = (u8)POOL_POISON_BYTE; }
+	}
+
+	PoolFreeSlot* slot = item;
+	slot->next = pool->free_list;
+	pool->free_list = slot;
+
+	pool->live_count--;
+}
+
+/**
+* Returns a handle for a live item. Needs POOL_FLAG_GENERATIONS.
+*/
+PoolHandle pool_handle(Pool* pool, void* item) {
+	if (NEVER(!(pool->flags & POOL_FLAG_GENERATIONS) || item == NULL)) return (PoolHandle) {0};
+
+	return (PoolHandle) {
+		.index = pool_index_internal(pool, item),
+		.generation = pool_header_internal(pool, item)->generation,
+	};
+}
+
+/**
+* Returns the item a handle refers to, or NULL if it has been freed since the handle was made.
+*/
+void* pool_get(Pool* pool, PoolHandle handle) {
+	if (!(pool->flags & POOL_FLAG_GENERATIONS)) return NULL;
+	if (handle.generation == 0 || handle.index >= pool->slot_count) return NULL;
+
+	void* item = pool_item_at_internal(pool, handle.index);
+	PoolSlotHeader* header = pool_header_internal(pool, item);
+
+	if (!header->is_live || header->generation != handle.generation) return NULL;
+	return item;
+}
+
+void pool_free_handle(Pool* pool, PoolHandle handle) {
+	pool_free(pool, pool_get(pool, handle));
+}
+
+/**
+* Frees every item at once. Outstanding handles all become stale.
+*/
+void pool_reset(Pool* pool) {
+	if (pool->flags & POOL_FLAG_GENERATIONS) {
+		for (u32 i = 0; i < pool->slot_count; i++) {
+			PoolSlotHeader* header = pool_header_internal(pool, pool_item_at_internal(pool, i));
+			if (header->is_live) {
+				header->is_live = false;
+				header->generation++;
+				if (header->generation == 0) { header->generation = 1; }
+			}
+		}
+	}
+
+	/* Rebuilding the free list would touch every slot. Just start carving from the bottom again. */
+	arena_restore(&pool->arena, 0);
+	pool->free_list = NULL;
+	pool->live_count = 0;
+	pool->slot_count = 0;
+}
+
+/**
+* Gives the pool's memory back. Handles are not protected past this point, so drop them first.
+*/
+void pool_destroy(Pool* pool) {
+	arena_free(&pool->arena);
+	pool->free_list = NULL;
+	pool->slot_count = 0;
+	pool->live_count = 0;
+	pool->slot_high_water = 0;
+}
+
+#endif
+
 typedef struct string {
 	char* str;
 	int length;
@@ -453,8 +1400,8 @@ StringArray platform_dependent_get_all_files_in_directory(Arena* strings_arena,
 	StringArray array = { .strings = NULL, .len = 0 };
 
 	/* We can't assume that the string is null terminated. It could be a string slice. */
-	int prev = arena_save(strings_arena);
-		char* directory_name = arena_alloc(strings_arena, directory.length + 1);
+	TempArena scratch = scratch_begin(&strings_arena, 1);
+		char* directory_name = arena_alloc(scratch.arena, directory.length + 1);
 
 		for (int i = 0; i < directory.length; i++) {
 			directory_name[i] = directory.str[i];
@@ -463,7 +1410,7 @@ StringArray platform_dependent_get_all_files_in_directory(Arena* strings_arena,
 
 		DIR* directory_stream = opendir(directory_name);
 		DIR* directory_stream_2 = opendir(directory_name);
-	arena_restore(strings_arena, prev);
+	scratch_end(scratch);
 
 	if (directory_stream != NULL && directory_stream_2 != NULL) {
 		/* There might be a better way but I wanted to do it all in one allocation so I just loop over it twice. */
@@ -493,7 +1440,8 @@ StringArray platform_dependent_get_all_files_in_directory(Arena* strings_arena,
 				if (!string_eq(str, (String) {.length = 1, .str = "."}) &&
 					!string_eq(str, (String) {.length = 2, .str = ".."})
 				) {
-					array.strings[i] = str;
+					/* d_name is owned by the directory stream, which is closed below */
+					array.strings[i] = string_copy(strings_arena, str);
 					i++;
 				}
 			}
@@ -567,8 +1515,8 @@ StringArray platform_dependent_get_all_files_in_directory(Arena* strings_arena,
 	int count = 0;
 
 	/* We can't assume that the string is null terminated. It could be a string slice. */
-	int prev = arena_save(strings_arena);
-		LPCSTR name = platform_dependent_generate_valid_relative_directory(strings_arena, directory);
+	TempArena scratch = scratch_begin(&strings_arena, 1);
+		LPCSTR name = platform_dependent_generate_valid_relative_directory(scratch.arena, directory);
 
 		WIN32_FIND_DATAA find_data = {0};
 		HANDLE handle = FindFirstFileExA(name, FindExInfoBasic, &find_data, FindExSearchNameMatch, NULL, 0);
@@ -584,8 +1532,9 @@ StringArray platform_dependent_get_all_files_in_directory(Arena* strings_arena,
 		}
 
 		handle = FindFirstFileExA(name, FindExInfoBasic, &find_data, FindExSearchNameMatch, NULL, 0);
-	arena_restore(strings_arena, prev);
+	scratch_end(scratch);
 
+	u64 prev = arena_save(strings_arena);
 	array.strings = arena_alloc(strings_arena, sizeof(*array.strings) * count);
 	array.len = count;
 
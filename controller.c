@@ -0,0 +1,410 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Kinematic character controller. A capsule standing upright on position that gets moved by whatever the caller asks
+* for, and stops or slides wherever the static colliders in a SpacialHash are in the way. Nothing pushes it around,
+* it goes exactly where it's told unless something blocks it (collide and slide).
+*
+* A move happens in passes, each one made of a few swept capsule queries:
+*   - Up, for the upward part of the motion.
+*   - Across, for the sideways part. Walls and ground too steep to walk on stop it here. If something low got in the
+*     way it also tries going over it: up by step_height, across, back down onto walkable ground, and keeps whichever
+*     went further.
+*   - Down, for the downward part. It stops on walkable ground instead of sliding down it.
+*   - Ground snap. Something that was on the ground and isn't jumping sticks to ground up to snap_distance below it,
+*     so it doesn't float off the top of slopes and stairs.
+*
+* Every time a sweep hits, the capsule moves up to the contact and the rest of the motion gets clipped against the
+* planes of every contact so far, sliding along a crease when it's wedged between two. The contacts it's still
+* touching at the end of a move are kept, and start the next move off already clipped against, so pressing into a
+* wall doesn't cost a sweep every frame to find the wall again.
+*
+* CharacterController player = character_controller_create(spawn, 0.4f, 1.8f, MASK_STATIC_GEOMETRY);
+*     character_controller_move(&player, spacial_hash, Vector3Scale(walk_direction, speed * dt));
+*     if (player.grounded) { ... }
+*/
+
+/* Sweeps per pass */
+#define CHARACTER_MAX_ITERATIONS 4
+/* Contacts kept from one move to the next */
+#define CHARACTER_MAX_CONTACTS 4
+/* Planes the motion gets clipped against in one pass, the kept contacts and the ground included */
+#define CHARACTER_MAX_PLANES (CHARACTER_MAX_CONTACTS + CHARACTER_MAX_ITERATIONS + 1)
+/* How far it stays away from what it touches, so the next sweep doesn't start inside it */
+#define CHARACTER_SKIN_WIDTH 0.01f
+/* How much motion clipping may still push into a plane, for rounding */
+#define CHARACTER_CLIP_EPSILON 1e-4f
+/* Motion shorter than this isn't worth a sweep */
+#define CHARACTER_MIN_MOVE 1e-5f
+
+#define CHARACTER_DEFAULT_STEP_HEIGHT 0.35f
+#define CHARACTER_DEFAULT_MAX_SLOPE_DEGREES 50.0f
+#define CHARACTER_DEFAULT_SNAP_DISTANCE 0.25f
+
+/**
+* Something the capsule touched, the normal is the plane its motion got clipped against. The triangle is a copy, the
+* spacial hash it came from is usually gone by the next move.
+*/
+typedef struct CharacterContact {
+	Vector3 normal;
+	Vector3 point;
+	Vector3 triangle[3];
+	EntityHandle entity_id;
+} CharacterContact;
+
+typedef struct CharacterController {
+	/* The bottom of the capsule, where its feet are */
+	Vector3 position;
+	f32 radius;
+	/* From the bottom of the capsule to its top, at least 2 * radius */
+	f32 height;
+	/* The tallest thing it walks up onto without jumping */
+	f32 step_height;
+	/* The cosine of the steepest slope it can stand on, ground steeper than that is a wall */
+	f32 min_ground_normal_y;
+	f32 snap_distance;
+	LayerMask collide_mask;
+
+	/* Set by character_controller_move */
+	bool grounded;
+	Vector3 ground_normal;
+	EntityHandle ground_entity;
+	/* The walls it's touching, reused by the next move */
+	CharacterContact contacts[CHARACTER_MAX_CONTACTS];
+	int contact_count;
+	/* Instrumentation, for the last move */
+	int sweep_count;
+	bool stepped;
+} CharacterController;
+
+/* Everything a pass needs to carry along */
+typedef struct CharacterPass {
+	const CharacterController* controller;
+	const SpacialHash* spacial_hash;
+	Vector3 planes[CHARACTER_MAX_PLANES];
+	int plane_count;
+	CharacterContact contacts[CHARACTER_MAX_ITERATIONS];
+	int contact_count;
+	/* Hit a wall, or ground too steep to stand on */
+	bool blocked;
+	int sweep_count;
+} CharacterPass;
+
+CharacterController character_controller_create(Vector3 position, f32 radius, f32 height, LayerMask collide_mask) {
+	NEVER(radius <= 0.0f);
+	NEVER(height < 2.0f * radius);
+	return (CharacterController) {
+		.position = position,
+		.radius = radius,
+		.height = height,
+		.step_height = CHARACTER_DEFAULT_STEP_HEIGHT,
+		.min_ground_normal_y = cosf(CHARACTER_DEFAULT_MAX_SLOPE_DEGREES * DEG2RAD),
+		.snap_distance = CHARACTER_DEFAULT_SNAP_DISTANCE,
+		.collide_mask = collide_mask,
+		.ground_normal = VECTOR3_UP,
+		.ground_entity = ENTITY_HANDLE_NONE,
+	};
+}
+
+bool character_walkable_internal(const CharacterController* controller, Vector3 normal) {
+	return normal.y >= controller->min_ground_normal_y;
+}
+
+SweepHit character_sweep_internal(CharacterPass* pass, Vector3 position, Vector3 motion) {
+	const CharacterController* controller = pass->controller;
+	pass->sweep_count++;
+	return collision_sweep_capsule(
+		pass->spacial_hash,
+		controller->collide_mask,
+		Vector3Add(position, (Vector3) { 0.0f, controller->radius, 0.0f }),
+		Vector3Add(position, (Vector3) { 0.0f, controller->height - controller->radius, 0.0f }),
+		controller->radius,
+		motion
+	);
+}
+
+/* How far along motion it can go before hitting, backed off by the skin width */
+f32 character_safe_time_internal(SweepHit hit, f32 motion_length) {
+	return MAX2((hit.time * motion_length) - CHARACTER_SKIN_WIDTH, 0.0f) / motion_length;
+}
+
+/**
+* Backs away from what it hit until it's skin width away. Something that starts a move touching a surface, like a
+* character spawned right on the ground, would otherwise graze every edge of it it walks over.
+*/
+Vector3 character_push_out_internal(const CharacterController* controller, Vector3 position, SweepHit hit) {
+	const TriangleCollider* tri = hit.collider;
+	Vector3 segment_point; Vector3 triangle_point;
+	math_closest_points_segment_triangle(
+		Vector3Add(position, (Vector3) { 0.0f, controller->radius, 0.0f }),
+		Vector3Add(position, (Vector3) { 0.0f, controller->height - controller->radius, 0.0f }),
+		tri->vert_1, tri->vert_2, tri->vert_3,
+		&segment_point, &triangle_point
+	);
+
+	f32 separation = Vector3Distance(segment_point, triangle_point) - controller->radius;
+	if (separation >= CHARACTER_SKIN_WIDTH) { return position; }
+	return Vector3Add(position, Vector3Scale(hit.normal, CHARACTER_SKIN_WIDTH - separation));
+}
+
+bool character_motion_fits_internal(Vector3 motion, const Vector3* planes, int plane_count, int skip_a, int skip_b) {
+	for (int i = 0; i < plane_count; i++) {
+		if (i == skip_a || i == skip_b) { continue; }
+		if (Vector3DotProduct(motion, planes[i]) < -CHARACTER_CLIP_EPSILON) { return false; }
+	}
+	return true;
+}
+
+/**
+* The part of motion that doesn't go into any of the planes. First along one plane, then along the crease of two,
+* and if it's boxed in by more than that there's nowhere to go.
+*/
+Vector3 character_clip_motion_internal(Vector3 motion, const Vector3* planes, int plane_count) {
+	if (character_motion_fits_internal(motion, planes, plane_count, -1, -1)) { return motion; }
+
+	for (int i = 0; i < plane_count; i++) {
+		f32 into = Vector3DotProduct(motion, planes[i]);
+		if (into >= 0.0f) { continue; }
+
+		Vector3 along = Vector3Subtract(motion, Vector3Scale(planes[i], into));
+		if (character_motion_fits_internal(along, planes, plane_count, i, -1)) { return along; }
+	}
+
+	for (int i = 0; i < plane_count; i++) {
+		for (int j = i + 1; j < plane_count; j++) {
+			Vector3 crease = Vector3CrossProduct(planes[i], planes[j]);
+			f32 length = Vector3Length(crease);
+			if (length < EPSILON) { continue; }
+
+			crease = Vector3Scale(crease, 1.0f / length);
+			Vector3 along = Vector3Scale(crease, Vector3DotProduct(crease, motion));
+			if (character_motion_fits_internal(along, planes, plane_count, i, j)) { return along; }
+		}
+	}
+	return VECTOR3_ZERO;
+}
+
+void character_add_plane_internal(CharacterPass* pass, Vector3 normal) {
+	for (int i = 0; i < pass->plane_count; i++) {
+		if (Vector3DotProduct(pass->planes[i], normal) > 1.0f - CHARACTER_CLIP_EPSILON) { return; }
+	}
+	if (pass->plane_count < CHARACTER_MAX_PLANES) {
+		pass->planes[pass->plane_count++] = normal;
+	}
+}
+
+/**
+* Moves along motion as far as it gets in CHARACTER_MAX_ITERATIONS sweeps, sliding along whatever it hits.
+* With flatten_steep, ground too steep to stand on counts as a wall so walking into it doesn't climb it.
+* With stop_on_ground, it stays where it lands on walkable ground instead of sliding down it.
+*/
+Vector3 character_slide_internal(CharacterPass* pass, Vector3 position, Vector3 motion, bool flatten_steep, bool stop_on_ground) {
+	const CharacterController* controller = pass->controller;
+	Vector3 wanted = motion;
+	motion = character_clip_motion_internal(motion, pass->planes, pass->plane_count);
+
+	for (int iteration = 0; iteration < CHARACTER_MAX_ITERATIONS; iteration++) {
+		f32 length = Vector3Length(motion);
+		if (length < CHARACTER_MIN_MOVE) { break; }
+
+		SweepHit hit = character_sweep_internal(pass, position, motion);
+		if (hit.collider == NULL) {
+			position = Vector3Add(position, motion);
+			break;
+		}
+
+		f32 safe_time = character_safe_time_internal(hit, length);
+		position = character_push_out_internal(controller, Vector3Add(position, Vector3Scale(motion, safe_time)), hit);
+		Vector3 remaining = Vector3Scale(motion, 1.0f - safe_time);
+
+		bool walkable = character_walkable_internal(controller, hit.normal);
+		Vector3 normal = hit.normal;
+		if (!walkable) {
+			pass->blocked = true;
+			if (flatten_steep && normal.y > 0.0f) {
+				Vector3 flat = { normal.x, 0.0f, normal.z };
+				if (Vector3LengthSqr(flat) > EPSILON * EPSILON) { normal = Vector3Normalize(flat); }
+			}
+		}
+		pass->contacts[pass->contact_count++] = (CharacterContact) {
+			.normal = normal,
+			.point = hit.point,
+			.triangle = { hit.collider->vert_1, hit.collider->vert_2, hit.collider->vert_3 },
+			.entity_id = hit.entity_id,
+		};
+		if (walkable && stop_on_ground) { break; }
+
+		character_add_plane_internal(pass, normal);
+		motion = character_clip_motion_internal(remaining, pass->planes, pass->plane_count);
+		/* Turned back on itself in a corner, stop instead of jittering */
+		if (Vector3DotProduct(motion, wanted) <= 0.0f) { break; }
+	}
+	return position;
+}
+
+void character_pass_begin_internal(CharacterPass* pass) {
+	pass->plane_count = 0;
+	pass->contact_count = 0;
+	pass->blocked = false;
+}
+
+/* Seeds the pass with the contacts from the last move that it's still touching */
+void character_reuse_contacts_internal(CharacterPass* pass, Vector3 position) {
+	const CharacterController* controller = pass->controller;
+	Vector3 start = Vector3Add(position, (Vector3) { 0.0f, controller->radius, 0.0f });
+	Vector3 end = Vector3Add(position, (Vector3) { 0.0f, controller->height - controller->radius, 0.0f });
+	f32 touching = controller->radius + (2.0f * CHARACTER_SKIN_WIDTH);
+
+	for (int i = 0; i < controller->contact_count; i++) {
+		const CharacterContact* contact = &controller->contacts[i];
+		Vector3 segment_point; Vector3 triangle_point;
+		math_closest_points_segment_triangle(start, end, contact->triangle[0], contact->triangle[1], contact->triangle[2], &segment_point, &triangle_point);
+		if (Vector3DistanceSqr(segment_point, triangle_point) <= touching * touching) {
+			character_add_plane_internal(pass, contact->normal);
+		}
+	}
+}
+
+f32 character_horizontal_distance_sqr_internal(Vector3 from, Vector3 to) {
+	f32 x = to.x - from.x;
+	f32 z = to.z - from.z;
+	return (x * x) + (z * z);
+}
+
+/**
+* Moves the controller by motion, colliding with the triangles in spacial_hash on its collide_mask.
+* Updates position, grounded, ground_normal and the contacts the next move starts from.
+*/
+void character_controller_move(CharacterController* controller, const SpacialHash* spacial_hash, Vector3 motion) {
+	CharacterPass pass = {
+		.controller = controller,
+		.spacial_hash = spacial_hash,
+	};
+	bool was_grounded = controller->grounded;
+	Vector3 position = controller->position;
+	Vector3 across = { motion.x, 0.0f, motion.z };
+	controller->stepped = false;
+
+	if (motion.y > 0.0f) {
+		character_pass_begin_internal(&pass);
+		position = character_slide_internal(&pass, position, (Vector3) { 0.0f, motion.y, 0.0f }, false, false);
+	}
+
+	CharacterContact walls[CHARACTER_MAX_CONTACTS];
+	int wall_count = 0;
+	if (Vector3LengthSqr(across) > CHARACTER_MIN_MOVE * CHARACTER_MIN_MOVE) {
+		Vector3 start = position;
+		character_pass_begin_internal(&pass);
+		character_reuse_contacts_internal(&pass, start);
+		if (was_grounded && motion.y <= 0.0f) {
+			/* Walk along the ground it's on, up or down the slope */
+			character_add_plane_internal(&pass, controller->ground_normal);
+		}
+		position = character_slide_internal(&pass, start, across, true, false);
+
+		for (int i = 0; i < pass.contact_count && wall_count < CHARACTER_MAX_CONTACTS; i++) {
+			if (!character_walkable_internal(controller, pass.contacts[i].normal)) { walls[wall_count++] = pass.contacts[i]; }
+		}
+
+		if (pass.blocked && was_grounded && controller->step_height > 0.0f) {
+			/* Up, across and back down onto walkable ground, only kept if it got further */
+			CharacterPass step = pass;
+			character_pass_begin_internal(&step);
+			Vector3 raised = character_slide_internal(&step, start, (Vector3) { 0.0f, controller->step_height, 0.0f }, false, false);
+			f32 lift = raised.y - start.y;
+
+			character_pass_begin_internal(&step);
+			character_reuse_contacts_internal(&step, raised);
+			Vector3 stepped = character_slide_internal(&step, raised, across, true, false);
+
+			Vector3 down = { 0.0f, -(lift + CHARACTER_SKIN_WIDTH), 0.0f };
+			SweepHit landing = character_sweep_internal(&step, stepped, down);
+			bool lands = landing.collider == NULL || character_walkable_internal(controller, landing.normal);
+			if (landing.collider != NULL) {
+				stepped.y -= character_safe_time_internal(landing, Vector3Length(down)) * -down.y;
+			} else {
+				stepped.y += down.y;
+			}
+
+			if (lands && lift > CHARACTER_SKIN_WIDTH &&
+				character_horizontal_distance_sqr_internal(start, stepped) > character_horizontal_distance_sqr_internal(start, position) + CHARACTER_MIN_MOVE) {
+				position = stepped;
+				controller->stepped = true;
+				wall_count = 0;
+				for (int i = 0; i < step.contact_count && wall_count < CHARACTER_MAX_CONTACTS; i++) {
+					if (!character_walkable_internal(controller, step.contacts[i].normal)) { walls[wall_count++] = step.contacts[i]; }
+				}
+			}
+			pass.sweep_count = step.sweep_count;
+		}
+	}
+
+	controller->grounded = false;
+	controller->ground_normal = VECTOR3_UP;
+	controller->ground_entity = ENTITY_HANDLE_NONE;
+	if (motion.y < 0.0f) {
+		character_pass_begin_internal(&pass);
+		position = character_slide_internal(&pass, position, (Vector3) { 0.0f, motion.y, 0.0f }, false, true);
+
+		/* Landed, so that's the ground and there's no need to look for it */
+		const CharacterContact* landing = (pass.contact_count > 0) ? &pass.contacts[pass.contact_count - 1] : NULL;
+		if (landing != NULL && character_walkable_internal(controller, landing->normal)) {
+			controller->grounded = true;
+			controller->ground_normal = landing->normal;
+			controller->ground_entity = landing->entity_id;
+		}
+	}
+
+	/* Ground check, and snapping down onto it */
+	if (motion.y <= 0.0f && !controller->grounded) {
+		f32 probe = (was_grounded || controller->stepped) ? MAX2(controller->snap_distance, 2.0f * CHARACTER_SKIN_WIDTH) : 2.0f * CHARACTER_SKIN_WIDTH;
+		Vector3 down = { 0.0f, -probe, 0.0f };
+		SweepHit ground = character_sweep_internal(&pass, position, down);
+		if (ground.collider != NULL && character_walkable_internal(controller, ground.normal)) {
+			position.y -= character_safe_time_internal(ground, probe) * probe;
+			position = character_push_out_internal(controller, position, ground);
+			controller->grounded = true;
+			controller->ground_normal = ground.normal;
+			controller->ground_entity = ground.entity_id;
+		}
+	}
+
+	controller->position = position;
+	controller->contact_count = wall_count;
+	for (int i = 0; i < wall_count; i++) {
+		controller->contacts[i] = walls[i];
+	}
+	controller->sweep_count = pass.sweep_count;
+}
+
+#ifndef REGION_CHARACTER_BATCH
+typedef struct CharacterMoveBatch {
+	CharacterController* controllers;
+	const Vector3* motions;
+	const SpacialHash* spacial_hash;
+} CharacterMoveBatch;
+
+void character_controllers_move_range_internal(void* user_data, int start, int end) {
+	CharacterMoveBatch* batch = user_data;
+	for (int i = start; i < end; i++) {
+		character_controller_move(&batch->controllers[i], batch->spacial_hash, batch->motions[i]);
+	}
+}
+
+/**
+* character_controller_move for count controllers, each by its own motion, spread over the job system's workers.
+* They only collide with the spacial hash, not with each other, so the result is the same as moving them one by one.
+*/
+void character_controllers_move(CharacterController* controllers, const Vector3* motions, int count, const SpacialHash* spacial_hash) {
+	CharacterMoveBatch batch = {
+		.controllers = controllers,
+		.motions = motions,
+		.spacial_hash = spacial_hash,
+	};
+	parallel_for(count, 32, character_controllers_move_range_internal, &batch);
+}
+#endif
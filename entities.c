@@ -17,6 +17,14 @@ typedef enum ModelID {
 	MODEL_ID_COUNT
 } ModelID;
 
+/* What the simulation does with an entity every step. Plain scenery is ENTITY_TYPE_NONE. */
+typedef enum EntityType {
+	ENTITY_TYPE_NONE = 0,
+	ENTITY_TYPE_SPINNER, /* Turns around its local up axis */
+
+	ENTITY_TYPE_COUNT
+} EntityType;
+
 /**
 * This is for any and all data that is needed only for the editor.
 *
@@ -42,14 +50,749 @@ typedef struct EditorEntityData {
  */
 typedef struct Entity {
 	int entity_type;
+	/* Relative to the parent, or to the world for roots */
 	Transform transform;
+	EntityHandle parent;
 	
 	ModelID collider_model_id;
 	ModelID visible_model_id;
+	LayerMask layer;
 
 	EditorEntityData editor_data;
 } Entity;
 
+/**
+* One bit per component array, plus the per-frame data that gets built from them.
+* Systems use these to declare what they read and write, see scheduler.c.
+*/
+typedef enum ComponentMask {
+	COMPONENT_NONE               = 0,
+	COMPONENT_ENTITY_TYPE        = (1 << 0),
+	COMPONENT_TRANSFORM          = (1 << 1),
+	COMPONENT_COLLIDER_MODEL     = (1 << 2),
+	COMPONENT_VISIBLE_MODEL      = (1 << 3),
+	COMPONENT_LAYER              = (1 << 4),
+	COMPONENT_EDITOR_DATA        = (1 << 5),
+	COMPONENT_HIERARCHY          = (1 << 6),
+	COMPONENT_WORLD_MATRIX       = (1 << 7),
+	COMPONENT_RENDER_MATRIX      = (1 << 8),
+
+	/* Not stored per entity, rebuilt every frame */
+	COMPONENT_TRIANGLE_COLLIDERS = (1 << 16),
+	COMPONENT_SPACIAL_HASH       = (1 << 17),
+	COMPONENT_CAMERA             = (1 << 18),
+
+	COMPONENT_ALL                = -1,
+} ComponentMask;
+
+#ifndef REGION_ENTITY_STORE
+#include <stddef.h>
+
+/**
+* The entity store keeps every component in its own densely packed array (structure of arrays), so a loop
+* that only needs transforms and collider models never pulls the rest of the entity through the cache.
+* Element i of every dense array belongs to the same entity. Destroying an entity moves the last entity into its place,
+* so the dense arrays never have holes and dense indices are NOT stable. Hold handles, not indices.
+*
+* Each array lives alone in its own arena, so growing one is just committing more of its reservation.
+* Arrays never move, which means pointers into them stay valid for the lifetime of the store (though the entity they
+* point at can change when something is destroyed).
+*
+* Entities can have a parent. The dense arrays are kept sorted by depth in the hierarchy, so every parent comes before
+* its children and each depth is one contiguous range. World matrices are cached and entity_store_update_hierarchy only
+* recomputes the ones under a changed transform, one depth at a time, each depth in parallel.
+*/
+typedef enum EntityStoreArray {
+	ENTITY_ARRAY_HANDLES,
+	ENTITY_ARRAY_TYPES,
+	ENTITY_ARRAY_TRANSFORMS,
+	ENTITY_ARRAY_COLLIDER_MODELS,
+	ENTITY_ARRAY_VISIBLE_MODELS,
+	ENTITY_ARRAY_LAYERS,
+	ENTITY_ARRAY_EDITOR_DATA,
+	ENTITY_ARRAY_PARENTS,
+	ENTITY_ARRAY_PARENT_INDICES,
+	ENTITY_ARRAY_CHILD_COUNTS,
+	ENTITY_ARRAY_DEPTHS,
+	ENTITY_ARRAY_DIRTY,
+	ENTITY_ARRAY_WORLD_MATRICES,
+	ENTITY_ARRAY_PREVIOUS_TRANSFORMS,
+	ENTITY_ARRAY_MOVED,
+	ENTITY_ARRAY_RENDER_MATRICES,
+
+	/* Everything below is indexed by handle index instead of dense index */
+	ENTITY_ARRAY_SPARSE,
+	ENTITY_ARRAY_GENERATIONS,
+
+	ENTITY_ARRAY_COUNT
+} EntityStoreArray;
+
+#define ENTITY_ARRAY_DENSE_COUNT ENTITY_ARRAY_SPARSE
+
+/* Arrays grow by this many elements at a time. Keeps every growth a multiple of the arena alignment. */
+#define ENTITY_STORE_GROWTH 1024
+
+/* Marks the end of the free list of sparse slots */
+#define ENTITY_FREE_LIST_END 0xFFFFFFFFu
+
+/* Roots have depth zero */
+#define ENTITY_MAX_DEPTH 64
+
+/* Entities per parallel_for chunk when updating world matrices */
+#define ENTITY_HIERARCHY_GRAIN_SIZE 256
+
+/* Why an entity needs a new world matrix */
+typedef enum EntityDirtyFlags {
+	ENTITY_DIRTY_TRANSFORM = (1 << 0), /* Local transform changed, gets interpolated */
+	ENTITY_DIRTY_HIERARCHY = (1 << 1), /* Created, reparented or resorted, snaps */
+	ENTITY_DIRTY_PARENT    = (1 << 2), /* Set during the update when the parent was recomputed */
+} EntityDirtyFlags;
+
+/* How an entity's world matrix changed in the last update, for interpolating between the last two */
+typedef enum EntityMovedFlags {
+	ENTITY_MOVED_LOCAL  = (1 << 0),
+	ENTITY_MOVED_PARENT = (1 << 1),
+} EntityMovedFlags;
+
+typedef struct EntityStore {
+	int count;
+	int capacity;
+
+	/* Dense, one element per live entity */
+	EntityHandle* handles;
+	int* entity_types;
+	Transform* transforms;
+	ModelID* collider_model_ids;
+	ModelID* visible_model_ids;
+	LayerMask* layers;
+	EditorEntityData* editor_data;
+
+	/* Hierarchy. parent_indices is the parent's dense index, -1 for roots. */
+	EntityHandle* parents;
+	int* parent_indices;
+	int* child_counts;
+	u8* depths;
+	u8* dirty;
+	Matrix* world_matrices;
+
+	/* Interpolation. The local transform before the last change, and the matrices to draw between two updates. */
+	Transform* previous_transforms;
+	u8* moved;
+	Matrix* render_matrices;
+
+	/* Sparse, indexed by handle index. For free slots sparse_to_dense holds the next free slot instead. */
+	u32* sparse_to_dense;
+	u32* generations;
+	int sparse_count;
+	int sparse_capacity;
+	u32 free_head;
+
+	/* Set when an entity is created, destroyed or reparented out of depth order. Cleared by the next update. */
+	bool hierarchy_unsorted;
+	bool any_dirty;
+	bool any_moved;
+	/* Dense range of each depth, valid while the hierarchy is sorted */
+	int depth_count;
+	int depth_starts[ENTITY_MAX_DEPTH + 1];
+
+	Arena arenas[ENTITY_ARRAY_COUNT];
+} EntityStore;
+
+typedef struct EntityStoreArrayInfo {
+	const char* name;
+	u64 offset;
+	u64 item_size;
+} EntityStoreArrayInfo;
+
+#define ENTITY_ARRAY_INFO(field, name) { name, offsetof(EntityStore, field), sizeof(*((EntityStore*)0)->field) }
+
+global const EntityStoreArrayInfo entity_store_arrays[ENTITY_ARRAY_COUNT] = {
+	[ENTITY_ARRAY_HANDLES]         = ENTITY_ARRAY_INFO(handles,            "entity_handles"),
+	[ENTITY_ARRAY_TYPES]           = ENTITY_ARRAY_INFO(entity_types,       "entity_types"),
+	[ENTITY_ARRAY_TRANSFORMS]      = ENTITY_ARRAY_INFO(transforms,         "entity_transforms"),
+	[ENTITY_ARRAY_COLLIDER_MODELS] = ENTITY_ARRAY_INFO(collider_model_ids, "entity_collider_models"),
+	[ENTITY_ARRAY_VISIBLE_MODELS]  = ENTITY_ARRAY_INFO(visible_model_ids,  "entity_visible_models"),
+	[ENTITY_ARRAY_LAYERS]          = ENTITY_ARRAY_INFO(layers,             "entity_layers"),
+	[ENTITY_ARRAY_EDITOR_DATA]     = ENTITY_ARRAY_INFO(editor_data,        "entity_editor_data"),
+	[ENTITY_ARRAY_PARENTS]         = ENTITY_ARRAY_INFO(parents,            "entity_parents"),
+	[ENTITY_ARRAY_PARENT_INDICES]  = ENTITY_ARRAY_INFO(parent_indices,     "entity_parent_indices"),
+	[ENTITY_ARRAY_CHILD_COUNTS]    = ENTITY_ARRAY_INFO(child_counts,       "entity_child_counts"),
+	[ENTITY_ARRAY_DEPTHS]          = ENTITY_ARRAY_INFO(depths,             "entity_depths"),
+	[ENTITY_ARRAY_DIRTY]           = ENTITY_ARRAY_INFO(dirty,              "entity_dirty"),
+	[ENTITY_ARRAY_WORLD_MATRICES]  = ENTITY_ARRAY_INFO(world_matrices,     "entity_world_matrices"),
+	[ENTITY_ARRAY_PREVIOUS_TRANSFORMS] = ENTITY_ARRAY_INFO(previous_transforms, "entity_previous_transforms"),
+	[ENTITY_ARRAY_MOVED]           = ENTITY_ARRAY_INFO(moved,              "entity_moved"),
+	[ENTITY_ARRAY_RENDER_MATRICES] = ENTITY_ARRAY_INFO(render_matrices,    "entity_render_matrices"),
+	[ENTITY_ARRAY_SPARSE]          = ENTITY_ARRAY_INFO(sparse_to_dense,    "entity_sparse"),
+	[ENTITY_ARRAY_GENERATIONS]     = ENTITY_ARRAY_INFO(generations,        "entity_generations"),
+};
+
+/*
+* The fields are typed pointers, so they are read and written byte by byte here.
+* Going through a u8** instead would break strict aliasing, and the optimizer does notice.
+*/
+u8* entity_store_array_internal(const EntityStore* store, int array) {
+	u8* items;
+	const u8* field = (const u8*)store + entity_store_arrays[array].offset;
+	for (u64 b = 0; b < sizeof(items); b++) { ((u8*)&items)[b] = field[b]; }
+	return items;
+}
+
+void entity_store_set_array_internal(EntityStore* store, int array, u8* items) {
+	u8* field = (u8*)store + entity_store_arrays[array].offset;
+	for (u64 b = 0; b < sizeof(items); b++) { field[b] = ((u8*)&items)[b]; }
+}
+
+void entity_store_init(EntityStore* store) {
+	*store = (EntityStore) { .free_head = ENTITY_FREE_LIST_END };
+	for (int i = 0; i < ENTITY_ARRAY_COUNT; i++) {
+		/* Reservation only, nothing is committed until an entity needs it */
+		store->arenas[i] = (Arena) {
+			.name = entity_store_arrays[i].name,
+			.total_reserved_bytes = entity_store_arrays[i].item_size * ENTITY_MAX_COUNT,
+		};
+	}
+}
+
+void entity_store_free(EntityStore* store) {
+	for (int i = 0; i < ENTITY_ARRAY_COUNT; i++) {
+		arena_free(&store->arenas[i]);
+	}
+	*store = (EntityStore) { .free_head = ENTITY_FREE_LIST_END };
+}
+
+/* Extends arrays [first, last) by ENTITY_STORE_GROWTH elements. Each is the only thing in its arena, so it stays contiguous. */
+void entity_store_grow_internal(EntityStore* store, EntityStoreArray first, EntityStoreArray last, int capacity) {
+	for (int i = first; i < (int)last; i++) {
+		u8* items = entity_store_array_internal(store, i);
+		u64 item_size = entity_store_arrays[i].item_size;
+
+		u8* extension = arena_alloc(&store->arenas[i], item_size * ENTITY_STORE_GROWTH);
+		if (items == NULL) {
+			entity_store_set_array_internal(store, i, extension);
+		} else {
+			ASSERT(extension == items + item_size * (u64)capacity);
+		}
+	}
+}
+
+bool entity_is_alive(const EntityStore* store, EntityHandle handle) {
+	u32 index = entity_handle_index(handle);
+	return handle != ENTITY_HANDLE_NONE
+		&& index < (u32)store->sparse_count
+		&& store->generations[index] == entity_handle_generation(handle);
+}
+
+/* Returns the entity's position in the dense arrays, or -1 if the handle is stale. Only valid until the next destroy. */
+int entity_dense_index(const EntityStore* store, EntityHandle handle) {
+	if (!entity_is_alive(store, handle)) {
+		return -1;
+	}
+	return (int)store->sparse_to_dense[entity_handle_index(handle)];
+}
+
+/* Creates an entity with the given components and returns its handle. The parent must be alive or ENTITY_HANDLE_NONE. */
+EntityHandle entity_create(EntityStore* store, Entity initial) {
+	int parent_index = -1;
+	if (initial.parent != ENTITY_HANDLE_NONE) {
+		parent_index = entity_dense_index(store, initial.parent);
+		if (NEVER(parent_index < 0)) {
+			initial.parent = ENTITY_HANDLE_NONE;
+		}
+	}
+
+	u32 index;
+	if (store->free_head != ENTITY_FREE_LIST_END) {
+		index = store->free_head;
+		store->free_head = store->sparse_to_dense[index];
+	} else {
+		if (NEVER(store->sparse_count >= ENTITY_MAX_COUNT)) {
+			return ENTITY_HANDLE_NONE;
+		}
+		if (store->sparse_count == store->sparse_capacity) {
+			entity_store_grow_internal(store, ENTITY_ARRAY_SPARSE, ENTITY_ARRAY_COUNT, store->sparse_capacity);
+			store->sparse_capacity += ENTITY_STORE_GROWTH;
+		}
+		index = (u32)store->sparse_count++;
+		/* Zero is reserved for ENTITY_HANDLE_NONE, so generations start at one */
+		store->generations[index] = 1;
+	}
+
+	if (store->count == store->capacity) {
+		entity_store_grow_internal(store, 0, ENTITY_ARRAY_DENSE_COUNT, store->capacity);
+		store->capacity += ENTITY_STORE_GROWTH;
+	}
+
+	int dense = store->count++;
+	EntityHandle handle = entity_handle_make(index, store->generations[index]);
+	store->sparse_to_dense[index] = (u32)dense;
+
+	store->handles[dense]            = handle;
+	store->entity_types[dense]       = initial.entity_type;
+	store->transforms[dense]         = initial.transform;
+	store->collider_model_ids[dense] = initial.collider_model_id;
+	store->visible_model_ids[dense]  = initial.visible_model_id;
+	store->layers[dense]             = initial.layer;
+	store->editor_data[dense]        = initial.editor_data;
+
+	store->parents[dense]        = initial.parent;
+	store->parent_indices[dense] = parent_index;
+	store->child_counts[dense]   = 0;
+	store->depths[dense]         = (parent_index < 0) ? 0 : store->depths[parent_index] + 1;
+	store->dirty[dense]          = ENTITY_DIRTY_HIERARCHY;
+	store->world_matrices[dense] = MatrixIdentity();
+	store->previous_transforms[dense] = initial.transform;
+	store->moved[dense]          = 0;
+	store->any_dirty = true;
+	if (parent_index >= 0) {
+		store->child_counts[parent_index]++;
+	}
+
+	/* Appending keeps the order sorted only if nothing after the end is shallower */
+	int depth = store->depths[dense];
+	NEVER(depth >= ENTITY_MAX_DEPTH);
+	if (store->hierarchy_unsorted || depth < store->depth_count - 1) {
+		store->hierarchy_unsorted = true;
+	} else {
+		if (depth == store->depth_count) {
+			store->depth_starts[store->depth_count++] = dense;
+		}
+		store->depth_starts[store->depth_count] = store->count;
+	}
+	return handle;
+}
+
+/* Gathers all components of an entity. Returns false if the handle is stale. */
+bool entity_get(const EntityStore* store, EntityHandle handle, Entity* out_entity) {
+	int dense = entity_dense_index(store, handle);
+	if (dense < 0) {
+		return false;
+	}
+	*out_entity = (Entity) {
+		.entity_type       = store->entity_types[dense],
+		.transform         = store->transforms[dense],
+		.parent            = store->parents[dense],
+		.collider_model_id = store->collider_model_ids[dense],
+		.visible_model_id  = store->visible_model_ids[dense],
+		.layer             = store->layers[dense],
+		.editor_data       = store->editor_data[dense],
+	};
+	return true;
+}
+
+/* Returns the world matrix computed by the last entity_store_update_hierarchy */
+Matrix entity_world_matrix(const EntityStore* store, EntityHandle handle) {
+	int dense = entity_dense_index(store, handle);
+	return (dense < 0) ? MatrixIdentity() : store->world_matrices[dense];
+}
+
+/**
+* Replaces the local transform. The entity and everything under it get new world matrices on the next update.
+* Rendering interpolates from the transform the entity had at the previous update.
+*/
+void entity_set_transform(EntityStore* store, EntityHandle handle, Transform transform) {
+	int dense = entity_dense_index(store, handle);
+	if (dense < 0) return;
+
+	/* Only the first change since the last update saves the old transform */
+	if (!(store->dirty[dense] & ENTITY_DIRTY_TRANSFORM)) {
+		store->previous_transforms[dense] = store->transforms[dense];
+	}
+	store->transforms[dense] = transform;
+	store->dirty[dense] |= ENTITY_DIRTY_TRANSFORM;
+	store->any_dirty = true;
+}
+
+bool entity_is_ancestor(const EntityStore* store, EntityHandle ancestor, EntityHandle handle) {
+	for (int dense = entity_dense_index(store, handle); dense >= 0; ) {
+		EntityHandle parent = store->parents[dense];
+		if (parent == ancestor) return true;
+		dense = entity_dense_index(store, parent);
+	}
+	return false;
+}
+
+/* Moves an entity (and everything under it) to a new parent, or to the root with ENTITY_HANDLE_NONE. The local transform is kept. */
+void entity_set_parent(EntityStore* store, EntityHandle handle, EntityHandle parent) {
+	int dense = entity_dense_index(store, handle);
+	if (dense < 0) return;
+	if (parent != ENTITY_HANDLE_NONE && !entity_is_alive(store, parent)) return;
+	if (NEVER(parent == handle || entity_is_ancestor(store, handle, parent))) return;
+
+	int old_parent = entity_dense_index(store, store->parents[dense]);
+	if (old_parent >= 0) { store->child_counts[old_parent]--; }
+	int new_parent = entity_dense_index(store, parent);
+	if (new_parent >= 0) { store->child_counts[new_parent]++; }
+
+	store->parents[dense] = parent;
+	store->dirty[dense] |= ENTITY_DIRTY_HIERARCHY;
+	store->any_dirty = true;
+	/* Depths of the whole subtree change, let the next update sort it out */
+	store->hierarchy_unsorted = true;
+}
+
+/* Removes one entity, its children are left pointing at a dead parent */
+void entity_destroy_one_internal(EntityStore* store, int dense) {
+	EntityHandle handle = store->handles[dense];
+
+	int parent = entity_dense_index(store, store->parents[dense]);
+	if (parent >= 0) { store->child_counts[parent]--; }
+
+	/*
+	* Moving the last entity into the hole keeps the order sorted if it is as deep as the hole and nothing
+	* points at it as a parent. Always true for scenes without hierarchy.
+	*/
+	int last = store->count - 1;
+	bool stays_sorted = !store->hierarchy_unsorted
+		&& store->depths[dense] == store->depths[last]
+		&& store->child_counts[last] == 0;
+
+	/* Fill the hole with the last entity */
+	if (dense != last) {
+		for (int array = 0; array < ENTITY_ARRAY_DENSE_COUNT; array++) {
+			u8* items = entity_store_array_internal(store, array);
+			u64 item_size = entity_store_arrays[array].item_size;
+			for (u64 b = 0; b < item_size; b++) {
+				items[(u64)dense * item_size + b] = items[(u64)last * item_size + b];
+			}
+		}
+		store->sparse_to_dense[entity_handle_index(store->handles[dense])] = (u32)dense;
+	}
+	store->count--;
+
+	if (stays_sorted) {
+		store->depth_starts[store->depth_count] = store->count;
+		if (store->depth_starts[store->depth_count - 1] == store->count) {
+			store->depth_count--;
+		}
+	} else {
+		store->hierarchy_unsorted = true;
+	}
+
+	u32 index = entity_handle_index(handle);
+	u32 generation = (store->generations[index] + 1) & ENTITY_GENERATION_MASK;
+	store->generations[index] = generation == 0 ? 1 : generation;
+	store->sparse_to_dense[index] = store->free_head;
+	store->free_head = index;
+}
+
+void entity_store_sort_hierarchy_internal(EntityStore* store);
+
+/* Destroys an entity and everything under it. Stale handles are ignored. Every existing handle to them becomes stale. */
+void entity_destroy(EntityStore* store, EntityHandle handle) {
+	int dense = entity_dense_index(store, handle);
+	if (dense < 0) {
+		return;
+	}
+	if (store->child_counts[dense] == 0) {
+		entity_destroy_one_internal(store, dense);
+		return;
+	}
+
+	/* Sorted, every descendant comes after its parent, so one pass from the entity finds the whole subtree */
+	if (store->hierarchy_unsorted) {
+		entity_store_sort_hierarchy_internal(store);
+	}
+
+	int first = entity_dense_index(store, handle);
+	TempArena scratch = scratch_begin(NULL, 0);
+	u8* doomed = arena_alloc(scratch.arena, (u64)store->count);
+	for (int i = 0; i < store->count; i++) { doomed[i] = false; }
+
+	doomed[first] = true;
+	int doomed_count = 1;
+	for (int i = first + 1; i < store->count; i++) {
+		int parent = store->parent_indices[i];
+		if (parent >= 0 && doomed[parent]) {
+			doomed[i] = true;
+			doomed_count++;
+		}
+	}
+
+	EntityHandle* doomed_handles = arena_alloc(scratch.arena, sizeof(*doomed_handles) * doomed_count);
+	for (int i = first, n = 0; i < store->count; i++) {
+		if (doomed[i]) { doomed_handles[n++] = store->handles[i]; }
+	}
+	for (int i = 0; i < doomed_count; i++) {
+		entity_destroy_one_internal(store, entity_dense_index(store, doomed_handles[i]));
+	}
+	scratch_end(scratch);
+}
+
+/**
+* Reorders every dense array so entities are sorted by depth, keeping the existing order within a depth.
+* Recomputes depths and parent indices on the way, and marks everything dirty.
+*/
+void entity_store_sort_hierarchy_internal(EntityStore* store) {
+	int count = store->count;
+	TempArena scratch = scratch_begin(NULL, 0);
+
+	/* Depths from scratch, parents can be anywhere in the arrays while unsorted */
+	u8* known = arena_alloc(scratch.arena, (u64)count + 1);
+	for (int i = 0; i < count; i++) { known[i] = false; }
+
+	for (int i = 0; i < count; i++) {
+		int steps = 0;
+		int top = i;
+		while (!known[top] && store->parents[top] != ENTITY_HANDLE_NONE) {
+			top = (int)store->sparse_to_dense[entity_handle_index(store->parents[top])];
+			steps++;
+		}
+		int depth = (known[top] ? store->depths[top] : 0) + steps;
+		NEVER(depth >= ENTITY_MAX_DEPTH);
+
+		for (int j = i; !known[j]; depth--) {
+			store->depths[j] = (u8)depth;
+			known[j] = true;
+			if (store->parents[j] == ENTITY_HANDLE_NONE) break;
+			j = (int)store->sparse_to_dense[entity_handle_index(store->parents[j])];
+		}
+	}
+
+	/* Stable counting sort by depth */
+	int depth_sizes[ENTITY_MAX_DEPTH] = {0};
+	store->depth_count = 0;
+	for (int i = 0; i < count; i++) {
+		depth_sizes[(int)store->depths[i]]++;
+		store->depth_count = MAX2(store->depth_count, store->depths[i] + 1);
+	}
+	int next_slot[ENTITY_MAX_DEPTH];
+	for (int d = 0, start = 0; d <= store->depth_count; d++) {
+		store->depth_starts[d] = start;
+		if (d < store->depth_count) {
+			next_slot[d] = start;
+			start += depth_sizes[d];
+		}
+	}
+	int* order = arena_alloc(scratch.arena, sizeof(*order) * (count + 1));
+	for (int i = 0; i < count; i++) {
+		order[next_slot[(int)store->depths[i]]++] = i;
+	}
+
+	for (int array = 0; array < ENTITY_ARRAY_DENSE_COUNT; array++) {
+		u8* items = entity_store_array_internal(store, array);
+		u64 item_size = entity_store_arrays[array].item_size;
+		u64 byte_count = item_size * (u64)count;
+
+		u8* copy = arena_alloc(scratch.arena, byte_count + 1);
+		for (u64 b = 0; b < byte_count; b++) { copy[b] = items[b]; }
+		for (int i = 0; i < count; i++) {
+			const u8* from = copy + (u64)order[i] * item_size;
+			u8* to = items + (u64)i * item_size;
+			for (u64 b = 0; b < item_size; b++) { to[b] = from[b]; }
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		store->sparse_to_dense[entity_handle_index(store->handles[i])] = (u32)i;
+	}
+	for (int i = 0; i < count; i++) {
+		store->child_counts[i] = 0;
+	}
+	for (int i = 0; i < count; i++) {
+		EntityHandle parent = store->parents[i];
+		store->parent_indices[i] = (parent == ENTITY_HANDLE_NONE) ? -1 : (int)store->sparse_to_dense[entity_handle_index(parent)];
+		if (store->parent_indices[i] >= 0) { store->child_counts[store->parent_indices[i]]++; }
+		store->dirty[i] |= ENTITY_DIRTY_HIERARCHY;
+	}
+
+	store->any_dirty = true;
+	store->hierarchy_unsorted = false;
+	scratch_end(scratch);
+}
+
+void entity_hierarchy_range_internal(void* user_data, int start, int end) {
+	EntityStore* store = user_data;
+	for (int i = start; i < end; i++) {
+		int parent = store->parent_indices[i];
+		u8 dirty = store->dirty[i];
+		bool parent_dirty = (parent >= 0) && store->dirty[parent];
+		if (!dirty && !parent_dirty) {
+			store->moved[i] = 0;
+			continue;
+		}
+
+		u8 moved = 0;
+		if (dirty & ENTITY_DIRTY_TRANSFORM) moved |= ENTITY_MOVED_LOCAL;
+		if (parent >= 0 && store->moved[parent]) moved |= ENTITY_MOVED_PARENT;
+		store->moved[i] = moved;
+		if (moved) __atomic_store_n(&store->any_moved, true, __ATOMIC_RELAXED);
+
+		Matrix local = math_transform_to_matrix(store->transforms[i]);
+		store->world_matrices[i] = (parent < 0) ? local : math_matrix_multiply(local, store->world_matrices[parent]);
+		/* Children check this on the next depth */
+		store->dirty[i] = dirty | ENTITY_DIRTY_PARENT;
+	}
+}
+
+void entity_clear_dirty_range_internal(void* user_data, int start, int end) {
+	EntityStore* store = user_data;
+	for (int i = start; i < end; i++) {
+		store->dirty[i] = 0;
+	}
+}
+
+void entity_clear_moved_range_internal(void* user_data, int start, int end) {
+	EntityStore* store = user_data;
+	for (int i = start; i < end; i++) {
+		store->moved[i] = 0;
+	}
+}
+
+/**
+* Brings world matrices up to date. Entities whose transform (or an ancestor's) didn't change since the last update
+* are skipped. Each depth only reads the depth above it, so the entities of one depth are split over the job system.
+*/
+void entity_store_update_hierarchy(EntityStore* store) {
+	if (store->hierarchy_unsorted) {
+		entity_store_sort_hierarchy_internal(store);
+	}
+	if (!store->any_dirty) {
+		/* Nothing moved this time, so there is nothing to interpolate either */
+		if (store->any_moved) {
+			parallel_for(store->count, ENTITY_HIERARCHY_GRAIN_SIZE * 16, entity_clear_moved_range_internal, store);
+			store->any_moved = false;
+		}
+		return;
+	}
+
+	/* Every entity's moved flags get rewritten below */
+	store->any_moved = false;
+	for (int d = 0; d < store->depth_count; d++) {
+		int start = store->depth_starts[d];
+		int end = store->depth_starts[d + 1];
+		parallel_for_range(start, end, ENTITY_HIERARCHY_GRAIN_SIZE, entity_hierarchy_range_internal, store);
+	}
+	parallel_for(store->count, ENTITY_HIERARCHY_GRAIN_SIZE * 16, entity_clear_dirty_range_internal, store);
+	store->any_dirty = false;
+}
+#endif
+
+#ifndef REGION_ENTITY_SNAPSHOT
+/**
+* What drawing needs from the entity store. Taken into a frame arena at the end of a simulation frame,
+* so the simulation can carry on with the store while the snapshot is drawn (see FramePipeline in simulation.c).
+* Nothing in it changes after it's taken except render_matrices, which belong to whoever draws it.
+*/
+typedef struct EntitySnapshot {
+	int count;
+	int depth_count;
+	int depth_starts[ENTITY_MAX_DEPTH + 1];
+	bool any_moved;
+
+	const ModelID* visible_model_ids;
+	const Matrix* world_matrices;
+
+	/* Only needed for interpolation, so only copied when something moved */
+	const int* parent_indices;
+	const Transform* transforms;
+	const Transform* previous_transforms;
+	const u8* moved;
+
+	Matrix* render_matrices;
+} EntitySnapshot;
+
+/* A snapshot that points straight at the store's arrays. Only valid until the store changes. */
+EntitySnapshot entity_snapshot_view(EntityStore* store) {
+	EntitySnapshot snapshot = {
+		.count               = store->count,
+		.depth_count         = store->depth_count,
+		.any_moved           = store->any_moved,
+		.visible_model_ids   = store->visible_model_ids,
+		.world_matrices      = store->world_matrices,
+		.parent_indices      = store->parent_indices,
+		.transforms          = store->transforms,
+		.previous_transforms = store->previous_transforms,
+		.moved               = store->moved,
+		.render_matrices     = store->render_matrices,
+	};
+	for (int d = 0; d <= store->depth_count; d++) {
+		snapshot.depth_starts[d] = store->depth_starts[d];
+	}
+	return snapshot;
+}
+
+void* entity_snapshot_copy_internal(Arena* arena, const void* items, int count, u64 item_size) {
+	u64 byte_count = (u64)count * item_size;
+	u8* copy = arena_alloc(arena, byte_count);
+	const u8* from = items;
+	for (u64 b = 0; b < byte_count; b++) { copy[b] = from[b]; }
+	return copy;
+}
+
+/* Copies what drawing needs into arena. The store has to be up to date (see entity_store_update_hierarchy). */
+EntitySnapshot entity_snapshot_take(Arena* arena, EntityStore* store) {
+	ASSERT(!store->hierarchy_unsorted);
+	EntitySnapshot snapshot = entity_snapshot_view(store);
+	int count = store->count;
+
+	snapshot.visible_model_ids = entity_snapshot_copy_internal(arena, store->visible_model_ids, count, sizeof(*store->visible_model_ids));
+	snapshot.world_matrices    = entity_snapshot_copy_internal(arena, store->world_matrices, count, sizeof(*store->world_matrices));
+	snapshot.render_matrices   = NULL;
+	snapshot.parent_indices      = NULL;
+	snapshot.transforms          = NULL;
+	snapshot.previous_transforms = NULL;
+	snapshot.moved               = NULL;
+
+	if (snapshot.any_moved) {
+		snapshot.parent_indices      = entity_snapshot_copy_internal(arena, store->parent_indices, count, sizeof(*store->parent_indices));
+		snapshot.transforms          = entity_snapshot_copy_internal(arena, store->transforms, count, sizeof(*store->transforms));
+		snapshot.previous_transforms = entity_snapshot_copy_internal(arena, store->previous_transforms, count, sizeof(*store->previous_transforms));
+		snapshot.moved               = entity_snapshot_copy_internal(arena, store->moved, count, sizeof(*store->moved));
+		snapshot.render_matrices     = arena_alloc(arena, sizeof(*snapshot.render_matrices) * count);
+	}
+	return snapshot;
+}
+
+typedef struct EntityInterpolation {
+	EntitySnapshot* snapshot;
+	f32 alpha;
+} EntityInterpolation;
+
+void entity_interpolate_range_internal(void* user_data, int start, int end) {
+	EntityInterpolation* interpolation = user_data;
+	EntitySnapshot* snapshot = interpolation->snapshot;
+
+	for (int i = start; i < end; i++) {
+		u8 moved = snapshot->moved[i];
+		if (!moved) {
+			snapshot->render_matrices[i] = snapshot->world_matrices[i];
+			continue;
+		}
+
+		Transform local = snapshot->transforms[i];
+		if (moved & ENTITY_MOVED_LOCAL) {
+			local = math_transform_lerp(snapshot->previous_transforms[i], local, interpolation->alpha);
+		}
+		Matrix local_matrix = math_transform_to_matrix(local);
+		int parent = snapshot->parent_indices[i];
+		snapshot->render_matrices[i] = (parent < 0) ? local_matrix : math_matrix_multiply(local_matrix, snapshot->render_matrices[parent]);
+	}
+}
+
+/**
+* Returns the matrices to draw, blended alpha of the way from the update before last to the last one.
+* Only entities that moved in the last update are blended. If none did, these are just the world matrices.
+*/
+const Matrix* entity_snapshot_interpolate(EntitySnapshot* snapshot, f32 alpha) {
+	if (!snapshot->any_moved) {
+		return snapshot->world_matrices;
+	}
+
+	EntityInterpolation interpolation = { .snapshot = snapshot, .alpha = alpha };
+	for (int d = 0; d < snapshot->depth_count; d++) {
+		parallel_for_range(snapshot->depth_starts[d], snapshot->depth_starts[d + 1], ENTITY_HIERARCHY_GRAIN_SIZE, entity_interpolate_range_internal, &interpolation);
+	}
+	return snapshot->render_matrices;
+}
+
+/* entity_snapshot_interpolate straight from the store, into its own render_matrices */
+const Matrix* entity_store_interpolate(EntityStore* store, f32 alpha) {
+	EntitySnapshot view = entity_snapshot_view(store);
+	return entity_snapshot_interpolate(&view, alpha);
+}
+#endif
+
 /**
  * StaticObjects are entirely built from scratch each frame.
  *
@@ -66,59 +809,143 @@ typedef struct StaticObjectArray {
 	int len;
 } StaticObjectArray;
 
+/**
+ * Writes a mesh's triangles to tris, transformed by matrix, and returns their bounding box. The vertices go straight
+ * from the mesh into the colliders through the batch transform (see math_batch_transform_triangles).
+ */
+BoundingBox collider_fill_triangles_internal(TriangleCollider* tris, const f32* vertices, int triangle_count, Matrix matrix, LayerMask mask, EntityHandle handle) {
+	if (triangle_count <= 0) return math_aabb_empty();
+
+	/* Currently, colliders lack support for rotation/scaling */
+	BoundingBox bounds = math_batch_transform_triangles(&tris[0].vert_1, sizeof(*tris), (const Vector3*)vertices, triangle_count, matrix);
+	for (int j = 0; j < triangle_count; j++) {
+		tris[j].mask = mask;
+		tris[j].entity_id = handle;
+	}
+	return bounds;
+}
+
 /**
  * Handles things like terrain and other objects that do not change during their lifetime.
+ * If bounds isn't NULL it gets the bounding box of every collider, the same as collision_get_world_bounding_box.
  */
-TriangleColliderArray static_object_loop(Arena* collider_data_arena, StaticObjectArray static_objects, const Model* model_prefabs) {
+TriangleColliderArray static_object_loop(Arena* collider_data_arena, StaticObjectArray static_objects, const Model* model_prefabs, BoundingBox* bounds) {
 	TriangleColliderArray tri_array = {0};
+	BoundingBox world_bounds = math_aabb_empty();
+
+	/* Count first so the whole array is one allocation */
+	int total_scene_tris = 0;
+	for (int i = 0; i < static_objects.len; i++) {
+		Model model = model_prefabs[static_objects.objects[i].id];
+		for (int mesh_index = 0; mesh_index < model.meshCount; mesh_index++) {
+			total_scene_tris += model.meshes[mesh_index].vertexCount / 3;
+		}
+	}
+	if (!arena_array_reserve(collider_data_arena, tri_array.colliders, tri_array.length, tri_array.capacity, total_scene_tris)) {
+		if (bounds != NULL) { *bounds = world_bounds; }
+		return tri_array;
+	}
 
 	for (int i = 0; i < static_objects.len; i++) {
 		StaticObject object = static_objects.objects[i];
+		Matrix t_matrix = math_transform_to_matrix(object.transform);
 		for (int mesh_index = 0; mesh_index < model_prefabs[object.id].meshCount; mesh_index++) {
 			Mesh mesh = model_prefabs[object.id].meshes[mesh_index];
 			int total_tris = mesh.vertexCount / 3;
-			TriangleCollider* tris = arena_alloc(collider_data_arena, sizeof(TriangleCollider) * total_tris);
-
-			for (int j = 0; j < total_tris; j += 1) {
-				Matrix t_matrix = math_transform_to_matrix(object.transform);
-				int stride = 3;
-				Vector3 v1 = {
-					mesh.vertices[stride * (j * 3 + 0) + 0],
-					mesh.vertices[stride * (j * 3 + 0) + 1],
-					mesh.vertices[stride * (j * 3 + 0) + 2],
-				};
-
-				Vector3 v2 = {
-					mesh.vertices[stride * (j * 3 + 1) + 0],
-					mesh.vertices[stride * (j * 3 + 1) + 1],
-					mesh.vertices[stride * (j * 3 + 1) + 2],
-				};
-
-				Vector3 v3 = {
-					mesh.vertices[stride * (j * 3 + 2) + 0],
-					mesh.vertices[stride * (j * 3 + 2) + 1],
-					mesh.vertices[stride * (j * 3 + 2) + 2],
-				};
-				v1 = Vector3Transform(v1, t_matrix);
-				v2 = Vector3Transform(v2, t_matrix);
-				v3 = Vector3Transform(v3, t_matrix);
-
-				/* Currently, colliders lack support for rotation/scaling */
-				tris[j] = (TriangleCollider) {
-					.mask = MASK_STATIC_GEOMETRY,
-					.vert_1 = v1,
-					.vert_2 = v2,
-					.vert_3 = v3,
-					/* TODO: Introduce a better way to rep the entity id. */
-					.entity_id = i,
-				};
-
-				if (tri_array.colliders == NULL) {
-					tri_array.colliders = tris;
-				}
-				tri_array.length++;
-			}
+			TriangleCollider* tris = arena_array_push_n(collider_data_arena, tri_array.colliders, tri_array.length, tri_array.capacity, total_tris);
+			/* Static objects are not entities, entity_collider_loop fills in real handles */
+			BoundingBox mesh_bounds = collider_fill_triangles_internal(tris, mesh.vertices, total_tris, t_matrix, MASK_STATIC_GEOMETRY, ENTITY_HANDLE_NONE);
+			world_bounds = math_aabb_merge(world_bounds, mesh_bounds);
+		}
+	}
+
+	if (bounds != NULL) { *bounds = world_bounds; }
+	return tri_array;
+}
+
+/* Entities per parallel_for chunk in entity_collider_loop */
+#define ENTITY_COLLIDER_GRAIN_SIZE 64
+
+typedef struct EntityColliderJob {
+	const EntityStore* store;
+	const Model* model_prefabs;
+	const int* first_triangle;
+	TriangleCollider* colliders;
+	/* One per chunk, chunks never share one so nothing needs to be atomic */
+	BoundingBox* chunk_bounds;
+} EntityColliderJob;
+
+void entity_collider_range_internal(void* user_data, int start, int end) {
+	EntityColliderJob* job = user_data;
+	const EntityStore* store = job->store;
+	BoundingBox bounds = math_aabb_empty();
+
+	for (int i = start; i < end; i++) {
+		ModelID model_id = store->collider_model_ids[i];
+		if (model_id == MODEL_NONE) continue;
+
+		Matrix t_matrix = store->world_matrices[i];
+		LayerMask layer = store->layers[i];
+		EntityHandle handle = store->handles[i];
+		TriangleCollider* tris = job->colliders + job->first_triangle[i];
+
+		for (int mesh_index = 0; mesh_index < job->model_prefabs[model_id].meshCount; mesh_index++) {
+			Mesh mesh = job->model_prefabs[model_id].meshes[mesh_index];
+			int total_tris = mesh.vertexCount / 3;
+
+			bounds = math_aabb_merge(bounds, collider_fill_triangles_internal(tris, mesh.vertices, total_tris, t_matrix, layer, handle));
+			tris += total_tris;
+		}
+	}
+
+	job->chunk_bounds[start / ENTITY_COLLIDER_GRAIN_SIZE] = bounds;
+}
+
+/**
+ * Builds the triangle colliders for every entity in the store that has a collider model.
+ * Only walks the world matrix, collider model, layer and handle arrays, so world matrices have to be
+ * up to date (entity_store_update_hierarchy).
+ *
+ * Each entity's triangles go to a precomputed offset, so the entities are split over the job system
+ * and the output is the same no matter how many workers there are.
+ *
+ * If bounds isn't NULL it gets the bounding box of every collider, the same as collision_get_world_bounding_box.
+ * Each chunk keeps its own box while the triangles are still in registers, and they're merged at the end.
+ */
+TriangleColliderArray entity_collider_loop(Arena* collider_data_arena, const EntityStore* store, const Model* model_prefabs, BoundingBox* bounds) {
+	TriangleColliderArray tri_array = {0};
+	TempArena scratch = scratch_begin(&collider_data_arena, 1);
+
+	int* first_triangle = arena_alloc(scratch.arena, sizeof(*first_triangle) * (store->count + 1));
+	int total_scene_tris = 0;
+	for (int i = 0; i < store->count; i++) {
+		first_triangle[i] = total_scene_tris;
+		if (store->collider_model_ids[i] == MODEL_NONE) continue;
+
+		Model model = model_prefabs[store->collider_model_ids[i]];
+		for (int mesh_index = 0; mesh_index < model.meshCount; mesh_index++) {
+			total_scene_tris += model.meshes[mesh_index].vertexCount / 3;
+		}
+	}
+	first_triangle[store->count] = total_scene_tris;
+
+	EntityColliderJob job = {
+		.store = store,
+		.model_prefabs = model_prefabs,
+		.first_triangle = first_triangle,
+		.colliders = arena_array_push_n(collider_data_arena, tri_array.colliders, tri_array.length, tri_array.capacity, total_scene_tris),
+	};
+	int chunk_count = (store->count + ENTITY_COLLIDER_GRAIN_SIZE - 1) / ENTITY_COLLIDER_GRAIN_SIZE;
+	job.chunk_bounds = arena_alloc(scratch.arena, sizeof(*job.chunk_bounds) * MAX2(chunk_count, 1));
+	parallel_for(store->count, ENTITY_COLLIDER_GRAIN_SIZE, entity_collider_range_internal, &job);
+
+	if (bounds != NULL) {
+		*bounds = math_aabb_empty();
+		for (int i = 0; i < chunk_count; i++) {
+			*bounds = math_aabb_merge(*bounds, job.chunk_bounds[i]);
 		}
 	}
+
+	scratch_end(scratch);
 	return tri_array;
-}
\ No newline at end of file
+}
@@ -0,0 +1,27 @@
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Entities are referred to by 32-bit generational handles. The low bits index into the entity store's sparse table,
+* the high bits are that slot's generation, which changes every time an entity there is destroyed.
+* A handle to a destroyed entity therefore never resolves to whatever reuses its slot.
+*
+* Zero is never a valid handle.
+*/
+typedef u32 EntityHandle;
+
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_GENERATION_BITS (32 - ENTITY_INDEX_BITS)
+
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK ((1u << ENTITY_GENERATION_BITS) - 1)
+
+/* Most entities that can be alive at once */
+#define ENTITY_MAX_COUNT (1 << ENTITY_INDEX_BITS)
+
+#define ENTITY_HANDLE_NONE ((EntityHandle)0)
+
+#define entity_handle_index(handle) ((u32)(handle) & ENTITY_INDEX_MASK)
+#define entity_handle_generation(handle) ((u32)(handle) >> ENTITY_INDEX_BITS)
+#define entity_handle_make(index, generation) ((EntityHandle)(((u32)(generation) << ENTITY_INDEX_BITS) | ((u32)(index) & ENTITY_INDEX_MASK)))
@@ -111,7 +111,7 @@ u64 hash_push(
 bool bytes_eq_internal(const u8* bytes_1, u64 bytes_1_len, const u8* bytes_2, u64 bytes_2_len) {
 	if (bytes_1_len != bytes_2_len) { return false; }
 
-	for (u64 i = bytes_1_len; i < bytes_1_len; i++) {
+	for (u64 i = 0; i < bytes_1_len; i++) {
 		if (bytes_1[i] != bytes_2[i]) { return false; }
 	}
 
@@ -0,0 +1,315 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+#include <stdio.h>
+
+/**
+* Everything the game reads from the keyboard and mouse goes through an InputFrame, polled once per frame.
+* Nothing past input_poll talks to raylib's input functions, so a frame can just as well come out of a recording.
+*
+* A recording is a compact binary log of InputFrames. Replaying it feeds the exact same input and the exact same
+* frame times back in, so the fixed step clock runs the same steps and the session plays out the same way
+* on any machine and in any build. That makes frame time traces of two builds comparable.
+*
+* Not recorded: the immediate mode UI still reads the mouse position directly, it doesn't affect the simulation.
+*/
+
+/* Every key and mouse button the game looks at, one bit each */
+typedef enum InputKey {
+	INPUT_KEY_UP,
+	INPUT_KEY_DOWN,
+	INPUT_KEY_LEFT,
+	INPUT_KEY_RIGHT,
+	INPUT_KEY_Q,
+	INPUT_KEY_E,
+	INPUT_KEY_W,
+	INPUT_KEY_A,
+	INPUT_KEY_S,
+	INPUT_KEY_D,
+	INPUT_KEY_P,
+	INPUT_KEY_SPACE,
+	INPUT_KEY_LEFT_SHIFT,
+	INPUT_KEY_LEFT_CONTROL,
+	INPUT_KEY_ESCAPE,
+	INPUT_KEY_F3,
+	INPUT_KEY_KP_ADD,
+	INPUT_KEY_KP_SUBTRACT,
+	INPUT_KEY_MOUSE_RIGHT,
+	INPUT_KEY_MOUSE_MIDDLE,
+	/* After the mouse buttons, so recorded input logs keep their bits */
+	INPUT_KEY_F4,
+
+	INPUT_KEY_COUNT
+} InputKey;
+
+/* Raylib's KeyboardKey for each InputKey, mouse buttons are handled separately */
+global const int input_raylib_keys[INPUT_KEY_COUNT] = {
+	[INPUT_KEY_UP]           = KEY_UP,
+	[INPUT_KEY_DOWN]         = KEY_DOWN,
+	[INPUT_KEY_LEFT]         = KEY_LEFT,
+	[INPUT_KEY_RIGHT]        = KEY_RIGHT,
+	[INPUT_KEY_Q]            = KEY_Q,
+	[INPUT_KEY_E]            = KEY_E,
+	[INPUT_KEY_W]            = KEY_W,
+	[INPUT_KEY_A]            = KEY_A,
+	[INPUT_KEY_S]            = KEY_S,
+	[INPUT_KEY_D]            = KEY_D,
+	[INPUT_KEY_P]            = KEY_P,
+	[INPUT_KEY_SPACE]        = KEY_SPACE,
+	[INPUT_KEY_LEFT_SHIFT]   = KEY_LEFT_SHIFT,
+	[INPUT_KEY_LEFT_CONTROL] = KEY_LEFT_CONTROL,
+	[INPUT_KEY_ESCAPE]       = KEY_ESCAPE,
+	[INPUT_KEY_F3]           = KEY_F3,
+	[INPUT_KEY_KP_ADD]       = KEY_KP_ADD,
+	[INPUT_KEY_KP_SUBTRACT]  = KEY_KP_SUBTRACT,
+	[INPUT_KEY_F4]           = KEY_F4,
+};
+
+typedef struct InputFrame {
+	/* Since the session started. This is what the fixed step clock runs on. */
+	u64 time_ns;
+	/* Since the previous frame, for anything that moves per frame like the editor camera */
+	f32 delta_seconds;
+
+	Vector2 mouse_delta;
+	f32 mouse_wheel;
+	/* Bit per InputKey. Pressed is only set on the frame the key went down. */
+	u32 keys_down;
+	u32 keys_pressed;
+} InputFrame;
+
+bool input_key_down(const InputFrame* input, InputKey key) {
+	return (input->keys_down >> key) & 1;
+}
+
+bool input_key_pressed(const InputFrame* input, InputKey key) {
+	return (input->keys_pressed >> key) & 1;
+}
+
+/* Reads this frame's input from raylib. time_ns and previous_time_ns are since the session started. */
+InputFrame input_poll(u64 time_ns, u64 previous_time_ns) {
+	InputFrame input = {
+		.time_ns = time_ns,
+		.delta_seconds = (f32)((f64)(time_ns - previous_time_ns) / 1e9),
+		.mouse_delta = GetMouseDelta(),
+		.mouse_wheel = GetMouseWheelMove(),
+	};
+
+	for (int key = 0; key < INPUT_KEY_COUNT; key++) {
+		if (key == INPUT_KEY_MOUSE_RIGHT || key == INPUT_KEY_MOUSE_MIDDLE) continue;
+		if (IsKeyDown(input_raylib_keys[key]))    { input.keys_down    |= (1u << key); }
+		if (IsKeyPressed(input_raylib_keys[key])) { input.keys_pressed |= (1u << key); }
+	}
+	if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))     { input.keys_down    |= (1u << INPUT_KEY_MOUSE_RIGHT); }
+	if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))  { input.keys_pressed |= (1u << INPUT_KEY_MOUSE_RIGHT); }
+	if (IsMouseButtonDown(MOUSE_BUTTON_MIDDLE))    { input.keys_down    |= (1u << INPUT_KEY_MOUSE_MIDDLE); }
+	if (IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE)) { input.keys_pressed |= (1u << INPUT_KEY_MOUSE_MIDDLE); }
+
+	return input;
+}
+
+#ifndef REGION_INPUT_LOG
+/**
+* Log layout: an 8 byte header (INPUT_LOG_MAGIC, then the version as a little endian u32), then one record per frame.
+*
+* Each record starts with a flags byte and the time since the previous frame in nanoseconds as a LEB128 varint.
+* Everything else is only there when its flag says so: the mouse delta (2 f32), the wheel (f32), keys_down (u32, only
+* when it changed since the previous frame) and keys_pressed (u32). Idle frames come out at 4 or 5 bytes.
+* All values are little endian.
+*/
+#define INPUT_LOG_MAGIC "AHIN"
+#define INPUT_LOG_VERSION 1
+#define INPUT_LOG_HEADER_SIZE 8
+
+/* Biggest possible record: flags, a 10 byte varint and every optional field */
+#define INPUT_RECORD_MAX_SIZE (1 + 10 + 8 + 4 + 4 + 4)
+
+typedef enum InputRecordFlags {
+	INPUT_RECORD_MOUSE_DELTA  = (1 << 0),
+	INPUT_RECORD_MOUSE_WHEEL  = (1 << 1),
+	INPUT_RECORD_KEYS_DOWN    = (1 << 2),
+	INPUT_RECORD_KEYS_PRESSED = (1 << 3),
+} InputRecordFlags;
+
+int input_write_u32_internal(u8* out, u32 value) {
+	for (int i = 0; i < 4; i++) { out[i] = (u8)(value >> (i * 8)); }
+	return 4;
+}
+
+int input_write_f32_internal(u8* out, f32 value) {
+	union { f32 f; u32 u; } bits = { .f = value };
+	return input_write_u32_internal(out, bits.u);
+}
+
+u32 input_read_u32_internal(const u8* in) {
+	u32 value = 0;
+	for (int i = 0; i < 4; i++) { value |= (u32)(unsigned char)in[i] << (i * 8); }
+	return value;
+}
+
+f32 input_read_f32_internal(const u8* in) {
+	union { f32 f; u32 u; } bits = { .u = input_read_u32_internal(in) };
+	return bits.f;
+}
+
+/**
+* Encodes one frame into out, which needs room for INPUT_RECORD_MAX_SIZE bytes. Returns the bytes written.
+* previous is the frame recorded before this one, zeroed for the first.
+*/
+int input_record_encode(u8* out, const InputFrame* frame, const InputFrame* previous) {
+	u8 flags = 0;
+	if (frame->mouse_delta.x != 0.0f || frame->mouse_delta.y != 0.0f) { flags |= INPUT_RECORD_MOUSE_DELTA; }
+	if (frame->mouse_wheel != 0.0f)               { flags |= INPUT_RECORD_MOUSE_WHEEL; }
+	if (frame->keys_down != previous->keys_down)  { flags |= INPUT_RECORD_KEYS_DOWN; }
+	if (frame->keys_pressed != 0)                 { flags |= INPUT_RECORD_KEYS_PRESSED; }
+
+	int size = 0;
+	out[size++] = (u8)flags;
+
+	u64 delta_ns = frame->time_ns - previous->time_ns;
+	do {
+		u8 byte = (u8)(delta_ns & 0x7F);
+		delta_ns >>= 7;
+		if (delta_ns != 0) { byte = (u8)(byte | 0x80); }
+		out[size++] = byte;
+	} while (delta_ns != 0);
+
+	if (flags & INPUT_RECORD_MOUSE_DELTA) {
+		size += input_write_f32_internal(out + size, frame->mouse_delta.x);
+		size += input_write_f32_internal(out + size, frame->mouse_delta.y);
+	}
+	if (flags & INPUT_RECORD_MOUSE_WHEEL)  { size += input_write_f32_internal(out + size, frame->mouse_wheel); }
+	if (flags & INPUT_RECORD_KEYS_DOWN)    { size += input_write_u32_internal(out + size, frame->keys_down); }
+	if (flags & INPUT_RECORD_KEYS_PRESSED) { size += input_write_u32_internal(out + size, frame->keys_pressed); }
+
+	ASSERT(size <= INPUT_RECORD_MAX_SIZE);
+	return size;
+}
+
+/**
+* Decodes the record at *cursor into out and moves the cursor past it. previous is the frame decoded before this one.
+* Returns false at the end of the data or if the record is cut off.
+*/
+bool input_record_decode(const u8* bytes, u64 length, u64* cursor, const InputFrame* previous, InputFrame* out) {
+	u64 at = *cursor;
+	if (at >= length) return false;
+
+	u8 flags = bytes[at++];
+	u64 delta_ns = 0;
+	for (int shift = 0; ; shift += 7) {
+		if (at >= length || shift > 63) return false;
+		u8 byte = bytes[at++];
+		delta_ns |= (u64)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) break;
+	}
+
+	u64 payload = 0;
+	if (flags & INPUT_RECORD_MOUSE_DELTA)  { payload += 8; }
+	if (flags & INPUT_RECORD_MOUSE_WHEEL)  { payload += 4; }
+	if (flags & INPUT_RECORD_KEYS_DOWN)    { payload += 4; }
+	if (flags & INPUT_RECORD_KEYS_PRESSED) { payload += 4; }
+	if (length - at < payload) return false;
+
+	InputFrame frame = {
+		.time_ns = previous->time_ns + delta_ns,
+		.delta_seconds = (f32)((f64)delta_ns / 1e9),
+		.keys_down = previous->keys_down,
+	};
+	if (flags & INPUT_RECORD_MOUSE_DELTA) {
+		frame.mouse_delta.x = input_read_f32_internal(bytes + at); at += 4;
+		frame.mouse_delta.y = input_read_f32_internal(bytes + at); at += 4;
+	}
+	if (flags & INPUT_RECORD_MOUSE_WHEEL)  { frame.mouse_wheel  = input_read_f32_internal(bytes + at); at += 4; }
+	if (flags & INPUT_RECORD_KEYS_DOWN)    { frame.keys_down    = input_read_u32_internal(bytes + at); at += 4; }
+	if (flags & INPUT_RECORD_KEYS_PRESSED) { frame.keys_pressed = input_read_u32_internal(bytes + at); at += 4; }
+
+	*out = frame;
+	*cursor = at;
+	return true;
+}
+
+void input_log_header_internal(u8* header) {
+	for (int i = 0; i < 4; i++) { header[i] = INPUT_LOG_MAGIC[i]; }
+	input_write_u32_internal(header + 4, INPUT_LOG_VERSION);
+}
+
+typedef struct InputRecorder {
+	FILE* file;
+	InputFrame previous;
+	u64 frame_count;
+	u64 byte_count;
+} InputRecorder;
+
+bool input_recorder_open(InputRecorder* recorder, const char* path) {
+	*recorder = (InputRecorder) { .file = fopen(path, "wb") };
+	if (recorder->file == NULL) return false;
+
+	u8 header[INPUT_LOG_HEADER_SIZE];
+	input_log_header_internal(header);
+	recorder->byte_count = fwrite(header, 1, sizeof(header), recorder->file);
+	return true;
+}
+
+void input_recorder_write(InputRecorder* recorder, const InputFrame* frame) {
+	u8 record[INPUT_RECORD_MAX_SIZE];
+	int size = input_record_encode(record, frame, &recorder->previous);
+	recorder->byte_count += fwrite(record, 1, (size_t)size, recorder->file);
+	recorder->previous = *frame;
+	recorder->frame_count++;
+}
+
+void input_recorder_close(InputRecorder* recorder) {
+	if (recorder->file != NULL) { fclose(recorder->file); }
+	recorder->file = NULL;
+}
+
+typedef struct InputReplay {
+	const u8* bytes;
+	u64 length;
+	u64 cursor;
+	InputFrame previous;
+	u64 frame_count;
+} InputReplay;
+
+/* Replays a log that's already in memory, header included. Returns false if it isn't an input log this build can read. */
+bool input_replay_from_bytes(InputReplay* replay, const u8* bytes, u64 length) {
+	*replay = (InputReplay) { .bytes = bytes, .length = length, .cursor = INPUT_LOG_HEADER_SIZE };
+	if (length < INPUT_LOG_HEADER_SIZE) return false;
+
+	u8 header[INPUT_LOG_HEADER_SIZE];
+	input_log_header_internal(header);
+	for (int i = 0; i < INPUT_LOG_HEADER_SIZE; i++) {
+		if (bytes[i] != header[i]) return false;
+	}
+	return true;
+}
+
+/* Loads the whole log into arena */
+bool input_replay_open(InputReplay* replay, Arena* arena, const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return false;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	u8* bytes = arena_alloc(arena, (u64)MAX2(length, 1));
+	bool read = (length > 0) && (fread(bytes, 1, (size_t)length, file) == (size_t)length);
+	fclose(file);
+
+	return read && input_replay_from_bytes(replay, bytes, (u64)length);
+}
+
+/* Returns false once the log runs out */
+bool input_replay_next(InputReplay* replay, InputFrame* out) {
+	if (!input_record_decode(replay->bytes, replay->length, &replay->cursor, &replay->previous, out)) {
+		return false;
+	}
+	replay->previous = *out;
+	replay->frame_count++;
+	return true;
+}
+#endif
@@ -0,0 +1,458 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Work-stealing job system. This is what every parallel part of the engine runs on.
+*
+* Each worker owns a Chase-Lev deque: it pushes and pops jobs at the bottom without locking, while idle workers
+* steal from the top of someone else's. Jobs submitted from a thread that isn't a worker (or from a worker whose deque
+* is full) go into a small locked injection queue that everyone checks.
+*
+* The thread calling job_system_init becomes worker 0. It doesn't loop like the others, it runs jobs whenever it waits
+* on a counter. Waiting always helps, so a job may wait on jobs it submitted without deadlocking the pool.
+*
+* Before job_system_init (and after job_system_shutdown) job_submit just runs the job on the spot.
+* That keeps everything built on top of this usable from tests and tools that never start any threads.
+*/
+
+#define JOB_MAX_WORKERS 64
+
+/* Power of two. Per worker, a full deque spills into the injection queue. */
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_INJECTION_CAPACITY 4096
+
+/* Rounds of failed stealing before an idle worker goes to sleep */
+#define JOB_IDLE_SPIN_COUNT 64
+
+#define JOB_CACHE_LINE 64
+
+typedef void JobProc(void* user_data);
+
+/**
+* Counts unfinished jobs. Zero it, pass it to any number of job_submit calls, then job_counter_wait on it.
+*/
+typedef struct JobCounter {
+	int value;
+} JobCounter;
+
+typedef struct Job {
+	JobProc* proc;
+	void* user_data;
+	JobCounter* counter;
+} Job;
+
+typedef struct JobDeque {
+	/* Thieves take from the top, the owner pushes and pops at the bottom. Kept on separate cache lines. */
+	i64 top;
+	u8 padding_top[JOB_CACHE_LINE - sizeof(i64)];
+	i64 bottom;
+	u8 padding_bottom[JOB_CACHE_LINE - sizeof(i64)];
+
+	Job jobs[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobWorker {
+	JobDeque deque;
+	PlatformThread thread;
+	int index;
+
+	/* Written only by the owning worker */
+	u64 jobs_executed;
+	u64 jobs_stolen;
+} JobWorker;
+
+typedef struct JobSystem {
+	Arena arena;
+	JobWorker* workers;
+	int worker_count;
+
+	u8 injection_lock;
+	int injection_head;
+	int injection_count;
+	Job injection[JOB_INJECTION_CAPACITY];
+
+	PlatformSemaphore wake;
+	int sleeping_workers;
+	bool shutting_down;
+} JobSystem;
+
+global JobSystem job_system = { .arena = { .name = "jobs", .total_reserved_bytes = sizeof(JobWorker) * JOB_MAX_WORKERS } };
+
+thread_global int job_worker_index_internal = -1;
+thread_global u32 job_steal_seed_internal = 0;
+
+/* Index of the calling worker, or -1 if the calling thread isn't one */
+int job_worker_index(void) {
+	return job_worker_index_internal;
+}
+
+/* Workers including the thread that started the system. 1 when the system isn't running. */
+int job_worker_count(void) {
+	return (job_system.worker_count > 0) ? job_system.worker_count : 1;
+}
+
+#ifndef REGION_JOB_DEQUE
+/* Slots are read by thieves while the owner may be writing them, so every field goes through an atomic */
+void job_store_internal(Job* slot, Job job) {
+	__atomic_store_n(&slot->proc, job.proc, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->user_data, job.user_data, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->counter, job.counter, __ATOMIC_RELAXED);
+}
+
+Job job_load_internal(Job* slot) {
+	return (Job) {
+		.proc      = __atomic_load_n(&slot->proc, __ATOMIC_RELAXED),
+		.user_data = __atomic_load_n(&slot->user_data, __ATOMIC_RELAXED),
+		.counter   = __atomic_load_n(&slot->counter, __ATOMIC_RELAXED),
+	};
+}
+
+/* Owner only. Returns false if the deque is full. */
+bool job_deque_push(JobDeque* deque, Job job) {
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	if (bottom - top >= JOB_DEQUE_CAPACITY) {
+		return false;
+	}
+
+	job_store_internal(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)], job);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/* Owner only. Takes the most recently pushed job. */
+bool job_deque_pop(JobDeque* deque, Job* out_job) {
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if (top > bottom) {
+		/* Empty */
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	*out_job = job_load_internal(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)]);
+	if (top == bottom) {
+		/* Last job, race the thieves for it */
+		bool won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return won;
+	}
+	return true;
+}
+
+/* Any thread. Takes the oldest job. Fails spuriously when another thread wins the race for it. */
+bool job_deque_steal(JobDeque* deque, Job* out_job) {
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+	if (top >= bottom) {
+		return false;
+	}
+
+	Job job = job_load_internal(&deque->jobs[top & (JOB_DEQUE_CAPACITY - 1)]);
+	if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		return false;
+	}
+	*out_job = job;
+	return true;
+}
+#endif
+
+#ifndef REGION_JOB_INJECTION_QUEUE
+void job_injection_lock_internal(void) {
+	while (__atomic_test_and_set(&job_system.injection_lock, __ATOMIC_ACQUIRE)) {}
+}
+
+void job_injection_unlock_internal(void) {
+	__atomic_clear(&job_system.injection_lock, __ATOMIC_RELEASE);
+}
+
+bool job_injection_push_internal(Job job) {
+	bool pushed = false;
+	job_injection_lock_internal();
+		if (job_system.injection_count < JOB_INJECTION_CAPACITY) {
+			int slot = (job_system.injection_head + job_system.injection_count) % JOB_INJECTION_CAPACITY;
+			job_system.injection[slot] = job;
+			__atomic_store_n(&job_system.injection_count, job_system.injection_count + 1, __ATOMIC_RELAXED);
+			pushed = true;
+		}
+	job_injection_unlock_internal();
+	return pushed;
+}
+
+bool job_injection_pop_internal(Job* out_job) {
+	/* Cheap check first so idle workers don't all hammer the lock */
+	if (__atomic_load_n(&job_system.injection_count, __ATOMIC_RELAXED) == 0) {
+		return false;
+	}
+
+	bool popped = false;
+	job_injection_lock_internal();
+		if (job_system.injection_count > 0) {
+			*out_job = job_system.injection[job_system.injection_head];
+			job_system.injection_head = (job_system.injection_head + 1) % JOB_INJECTION_CAPACITY;
+			__atomic_store_n(&job_system.injection_count, job_system.injection_count - 1, __ATOMIC_RELAXED);
+			popped = true;
+		}
+	job_injection_unlock_internal();
+	return popped;
+}
+#endif
+
+void job_run_internal(Job job) {
+	job.proc(job.user_data);
+	if (job.counter != NULL) {
+		__atomic_sub_fetch(&job.counter->value, 1, __ATOMIC_ACQ_REL);
+	}
+}
+
+/**
+* Runs one pending job if there is any: the caller's own newest job first, then the injection queue,
+* then the oldest job of some other worker. Returns false if nothing was found.
+*/
+bool job_try_run_one(void) {
+	int self = job_worker_index();
+	Job job;
+
+	if (self >= 0 && job_deque_pop(&job_system.workers[self].deque, &job)) {
+		job_run_internal(job);
+		job_system.workers[self].jobs_executed++;
+		return true;
+	}
+
+	if (job_injection_pop_internal(&job)) {
+		job_run_internal(job);
+		if (self >= 0) { job_system.workers[self].jobs_executed++; }
+		return true;
+	}
+
+	int count = job_system.worker_count;
+	if (count <= 1) {
+		return false;
+	}
+
+	/* xorshift32, so thieves spread out instead of all going for worker 0 */
+	u32 seed = job_steal_seed_internal;
+	if (seed == 0) { seed = 0x9E3779B9u ^ (u32)(self + 2); }
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	job_steal_seed_internal = seed;
+
+	for (int i = 0; i < count; i++) {
+		int victim = (int)((seed + (u32)i) % (u32)count);
+		if (victim == self) continue;
+
+		if (job_deque_steal(&job_system.workers[victim].deque, &job)) {
+			job_run_internal(job);
+			if (self >= 0) {
+				job_system.workers[self].jobs_executed++;
+				job_system.workers[self].jobs_stolen++;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool job_work_available_internal(void) {
+	if (__atomic_load_n(&job_system.injection_count, __ATOMIC_RELAXED) > 0) {
+		return true;
+	}
+	for (int i = 0; i < job_system.worker_count; i++) {
+		JobDeque* deque = &job_system.workers[i].deque;
+		if (__atomic_load_n(&deque->top, __ATOMIC_ACQUIRE) < __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void job_wake_one_internal(void) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int sleeping = __atomic_load_n(&job_system.sleeping_workers, __ATOMIC_RELAXED);
+	while (sleeping > 0) {
+		if (__atomic_compare_exchange_n(&job_system.sleeping_workers, &sleeping, sleeping - 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			platform_dependent_semaphore_post(&job_system.wake, 1);
+			return;
+		}
+	}
+}
+
+/* Queues a job. If counter is not NULL it is incremented now and decremented once the job has run. */
+void job_submit(JobProc* proc, void* user_data, JobCounter* counter) {
+	Job job = { .proc = proc, .user_data = user_data, .counter = counter };
+	if (counter != NULL) {
+		__atomic_add_fetch(&counter->value, 1, __ATOMIC_ACQ_REL);
+	}
+
+	if (job_system.worker_count == 0) {
+		job_run_internal(job);
+		return;
+	}
+
+	int self = job_worker_index();
+	bool queued = (self >= 0) && job_deque_push(&job_system.workers[self].deque, job);
+	if (!queued) {
+		queued = job_injection_push_internal(job);
+	}
+	if (!queued) {
+		/* Everything is backed up, doing it now is the best we can do */
+		job_run_internal(job);
+		return;
+	}
+
+	job_wake_one_internal();
+}
+
+/* Runs other jobs until every job submitted with this counter has finished */
+void job_counter_wait(JobCounter* counter) {
+	while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > 0) {
+		if (!job_try_run_one()) {
+			platform_dependent_thread_yield();
+		}
+	}
+}
+
+void job_worker_internal(void* user_data) {
+	JobWorker* worker = user_data;
+	job_worker_index_internal = worker->index;
+
+	while (!__atomic_load_n(&job_system.shutting_down, __ATOMIC_ACQUIRE)) {
+		if (job_try_run_one()) continue;
+
+		bool found = false;
+		for (int spin = 0; spin < JOB_IDLE_SPIN_COUNT && !found; spin++) {
+			platform_dependent_thread_yield();
+			found = job_try_run_one();
+		}
+		if (found) continue;
+
+		/* Announce the sleep before the last check, so a submit in between either is seen here or wakes us */
+		__atomic_add_fetch(&job_system.sleeping_workers, 1, __ATOMIC_SEQ_CST);
+		if (job_work_available_internal() || __atomic_load_n(&job_system.shutting_down, __ATOMIC_ACQUIRE)) {
+			int sleeping = __atomic_load_n(&job_system.sleeping_workers, __ATOMIC_RELAXED);
+			while (sleeping > 0 && !__atomic_compare_exchange_n(&job_system.sleeping_workers, &sleeping, sleeping - 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {}
+			continue;
+		}
+		platform_dependent_semaphore_wait(&job_system.wake);
+	}
+
+	job_worker_index_internal = -1;
+	scratch_thread_release();
+}
+
+/**
+* Starts the workers. worker_count includes the calling thread, which becomes worker 0.
+* Zero picks one worker per logical core.
+*/
+void job_system_init(int worker_count) {
+	ASSERT(job_system.worker_count == 0);
+	if (worker_count <= 0) {
+		worker_count = platform_dependent_cpu_count();
+	}
+	worker_count = MIN2(worker_count, JOB_MAX_WORKERS);
+
+	job_system.workers = arena_alloc(&job_system.arena, sizeof(*job_system.workers) * worker_count);
+	job_system.injection_head = 0;
+	job_system.injection_count = 0;
+	job_system.sleeping_workers = 0;
+	job_system.shutting_down = false;
+	platform_dependent_semaphore_init(&job_system.wake, 0);
+
+	for (int i = 0; i < worker_count; i++) {
+		job_system.workers[i] = (JobWorker) { .index = i };
+	}
+	job_worker_index_internal = 0;
+
+	/* Workers read worker_count while stealing, so it has to be final before the first one starts */
+	job_system.worker_count = worker_count;
+	for (int i = 1; i < worker_count; i++) {
+		if (!platform_dependent_thread_create(&job_system.workers[i].thread, job_worker_internal, &job_system.workers[i])) {
+			/* Nothing can be queued yet, so shrinking is safe. Run with the workers that did start. */
+			__atomic_store_n(&job_system.worker_count, i, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+}
+
+/* Finishes whatever is queued, then stops and joins the workers */
+void job_system_shutdown(void) {
+	if (job_system.worker_count == 0) return;
+
+	while (job_try_run_one()) {}
+
+	__atomic_store_n(&job_system.shutting_down, true, __ATOMIC_RELEASE);
+	platform_dependent_semaphore_post(&job_system.wake, job_system.worker_count);
+	for (int i = 1; i < job_system.worker_count; i++) {
+		platform_dependent_thread_join(&job_system.workers[i].thread);
+	}
+
+	platform_dependent_semaphore_destroy(&job_system.wake);
+	arena_free(&job_system.arena);
+	job_system.workers = NULL;
+	job_system.worker_count = 0;
+	job_worker_index_internal = -1;
+}
+
+#ifndef REGION_PARALLEL_FOR
+/* Called with consecutive index ranges [start, end), each at most grain_size long */
+typedef void ParallelForProc(void* user_data, int start, int end);
+
+typedef struct ParallelForRange {
+	ParallelForProc* proc;
+	void* user_data;
+	int end;
+	int grain_size;
+	int next;
+} ParallelForRange;
+
+void parallel_for_chunks_internal(void* user_data) {
+	ParallelForRange* range = user_data;
+	for (;;) {
+		int start = __atomic_fetch_add(&range->next, range->grain_size, __ATOMIC_RELAXED);
+		if (start >= range->end) return;
+		range->proc(range->user_data, start, MIN2(start + range->grain_size, range->end));
+	}
+}
+
+/**
+* Calls proc over [start, end) split into chunks of grain_size indices, spread over the workers.
+* Returns once every chunk is done.
+*
+* Chunks are handed out from a shared counter rather than as one job each, so a small grain size balances uneven
+* work without flooding the deques. Pick a grain big enough that one chunk is worth a few microseconds.
+*/
+void parallel_for_range(int start, int end, int grain_size, ParallelForProc* proc, void* user_data) {
+	if (end <= start) return;
+	if (grain_size <= 0) grain_size = 1;
+
+	ParallelForRange range = {
+		.proc = proc,
+		.user_data = user_data,
+		.end = end,
+		.grain_size = grain_size,
+		.next = start,
+	};
+
+	int chunk_count = (end - start + grain_size - 1) / grain_size;
+	int helper_count = MIN2(chunk_count, job_worker_count()) - 1;
+
+	JobCounter counter = {0};
+	for (int i = 0; i < helper_count; i++) {
+		job_submit(parallel_for_chunks_internal, &range, &counter);
+	}
+	parallel_for_chunks_internal(&range);
+	job_counter_wait(&counter);
+}
+/* parallel_for_range over [0, count) */
+void parallel_for(int count, int grain_size, ParallelForProc* proc, void* user_data) {
+	parallel_for_range(0, count, grain_size, proc, user_data);
+}
+#endif
@@ -1,5 +1,5 @@
 #include "afterhours.c"
 
-int main(void) {
-    afterhours_main();
+int main(int argc, char** argv) {
+    return afterhours_main(afterhours_parse_args(argc, argv));
 }
\ No newline at end of file
@@ -63,7 +63,7 @@ Vector3 math_triplane_line_intersection(
 
 	f32 denom = (nx * a) + (ny * b) + (nz * c);
 
-	/* denom = 0 means paralell to triangle. */
+	/* denom = 0 means parallel to triangle. */
 	if (math_f32_abs(denom) >= EPSILON) {
 		float px = tri_point_1.x - line_0.x;
 		float py = tri_point_1.y - line_0.y;
@@ -72,8 +72,8 @@ Vector3 math_triplane_line_intersection(
 		float t = (nx * px + ny * py + nz * pz) / denom;
 
 		return_vec.x = line_0.x + (a * t);
-		return_vec.y = line_0.y + (a * t);
-		return_vec.z = line_0.z + (a * t);
+		return_vec.y = line_0.y + (b * t);
+		return_vec.z = line_0.z + (c * t);
 	}
 
 	return return_vec;
@@ -131,6 +131,321 @@ Vector3 math_line_triangle_intersection(
 	}
 }
 
+/**
+ * Returns the distance t along the ray (origin + t * direction) at which it hits the given triangle.
+ * Both faces count as hits.
+ *
+ * Returns INFINITY if the ray misses, runs parallel to the triangle, or the hit is behind the origin.
+ * The direction does not need to be normalized, but t is then measured in multiples of it.
+ */
+f32 math_ray_triangle_distance(
+	Vector3 tri_point_1,
+	Vector3 tri_point_2,
+	Vector3 tri_point_3,
+
+	Vector3 origin,
+	Vector3 direction
+) {
+	/* Moller-Trumbore. Avoids computing the plane intersection point before the inside test. */
+	float e1x = tri_point_2.x - tri_point_1.x;
+	float e1y = tri_point_2.y - tri_point_1.y;
+	float e1z = tri_point_2.z - tri_point_1.z;
+
+	float e2x = tri_point_3.x - tri_point_1.x;
+	float e2y = tri_point_3.y - tri_point_1.y;
+	float e2z = tri_point_3.z - tri_point_1.z;
+
+	/* p = direction x e2 */
+	float px = direction.y * e2z - direction.z * e2y;
+	float py = direction.z * e2x - direction.x * e2z;
+	float pz = direction.x * e2y - direction.y * e2x;
+
+	float det = (e1x * px) + (e1y * py) + (e1z * pz);
+	if (math_f32_abs(det) < EPSILON * EPSILON) { return INFINITY; }
+
+	float inv_det = 1.0f / det;
+
+	float sx = origin.x - tri_point_1.x;
+	float sy = origin.y - tri_point_1.y;
+	float sz = origin.z - tri_point_1.z;
+
+	float u = ((sx * px) + (sy * py) + (sz * pz)) * inv_det;
+	if (u < 0.0f || u > 1.0f) { return INFINITY; }
+
+	/* q = s x e1 */
+	float qx = sy * e1z - sz * e1y;
+	float qy = sz * e1x - sx * e1z;
+	float qz = sx * e1y - sy * e1x;
+
+	float v = ((direction.x * qx) + (direction.y * qy) + (direction.z * qz)) * inv_det;
+	if (v < 0.0f || u + v > 1.0f) { return INFINITY; }
+
+	float t = ((e2x * qx) + (e2y * qy) + (e2z * qz)) * inv_det;
+	return (t >= 0.0f) ? t : INFINITY;
+}
+
+/* Ericson, Real-Time Collision Detection 5.1.5. Works out which of the seven regions (face, edges, vertices) point is in. */
+Vector3 math_closest_point_triangle(Vector3 point, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3) {
+	Vector3 ab = Vector3Subtract(tri_point_2, tri_point_1);
+	Vector3 ac = Vector3Subtract(tri_point_3, tri_point_1);
+
+	Vector3 ap = Vector3Subtract(point, tri_point_1);
+	f32 d1 = Vector3DotProduct(ab, ap);
+	f32 d2 = Vector3DotProduct(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) { return tri_point_1; }
+
+	Vector3 bp = Vector3Subtract(point, tri_point_2);
+	f32 d3 = Vector3DotProduct(ab, bp);
+	f32 d4 = Vector3DotProduct(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) { return tri_point_2; }
+
+	f32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return Vector3Add(tri_point_1, Vector3Scale(ab, d1 / (d1 - d3)));
+	}
+
+	Vector3 cp = Vector3Subtract(point, tri_point_3);
+	f32 d5 = Vector3DotProduct(ab, cp);
+	f32 d6 = Vector3DotProduct(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) { return tri_point_3; }
+
+	f32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return Vector3Add(tri_point_1, Vector3Scale(ac, d2 / (d2 - d6)));
+	}
+
+	f32 va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		f32 w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return Vector3Add(tri_point_2, Vector3Scale(Vector3Subtract(tri_point_3, tri_point_2), w));
+	}
+
+	/* Inside the face, degenerate triangles never get here */
+	f32 denominator = 1.0f / (va + vb + vc);
+	return Vector3Add(tri_point_1, Vector3Add(Vector3Scale(ab, vb * denominator), Vector3Scale(ac, vc * denominator)));
+}
+
+/* Ericson 5.1.9. Closest points of the two lines, clamped to the segments one after the other. */
+void math_closest_points_segments(Vector3 a_start, Vector3 a_end, Vector3 b_start, Vector3 b_end, Vector3* out_a, Vector3* out_b) {
+	Vector3 d1 = Vector3Subtract(a_end, a_start);
+	Vector3 d2 = Vector3Subtract(b_end, b_start);
+	Vector3 r = Vector3Subtract(a_start, b_start);
+	f32 a = Vector3DotProduct(d1, d1);
+	f32 e = Vector3DotProduct(d2, d2);
+	f32 f = Vector3DotProduct(d2, r);
+
+	f32 s = 0.0f;
+	f32 t = 0.0f;
+	if (a <= EPSILON * EPSILON && e <= EPSILON * EPSILON) {
+		/* Both are points */
+	} else if (a <= EPSILON * EPSILON) {
+		t = Clamp(f / e, 0.0f, 1.0f);
+	} else {
+		f32 c = Vector3DotProduct(d1, r);
+		if (e <= EPSILON * EPSILON) {
+			s = Clamp(-c / a, 0.0f, 1.0f);
+		} else {
+			f32 b = Vector3DotProduct(d1, d2);
+			f32 denominator = a * e - b * b;
+
+			/* Parallel segments have a whole range of closest points, any of them will do */
+			s = (denominator != 0.0f) ? Clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+
+			if (t < 0.0f) {
+				t = 0.0f;
+				s = Clamp(-c / a, 0.0f, 1.0f);
+			} else if (t > 1.0f) {
+				t = 1.0f;
+				s = Clamp((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	*out_a = Vector3Add(a_start, Vector3Scale(d1, s));
+	*out_b = Vector3Add(b_start, Vector3Scale(d2, t));
+}
+
+/* Whether point, already on the plane of the triangle, is inside it. normal is the cross product of the edges, any length. */
+bool math_point_in_triangle_internal(Vector3 point, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3, Vector3 normal) {
+	Vector3 edge_1 = Vector3CrossProduct(Vector3Subtract(tri_point_2, tri_point_1), Vector3Subtract(point, tri_point_1));
+	Vector3 edge_2 = Vector3CrossProduct(Vector3Subtract(tri_point_3, tri_point_2), Vector3Subtract(point, tri_point_2));
+	Vector3 edge_3 = Vector3CrossProduct(Vector3Subtract(tri_point_1, tri_point_3), Vector3Subtract(point, tri_point_3));
+	return Vector3DotProduct(edge_1, normal) >= 0.0f && Vector3DotProduct(edge_2, normal) >= 0.0f && Vector3DotProduct(edge_3, normal) >= 0.0f;
+}
+
+/**
+ * Unless the segment goes through the triangle, the closest points are an end of the segment and the face, or the
+ * segment and one of the edges. Trying all of them and keeping the closest pair covers every case.
+ */
+void math_closest_points_segment_triangle(
+	Vector3 start,
+	Vector3 end,
+	Vector3 tri_point_1,
+	Vector3 tri_point_2,
+	Vector3 tri_point_3,
+
+	Vector3* out_segment_point,
+	Vector3* out_triangle_point
+) {
+	Vector3 normal = Vector3CrossProduct(Vector3Subtract(tri_point_2, tri_point_1), Vector3Subtract(tri_point_3, tri_point_1));
+	f32 start_distance = Vector3DotProduct(Vector3Subtract(start, tri_point_1), normal);
+	f32 end_distance = Vector3DotProduct(Vector3Subtract(end, tri_point_1), normal);
+
+	if ((start_distance > 0.0f) != (end_distance > 0.0f) && start_distance != end_distance) {
+		Vector3 crossing = Vector3Lerp(start, end, start_distance / (start_distance - end_distance));
+		if (math_point_in_triangle_internal(crossing, tri_point_1, tri_point_2, tri_point_3, normal)) {
+			*out_segment_point = crossing;
+			*out_triangle_point = crossing;
+			return;
+		}
+	}
+
+	*out_segment_point = start;
+	*out_triangle_point = math_closest_point_triangle(start, tri_point_1, tri_point_2, tri_point_3);
+	f32 best = Vector3DistanceSqr(*out_segment_point, *out_triangle_point);
+
+	Vector3 end_point = math_closest_point_triangle(end, tri_point_1, tri_point_2, tri_point_3);
+	f32 distance = Vector3DistanceSqr(end, end_point);
+	if (distance < best) {
+		best = distance;
+		*out_segment_point = end;
+		*out_triangle_point = end_point;
+	}
+
+	Vector3 edges[4] = { tri_point_1, tri_point_2, tri_point_3, tri_point_1 };
+	for (int i = 0; i < 3; i++) {
+		Vector3 segment_point; Vector3 edge_point;
+		math_closest_points_segments(start, end, edges[i], edges[i + 1], &segment_point, &edge_point);
+		distance = Vector3DistanceSqr(segment_point, edge_point);
+		if (distance < best) {
+			best = distance;
+			*out_segment_point = segment_point;
+			*out_triangle_point = edge_point;
+		}
+	}
+}
+
+/* Whether axis separates the triangle a, b, c from a box centered on the origin with half size extents */
+bool math_separating_axis_internal(Vector3 axis, Vector3 a, Vector3 b, Vector3 c, Vector3 extents) {
+	f32 p_a = Vector3DotProduct(axis, a);
+	f32 p_b = Vector3DotProduct(axis, b);
+	f32 p_c = Vector3DotProduct(axis, c);
+	f32 radius = (extents.x * math_f32_abs(axis.x)) + (extents.y * math_f32_abs(axis.y)) + (extents.z * math_f32_abs(axis.z));
+	return MIN3(p_a, p_b, p_c) > radius || MAX3(p_a, p_b, p_c) < -radius;
+}
+
+/**
+ * Moves the box to the origin and tries the 13 axes that can separate a triangle from it: the box's 3 axes, the
+ * triangle's normal, and the cross products of the box's axes with the triangle's edges.
+ */
+bool math_triangle_aabb_overlap(Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3, BoundingBox box) {
+	Vector3 center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+	Vector3 extents = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+	Vector3 a = Vector3Subtract(tri_point_1, center);
+	Vector3 b = Vector3Subtract(tri_point_2, center);
+	Vector3 c = Vector3Subtract(tri_point_3, center);
+
+	if (MIN3(a.x, b.x, c.x) > extents.x || MAX3(a.x, b.x, c.x) < -extents.x) { return false; }
+	if (MIN3(a.y, b.y, c.y) > extents.y || MAX3(a.y, b.y, c.y) < -extents.y) { return false; }
+	if (MIN3(a.z, b.z, c.z) > extents.z || MAX3(a.z, b.z, c.z) < -extents.z) { return false; }
+
+	Vector3 edges[3] = { Vector3Subtract(b, a), Vector3Subtract(c, b), Vector3Subtract(a, c) };
+	if (math_separating_axis_internal(Vector3CrossProduct(edges[0], edges[1]), a, b, c, extents)) { return false; }
+
+	Vector3 box_axes[3] = { VECTOR3_RIGHT, VECTOR3_UP, VECTOR3_FORWARD };
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			if (math_separating_axis_internal(Vector3CrossProduct(box_axes[i], edges[j]), a, b, c, extents)) { return false; }
+		}
+	}
+	return true;
+}
+
+/**
+ * Gribb and Hartmann. A point is inside when -w <= x, y, z <= w in clip space, and each of those is a plane made of
+ * the matrix's last row plus or minus one of the others.
+ */
+Frustum math_frustum_from_matrix(Matrix m) {
+	Vector4 rows[4] = {
+		{ m.m0, m.m4, m.m8, m.m12 },
+		{ m.m1, m.m5, m.m9, m.m13 },
+		{ m.m2, m.m6, m.m10, m.m14 },
+		{ m.m3, m.m7, m.m11, m.m15 },
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; i++) {
+		Vector4 row = rows[i / 2];
+		f32 sign = (i % 2 == 0) ? 1.0f : -1.0f;
+		Vector4 plane = {
+			rows[3].x + (sign * row.x),
+			rows[3].y + (sign * row.y),
+			rows[3].z + (sign * row.z),
+			rows[3].w + (sign * row.w),
+		};
+		f32 length = Vector3Length((Vector3) { plane.x, plane.y, plane.z });
+		frustum.planes[i] = (Vector4) { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+	}
+	return frustum;
+}
+
+/* Where three planes meet */
+Vector3 math_planes_intersection_internal(Vector4 a, Vector4 b, Vector4 c) {
+	Vector3 normal_a = { a.x, a.y, a.z };
+	Vector3 normal_b = { b.x, b.y, b.z };
+	Vector3 normal_c = { c.x, c.y, c.z };
+	Vector3 b_cross_c = Vector3CrossProduct(normal_b, normal_c);
+
+	Vector3 sum = Vector3Add(Vector3Add(
+		Vector3Scale(b_cross_c, -a.w),
+		Vector3Scale(Vector3CrossProduct(normal_c, normal_a), -b.w)),
+		Vector3Scale(Vector3CrossProduct(normal_a, normal_b), -c.w)
+	);
+	return Vector3Scale(sum, 1.0f / Vector3DotProduct(normal_a, b_cross_c));
+}
+
+BoundingBox math_frustum_bounds(const Frustum* frustum) {
+	BoundingBox bounds = math_aabb_empty();
+	for (int corner = 0; corner < 8; corner++) {
+		Vector3 point = math_planes_intersection_internal(
+			frustum->planes[0 + (corner & 1)],
+			frustum->planes[2 + ((corner >> 1) & 1)],
+			frustum->planes[4 + ((corner >> 2) & 1)]
+		);
+		bounds.min = Vector3Min(bounds.min, point);
+		bounds.max = Vector3Max(bounds.max, point);
+	}
+	return bounds;
+}
+
+/* Only the corner furthest along each plane's normal has to be inside it */
+bool math_frustum_aabb_overlap(const Frustum* frustum, BoundingBox box) {
+	for (int i = 0; i < 6; i++) {
+		Vector4 plane = frustum->planes[i];
+		Vector3 furthest = {
+			(plane.x >= 0.0f) ? box.max.x : box.min.x,
+			(plane.y >= 0.0f) ? box.max.y : box.min.y,
+			(plane.z >= 0.0f) ? box.max.z : box.min.z,
+		};
+		if ((plane.x * furthest.x) + (plane.y * furthest.y) + (plane.z * furthest.z) + plane.w < 0.0f) { return false; }
+	}
+	return true;
+}
+
+bool math_frustum_triangle_overlap(const Frustum* frustum, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3) {
+	for (int i = 0; i < 6; i++) {
+		Vector4 plane = frustum->planes[i];
+		Vector3 normal = { plane.x, plane.y, plane.z };
+		if (Vector3DotProduct(normal, tri_point_1) + plane.w < 0.0f &&
+			Vector3DotProduct(normal, tri_point_2) + plane.w < 0.0f &&
+			Vector3DotProduct(normal, tri_point_3) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
 Matrix math_transform_to_matrix(Transform transform) {
 	/* Extract rotation basis */
 	Vector3 x = Vector3RotateByQuaternion(VECTOR3_RIGHT, transform.rotation);
@@ -151,3 +466,897 @@ Matrix math_transform_to_matrix(Transform transform) {
 		0.0f, 0.0f, 0.0f, 1.0f
 	};
 }
+
+Transform math_transform_lerp(Transform a, Transform b, f32 t) {
+	return (Transform){
+		.translation = Vector3Lerp(a.translation, b.translation, t),
+		.rotation    = QuaternionSlerp(a.rotation, b.rotation, t),
+		.scale       = Vector3Lerp(a.scale, b.scale, t),
+	};
+}
+
+#ifndef REGION_BATCH_MATH
+#if defined(MATH_SIMD_AVX)
+	#include <immintrin.h>
+#elif defined(MATH_SIMD_SSE)
+	#include <emmintrin.h>
+#endif
+
+void math_batch_transform_points_scalar(Vector3* out, const Vector3* points, int count, Matrix matrix) {
+	for (int i = 0; i < count; i++) {
+		Vector3 p = points[i];
+		out[i] = (Vector3) {
+			matrix.m0 * p.x + matrix.m4 * p.y + matrix.m8 * p.z + matrix.m12,
+			matrix.m1 * p.x + matrix.m5 * p.y + matrix.m9 * p.z + matrix.m13,
+			matrix.m2 * p.x + matrix.m6 * p.y + matrix.m10 * p.z + matrix.m14,
+		};
+	}
+}
+
+BoundingBox math_aabb_empty(void) {
+	return (BoundingBox) { VECTOR3_INFINITY, { -INFINITY, -INFINITY, -INFINITY } };
+}
+
+BoundingBox math_aabb_merge(BoundingBox a, BoundingBox b) {
+	return (BoundingBox) {
+		{ MIN2(a.min.x, b.min.x), MIN2(a.min.y, b.min.y), MIN2(a.min.z, b.min.z) },
+		{ MAX2(a.max.x, b.max.x), MAX2(a.max.y, b.max.y), MAX2(a.max.z, b.max.z) },
+	};
+}
+
+BoundingBox math_batch_transform_triangles_scalar(Vector3* out, int out_stride, const Vector3* triangles, int triangle_count, Matrix matrix) {
+	BoundingBox box = math_aabb_empty();
+	u8* out_bytes = (u8*)out;
+	for (int i = 0; i < triangle_count; i++) {
+		Vector3* result = (Vector3*)(out_bytes + (u64)i * (u64)out_stride);
+		math_batch_transform_points_scalar(result, triangles + 3 * i, 3, matrix);
+		box = math_aabb_merge(box, math_batch_aabb_scalar(result, 3));
+	}
+	return box;
+}
+
+void math_batch_quaternion_multiply_scalar(Quaternion* out, const Quaternion* a, const Quaternion* b, int count) {
+	for (int i = 0; i < count; i++) {
+		Quaternion q1 = a[i];
+		Quaternion q2 = b[i];
+		out[i] = (Quaternion) {
+			q1.x * q2.w + q1.w * q2.x + q1.y * q2.z - q1.z * q2.y,
+			q1.y * q2.w + q1.w * q2.y + q1.z * q2.x - q1.x * q2.z,
+			q1.z * q2.w + q1.w * q2.z + q1.x * q2.y - q1.y * q2.x,
+			q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z,
+		};
+	}
+}
+
+BoundingBox math_batch_aabb_scalar(const Vector3* points, int count) {
+	BoundingBox box = math_aabb_empty();
+	for (int i = 0; i < count; i++) {
+		Vector3 p = points[i];
+		box.min = (Vector3) { MIN2(box.min.x, p.x), MIN2(box.min.y, p.y), MIN2(box.min.z, p.z) };
+		box.max = (Vector3) { MAX2(box.max.x, p.x), MAX2(box.max.y, p.y), MAX2(box.max.z, p.z) };
+	}
+	return box;
+}
+
+BoundingBox math_batch_aabb_triangles_scalar(const Vector3* triangles, int stride, int triangle_count) {
+	BoundingBox box = math_aabb_empty();
+	const u8* bytes = (const u8*)triangles;
+	for (int i = 0; i < triangle_count; i++) {
+		box = math_aabb_merge(box, math_batch_aabb_scalar((const Vector3*)(bytes + (u64)i * (u64)stride), 3));
+	}
+	return box;
+}
+
+void math_batch_dot_scalar(f32* out, const Vector3* a, const Vector3* b, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i] = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z;
+	}
+}
+
+void math_batch_cross_scalar(Vector3* out, const Vector3* a, const Vector3* b, int count) {
+	for (int i = 0; i < count; i++) {
+		Vector3 u = a[i];
+		Vector3 v = b[i];
+		out[i] = (Vector3) { u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x };
+	}
+}
+
+/**
+ * Seen from above, each vertex is weighted by the signed area of the triangle the point makes with the other two.
+ * The point is inside when all three weights have the same sign, and the weights interpolate the height.
+ */
+void math_batch_vertical_line_triangles_scalar(f32* out_heights, f32 x, f32 z, const Vector3* const* triangles, int count) {
+	for (int i = 0; i < count; i++) {
+		Vector3 v1 = triangles[i][0];
+		Vector3 v2 = triangles[i][1];
+		Vector3 v3 = triangles[i][2];
+
+		f32 x1 = v1.x - x; f32 z1 = v1.z - z;
+		f32 x2 = v2.x - x; f32 z2 = v2.z - z;
+		f32 x3 = v3.x - x; f32 z3 = v3.z - z;
+
+		f32 weight_1 = (x2 * z3) - (z2 * x3);
+		f32 weight_2 = (x3 * z1) - (z3 * x1);
+		f32 weight_3 = (x1 * z2) - (z1 * x2);
+		f32 area = weight_1 + weight_2 + weight_3;
+
+		bool is_inside = (weight_1 >= 0.0f && weight_2 >= 0.0f && weight_3 >= 0.0f) || (weight_1 <= 0.0f && weight_2 <= 0.0f && weight_3 <= 0.0f);
+		out_heights[i] = (is_inside && area != 0.0f)
+			? ((weight_1 * v1.y) + (weight_2 * v2.y) + (weight_3 * v3.y)) / area
+			: -INFINITY;
+	}
+}
+
+/* Below this a sweep is taken as not moving, relative to the speed squared */
+#define MATH_SWEEP_EPSILON 1e-12f
+
+/* Edges closer to parallel than this (sine of the angle, squared) are left to the tests of their ends */
+#define MATH_SWEEP_PARALLEL 1e-6f
+
+/**
+ * The first t in [0, 1] where |f + t * motion| reaches radius coming from outside, for a = dot(motion, motion),
+ * b = dot(f, motion) and c = dot(f, f) - radius^2. 0 if it starts inside and keeps going in, INFINITY otherwise.
+ */
+f32 math_sweep_quadratic_internal(f32 a, f32 b, f32 c) {
+	if (b >= 0.0f || a <= MATH_SWEEP_EPSILON) { return INFINITY; }
+	if (c <= 0.0f) { return 0.0f; }
+
+	f32 discriminant = b * b - a * c;
+	if (discriminant < 0.0f) { return INFINITY; }
+
+	f32 t = (-b - sqrtf(discriminant)) / a;
+	return (t <= 1.0f) ? t : INFINITY;
+}
+
+/* A point moving from point along motion against a sphere */
+f32 math_sweep_point_sphere_internal(Vector3 point, Vector3 motion, Vector3 center, f32 radius) {
+	Vector3 f = Vector3Subtract(point, center);
+	return math_sweep_quadratic_internal(Vector3DotProduct(motion, motion), Vector3DotProduct(f, motion), Vector3DotProduct(f, f) - radius * radius);
+}
+
+/* A point moving from point along motion against the cylinder around the segment from base to base + axis, without its caps */
+f32 math_sweep_point_cylinder_internal(Vector3 point, Vector3 motion, Vector3 base, Vector3 axis, f32 radius) {
+	f32 axis_length_squared = Vector3DotProduct(axis, axis);
+	if (axis_length_squared <= MATH_SWEEP_EPSILON) { return INFINITY; }
+
+	/* The same quadratic as the sphere, with everything along the axis taken out */
+	Vector3 f = Vector3Subtract(point, base);
+	f32 f_along = Vector3DotProduct(f, axis);
+	f32 motion_along = Vector3DotProduct(motion, axis);
+	f32 a = Vector3DotProduct(motion, motion) - motion_along * motion_along / axis_length_squared;
+	f32 b = Vector3DotProduct(f, motion) - f_along * motion_along / axis_length_squared;
+	f32 c = Vector3DotProduct(f, f) - f_along * f_along / axis_length_squared - radius * radius;
+
+	f32 t = math_sweep_quadratic_internal(a, b, c);
+	f32 s = (f_along + t * motion_along) / axis_length_squared;
+	return (s >= 0.0f && s <= 1.0f) ? t : INFINITY;
+}
+
+/* A point moving from point along motion until it's radius away from the face of a triangle, above its inside */
+f32 math_sweep_point_face_internal(Vector3 point, Vector3 motion, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3, Vector3 normal, f32 radius) {
+	f32 normal_length_squared = Vector3DotProduct(normal, normal);
+	if (normal_length_squared <= MATH_SWEEP_EPSILON) { return INFINITY; }
+
+	f32 inverse_length = 1.0f / sqrtf(normal_length_squared);
+	f32 distance = Vector3DotProduct(Vector3Subtract(point, tri_point_1), normal) * inverse_length;
+	f32 speed = Vector3DotProduct(motion, normal) * inverse_length;
+	if (distance < 0.0f) {
+		distance = -distance;
+		speed = -speed;
+	}
+	if (speed >= 0.0f) { return INFINITY; }
+
+	f32 t = MAX2((distance - radius) / -speed, 0.0f);
+	if (t > 1.0f) { return INFINITY; }
+
+	Vector3 contact = Vector3Add(point, Vector3Scale(motion, t));
+	return math_point_in_triangle_internal(contact, tri_point_1, tri_point_2, tri_point_3, normal) ? t : INFINITY;
+}
+
+/**
+ * A segment from start along direction, moving along motion, until it's radius away from a triangle edge from base
+ * along axis, with the closest points inside both. Translating doesn't turn the lines, so their distance along the
+ * common normal changes linearly.
+ */
+f32 math_sweep_segment_edge_internal(Vector3 start, Vector3 direction, Vector3 motion, Vector3 base, Vector3 axis, f32 radius) {
+	Vector3 normal = Vector3CrossProduct(direction, axis);
+	f32 normal_length_squared = Vector3DotProduct(normal, normal);
+	f32 direction_squared = Vector3DotProduct(direction, direction);
+	f32 axis_squared = Vector3DotProduct(axis, axis);
+	if (normal_length_squared <= MATH_SWEEP_PARALLEL * direction_squared * axis_squared || normal_length_squared <= MATH_SWEEP_EPSILON) { return INFINITY; }
+
+	f32 inverse_length = 1.0f / sqrtf(normal_length_squared);
+	Vector3 offset = Vector3Subtract(start, base);
+	f32 distance = Vector3DotProduct(offset, normal) * inverse_length;
+	f32 speed = Vector3DotProduct(motion, normal) * inverse_length;
+	if (distance < 0.0f) {
+		distance = -distance;
+		speed = -speed;
+	}
+	if (speed >= 0.0f) { return INFINITY; }
+
+	f32 t = MAX2((distance - radius) / -speed, 0.0f);
+	if (t > 1.0f) { return INFINITY; }
+
+	offset = Vector3Add(offset, Vector3Scale(motion, t));
+	f32 cross_dot = Vector3DotProduct(direction, axis);
+	f32 direction_offset = Vector3DotProduct(direction, offset);
+	f32 axis_offset = Vector3DotProduct(axis, offset);
+	f32 u = (cross_dot * axis_offset - axis_squared * direction_offset) / normal_length_squared;
+	f32 s = (direction_squared * axis_offset - cross_dot * direction_offset) / normal_length_squared;
+	return (u >= 0.0f && u <= 1.0f && s >= 0.0f && s <= 1.0f) ? t : INFINITY;
+}
+
+/* A sphere at point against everything of a triangle: its face, its edges and its corners */
+f32 math_sweep_sphere_triangle_internal(Vector3 point, Vector3 motion, f32 radius, const Vector3* triangle, Vector3 normal) {
+	f32 t = math_sweep_point_face_internal(point, motion, triangle[0], triangle[1], triangle[2], normal, radius);
+	for (int i = 0; i < 3; i++) {
+		Vector3 edge = Vector3Subtract(triangle[(i + 1) % 3], triangle[i]);
+		t = MIN2(t, math_sweep_point_cylinder_internal(point, motion, triangle[i], edge, radius));
+		t = MIN2(t, math_sweep_point_sphere_internal(point, motion, triangle[i], radius));
+	}
+	return t;
+}
+
+/**
+ * Until two shapes go through each other, they first touch where their closest points are. For a capsule and a triangle
+ * those are an end of the capsule and anything of the triangle, the middle of the capsule and an edge, or the middle of
+ * the capsule and a corner, so the sweep is the earliest of all of those.
+ */
+void math_batch_sweep_capsule_triangles_scalar(f32* out_times, Vector3 start, Vector3 end, f32 radius, Vector3 motion, const Vector3* const* triangles, int count) {
+	Vector3 direction = Vector3Subtract(end, start);
+	bool is_capsule = !Vector3Equals(start, end);
+	Vector3 backwards = Vector3Negate(motion);
+	Vector3 hull[4] = { start, end, Vector3Add(start, motion), Vector3Add(end, motion) };
+
+	for (int i = 0; i < count; i++) {
+		const Vector3* triangle = triangles[i];
+		Vector3 normal = Vector3CrossProduct(Vector3Subtract(triangle[1], triangle[0]), Vector3Subtract(triangle[2], triangle[0]));
+
+		/* Most triangles have the whole sweep more than radius to one side of their plane */
+		f32 reach = radius * sqrtf(Vector3DotProduct(normal, normal));
+		f32 min_distance = INFINITY;
+		f32 max_distance = -INFINITY;
+		for (int h = 0; h < 4; h++) {
+			f32 distance = Vector3DotProduct(Vector3Subtract(hull[h], triangle[0]), normal);
+			min_distance = MIN2(min_distance, distance);
+			max_distance = MAX2(max_distance, distance);
+		}
+		if (min_distance > reach || max_distance < -reach) {
+			out_times[i] = INFINITY;
+			continue;
+		}
+
+		f32 t = math_sweep_sphere_triangle_internal(start, motion, radius, triangle, normal);
+		if (is_capsule) {
+			t = MIN2(t, math_sweep_sphere_triangle_internal(end, motion, radius, triangle, normal));
+			for (int j = 0; j < 3; j++) {
+				Vector3 edge = Vector3Subtract(triangle[(j + 1) % 3], triangle[j]);
+				t = MIN2(t, math_sweep_segment_edge_internal(start, direction, motion, triangle[j], edge, radius));
+				t = MIN2(t, math_sweep_point_cylinder_internal(triangle[j], backwards, start, direction, radius));
+			}
+
+			/* Already going through the triangle */
+			f32 start_distance = Vector3DotProduct(Vector3Subtract(start, triangle[0]), normal);
+			f32 end_distance = Vector3DotProduct(Vector3Subtract(end, triangle[0]), normal);
+			if ((start_distance > 0.0f) != (end_distance > 0.0f) && start_distance != end_distance) {
+				Vector3 crossing = Vector3Lerp(start, end, start_distance / (start_distance - end_distance));
+				if (math_point_in_triangle_internal(crossing, triangle[0], triangle[1], triangle[2], normal)) { t = 0.0f; }
+			}
+		}
+		out_times[i] = t;
+	}
+}
+
+#if defined(MATH_SIMD_SSE)
+/**
+ * Four Vector3s are 12 floats, three registers of x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+ * Shuffling them into all x, all y and all z lets each operation work on four points at once.
+ */
+void math_sse_load_xyz_internal(const f32* floats, __m128* x, __m128* y, __m128* z) {
+	__m128 a = _mm_loadu_ps(floats + 0);
+	__m128 b = _mm_loadu_ps(floats + 4);
+	__m128 c = _mm_loadu_ps(floats + 8);
+
+	*x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(3, 0, 3, 0));
+	*y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	*z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/* The reverse of math_sse_load_xyz_internal */
+void math_sse_store_xyz_internal(f32* floats, __m128 x, __m128 y, __m128 z) {
+	__m128 xy_lo = _mm_unpacklo_ps(x, y);
+	__m128 xy_hi = _mm_unpackhi_ps(x, y);
+
+	_mm_storeu_ps(floats + 0, _mm_shuffle_ps(xy_lo, _mm_shuffle_ps(z, xy_lo, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(floats + 4, _mm_shuffle_ps(_mm_shuffle_ps(xy_lo, z, _MM_SHUFFLE(1, 1, 3, 3)), xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(floats + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, xy_hi, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(xy_hi, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+/**
+ * Sorts the running min and max of triangles into a box. The nine floats of a triangle are kept as
+ * x1 y1 z1 x2 | y2 z2 x3 y3 | z3, so x is in lanes 0 and 3 of the first register and lane 2 of the second, and so on.
+ */
+BoundingBox math_sse_triangle_lanes_aabb_internal(__m128 min_first, __m128 min_second, __m128 min_last, __m128 max_first, __m128 max_second, __m128 max_last) {
+	f32 min_lanes[9], max_lanes[9];
+	_mm_storeu_ps(min_lanes + 0, min_first); _mm_storeu_ps(min_lanes + 4, min_second); _mm_store_ss(min_lanes + 8, min_last);
+	_mm_storeu_ps(max_lanes + 0, max_first); _mm_storeu_ps(max_lanes + 4, max_second); _mm_store_ss(max_lanes + 8, max_last);
+
+	BoundingBox box = math_aabb_empty();
+	f32* box_min = &box.min.x;
+	f32* box_max = &box.max.x;
+	for (int lane = 0; lane < 9; lane++) {
+		box_min[lane % 3] = MIN2(box_min[lane % 3], min_lanes[lane]);
+		box_max[lane % 3] = MAX2(box_max[lane % 3], max_lanes[lane]);
+	}
+	return box;
+}
+
+/* Four Vector3s, a register per coordinate */
+typedef struct MathSseVector3 {
+	__m128 x;
+	__m128 y;
+	__m128 z;
+} MathSseVector3;
+
+MathSseVector3 math_sse_vector3_set1_internal(Vector3 v) {
+	return (MathSseVector3) { _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z) };
+}
+
+MathSseVector3 math_sse_vector3_subtract_internal(MathSseVector3 a, MathSseVector3 b) {
+	return (MathSseVector3) { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+}
+
+/* a + b * scale */
+MathSseVector3 math_sse_vector3_add_scaled_internal(MathSseVector3 a, MathSseVector3 b, __m128 scale) {
+	return (MathSseVector3) { _mm_add_ps(a.x, _mm_mul_ps(b.x, scale)), _mm_add_ps(a.y, _mm_mul_ps(b.y, scale)), _mm_add_ps(a.z, _mm_mul_ps(b.z, scale)) };
+}
+
+__m128 math_sse_vector3_dot_internal(MathSseVector3 a, MathSseVector3 b) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+MathSseVector3 math_sse_vector3_cross_internal(MathSseVector3 a, MathSseVector3 b) {
+	return (MathSseVector3) {
+		_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+		_mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+		_mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)),
+	};
+}
+
+/* mask ? a : b, lane by lane */
+__m128 math_sse_select_internal(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* Gathers four triangles from anywhere, like math_batch_vertical_line_triangles does */
+void math_sse_load_triangles_internal(const Vector3* const* triangles, MathSseVector3* v1, MathSseVector3* v2, MathSseVector3* v3) {
+	const f32* t0 = &triangles[0][0].x;
+	const f32* t1 = &triangles[1][0].x;
+	const f32* t2 = &triangles[2][0].x;
+	const f32* t3 = &triangles[3][0].x;
+
+	__m128 x1 = _mm_loadu_ps(t0), y1 = _mm_loadu_ps(t1), z1 = _mm_loadu_ps(t2), x2 = _mm_loadu_ps(t3);
+	_MM_TRANSPOSE4_PS(x1, y1, z1, x2);
+	__m128 y2 = _mm_loadu_ps(t0 + 4), z2 = _mm_loadu_ps(t1 + 4), x3 = _mm_loadu_ps(t2 + 4), y3 = _mm_loadu_ps(t3 + 4);
+	_MM_TRANSPOSE4_PS(y2, z2, x3, y3);
+
+	*v1 = (MathSseVector3) { x1, y1, z1 };
+	*v2 = (MathSseVector3) { x2, y2, z2 };
+	*v3 = (MathSseVector3) { x3, y3, _mm_setr_ps(t0[8], t1[8], t2[8], t3[8]) };
+}
+
+/* The sweeps below are the _scalar ones from math_batch_sweep_capsule_triangles_scalar, four triangles at a time */
+__m128 math_sse_sweep_quadratic_internal(__m128 a, __m128 b, __m128 c) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 moving_in = _mm_and_ps(_mm_cmplt_ps(b, zero), _mm_cmpgt_ps(a, _mm_set1_ps(MATH_SWEEP_EPSILON)));
+	__m128 inside = _mm_cmple_ps(c, zero);
+
+	__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+	__m128 t = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(discriminant, zero))), a);
+	__m128 is_hit = _mm_and_ps(moving_in, _mm_or_ps(inside, _mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_cmple_ps(t, _mm_set1_ps(1.0f)))));
+
+	return math_sse_select_internal(is_hit, math_sse_select_internal(inside, zero, t), _mm_set1_ps(INFINITY));
+}
+
+__m128 math_sse_sweep_point_sphere_internal(MathSseVector3 point, MathSseVector3 motion, MathSseVector3 center, __m128 radius_squared) {
+	MathSseVector3 f = math_sse_vector3_subtract_internal(point, center);
+	return math_sse_sweep_quadratic_internal(
+		math_sse_vector3_dot_internal(motion, motion),
+		math_sse_vector3_dot_internal(f, motion),
+		_mm_sub_ps(math_sse_vector3_dot_internal(f, f), radius_squared)
+	);
+}
+
+__m128 math_sse_sweep_point_cylinder_internal(MathSseVector3 point, MathSseVector3 motion, MathSseVector3 base, MathSseVector3 axis, __m128 radius_squared) {
+	__m128 axis_length_squared = math_sse_vector3_dot_internal(axis, axis);
+	__m128 inverse_length_squared = _mm_div_ps(_mm_set1_ps(1.0f), axis_length_squared);
+
+	MathSseVector3 f = math_sse_vector3_subtract_internal(point, base);
+	__m128 f_along = math_sse_vector3_dot_internal(f, axis);
+	__m128 motion_along = math_sse_vector3_dot_internal(motion, axis);
+	__m128 a = _mm_sub_ps(math_sse_vector3_dot_internal(motion, motion), _mm_mul_ps(_mm_mul_ps(motion_along, motion_along), inverse_length_squared));
+	__m128 b = _mm_sub_ps(math_sse_vector3_dot_internal(f, motion), _mm_mul_ps(_mm_mul_ps(f_along, motion_along), inverse_length_squared));
+	__m128 c = _mm_sub_ps(_mm_sub_ps(math_sse_vector3_dot_internal(f, f), _mm_mul_ps(_mm_mul_ps(f_along, f_along), inverse_length_squared)), radius_squared);
+
+	__m128 t = math_sse_sweep_quadratic_internal(a, b, c);
+	__m128 s = _mm_mul_ps(_mm_add_ps(f_along, _mm_mul_ps(t, motion_along)), inverse_length_squared);
+	__m128 is_hit = _mm_and_ps(_mm_cmpgt_ps(axis_length_squared, _mm_set1_ps(MATH_SWEEP_EPSILON)), _mm_and_ps(_mm_cmpge_ps(s, _mm_setzero_ps()), _mm_cmple_ps(s, _mm_set1_ps(1.0f))));
+	return math_sse_select_internal(is_hit, t, _mm_set1_ps(INFINITY));
+}
+
+__m128 math_sse_point_in_triangle_internal(MathSseVector3 point, MathSseVector3 v1, MathSseVector3 v2, MathSseVector3 v3, MathSseVector3 normal) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 edge_1 = math_sse_vector3_dot_internal(math_sse_vector3_cross_internal(math_sse_vector3_subtract_internal(v2, v1), math_sse_vector3_subtract_internal(point, v1)), normal);
+	__m128 edge_2 = math_sse_vector3_dot_internal(math_sse_vector3_cross_internal(math_sse_vector3_subtract_internal(v3, v2), math_sse_vector3_subtract_internal(point, v2)), normal);
+	__m128 edge_3 = math_sse_vector3_dot_internal(math_sse_vector3_cross_internal(math_sse_vector3_subtract_internal(v1, v3), math_sse_vector3_subtract_internal(point, v3)), normal);
+	return _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge_1, zero), _mm_cmpge_ps(edge_2, zero)), _mm_cmpge_ps(edge_3, zero));
+}
+
+/**
+ * Distance and speed along a normal, flipped so the distance is positive. Returns when that distance reaches radius,
+ * clamped to 0, and whether it gets there moving in within the sweep.
+ */
+__m128 math_sse_sweep_plane_internal(MathSseVector3 offset, MathSseVector3 motion, MathSseVector3 normal, __m128 normal_length_squared, __m128 radius, __m128* out_is_hit) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 inverse_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(normal_length_squared));
+	__m128 distance = _mm_mul_ps(math_sse_vector3_dot_internal(offset, normal), inverse_length);
+	__m128 speed = _mm_mul_ps(math_sse_vector3_dot_internal(motion, normal), inverse_length);
+
+	__m128 flip = _mm_and_ps(_mm_cmplt_ps(distance, zero), _mm_set1_ps(-0.0f));
+	distance = _mm_xor_ps(distance, flip);
+	speed = _mm_xor_ps(speed, flip);
+
+	__m128 t = _mm_max_ps(_mm_div_ps(_mm_sub_ps(distance, radius), _mm_sub_ps(zero, speed)), zero);
+	*out_is_hit = _mm_and_ps(_mm_cmplt_ps(speed, zero), _mm_cmple_ps(t, _mm_set1_ps(1.0f)));
+	return t;
+}
+
+__m128 math_sse_sweep_point_face_internal(MathSseVector3 point, MathSseVector3 motion, MathSseVector3 v1, MathSseVector3 v2, MathSseVector3 v3, MathSseVector3 normal, __m128 radius) {
+	__m128 normal_length_squared = math_sse_vector3_dot_internal(normal, normal);
+	__m128 is_hit;
+	__m128 t = math_sse_sweep_plane_internal(math_sse_vector3_subtract_internal(point, v1), motion, normal, normal_length_squared, radius, &is_hit);
+
+	MathSseVector3 contact = math_sse_vector3_add_scaled_internal(point, motion, t);
+	is_hit = _mm_and_ps(is_hit, _mm_cmpgt_ps(normal_length_squared, _mm_set1_ps(MATH_SWEEP_EPSILON)));
+	is_hit = _mm_and_ps(is_hit, math_sse_point_in_triangle_internal(contact, v1, v2, v3, normal));
+	return math_sse_select_internal(is_hit, t, _mm_set1_ps(INFINITY));
+}
+
+__m128 math_sse_sweep_segment_edge_internal(MathSseVector3 start, MathSseVector3 direction, MathSseVector3 motion, MathSseVector3 base, MathSseVector3 axis, __m128 radius) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	MathSseVector3 normal = math_sse_vector3_cross_internal(direction, axis);
+	__m128 normal_length_squared = math_sse_vector3_dot_internal(normal, normal);
+	__m128 direction_squared = math_sse_vector3_dot_internal(direction, direction);
+	__m128 axis_squared = math_sse_vector3_dot_internal(axis, axis);
+	__m128 not_parallel = _mm_and_ps(
+		_mm_cmpgt_ps(normal_length_squared, _mm_mul_ps(_mm_set1_ps(MATH_SWEEP_PARALLEL), _mm_mul_ps(direction_squared, axis_squared))),
+		_mm_cmpgt_ps(normal_length_squared, _mm_set1_ps(MATH_SWEEP_EPSILON))
+	);
+
+	MathSseVector3 offset = math_sse_vector3_subtract_internal(start, base);
+	__m128 is_hit;
+	__m128 t = math_sse_sweep_plane_internal(offset, motion, normal, normal_length_squared, radius, &is_hit);
+
+	offset = math_sse_vector3_add_scaled_internal(offset, motion, t);
+	__m128 cross_dot = math_sse_vector3_dot_internal(direction, axis);
+	__m128 direction_offset = math_sse_vector3_dot_internal(direction, offset);
+	__m128 axis_offset = math_sse_vector3_dot_internal(axis, offset);
+	__m128 u = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(cross_dot, axis_offset), _mm_mul_ps(axis_squared, direction_offset)), normal_length_squared);
+	__m128 s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(direction_squared, axis_offset), _mm_mul_ps(cross_dot, direction_offset)), normal_length_squared);
+
+	is_hit = _mm_and_ps(_mm_and_ps(is_hit, not_parallel), _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+	is_hit = _mm_and_ps(is_hit, _mm_and_ps(_mm_cmpge_ps(s, zero), _mm_cmple_ps(s, one)));
+	return math_sse_select_internal(is_hit, t, _mm_set1_ps(INFINITY));
+}
+
+__m128 math_sse_sweep_sphere_triangle_internal(MathSseVector3 point, MathSseVector3 motion, __m128 radius, const MathSseVector3* triangle, MathSseVector3 normal) {
+	__m128 radius_squared = _mm_mul_ps(radius, radius);
+	__m128 t = math_sse_sweep_point_face_internal(point, motion, triangle[0], triangle[1], triangle[2], normal, radius);
+	for (int i = 0; i < 3; i++) {
+		MathSseVector3 edge = math_sse_vector3_subtract_internal(triangle[(i + 1) % 3], triangle[i]);
+		t = _mm_min_ps(t, math_sse_sweep_point_cylinder_internal(point, motion, triangle[i], edge, radius_squared));
+		t = _mm_min_ps(t, math_sse_sweep_point_sphere_internal(point, motion, triangle[i], radius_squared));
+	}
+	return t;
+}
+#endif
+
+#if defined(MATH_SIMD_AVX)
+/* Same shuffles as the SSE version, with points 0 to 3 in the low half of each register and 4 to 7 in the high half */
+void math_avx_load_xyz_internal(const f32* floats, __m256* x, __m256* y, __m256* z) {
+	__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(floats + 0)), _mm_loadu_ps(floats + 12), 1);
+	__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(floats + 4)), _mm_loadu_ps(floats + 16), 1);
+	__m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(floats + 8)), _mm_loadu_ps(floats + 20), 1);
+
+	*x = _mm256_shuffle_ps(a, _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(3, 0, 3, 0));
+	*y = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	*z = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+void math_avx_store_xyz_internal(f32* floats, __m256 x, __m256 y, __m256 z) {
+	__m256 xy_lo = _mm256_unpacklo_ps(x, y);
+	__m256 xy_hi = _mm256_unpackhi_ps(x, y);
+
+	__m256 a = _mm256_shuffle_ps(xy_lo, _mm256_shuffle_ps(z, xy_lo, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+	__m256 b = _mm256_shuffle_ps(_mm256_shuffle_ps(xy_lo, z, _MM_SHUFFLE(1, 1, 3, 3)), xy_hi, _MM_SHUFFLE(1, 0, 2, 0));
+	__m256 c = _mm256_shuffle_ps(_mm256_shuffle_ps(z, xy_hi, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_shuffle_ps(xy_hi, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+	_mm_storeu_ps(floats + 0, _mm256_castps256_ps128(a));
+	_mm_storeu_ps(floats + 4, _mm256_castps256_ps128(b));
+	_mm_storeu_ps(floats + 8, _mm256_castps256_ps128(c));
+	_mm_storeu_ps(floats + 12, _mm256_extractf128_ps(a, 1));
+	_mm_storeu_ps(floats + 16, _mm256_extractf128_ps(b, 1));
+	_mm_storeu_ps(floats + 20, _mm256_extractf128_ps(c, 1));
+}
+#endif
+
+void math_batch_transform_points(Vector3* out, const Vector3* points, int count, Matrix matrix) {
+	int i = 0;
+#if defined(MATH_SIMD_AVX)
+	{
+		__m256 m0 = _mm256_set1_ps(matrix.m0), m4 = _mm256_set1_ps(matrix.m4), m8 = _mm256_set1_ps(matrix.m8), m12 = _mm256_set1_ps(matrix.m12);
+		__m256 m1 = _mm256_set1_ps(matrix.m1), m5 = _mm256_set1_ps(matrix.m5), m9 = _mm256_set1_ps(matrix.m9), m13 = _mm256_set1_ps(matrix.m13);
+		__m256 m2 = _mm256_set1_ps(matrix.m2), m6 = _mm256_set1_ps(matrix.m6), m10 = _mm256_set1_ps(matrix.m10), m14 = _mm256_set1_ps(matrix.m14);
+		for (; i + 8 <= count; i += 8) {
+			__m256 x, y, z;
+			math_avx_load_xyz_internal(&points[i].x, &x, &y, &z);
+			__m256 out_x = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m4, y)), _mm256_add_ps(_mm256_mul_ps(m8, z), m12));
+			__m256 out_y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, x), _mm256_mul_ps(m5, y)), _mm256_add_ps(_mm256_mul_ps(m9, z), m13));
+			__m256 out_z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, x), _mm256_mul_ps(m6, y)), _mm256_add_ps(_mm256_mul_ps(m10, z), m14));
+			math_avx_store_xyz_internal(&out[i].x, out_x, out_y, out_z);
+		}
+	}
+#endif
+#if defined(MATH_SIMD_SSE)
+	{
+		__m128 m0 = _mm_set1_ps(matrix.m0), m4 = _mm_set1_ps(matrix.m4), m8 = _mm_set1_ps(matrix.m8), m12 = _mm_set1_ps(matrix.m12);
+		__m128 m1 = _mm_set1_ps(matrix.m1), m5 = _mm_set1_ps(matrix.m5), m9 = _mm_set1_ps(matrix.m9), m13 = _mm_set1_ps(matrix.m13);
+		__m128 m2 = _mm_set1_ps(matrix.m2), m6 = _mm_set1_ps(matrix.m6), m10 = _mm_set1_ps(matrix.m10), m14 = _mm_set1_ps(matrix.m14);
+		for (; i + 4 <= count; i += 4) {
+			__m128 x, y, z;
+			math_sse_load_xyz_internal(&points[i].x, &x, &y, &z);
+			__m128 out_x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12));
+			__m128 out_y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13));
+			__m128 out_z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14));
+			math_sse_store_xyz_internal(&out[i].x, out_x, out_y, out_z);
+		}
+	}
+#endif
+	math_batch_transform_points_scalar(out + i, points + i, count - i, matrix);
+}
+
+BoundingBox math_batch_transform_triangles(Vector3* out, int out_stride, const Vector3* triangles, int triangle_count, Matrix matrix) {
+#if defined(MATH_SIMD_SSE)
+	/**
+	 * A triangle is nine floats, x1 y1 z1 x2 | y2 z2 x3 y3 | z3. The first two registers of the output have the same
+	 * layout, so each is one multiply-add per input axis with the matrix rows reordered to match, and z3 is done on its own.
+	 * Nothing is read or written past the triangle, so the output can sit in the middle of a struct.
+	 */
+	__m128 first_x = _mm_setr_ps(matrix.m0, matrix.m1, matrix.m2, matrix.m0);
+	__m128 first_y = _mm_setr_ps(matrix.m4, matrix.m5, matrix.m6, matrix.m4);
+	__m128 first_z = _mm_setr_ps(matrix.m8, matrix.m9, matrix.m10, matrix.m8);
+	__m128 first_w = _mm_setr_ps(matrix.m12, matrix.m13, matrix.m14, matrix.m12);
+	__m128 second_x = _mm_setr_ps(matrix.m1, matrix.m2, matrix.m0, matrix.m1);
+	__m128 second_y = _mm_setr_ps(matrix.m5, matrix.m6, matrix.m4, matrix.m5);
+	__m128 second_z = _mm_setr_ps(matrix.m9, matrix.m10, matrix.m8, matrix.m9);
+	__m128 second_w = _mm_setr_ps(matrix.m13, matrix.m14, matrix.m12, matrix.m13);
+
+	__m128 min_first = _mm_set1_ps(INFINITY), min_second = min_first, min_last = min_first;
+	__m128 max_first = _mm_set1_ps(-INFINITY), max_second = max_first, max_last = max_first;
+
+	u8* out_bytes = (u8*)out;
+	for (int i = 0; i < triangle_count; i++) {
+		const f32* in = &triangles[3 * i].x;
+		f32* result = (f32*)(out_bytes + (u64)i * (u64)out_stride);
+
+		__m128 a = _mm_loadu_ps(in + 0);
+		__m128 b = _mm_loadu_ps(in + 4);
+		__m128 c = _mm_load1_ps(in + 8);
+
+		/* x1 x1 x1 x2, y1 y1 y1 y2, z1 z1 z1 z2 */
+		__m128 y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+		__m128 z = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+		__m128 first = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(first_x, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 0, 0))), _mm_mul_ps(first_y, _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 0, 0, 0)))),
+			_mm_add_ps(_mm_mul_ps(first_z, _mm_shuffle_ps(z, z, _MM_SHUFFLE(2, 0, 0, 0))), first_w)
+		);
+		/* x2 x2 x3 x3, y2 y2 y3 y3, z2 z2 z3 z3 */
+		__m128 second = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(second_x, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 3, 3))), _mm_mul_ps(second_y, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 0, 0)))),
+			_mm_add_ps(_mm_mul_ps(second_z, _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 1, 1))), second_w)
+		);
+
+		__m128 last = _mm_set_ss(matrix.m2 * in[6] + matrix.m6 * in[7] + matrix.m10 * in[8] + matrix.m14);
+
+		_mm_storeu_ps(result + 0, first);
+		_mm_storeu_ps(result + 4, second);
+		_mm_store_ss(result + 8, last);
+
+		min_first = _mm_min_ps(min_first, first); max_first = _mm_max_ps(max_first, first);
+		min_second = _mm_min_ps(min_second, second); max_second = _mm_max_ps(max_second, second);
+		min_last = _mm_min_ss(min_last, last); max_last = _mm_max_ss(max_last, last);
+	}
+
+	return math_sse_triangle_lanes_aabb_internal(min_first, min_second, min_last, max_first, max_second, max_last);
+#else
+	return math_batch_transform_triangles_scalar(out, out_stride, triangles, triangle_count, matrix);
+#endif
+}
+
+BoundingBox math_batch_aabb_triangles(const Vector3* triangles, int stride, int triangle_count) {
+#if defined(MATH_SIMD_SSE)
+	__m128 min_first = _mm_set1_ps(INFINITY), min_second = min_first, min_last = min_first;
+	__m128 max_first = _mm_set1_ps(-INFINITY), max_second = max_first, max_last = max_first;
+
+	const u8* bytes = (const u8*)triangles;
+	for (int i = 0; i < triangle_count; i++) {
+		const f32* in = (const f32*)(bytes + (u64)i * (u64)stride);
+		__m128 first = _mm_loadu_ps(in + 0);
+		__m128 second = _mm_loadu_ps(in + 4);
+		__m128 last = _mm_load_ss(in + 8);
+
+		min_first = _mm_min_ps(min_first, first); max_first = _mm_max_ps(max_first, first);
+		min_second = _mm_min_ps(min_second, second); max_second = _mm_max_ps(max_second, second);
+		min_last = _mm_min_ss(min_last, last); max_last = _mm_max_ss(max_last, last);
+	}
+
+	return math_sse_triangle_lanes_aabb_internal(min_first, min_second, min_last, max_first, max_second, max_last);
+#else
+	return math_batch_aabb_triangles_scalar(triangles, stride, triangle_count);
+#endif
+}
+
+void math_batch_quaternion_multiply(Quaternion* out, const Quaternion* a, const Quaternion* b, int count) {
+	int i = 0;
+#if defined(MATH_SIMD_SSE)
+	/* Transposed to four x, four y, four z and four w, then the same sums as the scalar version */
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax = _mm_loadu_ps(&a[i + 0].x), ay = _mm_loadu_ps(&a[i + 1].x), az = _mm_loadu_ps(&a[i + 2].x), aw = _mm_loadu_ps(&a[i + 3].x);
+		__m128 bx = _mm_loadu_ps(&b[i + 0].x), by = _mm_loadu_ps(&b[i + 1].x), bz = _mm_loadu_ps(&b[i + 2].x), bw = _mm_loadu_ps(&b[i + 3].x);
+		_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+		__m128 x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bw), _mm_mul_ps(aw, bx)), _mm_mul_ps(ay, bz)), _mm_mul_ps(az, by));
+		__m128 y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ay, bw), _mm_mul_ps(aw, by)), _mm_mul_ps(az, bx)), _mm_mul_ps(ax, bz));
+		__m128 z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(az, bw), _mm_mul_ps(aw, bz)), _mm_mul_ps(ax, by)), _mm_mul_ps(ay, bx));
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&out[i + 0].x, x);
+		_mm_storeu_ps(&out[i + 1].x, y);
+		_mm_storeu_ps(&out[i + 2].x, z);
+		_mm_storeu_ps(&out[i + 3].x, w);
+	}
+#endif
+	math_batch_quaternion_multiply_scalar(out + i, a + i, b + i, count - i);
+}
+
+BoundingBox math_batch_aabb(const Vector3* points, int count) {
+	int i = 0;
+	BoundingBox box = math_aabb_empty();
+#if defined(MATH_SIMD_SSE)
+	/**
+	 * No shuffling needed: blocks of four points are always the same three registers of x y z x | y z x y | z x y z,
+	 * so min and max are taken straight from memory and the lanes only get sorted into x, y and z at the end.
+	 */
+	if (count >= 4) {
+		const f32* floats = &points[0].x;
+	#if defined(MATH_SIMD_AVX)
+		#define MATH_AABB_LANES 8
+		__m256 min_a = _mm256_set1_ps(INFINITY), min_b = min_a, min_c = min_a;
+		__m256 max_a = _mm256_set1_ps(-INFINITY), max_b = max_a, max_c = max_a;
+		for (; i + 8 <= count; i += 8) {
+			__m256 a = _mm256_loadu_ps(floats + 3 * i + 0);
+			__m256 b = _mm256_loadu_ps(floats + 3 * i + 8);
+			__m256 c = _mm256_loadu_ps(floats + 3 * i + 16);
+			min_a = _mm256_min_ps(min_a, a); max_a = _mm256_max_ps(max_a, a);
+			min_b = _mm256_min_ps(min_b, b); max_b = _mm256_max_ps(max_b, b);
+			min_c = _mm256_min_ps(min_c, c); max_c = _mm256_max_ps(max_c, c);
+		}
+		f32 min_lanes[3 * MATH_AABB_LANES], max_lanes[3 * MATH_AABB_LANES];
+		_mm256_storeu_ps(min_lanes + 0, min_a); _mm256_storeu_ps(min_lanes + 8, min_b); _mm256_storeu_ps(min_lanes + 16, min_c);
+		_mm256_storeu_ps(max_lanes + 0, max_a); _mm256_storeu_ps(max_lanes + 8, max_b); _mm256_storeu_ps(max_lanes + 16, max_c);
+	#else
+		#define MATH_AABB_LANES 4
+		__m128 min_a = _mm_set1_ps(INFINITY), min_b = min_a, min_c = min_a;
+		__m128 max_a = _mm_set1_ps(-INFINITY), max_b = max_a, max_c = max_a;
+		for (; i + 4 <= count; i += 4) {
+			__m128 a = _mm_loadu_ps(floats + 3 * i + 0);
+			__m128 b = _mm_loadu_ps(floats + 3 * i + 4);
+			__m128 c = _mm_loadu_ps(floats + 3 * i + 8);
+			min_a = _mm_min_ps(min_a, a); max_a = _mm_max_ps(max_a, a);
+			min_b = _mm_min_ps(min_b, b); max_b = _mm_max_ps(max_b, b);
+			min_c = _mm_min_ps(min_c, c); max_c = _mm_max_ps(max_c, c);
+		}
+		f32 min_lanes[3 * MATH_AABB_LANES], max_lanes[3 * MATH_AABB_LANES];
+		_mm_storeu_ps(min_lanes + 0, min_a); _mm_storeu_ps(min_lanes + 4, min_b); _mm_storeu_ps(min_lanes + 8, min_c);
+		_mm_storeu_ps(max_lanes + 0, max_a); _mm_storeu_ps(max_lanes + 4, max_b); _mm_storeu_ps(max_lanes + 8, max_c);
+	#endif
+		f32* box_min = &box.min.x;
+		f32* box_max = &box.max.x;
+		for (int lane = 0; lane < 3 * MATH_AABB_LANES; lane++) {
+			box_min[lane % 3] = MIN2(box_min[lane % 3], min_lanes[lane]);
+			box_max[lane % 3] = MAX2(box_max[lane % 3], max_lanes[lane]);
+		}
+		#undef MATH_AABB_LANES
+	}
+#endif
+	return math_aabb_merge(box, math_batch_aabb_scalar(points + i, count - i));
+}
+
+void math_batch_dot(f32* out, const Vector3* a, const Vector3* b, int count) {
+	int i = 0;
+#if defined(MATH_SIMD_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax, ay, az, bx, by, bz;
+		math_sse_load_xyz_internal(&a[i].x, &ax, &ay, &az);
+		math_sse_load_xyz_internal(&b[i].x, &bx, &by, &bz);
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz)));
+	}
+#endif
+	math_batch_dot_scalar(out + i, a + i, b + i, count - i);
+}
+
+void math_batch_cross(Vector3* out, const Vector3* a, const Vector3* b, int count) {
+	int i = 0;
+#if defined(MATH_SIMD_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax, ay, az, bx, by, bz;
+		math_sse_load_xyz_internal(&a[i].x, &ax, &ay, &az);
+		math_sse_load_xyz_internal(&b[i].x, &bx, &by, &bz);
+		math_sse_store_xyz_internal(&out[i].x,
+			_mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)),
+			_mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)),
+			_mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx))
+		);
+	}
+#endif
+	math_batch_cross_scalar(out + i, a + i, b + i, count - i);
+}
+
+void math_batch_vertical_line_triangles(f32* out_heights, f32 x, f32 z, const Vector3* const* triangles, int count) {
+	int i = 0;
+#if defined(MATH_SIMD_SSE)
+	__m128 point_x = _mm_set1_ps(x);
+	__m128 point_z = _mm_set1_ps(z);
+	__m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= count; i += 4) {
+		/* The nine floats of each triangle are x1 y1 z1 x2 | y2 z2 x3 y3 | z3, transposing the first eight gives a register per coordinate */
+		const f32* t0 = &triangles[i + 0][0].x;
+		const f32* t1 = &triangles[i + 1][0].x;
+		const f32* t2 = &triangles[i + 2][0].x;
+		const f32* t3 = &triangles[i + 3][0].x;
+
+		__m128 x1 = _mm_loadu_ps(t0), y1 = _mm_loadu_ps(t1), z1 = _mm_loadu_ps(t2), x2 = _mm_loadu_ps(t3);
+		_MM_TRANSPOSE4_PS(x1, y1, z1, x2);
+		__m128 y2 = _mm_loadu_ps(t0 + 4), z2 = _mm_loadu_ps(t1 + 4), x3 = _mm_loadu_ps(t2 + 4), y3 = _mm_loadu_ps(t3 + 4);
+		_MM_TRANSPOSE4_PS(y2, z2, x3, y3);
+		__m128 z3 = _mm_setr_ps(t0[8], t1[8], t2[8], t3[8]);
+
+		x1 = _mm_sub_ps(x1, point_x); z1 = _mm_sub_ps(z1, point_z);
+		x2 = _mm_sub_ps(x2, point_x); z2 = _mm_sub_ps(z2, point_z);
+		x3 = _mm_sub_ps(x3, point_x); z3 = _mm_sub_ps(z3, point_z);
+
+		__m128 weight_1 = _mm_sub_ps(_mm_mul_ps(x2, z3), _mm_mul_ps(z2, x3));
+		__m128 weight_2 = _mm_sub_ps(_mm_mul_ps(x3, z1), _mm_mul_ps(z3, x1));
+		__m128 weight_3 = _mm_sub_ps(_mm_mul_ps(x1, z2), _mm_mul_ps(z1, x2));
+		__m128 area = _mm_add_ps(_mm_add_ps(weight_1, weight_2), weight_3);
+
+		__m128 all_positive = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(weight_1, zero), _mm_cmpge_ps(weight_2, zero)), _mm_cmpge_ps(weight_3, zero));
+		__m128 all_negative = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(weight_1, zero), _mm_cmple_ps(weight_2, zero)), _mm_cmple_ps(weight_3, zero));
+		__m128 is_hit = _mm_and_ps(_mm_or_ps(all_positive, all_negative), _mm_cmpneq_ps(area, zero));
+
+		__m128 weighted = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weight_1, y1), _mm_mul_ps(weight_2, y2)), _mm_mul_ps(weight_3, y3));
+		__m128 height = _mm_div_ps(weighted, area);
+		_mm_storeu_ps(out_heights + i, _mm_or_ps(_mm_and_ps(is_hit, height), _mm_andnot_ps(is_hit, _mm_set1_ps(-INFINITY))));
+	}
+#endif
+	math_batch_vertical_line_triangles_scalar(out_heights + i, x, z, triangles + i, count - i);
+}
+
+void math_batch_sweep_capsule_triangles(f32* out_times, Vector3 start, Vector3 end, f32 radius, Vector3 motion, const Vector3* const* triangles, int count) {
+#if defined(MATH_SIMD_SSE)
+	MathSseVector3 start_4 = math_sse_vector3_set1_internal(start);
+	MathSseVector3 end_4 = math_sse_vector3_set1_internal(end);
+	MathSseVector3 direction_4 = math_sse_vector3_set1_internal(Vector3Subtract(end, start));
+	MathSseVector3 motion_4 = math_sse_vector3_set1_internal(motion);
+	MathSseVector3 backwards_4 = math_sse_vector3_set1_internal(Vector3Negate(motion));
+	MathSseVector3 hull[4] = { start_4, end_4, math_sse_vector3_set1_internal(Vector3Add(start, motion)), math_sse_vector3_set1_internal(Vector3Add(end, motion)) };
+	__m128 radius_4 = _mm_set1_ps(radius);
+	__m128 radius_squared_4 = _mm_set1_ps(radius * radius);
+	__m128 zero = _mm_setzero_ps();
+	__m128 infinity = _mm_set1_ps(INFINITY);
+	bool is_capsule = !Vector3Equals(start, end);
+
+	/* Sweeps usually get a handful of triangles, so the last few fill a register with copies of the last one instead of going scalar */
+	for (int i = 0; i < count; i += 4) {
+		int lane_count = MIN2(count - i, 4);
+		const Vector3* group[4];
+		for (int lane = 0; lane < 4; lane++) { group[lane] = triangles[i + MIN2(lane, lane_count - 1)]; }
+
+		MathSseVector3 triangle[3];
+		math_sse_load_triangles_internal(group, &triangle[0], &triangle[1], &triangle[2]);
+		MathSseVector3 normal = math_sse_vector3_cross_internal(
+			math_sse_vector3_subtract_internal(triangle[1], triangle[0]),
+			math_sse_vector3_subtract_internal(triangle[2], triangle[0])
+		);
+
+		__m128 reach = _mm_mul_ps(radius_4, _mm_sqrt_ps(math_sse_vector3_dot_internal(normal, normal)));
+		__m128 min_distance = infinity;
+		__m128 max_distance = _mm_set1_ps(-INFINITY);
+		for (int h = 0; h < 4; h++) {
+			__m128 distance = math_sse_vector3_dot_internal(math_sse_vector3_subtract_internal(hull[h], triangle[0]), normal);
+			min_distance = _mm_min_ps(min_distance, distance);
+			max_distance = _mm_max_ps(max_distance, distance);
+		}
+		__m128 is_rejected = _mm_or_ps(_mm_cmpgt_ps(min_distance, reach), _mm_cmplt_ps(max_distance, _mm_sub_ps(zero, reach)));
+
+		__m128 t = infinity;
+		if (_mm_movemask_ps(is_rejected) != 0xF) {
+			t = math_sse_sweep_sphere_triangle_internal(start_4, motion_4, radius_4, triangle, normal);
+			if (is_capsule) {
+				t = _mm_min_ps(t, math_sse_sweep_sphere_triangle_internal(end_4, motion_4, radius_4, triangle, normal));
+				for (int j = 0; j < 3; j++) {
+					MathSseVector3 edge = math_sse_vector3_subtract_internal(triangle[(j + 1) % 3], triangle[j]);
+					t = _mm_min_ps(t, math_sse_sweep_segment_edge_internal(start_4, direction_4, motion_4, triangle[j], edge, radius_4));
+					t = _mm_min_ps(t, math_sse_sweep_point_cylinder_internal(triangle[j], backwards_4, start_4, direction_4, radius_squared_4));
+				}
+
+				__m128 start_distance = math_sse_vector3_dot_internal(math_sse_vector3_subtract_internal(start_4, triangle[0]), normal);
+				__m128 end_distance = math_sse_vector3_dot_internal(math_sse_vector3_subtract_internal(end_4, triangle[0]), normal);
+				__m128 crosses = _mm_and_ps(
+					_mm_xor_ps(_mm_cmpgt_ps(start_distance, zero), _mm_cmpgt_ps(end_distance, zero)),
+					_mm_cmpneq_ps(start_distance, end_distance)
+				);
+				__m128 fraction = _mm_div_ps(start_distance, _mm_sub_ps(start_distance, end_distance));
+				MathSseVector3 crossing = math_sse_vector3_add_scaled_internal(start_4, direction_4, fraction);
+				crosses = _mm_and_ps(crosses, math_sse_point_in_triangle_internal(crossing, triangle[0], triangle[1], triangle[2], normal));
+				t = math_sse_select_internal(crosses, zero, t);
+			}
+			t = math_sse_select_internal(is_rejected, infinity, t);
+		}
+
+		if (lane_count == 4) {
+			_mm_storeu_ps(out_times + i, t);
+		} else {
+			f32 lanes[4];
+			_mm_storeu_ps(lanes, t);
+			for (int lane = 0; lane < lane_count; lane++) { out_times[i + lane] = lanes[lane]; }
+		}
+	}
+#else
+	math_batch_sweep_capsule_triangles_scalar(out_times, start, end, radius, motion, triangles, count);
+#endif
+}
+
+Matrix math_matrix_multiply(Matrix left, Matrix right) {
+#if defined(MATH_SIMD_SSE)
+	/**
+	 * Matrix is stored a row at a time (m0 m4 m8 m12 first), and row i of the result is
+	 * right's row i weighting left's rows, so each one is four broadcasts and four multiply-adds.
+	 */
+	Matrix result;
+	const f32* l = &left.m0;
+	const f32* r = &right.m0;
+	f32* out = &result.m0;
+	__m128 left_0 = _mm_loadu_ps(l + 0);
+	__m128 left_1 = _mm_loadu_ps(l + 4);
+	__m128 left_2 = _mm_loadu_ps(l + 8);
+	__m128 left_3 = _mm_loadu_ps(l + 12);
+	for (int row = 0; row < 4; row++) {
+		const f32* weights = r + 4 * row;
+		__m128 sum = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(weights[0]), left_0), _mm_mul_ps(_mm_set1_ps(weights[1]), left_1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(weights[2]), left_2), _mm_mul_ps(_mm_set1_ps(weights[3]), left_3))
+		);
+		_mm_storeu_ps(out + 4 * row, sum);
+	}
+	return result;
+#else
+	return MatrixMultiply(left, right);
+#endif
+}
+#endif
@@ -15,6 +15,12 @@
 	#define EPSILON 0.0001f
 #endif
 
+/* Returns the minimum of 2 numeric values. */
+#define MIN2(a,b) (((a) < (b)) ? (a) : (b))
+
+/* Returns the maximum of 2 numeric values. */
+#define MAX2(a,b) (((a) > (b)) ? (a) : (b))
+
 /* Returns the minimum of 3 numeric values. */
 #define MIN3(a,b,c) (((a) < (b)) \
 	? ((a) < (c)) ? (a) : (c) \
@@ -56,5 +62,138 @@ Vector3 math_line_triangle_intersection(
 	Vector3 line_0, float a, float b, float c
 );
 
+/**
+ * Returns the distance t along the ray (origin + t * direction) at which it hits the given triangle.
+ *
+ * Returns INFINITY if the ray misses or the hit is behind the origin.
+ */
+f32 math_ray_triangle_distance(
+	Vector3 tri_point_1,
+	Vector3 tri_point_2,
+	Vector3 tri_point_3,
+
+	Vector3 origin,
+	Vector3 direction
+);
+
+/* The closest point on a triangle to point */
+Vector3 math_closest_point_triangle(Vector3 point, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3);
+
+/* The closest points between the segments a_start..a_end and b_start..b_end */
+void math_closest_points_segments(Vector3 a_start, Vector3 a_end, Vector3 b_start, Vector3 b_end, Vector3* out_a, Vector3* out_b);
+
+/* The closest points between the segment start..end and a triangle. Both are the same point if the segment goes through it. */
+void math_closest_points_segment_triangle(
+	Vector3 start,
+	Vector3 end,
+	Vector3 tri_point_1,
+	Vector3 tri_point_2,
+	Vector3 tri_point_3,
+
+	Vector3* out_segment_point,
+	Vector3* out_triangle_point
+);
+
+/* Whether a triangle and a box touch, by the separating axis test */
+bool math_triangle_aabb_overlap(Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3, BoundingBox box);
+
+/* Six planes facing inwards. A point p is on the inside of a plane when dot(plane.xyz, p) + plane.w >= 0. */
+typedef struct Frustum {
+	/* Left, right, bottom, top, near, far, all unit length */
+	Vector4 planes[6];
+} Frustum;
+
+/* The frustum of a camera's view projection matrix, MatrixMultiply(view, projection) like raylib builds it */
+Frustum math_frustum_from_matrix(Matrix view_projection);
+
+/* The bounding box of the frustum's 8 corners */
+BoundingBox math_frustum_bounds(const Frustum* frustum);
+
+/**
+ * Whether a box is at least partly inside the frustum. Only false when the box is entirely outside one of the planes,
+ * so boxes just off the frustum's edges and corners can still pass.
+ */
+bool math_frustum_aabb_overlap(const Frustum* frustum, BoundingBox box);
+
+/* The same for a triangle, false only when its 3 corners are all outside one of the planes */
+bool math_frustum_triangle_overlap(const Frustum* frustum, Vector3 tri_point_1, Vector3 tri_point_2, Vector3 tri_point_3);
+
 /* Extracts the transform matrix from a Transform struct. */
-Matrix math_transform_to_matrix(Transform transform);
\ No newline at end of file
+Matrix math_transform_to_matrix(Transform transform);
+
+/* Blends two transforms, lerping translation and scale and slerping rotation. */
+Transform math_transform_lerp(Transform a, Transform b, f32 t);
+
+#ifndef REGION_BATCH_MATH
+/**
+ * Batch math works on whole arrays at once instead of one value at a time, so the loops can use SIMD.
+ * The instruction set is picked at compile time: AVX when the compiler targets it (-mavx), SSE on any x64 build,
+ * and plain C everywhere else. Define MATH_NO_SIMD to force plain C.
+ *
+ * Every function has a _scalar twin that always runs the plain C version. The SIMD ones use it for leftovers
+ * that don't fill a whole register, and tests compare against it.
+ */
+#if !defined(MATH_NO_SIMD) && defined(__AVX__)
+	#define MATH_SIMD_AVX
+#endif
+#if !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+	#define MATH_SIMD_SSE
+#endif
+
+/* Transforms count points by matrix, like Vector3Transform. out may be points. */
+void math_batch_transform_points(Vector3* out, const Vector3* points, int count, Matrix matrix);
+void math_batch_transform_points_scalar(Vector3* out, const Vector3* points, int count, Matrix matrix);
+
+/**
+ * Transforms a triangle soup (three vertices per triangle) by matrix. The three vertices of triangle i are written
+ * to the bytes at out + i * out_stride, so they can go straight into an array of structs like TriangleCollider.
+ * Returns the bounding box of everything written, which comes almost for free while the results are still in registers.
+ */
+BoundingBox math_batch_transform_triangles(Vector3* out, int out_stride, const Vector3* triangles, int triangle_count, Matrix matrix);
+BoundingBox math_batch_transform_triangles_scalar(Vector3* out, int out_stride, const Vector3* triangles, int triangle_count, Matrix matrix);
+
+/* out[i] = a[i] * b[i], like QuaternionMultiply. out may be a or b. */
+void math_batch_quaternion_multiply(Quaternion* out, const Quaternion* a, const Quaternion* b, int count);
+void math_batch_quaternion_multiply_scalar(Quaternion* out, const Quaternion* a, const Quaternion* b, int count);
+
+/* The smallest box holding every point. With no points min is +INFINITY and max is -INFINITY. */
+BoundingBox math_batch_aabb(const Vector3* points, int count);
+BoundingBox math_batch_aabb_scalar(const Vector3* points, int count);
+
+/* Like math_batch_aabb, for triangles laid out like in math_batch_transform_triangles, three vertices every stride bytes */
+BoundingBox math_batch_aabb_triangles(const Vector3* triangles, int stride, int triangle_count);
+BoundingBox math_batch_aabb_triangles_scalar(const Vector3* triangles, int stride, int triangle_count);
+
+/* The box with nothing in it, min +INFINITY and max -INFINITY. Merging it with any box gives that box back. */
+BoundingBox math_aabb_empty(void);
+
+/* The smallest box holding both */
+BoundingBox math_aabb_merge(BoundingBox a, BoundingBox b);
+
+/* out[i] = dot(a[i], b[i]) */
+void math_batch_dot(f32* out, const Vector3* a, const Vector3* b, int count);
+void math_batch_dot_scalar(f32* out, const Vector3* a, const Vector3* b, int count);
+
+/* out[i] = cross(a[i], b[i]). out may be a or b. */
+void math_batch_cross(Vector3* out, const Vector3* a, const Vector3* b, int count);
+void math_batch_cross_scalar(Vector3* out, const Vector3* a, const Vector3* b, int count);
+
+/**
+ * Where the vertical line through (x, z) crosses each triangle, written to out_heights. triangles[i] points at the three
+ * vertices of triangle i, so they can be gathered from anywhere. -INFINITY where the line misses or the triangle is vertical.
+ */
+void math_batch_vertical_line_triangles(f32* out_heights, f32 x, f32 z, const Vector3* const* triangles, int count);
+void math_batch_vertical_line_triangles_scalar(f32* out_heights, f32 x, f32 z, const Vector3* const* triangles, int count);
+
+/**
+ * How far a capsule from start to end with radius can move along motion before touching each triangle, as a fraction
+ * of motion in [0, 1], written to out_times. A sphere is a capsule with start == end. INFINITY where it never touches,
+ * or only while moving away. A capsule already touching a triangle it moves into gets 0, and so does one already
+ * going through it. triangles[i] points at the three vertices of triangle i, like in math_batch_vertical_line_triangles.
+ */
+void math_batch_sweep_capsule_triangles(f32* out_times, Vector3 start, Vector3 end, f32 radius, Vector3 motion, const Vector3* const* triangles, int count);
+void math_batch_sweep_capsule_triangles_scalar(f32* out_times, Vector3 start, Vector3 end, f32 radius, Vector3 motion, const Vector3* const* triangles, int count);
+
+/* Same result as raymath's MatrixMultiply(left, right): applies left first, then right. */
+Matrix math_matrix_multiply(Matrix left, Matrix right);
+#endif
@@ -0,0 +1,198 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Runs a frame's systems as jobs on the job system (see jobs.c).
+*
+* Every system declares which components it reads and writes (see ComponentMask in entities.c).
+* Two systems conflict when either one writes something the other touches. Conflicting systems always run
+* in the order they were added, everything else is free to run at the same time on any worker.
+*
+* The thread calling scheduler_run helps with jobs while it waits, and is the only one allowed to run
+* SYSTEM_FLAG_MAIN_THREAD systems. Anything that touches raylib's window, input or GPU state has to be one of those.
+*/
+
+#define SCHEDULER_MAX_SYSTEMS 64
+
+typedef void SystemProc(void* user_data);
+
+typedef enum SystemFlags {
+	SYSTEM_FLAG_NONE        = 0,
+	SYSTEM_FLAG_MAIN_THREAD = (1 << 0),
+} SystemFlags;
+
+struct SystemScheduler;
+
+typedef struct System {
+	const char* name;
+	SystemProc* proc;
+	void* user_data;
+	ComponentMask reads;
+	ComponentMask writes;
+	SystemFlags flags;
+
+	/* Dependency graph, extended every time a system is added */
+	int dependency_count;
+	int dependent_count;
+	u8 dependents[SCHEDULER_MAX_SYSTEMS];
+	struct SystemScheduler* scheduler;
+
+	/* Reset every run */
+	int pending_dependencies;
+	u64 last_duration_ns;
+	int last_worker;
+} System;
+
+typedef struct SystemScheduler {
+	System systems[SCHEDULER_MAX_SYSTEMS];
+	int system_count;
+
+	/* Main thread systems that are ready to run. Each is queued at most once per run, so this never wraps. */
+	u8 main_queue_lock;
+	int main_queue_head;
+	int main_queue_tail;
+	u8 main_queue[SCHEDULER_MAX_SYSTEMS];
+
+	/* Posted when a main thread system is ready and when the last system finishes */
+	PlatformSemaphore main_wake;
+	int remaining_systems;
+
+	u64 last_run_ns;
+} SystemScheduler;
+
+bool scheduler_systems_conflict(const System* a, const System* b) {
+	return (a->writes & (b->reads | b->writes)) || (b->writes & a->reads);
+}
+
+void scheduler_system_job_internal(void* user_data);
+
+void scheduler_push_ready_internal(SystemScheduler* scheduler, int system_index) {
+	if (scheduler->systems[system_index].flags & SYSTEM_FLAG_MAIN_THREAD) {
+		while (__atomic_test_and_set(&scheduler->main_queue_lock, __ATOMIC_ACQUIRE)) {}
+			ASSERT(scheduler->main_queue_tail < SCHEDULER_MAX_SYSTEMS);
+			scheduler->main_queue[scheduler->main_queue_tail++] = (u8)system_index;
+		__atomic_clear(&scheduler->main_queue_lock, __ATOMIC_RELEASE);
+
+		platform_dependent_semaphore_post(&scheduler->main_wake, 1);
+	} else {
+		job_submit(scheduler_system_job_internal, &scheduler->systems[system_index], NULL);
+	}
+}
+
+/* Returns -1 if no main thread system is ready */
+int scheduler_pop_main_internal(SystemScheduler* scheduler) {
+	int system_index = -1;
+	while (__atomic_test_and_set(&scheduler->main_queue_lock, __ATOMIC_ACQUIRE)) {}
+		if (scheduler->main_queue_head < scheduler->main_queue_tail) {
+			system_index = scheduler->main_queue[scheduler->main_queue_head++];
+		}
+	__atomic_clear(&scheduler->main_queue_lock, __ATOMIC_RELEASE);
+	return system_index;
+}
+
+void scheduler_run_system_internal(System* system) {
+	SystemScheduler* scheduler = system->scheduler;
+
+	u64 start = platform_dependent_time_nanoseconds();
+	system->proc(system->user_data);
+	system->last_duration_ns = platform_dependent_time_nanoseconds() - start;
+	system->last_worker = job_worker_index();
+
+	for (int i = 0; i < system->dependent_count; i++) {
+		int dependent = system->dependents[i];
+		if (__atomic_sub_fetch(&scheduler->systems[dependent].pending_dependencies, 1, __ATOMIC_ACQ_REL) == 0) {
+			scheduler_push_ready_internal(scheduler, dependent);
+		}
+	}
+
+	/* The final post is the last thing to touch the scheduler, scheduler_run doesn't return until it consumed it */
+	if (__atomic_sub_fetch(&scheduler->remaining_systems, 1, __ATOMIC_ACQ_REL) == 0) {
+		platform_dependent_semaphore_post(&scheduler->main_wake, 1);
+	}
+}
+
+void scheduler_system_job_internal(void* user_data) {
+	scheduler_run_system_internal(user_data);
+}
+
+/* The scheduler must not move after this, systems point back at it */
+void scheduler_init(SystemScheduler* scheduler) {
+	*scheduler = (SystemScheduler) {0};
+	platform_dependent_semaphore_init(&scheduler->main_wake, 0);
+}
+
+void scheduler_destroy(SystemScheduler* scheduler) {
+	platform_dependent_semaphore_destroy(&scheduler->main_wake);
+	*scheduler = (SystemScheduler) {0};
+}
+
+/**
+* Adds a system after every system already added, and returns its index.
+* It waits on each earlier system it conflicts with.
+*/
+int scheduler_add_system(SystemScheduler* scheduler, System system) {
+	if (NEVER(scheduler->system_count >= SCHEDULER_MAX_SYSTEMS)) {
+		return -1;
+	}
+	int index = scheduler->system_count++;
+
+	system.dependency_count = 0;
+	system.dependent_count = 0;
+	system.scheduler = scheduler;
+	scheduler->systems[index] = system;
+
+	for (int i = 0; i < index; i++) {
+		System* earlier = &scheduler->systems[i];
+		if (scheduler_systems_conflict(earlier, &scheduler->systems[index])) {
+			earlier->dependents[earlier->dependent_count++] = (u8)index;
+			scheduler->systems[index].dependency_count++;
+		}
+	}
+	return index;
+}
+
+/**
+* Runs every system once and returns when all of them have finished. SYSTEM_FLAG_MAIN_THREAD systems run on the calling thread,
+* so a scheduler with any of those must be run from the main thread. Others can be run from any thread, like the simulation thread.
+*/
+void scheduler_run(SystemScheduler* scheduler) {
+	if (scheduler->system_count == 0) return;
+	u64 start = platform_dependent_time_nanoseconds();
+
+	scheduler->main_queue_head = 0;
+	scheduler->main_queue_tail = 0;
+	int main_thread_count = 0;
+	for (int i = 0; i < scheduler->system_count; i++) {
+		scheduler->systems[i].pending_dependencies = scheduler->systems[i].dependency_count;
+		if (scheduler->systems[i].flags & SYSTEM_FLAG_MAIN_THREAD) main_thread_count++;
+	}
+	__atomic_store_n(&scheduler->remaining_systems, scheduler->system_count, __ATOMIC_RELEASE);
+
+	for (int i = 0; i < scheduler->system_count; i++) {
+		if (scheduler->systems[i].dependency_count == 0) {
+			scheduler_push_ready_internal(scheduler, i);
+		}
+	}
+
+	/**
+	* main_wake is posted once per main thread system and once more by whoever finishes last, and every other post
+	* happens before that final one. Consuming all of them means everything is done, nothing is still posting,
+	* and the semaphore is back at zero for the next run.
+	*/
+	int pending_posts = main_thread_count + 1;
+	while (pending_posts > 0) {
+		int system_index = scheduler_pop_main_internal(scheduler);
+		if (system_index >= 0) {
+			scheduler_run_system_internal(&scheduler->systems[system_index]);
+		} else if (!job_try_run_one()) {
+			/* Nothing to help with, sleep until a main thread system is ready or everything is done */
+			platform_dependent_semaphore_wait(&scheduler->main_wake);
+			pending_posts--;
+		}
+	}
+
+	scheduler->last_run_ns = platform_dependent_time_nanoseconds() - start;
+}
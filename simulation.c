@@ -0,0 +1,262 @@
+#pragma once
+
+#ifndef AFTERHOURS_H
+	#include "afterhours.h"
+#endif
+
+/**
+* Fixed timestep clock. The simulation always advances in steps of exactly 1 / tick_rate seconds no matter how fast
+* frames are drawn, so it behaves the same at 30 and 240 fps. Each frame runs however many whole steps fit in the
+* time that passed, and the leftover fraction of a step is the alpha rendering interpolates with
+* (see entity_store_interpolate).
+*
+* When steps take longer than the time they simulate, every frame would owe more steps than the last one and the
+* game would grind to a halt. The clock never runs more than max_steps_per_frame in one frame and throws the rest of
+* the time away instead, so the simulation slows down rather than stalling.
+*/
+
+#define SIM_DEFAULT_TICK_RATE 120
+#define SIM_DEFAULT_MAX_STEPS_PER_FRAME 8
+
+/* Frames are counted by how many steps they ran, the last bucket holds everything above */
+#define SIM_STEPS_HISTOGRAM_SIZE 16
+
+/* How quickly steps_per_frame_average follows changes, per frame */
+#define SIM_STEPS_AVERAGE_WEIGHT 0.05f
+
+typedef struct FixedStepClock {
+	u64 step_ns;
+	int max_steps_per_frame;
+
+	u64 accumulator_ns;
+	u64 last_time_ns;
+	bool started;
+
+	/* Instrumentation */
+	u64 step_count;
+	u64 frame_count;
+	int steps_this_frame;
+	f32 steps_per_frame_average;
+	/* Frames that hit max_steps_per_frame and dropped time, and how much */
+	u64 clamped_frame_count;
+	u64 dropped_ns;
+	u64 steps_histogram[SIM_STEPS_HISTOGRAM_SIZE];
+} FixedStepClock;
+
+FixedStepClock fixed_step_clock_create(int tick_rate, int max_steps_per_frame) {
+	NEVER(tick_rate <= 0);
+	NEVER(max_steps_per_frame <= 0);
+	return (FixedStepClock) {
+		.step_ns = 1000000000ULL / (u64)tick_rate,
+		.max_steps_per_frame = max_steps_per_frame,
+	};
+}
+
+/**
+* Call once per frame with the current time. Returns how many steps to simulate this frame.
+* The first call only starts the clock and returns 0.
+*/
+int fixed_step_clock_advance(FixedStepClock* clock, u64 now_ns) {
+	if (!clock->started) {
+		clock->started = true;
+		clock->last_time_ns = now_ns;
+		return 0;
+	}
+
+	clock->accumulator_ns += now_ns - clock->last_time_ns;
+	clock->last_time_ns = now_ns;
+
+	u64 steps = clock->accumulator_ns / clock->step_ns;
+	if (steps > (u64)clock->max_steps_per_frame) {
+		/* Spiral of death guard. Keep the fraction of a step so alpha stays continuous. */
+		u64 dropped = (steps - (u64)clock->max_steps_per_frame) * clock->step_ns;
+		clock->accumulator_ns -= dropped;
+		clock->dropped_ns += dropped;
+		clock->clamped_frame_count++;
+		steps = (u64)clock->max_steps_per_frame;
+	}
+	clock->accumulator_ns -= steps * clock->step_ns;
+
+	clock->steps_this_frame = (int)steps;
+	clock->step_count += steps;
+	clock->frame_count++;
+	clock->steps_histogram[(steps < SIM_STEPS_HISTOGRAM_SIZE) ? steps : SIM_STEPS_HISTOGRAM_SIZE - 1]++;
+	clock->steps_per_frame_average += ((f32)steps - clock->steps_per_frame_average) * SIM_STEPS_AVERAGE_WEIGHT;
+
+	return (int)steps;
+}
+
+/* How far between the last step and the next one the current frame is, in [0, 1) */
+f32 fixed_step_clock_alpha(const FixedStepClock* clock) {
+	return (f32)((f64)clock->accumulator_ns / (f64)clock->step_ns);
+}
+
+f32 fixed_step_clock_step_seconds(const FixedStepClock* clock) {
+	return (f32)((f64)clock->step_ns / 1e9);
+}
+
+#ifndef REGION_FRAME_PIPELINE
+/**
+* Runs the simulation for frame N+1 on its own thread while the main thread draws frame N.
+*
+* Everything drawing needs is in a FrameState. There are two of them, each with its own arena: the simulation thread
+* fills one while the main thread draws the other, and they swap once per frame. The simulation is the only thing
+* that touches the entity store. Drawing only ever sees the snapshot, which doesn't change after it's published.
+*
+* A frame takes as long as the slower of the two instead of both added up, at the cost of drawing one frame later.
+*/
+
+#define FRAME_STATE_COUNT 2
+
+typedef struct FrameState {
+	/* Reset every time this state gets produced */
+	Arena arena;
+	u64 frame_index;
+
+	/* What the main thread asked for (see frame_pipeline_swap) */
+	int steps;
+	f32 alpha;
+	/* How long producing it took */
+	u64 produce_ns;
+
+	/* Filled in by the FrameProduceProc */
+	EntitySnapshot entities;
+	TriangleColliderArray colliders;
+	BoundingBox collider_bounds;
+	SpacialHash spacial_hash;
+	/**
+	* Queries against spacial_hash count into it while the state is drawn. Producing the state doesn't reset it, so
+	* the FrameProduceProc can collect what the queries did once the main thread has handed the state back.
+	*/
+	SpacialHashQueryStats spacial_hash_query_stats;
+	/* A copy of the tuner spacial_hash was built with, for drawing its numbers */
+	SpacialHashTuner spacial_hash_tuner;
+} FrameState;
+
+/* Runs state->steps simulation steps and publishes the result into state, allocating from state->arena */
+typedef void FrameProduceProc(void* user_data, FrameState* state);
+
+typedef struct FramePipeline {
+	FrameState states[FRAME_STATE_COUNT];
+	FrameProduceProc* produce;
+	void* user_data;
+
+	PlatformThread thread;
+	bool threaded;
+	PlatformSemaphore start;
+	/* 1 while a state is being produced, the main thread waits on it like on any job */
+	JobCounter in_flight;
+	bool quitting;
+
+	/* The newest complete state and the one being produced, -1 if none is */
+	int completed;
+	int producing;
+	int requested_steps;
+	f32 requested_alpha;
+	u64 frames_produced;
+
+	/* How long the last swap waited for the simulation thread */
+	u64 last_wait_ns;
+} FramePipeline;
+
+void frame_pipeline_produce_internal(FramePipeline* pipeline, int state_index) {
+	FrameState* state = &pipeline->states[state_index];
+	u64 start = platform_dependent_time_nanoseconds();
+
+	arena_restore(&state->arena, 0);
+	state->frame_index = pipeline->frames_produced++;
+	state->steps = pipeline->requested_steps;
+	state->alpha = pipeline->requested_alpha;
+	state->entities = (EntitySnapshot) {0};
+	state->colliders = (TriangleColliderArray) {0};
+	state->collider_bounds = math_aabb_empty();
+	state->spacial_hash = (SpacialHash) {0};
+	state->spacial_hash_tuner = (SpacialHashTuner) {0};
+	pipeline->produce(pipeline->user_data, state);
+
+	state->produce_ns = platform_dependent_time_nanoseconds() - start;
+}
+
+void frame_pipeline_thread_internal(void* user_data) {
+	FramePipeline* pipeline = user_data;
+
+	for (;;) {
+		platform_dependent_semaphore_wait(&pipeline->start);
+		if (__atomic_load_n(&pipeline->quitting, __ATOMIC_ACQUIRE)) break;
+
+		frame_pipeline_produce_internal(pipeline, pipeline->producing);
+		__atomic_sub_fetch(&pipeline->in_flight.value, 1, __ATOMIC_RELEASE);
+	}
+
+	scratch_thread_release();
+}
+
+/**
+* Produces the first state on the calling thread, so there is always something to draw, then starts the simulation thread.
+* Each state's arena reserves arena_reservation bytes. The pipeline must not move after this.
+* If the thread can't be started every frame is produced on the main thread instead.
+*/
+void frame_pipeline_start(FramePipeline* pipeline, u64 arena_reservation, FrameProduceProc* produce, void* user_data) {
+	local_persistent const char* arena_names[FRAME_STATE_COUNT] = { "frame_state_0", "frame_state_1" };
+
+	*pipeline = (FramePipeline) {
+		.produce = produce,
+		.user_data = user_data,
+		.producing = -1,
+	};
+	for (int i = 0; i < FRAME_STATE_COUNT; i++) {
+		pipeline->states[i].arena = (Arena) { .name = arena_names[i], .total_reserved_bytes = arena_reservation, .flags = ARENA_FLAG_HUGE_PAGES };
+	}
+
+	frame_pipeline_produce_internal(pipeline, 0);
+	pipeline->completed = 0;
+
+	platform_dependent_semaphore_init(&pipeline->start, 0);
+	pipeline->threaded = platform_dependent_thread_create(&pipeline->thread, frame_pipeline_thread_internal, pipeline);
+}
+
+/**
+* Call once per frame. Waits for the frame being simulated, starts simulating the next one with steps and alpha
+* (see fixed_step_clock_advance), and returns the newest complete state to draw. The state stays untouched until the next swap.
+*/
+FrameState* frame_pipeline_swap(FramePipeline* pipeline, int steps, f32 alpha) {
+	u64 wait_start = platform_dependent_time_nanoseconds();
+	job_counter_wait(&pipeline->in_flight);
+	pipeline->last_wait_ns = platform_dependent_time_nanoseconds() - wait_start;
+
+	if (pipeline->producing >= 0) {
+		pipeline->completed = pipeline->producing;
+	}
+	pipeline->producing = (pipeline->completed + 1) % FRAME_STATE_COUNT;
+	pipeline->requested_steps = steps;
+	pipeline->requested_alpha = alpha;
+
+	if (!pipeline->threaded) {
+		frame_pipeline_produce_internal(pipeline, pipeline->producing);
+		pipeline->completed = pipeline->producing;
+		pipeline->producing = -1;
+		return &pipeline->states[pipeline->completed];
+	}
+
+	__atomic_add_fetch(&pipeline->in_flight.value, 1, __ATOMIC_ACQ_REL);
+	platform_dependent_semaphore_post(&pipeline->start, 1);
+	return &pipeline->states[pipeline->completed];
+}
+
+/* Lets the frame in flight finish, then stops the simulation thread and frees both states */
+void frame_pipeline_stop(FramePipeline* pipeline) {
+	job_counter_wait(&pipeline->in_flight);
+
+	if (pipeline->threaded) {
+		__atomic_store_n(&pipeline->quitting, true, __ATOMIC_RELEASE);
+		platform_dependent_semaphore_post(&pipeline->start, 1);
+		platform_dependent_thread_join(&pipeline->thread);
+	}
+	platform_dependent_semaphore_destroy(&pipeline->start);
+
+	for (int i = 0; i < FRAME_STATE_COUNT; i++) {
+		arena_free(&pipeline->states[i].arena);
+	}
+	*pipeline = (FramePipeline) {0};
+}
+#endif
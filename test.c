@@ -111,6 +111,1931 @@ void test_raycasting() {
 	hit = collision_ray_intersection_with_aabb(&hash, (Vector3) {-100.0f, -100.0f, -100.0f}, (Vector3) {1.0f, 1.0f, 1.0f}, INFINITY);
 
 	printf("hitpt 2 = (%f, %f, %f)\n", hit.x, hit.y, hit.z);
+
+	/* Straight down onto the triangle */
+	RaycastHit rc_hit = collision_raycast(&hash, MASK_ALL, (Vector3) {10.0f, 10.0f, -10.0f}, VECTOR3_DOWN, 20.0f);
+	ASSERT(rc_hit.collider == &tri);
+	ASSERT(math_f32_abs(rc_hit.point.y) < EPSILON);
+
+	/* Diagonal across several cells, entering the grid from outside */
+	rc_hit = collision_raycast(&hash, MASK_ALL, (Vector3) {-80.0f, 30.0f, -30.0f}, (Vector3) {1.0f, -0.5f, 0.0f}, 200.0f);
+	ASSERT(rc_hit.collider == &tri);
+	ASSERT(math_f32_abs(rc_hit.point.x - -20.0f) < 0.01f);
+
+	/* Too short to reach it */
+	rc_hit = collision_raycast(&hash, MASK_ALL, (Vector3) {10.0f, 10.0f, -10.0f}, VECTOR3_DOWN, 5.0f);
+	ASSERT(rc_hit.collider == NULL);
+
+	/* Filtered out by the mask. The hash keeps its own copy of the masks, so it has to be rebuilt. */
+	tri.mask = MASK_STATIC_GEOMETRY;
+	hash = collision_spacial_hash_create(&collision_arena, arr);
+	rc_hit = collision_raycast(&hash, MASK_ENEMIES, (Vector3) {10.0f, 10.0f, -10.0f}, VECTOR3_DOWN, 20.0f);
+	ASSERT(rc_hit.collider == NULL);
+
+	arena_free(&collision_arena);
+}
+
+void test_arena_registry() {
+	Arena arena = { .name = "test_registry" };
+
+	arena_alloc(&arena, 100);
+	ArenaStats* stats = arena_stats(&arena);
+	ASSERT(stats != NULL);
+	ASSERT(stats->is_live);
+	ASSERT(stats->commit_calls == 1);
+
+	arena_alloc(&arena, PAGE_SIZE * 3);
+	ASSERT(stats->peak_allocated_bytes >= PAGE_SIZE * 3);
+
+	arena_restore(&arena, 0);
+	ASSERT(stats->allocated_bytes == 0);
+
+	int slot = arena.registry_slot;
+	arena_free(&arena);
+	ASSERT(!stats->is_live);
+	ASSERT(stats->decommit_calls == 1);
+	ASSERT(arena.bytes == NULL);
+
+	/* Recreating an arena with the same name reuses its slot and keeps the peak */
+	arena_alloc(&arena, 16);
+	ASSERT(arena.registry_slot == slot);
+	ASSERT(stats->lifetimes == 2);
+	ASSERT(stats->peak_allocated_bytes >= PAGE_SIZE * 3);
+
+	arena_free(&arena);
+}
+
+void test_arena_commit_growth() {
+	Arena arena = { .name = "test_commit_growth", .total_reserved_bytes = 64 * 1024 * 1024 };
+
+	for (int i = 0; i < 10000; i++) {
+		u8* bytes = arena_alloc(&arena, 64);
+		ASSERT(bytes != NULL);
+		bytes[63] = 1;
+	}
+	ArenaStats* stats = arena_stats(&arena);
+
+	/* 640 KiB in 64 KiB granules, doubling: 64, 128, 256, 512, 1024 */
+	ASSERT(stats->commit_calls <= 5);
+	ASSERT(arena.total_committed_bytes >= arena.first_unallocated_byte);
+
+	/* Restoring keeps the commit, so doing it all again costs no syscalls */
+	u64 commits = stats->commit_calls;
+	arena_restore(&arena, 0);
+	for (int i = 0; i < 10000; i++) { arena_alloc(&arena, 64); }
+	ASSERT(stats->commit_calls == commits);
+
+	arena_free(&arena);
+
+	Arena huge = { .name = "test_huge_pages", .flags = ARENA_FLAG_HUGE_PAGES };
+	u8* first = arena_alloc(&huge, 16);
+	ASSERT(((rawptr)first & (HUGE_PAGE_SIZE - 1)) == 0);
+	ASSERT(huge.total_committed_bytes == HUGE_PAGE_SIZE);
+	arena_free(&huge);
+}
+
+typedef struct TestPoolItem {
+	int value;
+	Vector3 position;
+} TestPoolItem;
+
+void test_pool() {
+	Pool pool = { .arena = { .name = "test_pool" } };
+	pool_init_typed(&pool, TestPoolItem, POOL_FLAG_GENERATIONS);
+
+	TestPoolItem* a = pool_alloc_typed(&pool, TestPoolItem);
+	TestPoolItem* b = pool_alloc_typed(&pool, TestPoolItem);
+	TestPoolItem* c = pool_alloc_typed(&pool, TestPoolItem);
+	ASSERT(a != NULL && b != NULL && c != NULL);
+	ASSERT(b->value == 0);
+
+	a->value = 1; b->value = 2; c->value = 3;
+
+	PoolHandle handle_b = pool_handle(&pool, b);
+	ASSERT(handle_b.index == 1);
+	ASSERT(pool_get_typed(&pool, TestPoolItem, handle_b) == b);
+
+	pool_free(&pool, b);
+	ASSERT(pool.live_count == 2);
+	ASSERT(pool_get(&pool, handle_b) == NULL);
+
+	/* DEBUG is defined, so the freed slot is poisoned */
+	ASSERT((u8)((u8*)b)[sizeof(TestPoolItem) - 1] == (u8)POOL_POISON_BYTE);
+
+	/* The freed slot is reused, but the old handle stays stale */
+	TestPoolItem* d = pool_alloc_typed(&pool, TestPoolItem);
+	ASSERT(d == b);
+	ASSERT(d->value == 0);
+	ASSERT(pool_get(&pool, handle_b) == NULL);
+	ASSERT(pool_handle(&pool, d).generation == handle_b.generation + 1);
+
+	PoolHandle handle_a = pool_handle(&pool, a);
+	ASSERT(pool_get(&pool, (PoolHandle) {0}) == NULL);
+
+	pool_reset(&pool);
+	ASSERT(pool.live_count == 0);
+	ASSERT(pool_get(&pool, handle_a) == NULL);
+
+	/* Carving the same slot again after a reset must not bring the handle back */
+	TestPoolItem* e = pool_alloc_typed(&pool, TestPoolItem);
+	ASSERT(e == a);
+	ASSERT(pool_get(&pool, handle_a) == NULL);
+
+	pool_destroy(&pool);
+}
+
+void test_arena_arrays() {
+	Arena arena = { .name = "test_arrays" };
+
+	int* items = NULL;
+	int length = 0;
+	int capacity = 0;
+
+	for (int i = 0; i < 100; i++) { *arena_array_push(&arena, items, length, capacity) = i; }
+	int* first_block = items;
+	ASSERT(length == 100);
+	ASSERT(capacity >= 100);
+
+	/* Nothing else was allocated, so it never moved */
+	for (int i = 100; i < 1000; i++) { *arena_array_push(&arena, items, length, capacity) = i; }
+	ASSERT(items == first_block);
+
+	/* Something on top forces the next growth to relocate */
+	arena_alloc(&arena, 16);
+	int wanted_capacity = capacity + 1;
+	ASSERT(arena_array_reserve(&arena, items, length, capacity, wanted_capacity));
+	ASSERT(items != first_block);
+
+	for (int i = 0; i < length; i++) { ASSERT(items[i] == i); }
+
+	int* bulk = arena_array_push_n(&arena, items, length, capacity, 50);
+	ASSERT(bulk == &items[1000]);
+	ASSERT(length == 1050);
+
+	arena_free(&arena);
+}
+
+void test_scratch_arenas() {
+	TempArena outer = scratch_begin(NULL, 0);
+	u64 outer_start = arena_save(outer.arena);
+
+	/* The result goes into a scratch arena, so the listing has to pick the other one for its temporaries */
+	String models_directory = {.str = "assets/models", .length = sizeof("assets/models") - 1};
+	StringArray files = fs_get_files_in_dir(outer.arena, models_directory);
+	ASSERT(files.len > 0);
+
+	TempArena inner = scratch_begin(&outer.arena, 1);
+	ASSERT(inner.arena != outer.arena);
+
+		/* Clobber whatever the listing might have left in the other scratch arena */
+		char* garbage = arena_alloc(inner.arena, 4096);
+		for (int i = 0; i < 4096; i++) { garbage[i] = 'x'; }
+
+	scratch_end(inner);
+
+	String obj_postfix = {.str = ".obj", .length = sizeof(".obj") - 1};
+	int obj_count = 0;
+	for (int i = 0; i < files.len; i++) {
+		obj_count += string_ends_with(files.strings[i], obj_postfix);
+	}
+	ASSERT(obj_count == 2);
+
+	scratch_end(outer);
+	ASSERT(arena_save(outer.arena) == outer_start);
+}
+
+void test_entity_store() {
+	EntityStore store;
+	entity_store_init(&store);
+
+	Entity entity = { .collider_model_id = MODEL_BOX, .layer = MASK_STATIC_GEOMETRY, .transform = default_transform() };
+	EntityHandle handles[3000];
+	for (int i = 0; i < 3000; i++) {
+		entity.entity_type = i;
+		handles[i] = entity_create(&store, entity);
+		ASSERT(handles[i] != ENTITY_HANDLE_NONE);
+	}
+	/* Crossed a growth boundary without the arrays moving */
+	ASSERT(store.count == 3000);
+	ASSERT(store.capacity >= 3000);
+
+	/* Destroying from the middle moves the last entity into the hole */
+	entity_destroy(&store, handles[10]);
+	ASSERT(!entity_is_alive(&store, handles[10]));
+	ASSERT(entity_dense_index(&store, handles[2999]) == 10);
+
+	Entity fetched = {0};
+	ASSERT(entity_get(&store, handles[2999], &fetched));
+	ASSERT(fetched.entity_type == 2999);
+	ASSERT(fetched.collider_model_id == MODEL_BOX);
+	ASSERT(!entity_get(&store, handles[10], &fetched));
+
+	/* Destroying twice is harmless */
+	entity_destroy(&store, handles[10]);
+	ASSERT(store.count == 2999);
+
+	/* The slot is reused with a new generation, the old handle stays stale */
+	EntityHandle reused = entity_create(&store, entity);
+	ASSERT(entity_handle_index(reused) == entity_handle_index(handles[10]));
+	ASSERT(reused != handles[10]);
+	ASSERT(!entity_is_alive(&store, handles[10]));
+	ASSERT(entity_is_alive(&store, reused));
+
+	ASSERT(!entity_is_alive(&store, ENTITY_HANDLE_NONE));
+
+	for (int i = 0; i < 3000; i++) {
+		entity_destroy(&store, handles[i]);
+	}
+	entity_destroy(&store, reused);
+	ASSERT(store.count == 0);
+
+	entity_store_free(&store);
+}
+
+void test_jobs_mark_range(void* user_data, int start, int end) {
+	int* marks = user_data;
+	for (int i = start; i < end; i++) {
+		__atomic_add_fetch(&marks[i], 1, __ATOMIC_RELAXED);
+	}
+}
+
+typedef struct TestJobsFork {
+	int depth;
+	int* leaves;
+} TestJobsFork;
+
+/* Each job forks two children and waits on them, so workers end up waiting inside jobs */
+void test_jobs_fork(void* user_data) {
+	TestJobsFork* fork = user_data;
+	if (fork->depth == 0) {
+		__atomic_add_fetch(fork->leaves, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	TestJobsFork children[2] = { {fork->depth - 1, fork->leaves}, {fork->depth - 1, fork->leaves} };
+	JobCounter counter = {0};
+	job_submit(test_jobs_fork, &children[0], &counter);
+	job_submit(test_jobs_fork, &children[1], &counter);
+	job_counter_wait(&counter);
+}
+
+void test_job_system() {
+	enum { COUNT = 100000 };
+	local_persistent int marks[COUNT];
+
+	/* Without workers everything runs inline */
+	parallel_for(COUNT, 1000, test_jobs_mark_range, marks);
+	for (int i = 0; i < COUNT; i++) { ASSERT(marks[i] == 1); }
+
+	job_system_init(4);
+	ASSERT(job_worker_index() == 0);
+
+	int grains[] = {1, 7, 1000, COUNT, COUNT * 2};
+	for (int g = 0; g < 5; g++) {
+		for (int i = 0; i < COUNT; i++) { marks[i] = 0; }
+		parallel_for(COUNT, grains[g], test_jobs_mark_range, marks);
+		for (int i = 0; i < COUNT; i++) { ASSERT(marks[i] == 1); }
+	}
+
+	int leaves = 0;
+	TestJobsFork root = {12, &leaves};
+	JobCounter counter = {0};
+	job_submit(test_jobs_fork, &root, &counter);
+	job_counter_wait(&counter);
+	ASSERT(leaves == (1 << 12));
+
+	job_system_shutdown();
+	ASSERT(job_worker_index() == -1);
+}
+
+typedef struct TestSchedulerLog {
+	int next;
+	int order[4];
+} TestSchedulerLog;
+
+typedef struct TestSchedulerSystem {
+	TestSchedulerLog* log;
+	int id;
+} TestSchedulerSystem;
+
+void test_scheduler_record(void* user_data) {
+	TestSchedulerSystem* system = user_data;
+	int slot = __atomic_fetch_add(&system->log->next, 1, __ATOMIC_ACQ_REL);
+	system->log->order[slot] = system->id;
+}
+
+void test_scheduler() {
+	job_system_init(4);
+	SystemScheduler scheduler;
+	scheduler_init(&scheduler);
+
+	TestSchedulerLog log = {0};
+	TestSchedulerSystem systems[4] = { {&log, 0}, {&log, 1}, {&log, 2}, {&log, 3} };
+
+	/* 0 -> 1 -> 3, with 2 independent of everything */
+	scheduler_add_system(&scheduler, (System) { .proc = test_scheduler_record, .user_data = &systems[0], .writes = COMPONENT_TRANSFORM });
+	scheduler_add_system(&scheduler, (System) { .proc = test_scheduler_record, .user_data = &systems[1], .reads = COMPONENT_TRANSFORM, .writes = COMPONENT_TRIANGLE_COLLIDERS });
+	scheduler_add_system(&scheduler, (System) { .proc = test_scheduler_record, .user_data = &systems[2], .reads = COMPONENT_LAYER | COMPONENT_TRANSFORM });
+	scheduler_add_system(&scheduler, (System) { .proc = test_scheduler_record, .user_data = &systems[3], .reads = COMPONENT_TRIANGLE_COLLIDERS, .flags = SYSTEM_FLAG_MAIN_THREAD });
+
+	ASSERT(scheduler.systems[0].dependency_count == 0);
+	ASSERT(scheduler.systems[1].dependency_count == 1);
+	/* Reading what system 0 writes orders it after 0, but not after 1 */
+	ASSERT(scheduler.systems[2].dependency_count == 1);
+	ASSERT(scheduler.systems[3].dependency_count == 1);
+
+	for (int run = 0; run < 200; run++) {
+		log = (TestSchedulerLog) {0};
+		scheduler_run(&scheduler);
+		ASSERT(log.next == 4);
+
+		int position[4];
+		for (int i = 0; i < 4; i++) { position[log.order[i]] = i; }
+		ASSERT(position[0] < position[1]);
+		ASSERT(position[0] < position[2]);
+		ASSERT(position[1] < position[3]);
+		ASSERT(scheduler.systems[3].last_worker == 0);
+	}
+
+	scheduler_destroy(&scheduler);
+	job_system_shutdown();
+}
+
+bool test_vector3_near(Vector3 a, Vector3 b) {
+	return math_f32_abs(a.x - b.x) < 0.0001f && math_f32_abs(a.y - b.y) < 0.0001f && math_f32_abs(a.z - b.z) < 0.0001f;
+}
+
+Vector3 test_matrix_translation(Matrix m) {
+	return (Vector3) {m.m12, m.m13, m.m14};
+}
+
+void test_transform_hierarchy() {
+	EntityStore store;
+	entity_store_init(&store);
+
+	Entity entity = { .transform = default_transform() };
+	entity.transform.translation = (Vector3) {1.0f, 0.0f, 0.0f};
+	EntityHandle a = entity_create(&store, entity);
+
+	entity.parent = a;
+	entity.transform.translation = (Vector3) {0.0f, 2.0f, 0.0f};
+	EntityHandle b = entity_create(&store, entity);
+
+	entity.parent = b;
+	entity.transform.translation = (Vector3) {0.0f, 0.0f, 3.0f};
+	EntityHandle c = entity_create(&store, entity);
+
+	/* Appending deeper entities keeps the arrays sorted */
+	ASSERT(!store.hierarchy_unsorted);
+	ASSERT(store.depth_count == 3);
+
+	entity_store_update_hierarchy(&store);
+	ASSERT(!store.any_dirty);
+	ASSERT(test_vector3_near(test_matrix_translation(entity_world_matrix(&store, c)), (Vector3) {1.0f, 2.0f, 3.0f}));
+
+	/* Moving the root moves the whole subtree */
+	Transform moved = default_transform();
+	moved.translation = (Vector3) {5.0f, 0.0f, 0.0f};
+	entity_set_transform(&store, a, moved);
+	entity_store_update_hierarchy(&store);
+	ASSERT(test_vector3_near(test_matrix_translation(entity_world_matrix(&store, c)), (Vector3) {5.0f, 2.0f, 3.0f}));
+
+	/* Parent rotation applies to the child's offset. 90 degrees around Y takes +Z to +X. */
+	Transform rotated = default_transform();
+	rotated.translation = VECTOR3_ZERO;
+	rotated.rotation = QuaternionFromAxisAngle(VECTOR3_UP, PI / 2.0f);
+	entity_set_transform(&store, b, rotated);
+	entity_store_update_hierarchy(&store);
+	ASSERT(test_vector3_near(test_matrix_translation(entity_world_matrix(&store, c)), (Vector3) {8.0f, 0.0f, 0.0f}));
+
+	/* Reparenting under an entity created later breaks the order until the next update */
+	entity = (Entity) { .transform = default_transform() };
+	entity.transform.translation = (Vector3) {0.0f, 10.0f, 0.0f};
+	EntityHandle d = entity_create(&store, entity);
+	entity_set_parent(&store, a, d);
+	ASSERT(store.hierarchy_unsorted);
+
+	entity_store_update_hierarchy(&store);
+	ASSERT(!store.hierarchy_unsorted);
+	ASSERT(entity_dense_index(&store, d) < entity_dense_index(&store, a));
+	ASSERT(entity_dense_index(&store, a) < entity_dense_index(&store, b));
+	ASSERT(test_vector3_near(test_matrix_translation(entity_world_matrix(&store, c)), (Vector3) {8.0f, 10.0f, 0.0f}));
+
+	/* No cycles */
+	#ifdef UNUSED
+		entity_set_parent(&store, d, c); /* Trips NEVER */
+	#endif
+	ASSERT(entity_is_ancestor(&store, d, c));
+	ASSERT(!entity_is_ancestor(&store, c, d));
+
+	/* Destroying takes the subtree with it */
+	entity_destroy(&store, a);
+	ASSERT(!entity_is_alive(&store, a));
+	ASSERT(!entity_is_alive(&store, b));
+	ASSERT(!entity_is_alive(&store, c));
+	ASSERT(entity_is_alive(&store, d));
+	ASSERT(store.count == 1);
+
+	entity_store_free(&store);
+}
+
+void test_spacial_hash_rasterize() {
+	Arena collision_arena = { .name = "test_rasterize" };
+
+	/* A long thin ramp across the grid diagonally, and a wall lined up with X */
+	TriangleCollider tris[2] = {
+		{ .mask = MASK_STATIC_GEOMETRY, .vert_1 = {0.0f, 0.0f, 0.0f}, .vert_2 = {30.0f, 10.0f, 30.0f}, .vert_3 = {30.0f, 10.0f, 28.0f} },
+		{ .mask = MASK_STATIC_GEOMETRY, .vert_1 = {3.0f, 0.0f, 6.0f}, .vert_2 = {9.0f, 0.0f, 6.0f}, .vert_3 = {3.0f, 5.0f, 6.0f} },
+	};
+	TriangleColliderArray arr = { .colliders = tris, .length = 2 };
+	SpacialHash hash = collision_spacial_hash_create(&collision_arena, arr);
+
+	int ramp_entries = 0;
+	int wall_entries = 0;
+	for (int i = 0; i < hash.slot_count; i++) {
+		for (int j = 0; j < hash.cells[i].count; j++) {
+			ramp_entries += (hash.cells[i].entries[j].collider == &tris[0]);
+			wall_entries += (hash.cells[i].entries[j].collider == &tris[1]);
+		}
+	}
+	/* The bounding rectangle of the ramp is 11 x 11 cells, it only touches the diagonal and its neighbours */
+	ASSERT(ramp_entries < 3 * hash.x_axis_cell_count);
+	/* The wall sits on a row boundary, so it may be in both rows it touches, but only the 3 columns it spans */
+	ASSERT(wall_entries >= 3 && wall_entries <= 6);
+
+	/* Every straight down ray over the ramp still finds it */
+	for (int i = 0; i <= 100; i++) {
+		f32 t = (f32)i / 100.0f;
+		Vector3 on_ramp = Vector3Lerp(tris[0].vert_1, Vector3Lerp(tris[0].vert_2, tris[0].vert_3, 0.5f), t);
+		RaycastHit hit = collision_raycast(&hash, MASK_ALL, Vector3Add(on_ramp, (Vector3) {0.0f, 20.0f, 0.0f}), VECTOR3_DOWN, 40.0f);
+		ASSERT(hit.collider == &tris[0]);
+	}
+	RaycastHit hit = collision_raycast(&hash, MASK_ALL, (Vector3) {4.0f, 1.0f, 0.0f}, VECTOR3_FORWARD, 20.0f);
+	ASSERT(hit.collider == &tris[1]);
+
+	arena_free(&collision_arena);
+}
+
+/* Closest hit over every triangle, for checking collision_raycast against */
+f32 test_raycast_brute_force(TriangleColliderArray arr, Vector3 start, Vector3 direction, f32 length) {
+	f32 closest = INFINITY;
+	for (int i = 0; i < arr.length; i++) {
+		TriangleCollider* col = &arr.colliders[i];
+		f32 t = math_ray_triangle_distance(col->vert_1, col->vert_2, col->vert_3, start, direction);
+		if (t <= length && t < closest) { closest = t; }
+	}
+	return closest;
+}
+
+void test_spacial_hash_columns() {
+	Arena collision_arena = { .name = "test_columns" };
+
+	/* A tower of 40 floors added top first, with a ramp through all of them */
+	int floor_count = 40;
+	TriangleColliderArray arr = {0};
+	TriangleCollider* tris = arena_array_push_n(&collision_arena, arr.colliders, arr.length, arr.capacity, floor_count * 2 + 1);
+	for (int floor = 0; floor < floor_count; floor++) {
+		f32 y = (f32)(floor_count - 1 - floor) * 2.0f;
+		tris[floor * 2 + 0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {0.0f, y, 0.0f}, .vert_2 = {0.0f, y, 9.0f}, .vert_3 = {9.0f, y, 0.0f} };
+		tris[floor * 2 + 1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {9.0f, y, 0.0f}, .vert_2 = {0.0f, y, 9.0f}, .vert_3 = {9.0f, y, 9.0f} };
+	}
+	tris[floor_count * 2] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {1.0f, 0.0f, 1.0f}, .vert_2 = {8.0f, 80.0f, 1.0f}, .vert_3 = {1.0f, 0.0f, 2.0f} };
+
+	SpacialHash hash = collision_spacial_hash_create(&collision_arena, arr);
+
+	for (int i = 0; i < hash.slot_count; i++) {
+		SpaceCell* cell = &hash.cells[i];
+		f32 max_y = -INFINITY;
+		for (int j = 0; j < cell->count; j++) {
+			ColliderColumnEntry entry = cell->entries[j];
+			ASSERT(j == 0 || cell->entries[j - 1].min_y <= entry.min_y);
+			max_y = MAX2(max_y, entry.max_y);
+			ASSERT(entry.max_y_so_far == max_y);
+		}
+		ASSERT(cell->max_y == max_y);
+		ASSERT(cell->min_y == ((cell->count > 0) ? cell->entries[0].min_y : INFINITY));
+	}
+
+	/* Nothing overlapping an interval is left outside the range */
+	SpaceCell* corner = &hash.cells[0];
+	ASSERT(corner->count >= floor_count);
+	for (int i = 0; i < 200; i++) {
+		f32 low = (f32)(i % 90) - 5.0f;
+		f32 high = low + (f32)(i % 7) * 0.75f;
+		int first; int end;
+		collision_space_cell_range(corner, low, high, &first, &end);
+		for (int j = 0; j < corner->count; j++) {
+			bool overlaps = corner->entries[j].min_y <= high && corner->entries[j].max_y >= low;
+			ASSERT(!overlaps || (j >= first && j < end));
+		}
+	}
+
+	/* Probes between floors land on the floor below and hit the one above, like a raycast over every triangle */
+	for (int floor = 0; floor < floor_count - 1; floor++) {
+		Vector3 start = { 4.0f, (f32)floor * 2.0f + 1.0f, 6.0f };
+		RaycastHit down = collision_raycast(&hash, MASK_ALL, start, VECTOR3_DOWN, 100.0f);
+		RaycastHit up = collision_raycast(&hash, MASK_ALL, start, VECTOR3_UP, 100.0f);
+		ASSERT(down.collider != NULL && math_f32_abs(down.point.y - (f32)floor * 2.0f) < 0.001f);
+		ASSERT(up.collider != NULL && math_f32_abs(up.point.y - (f32)(floor + 1) * 2.0f) < 0.001f);
+	}
+
+	u32 seed = 1234;
+	for (int i = 0; i < 500; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 start = { (f32)(seed % 900) / 100.0f, (f32)((seed >> 10) % 800) / 10.0f, (f32)((seed >> 20) % 900) / 100.0f };
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 direction = Vector3Normalize((Vector3) { (f32)(seed % 200) - 100.0f, (f32)((seed >> 8) % 200) - 100.0f, (f32)((seed >> 16) % 200) - 100.0f });
+		if (Vector3Length(direction) < 0.5f) { continue; }
+
+		RaycastHit hit = collision_raycast(&hash, MASK_ALL, start, direction, 30.0f);
+		f32 expected = test_raycast_brute_force(arr, start, direction, 30.0f);
+		if (expected == INFINITY) {
+			ASSERT(hit.collider == NULL);
+		} else {
+			ASSERT(hit.collider != NULL && math_f32_abs(Vector3Distance(hit.point, start) - expected) < 0.001f);
+		}
+	}
+
+	/* Inserting more keeps the cells sorted and holding everything */
+	int corner_count = corner->count;
+	TriangleCollider basement = { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {0.0f, -3.0f, 0.0f}, .vert_2 = {0.0f, -3.0f, 1.0f}, .vert_3 = {1.0f, -3.0f, 0.0f} };
+	collision_spacial_hash_insert_array(&collision_arena, &hash, (TriangleColliderArray) { .colliders = &basement, .length = 1 });
+	ASSERT(corner->count == corner_count + 1);
+	ASSERT(corner->entries[0].collider == &basement && corner->min_y == -3.0f);
+	RaycastHit hit = collision_raycast(&hash, MASK_ALL, (Vector3) {0.2f, -1.0f, 0.2f}, VECTOR3_DOWN, 10.0f);
+	ASSERT(hit.collider == &basement);
+
+	arena_free(&collision_arena);
+}
+
+void test_ground_height() {
+	Arena collision_arena = { .name = "test_ground_height" };
+
+	/* Rolling terrain 30 x 30 wide, a bridge over part of it and an enemy standing on the terrain */
+	int quads = 20;
+	f32 quad_width = 1.5f;
+	TriangleColliderArray arr = {0};
+	TriangleCollider* tris = arena_array_push_n(&collision_arena, arr.colliders, arr.length, arr.capacity, quads * quads * 2 + 3);
+	for (int z = 0; z < quads; z++) {
+		for (int x = 0; x < quads; x++) {
+			Vector3 p[4];
+			for (int corner = 0; corner < 4; corner++) {
+				f32 px = (f32)(x + (corner & 1)) * quad_width;
+				f32 pz = (f32)(z + (corner >> 1)) * quad_width;
+				p[corner] = (Vector3) { px, sinf(px * 0.3f) * cosf(pz * 0.2f) * 2.0f, pz };
+			}
+			tris[(z * quads + x) * 2 + 0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[0], .vert_2 = p[2], .vert_3 = p[1] };
+			tris[(z * quads + x) * 2 + 1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[1], .vert_2 = p[2], .vert_3 = p[3] };
+		}
+	}
+	TriangleCollider* bridge = &tris[quads * quads * 2];
+	bridge[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {5.0f, 6.0f, 5.0f}, .vert_2 = {5.0f, 6.0f, 25.0f}, .vert_3 = {10.0f, 6.0f, 5.0f} };
+	bridge[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {10.0f, 6.0f, 5.0f}, .vert_2 = {5.0f, 6.0f, 25.0f}, .vert_3 = {10.0f, 6.0f, 25.0f} };
+	TriangleCollider* enemy = &tris[quads * quads * 2 + 2];
+	*enemy = (TriangleCollider) { .mask = MASK_ENEMIES, .vert_1 = {20.0f, 4.0f, 20.0f}, .vert_2 = {20.0f, 4.0f, 22.0f}, .vert_3 = {22.0f, 4.0f, 20.0f} };
+
+	SpacialHash hash = collision_spacial_hash_create(&collision_arena, arr);
+
+	/* The SIMD line test agrees with the plain one, misses and vertical triangles included */
+	#define TEST_LINE_COUNT 37
+	const Vector3* triangles[TEST_LINE_COUNT];
+	f32 heights[TEST_LINE_COUNT], heights_scalar[TEST_LINE_COUNT];
+	for (int i = 0; i < TEST_LINE_COUNT; i++) {
+		triangles[i] = &tris[i * 7].vert_1;
+	}
+	TriangleCollider wall = { .vert_1 = {0.5f, 0.0f, 0.5f}, .vert_2 = {0.5f, 3.0f, 0.5f}, .vert_3 = {1.0f, 0.0f, 1.0f} };
+	triangles[3] = &wall.vert_1;
+	math_batch_vertical_line_triangles(heights, 0.6f, 0.8f, triangles, TEST_LINE_COUNT);
+	math_batch_vertical_line_triangles_scalar(heights_scalar, 0.6f, 0.8f, triangles, TEST_LINE_COUNT);
+	ASSERT(heights[0] > -INFINITY && heights[3] == -INFINITY);
+	for (int i = 0; i < TEST_LINE_COUNT; i++) {
+		ASSERT(heights[i] == heights_scalar[i] || math_f32_abs(heights[i] - heights_scalar[i]) < 0.0001f);
+	}
+
+	/* Same as a raycast straight down, from above the bridge, under it and in between floors of nothing */
+	#define TEST_GROUND_PROBES 400
+	Vector3 probes[TEST_GROUND_PROBES];
+	GroundHit batch_hits[TEST_GROUND_PROBES];
+	u32 seed = 99;
+	for (int i = 0; i < TEST_GROUND_PROBES; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		probes[i] = (Vector3) { (f32)(seed % 3200) / 100.0f - 1.0f, (f32)((seed >> 12) % 100) / 10.0f - 1.0f, (f32)((seed >> 20) % 3200) / 100.0f - 1.0f };
+	}
+	collision_ground_height_batch(&hash, NULL, probes, TEST_GROUND_PROBES, MASK_STATIC_GEOMETRY, batch_hits);
+
+	int hits = 0;
+	for (int i = 0; i < TEST_GROUND_PROBES; i++) {
+		GroundHit ground = collision_ground_height(&hash, probes[i].x, probes[i].z, probes[i].y, MASK_STATIC_GEOMETRY);
+		RaycastHit ray = collision_raycast(&hash, MASK_STATIC_GEOMETRY, probes[i], VECTOR3_DOWN, 100.0f);
+		ASSERT(batch_hits[i].collider == ground.collider && batch_hits[i].height == ground.height);
+
+		if (ray.collider == NULL) {
+			ASSERT(ground.collider == NULL && ground.height == -INFINITY);
+		} else {
+			ASSERT(ground.collider != NULL && math_f32_abs(ground.height - ray.point.y) < 0.001f);
+			hits++;
+		}
+	}
+	ASSERT(hits > TEST_GROUND_PROBES / 2);
+
+	GroundHit under_bridge = collision_ground_height(&hash, 7.0f, 15.0f, 5.0f, MASK_STATIC_GEOMETRY);
+	GroundHit on_bridge = collision_ground_height(&hash, 7.0f, 15.0f, 10.0f, MASK_STATIC_GEOMETRY);
+	ASSERT(under_bridge.collider != NULL && under_bridge.height < 3.0f);
+	ASSERT((on_bridge.collider == &bridge[0] || on_bridge.collider == &bridge[1]) && on_bridge.height == 6.0f);
+	ASSERT(collision_ground_height(&hash, 20.5f, 20.5f, 10.0f, MASK_ENEMIES).collider == enemy);
+	ASSERT(collision_ground_height(&hash, 20.5f, 20.5f, 10.0f, MASK_STATIC_GEOMETRY).height < 4.0f);
+	ASSERT(collision_ground_height(&hash, -50.0f, 0.0f, 10.0f, MASK_ALL).collider == NULL);
+
+	/* The heightmap is close on the terrain, exact on the bridge, and leaves probes under the bridge to the real query */
+	GroundHeightmap heightmap = collision_ground_heightmap_create(&collision_arena, &hash, MASK_STATIC_GEOMETRY, 4);
+	collision_ground_height_batch(&hash, &heightmap, probes, TEST_GROUND_PROBES, MASK_STATIC_GEOMETRY, batch_hits);
+	for (int i = 0; i < TEST_GROUND_PROBES; i++) {
+		GroundHit ground = collision_ground_height(&hash, probes[i].x, probes[i].z, probes[i].y, MASK_STATIC_GEOMETRY);
+		ASSERT((batch_hits[i].collider == NULL) == (ground.collider == NULL));
+		ASSERT(ground.collider == NULL || math_f32_abs(batch_hits[i].height - ground.height) < 0.05f);
+	}
+
+	Vector3 bridge_probes[2] = { {7.0f, 10.0f, 15.0f}, {7.0f, 5.0f, 15.0f} };
+	GroundHit bridge_hits[2];
+	collision_ground_height_batch(&hash, &heightmap, bridge_probes, 2, MASK_STATIC_GEOMETRY, bridge_hits);
+	ASSERT(bridge_hits[0].height == 6.0f);
+	ASSERT(bridge_hits[1].height == under_bridge.height && bridge_hits[1].collider == under_bridge.collider);
+
+	#undef TEST_LINE_COUNT
+	#undef TEST_GROUND_PROBES
+	arena_free(&collision_arena);
+}
+
+void test_spacial_hash_sparse() {
+	Arena collision_arena = { .name = "test_sparse", .total_reserved_bytes = 256 * 1024 * 1024 };
+
+	/* Two islands of rolling terrain, 3 km apart */
+	int quads = 12;
+	Vector3 island_offsets[2] = { {0.0f, 0.0f, 0.0f}, {3000.0f, 5.0f, 2000.0f} };
+	TriangleColliderArray arr = {0};
+	TriangleCollider* tris = arena_array_push_n(&collision_arena, arr.colliders, arr.length, arr.capacity, 2 * quads * quads * 2);
+	for (int island = 0; island < 2; island++) {
+		for (int z = 0; z < quads; z++) {
+			for (int x = 0; x < quads; x++) {
+				Vector3 p[4];
+				for (int corner = 0; corner < 4; corner++) {
+					f32 px = (f32)(x + (corner & 1)) * 2.0f;
+					f32 pz = (f32)(z + (corner >> 1)) * 2.0f;
+					p[corner] = Vector3Add(island_offsets[island], (Vector3) { px, sinf(px * 0.4f) * cosf(pz * 0.3f), pz });
+				}
+				TriangleCollider* quad = &tris[((island * quads + z) * quads + x) * 2];
+				quad[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[0], .vert_2 = p[2], .vert_3 = p[1] };
+				quad[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[1], .vert_2 = p[2], .vert_3 = p[3] };
+			}
+		}
+	}
+	BoundingBox bounds = collision_get_world_bounding_box(arr);
+
+	u64 dense_start = arena_save(&collision_arena);
+	SpacialHash dense = collision_spacial_hash_create_with_mode(&collision_arena, arr, bounds, SPACIAL_HASH_DENSE);
+	u64 sparse_start = arena_save(&collision_arena);
+	SpacialHash sparse = collision_spacial_hash_create_with_mode(&collision_arena, arr, bounds, SPACIAL_HASH_SPARSE);
+	u64 sparse_bytes = arena_save(&collision_arena) - sparse_start;
+
+	ASSERT(sparse_bytes * 20 < sparse_start - dense_start);
+	ASSERT(sparse.slot_count < 2048 && sparse.occupied_slot_count * 2 <= sparse.slot_count);
+	ASSERT(collision_spacial_hash_get_cell(&sparse, 500, 300) == NULL);
+	ASSERT(collision_spacial_hash_get_cell(&dense, 500, 300)->count == 0);
+
+	/* Every cell holds the same triangles in the same order */
+	int occupied = 0;
+	for (int slot = 0; slot < sparse.slot_count; slot++) {
+		if (sparse.cells[slot].count == 0) { continue; }
+		occupied++;
+
+		SpaceCellKey key = collision_spacial_hash_slot_key(&sparse, slot);
+		const SpaceCell* dense_cell = collision_spacial_hash_get_cell(&dense, key.x, key.z);
+		ASSERT(collision_spacial_hash_get_cell(&sparse, key.x, key.z) == &sparse.cells[slot]);
+		ASSERT(dense_cell->count == sparse.cells[slot].count);
+		for (int i = 0; i < dense_cell->count; i++) {
+			ASSERT(dense_cell->entries[i].collider == sparse.cells[slot].entries[i].collider);
+		}
+	}
+	ASSERT(occupied == sparse.occupied_slot_count);
+
+	/* Rays on each island, and from one to the other */
+	u32 seed = 7;
+	for (int i = 0; i < 300; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 offset = island_offsets[i & 1];
+		Vector3 start = Vector3Add(offset, (Vector3) { (f32)(seed % 2400) / 100.0f, 3.0f, (f32)((seed >> 12) % 2400) / 100.0f });
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 direction = { (f32)(seed % 200) - 100.0f, -(f32)((seed >> 8) % 100) - 1.0f, (f32)((seed >> 16) % 200) - 100.0f };
+		if (i % 10 == 0) { direction = Vector3Subtract(Vector3Add(island_offsets[1], (Vector3) {12.0f, -1.0f, 12.0f}), start); }
+
+		RaycastHit dense_hit = collision_raycast(&dense, MASK_ALL, start, direction, 5000.0f);
+		RaycastHit sparse_hit = collision_raycast(&sparse, MASK_ALL, start, direction, 5000.0f);
+		ASSERT(dense_hit.collider == sparse_hit.collider);
+		ASSERT(dense_hit.collider == NULL || Vector3Equals(dense_hit.point, sparse_hit.point));
+
+		GroundHit dense_ground = collision_ground_height(&dense, start.x, start.z, start.y, MASK_ALL);
+		GroundHit sparse_ground = collision_ground_height(&sparse, start.x, start.z, start.y, MASK_ALL);
+		ASSERT(dense_ground.collider == sparse_ground.collider && dense_ground.height == sparse_ground.height);
+	}
+
+	/* Adding a lot more to the sparse hash grows its table and keeps what was there */
+	TriangleColliderArray more = {0};
+	TriangleCollider* extra = arena_array_push_n(&collision_arena, more.colliders, more.length, more.capacity, 500);
+	for (int i = 0; i < 500; i++) {
+		f32 x = 100.0f + (f32)i * 4.0f;
+		extra[i] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {x, 0.0f, 1000.0f}, .vert_2 = {x, 0.0f, 1001.0f}, .vert_3 = {x + 1.0f, 0.0f, 1000.0f} };
+	}
+	int slots_before = sparse.slot_count;
+	collision_spacial_hash_insert_array(&collision_arena, &sparse, more);
+	ASSERT(sparse.slot_count > slots_before && sparse.occupied_slot_count * 2 <= sparse.slot_count);
+	ASSERT(collision_ground_height(&sparse, 1100.2f, 1000.2f, 5.0f, MASK_ALL).collider == &extra[250]);
+	ASSERT(collision_ground_height(&sparse, 1.0f, 1.0f, 5.0f, MASK_ALL).collider == collision_ground_height(&dense, 1.0f, 1.0f, 5.0f, MASK_ALL).collider);
+
+	arena_free(&collision_arena);
+}
+
+/* quads x quads quads of rolling terrain, quad_width wide each, two triangles per quad */
+TriangleColliderArray test_create_terrain(Arena* arena, int quads, f32 quad_width) {
+	TriangleColliderArray arr = {0};
+	TriangleCollider* tris = arena_array_push_n(arena, arr.colliders, arr.length, arr.capacity, quads * quads * 2);
+	for (int z = 0; z < quads; z++) {
+		for (int x = 0; x < quads; x++) {
+			Vector3 p[4];
+			for (int corner = 0; corner < 4; corner++) {
+				f32 px = (f32)(x + (corner & 1)) * quad_width;
+				f32 pz = (f32)(z + (corner >> 1)) * quad_width;
+				p[corner] = (Vector3) { px, sinf(px * 0.4f / quad_width) * quad_width, pz };
+			}
+			TriangleCollider* quad = &tris[(z * quads + x) * 2];
+			quad[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[0], .vert_2 = p[2], .vert_3 = p[1] };
+			quad[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = p[1], .vert_2 = p[2], .vert_3 = p[3] };
+		}
+	}
+	return arr;
+}
+
+void test_spacial_hash_tuning() {
+	Arena collision_arena = { .name = "test_tuning" };
+
+	/* The width follows the size of the triangles, and only the square root of it past the default width */
+	TriangleColliderArray small = test_create_terrain(&collision_arena, 24, 1.0f);
+	TriangleColliderArray large = test_create_terrain(&collision_arena, 24, 8.0f);
+	SpacialHashTuning small_tuning = collision_spacial_hash_tune(small, collision_get_world_bounding_box(small), SPACIAL_HASH_DENSE);
+	SpacialHashTuning large_tuning = collision_spacial_hash_tune(large, collision_get_world_bounding_box(large), SPACIAL_HASH_DENSE);
+	ASSERT(math_f32_abs(small_tuning.median_triangle_extent - 1.0f) < 0.001f);
+	ASSERT(math_f32_abs(small_tuning.cell_width - 1.0f) < 0.001f);
+	ASSERT(math_f32_abs(large_tuning.median_triangle_extent - 8.0f) < 0.01f);
+	/* DEFAULT_CELL_WIDTH is 3, test_raycasting undefines it */
+	ASSERT(math_f32_abs(large_tuning.cell_width - sqrtf(8.0f * 3.0f)) < 0.01f);
+	ASSERT(small_tuning.triangle_density > 1.9f && small_tuning.triangle_density < 2.1f);
+
+	/* Two small triangles far apart don't make a huge dense grid, a sparse one can afford small cells */
+	TriangleCollider far_apart[2] = {
+		{ .mask = MASK_ALL, .vert_1 = {0.0f, 0.0f, 0.0f}, .vert_2 = {0.0f, 0.0f, 1.0f}, .vert_3 = {1.0f, 0.0f, 0.0f} },
+		{ .mask = MASK_ALL, .vert_1 = {1000.0f, 0.0f, 1000.0f}, .vert_2 = {1000.0f, 0.0f, 1001.0f}, .vert_3 = {1001.0f, 0.0f, 1000.0f} },
+	};
+	TriangleColliderArray far_array = { .colliders = far_apart, .length = 2 };
+	BoundingBox far_bound = collision_get_world_bounding_box(far_array);
+	SpacialHashTuning dense_tuning = collision_spacial_hash_tune(far_array, far_bound, SPACIAL_HASH_DENSE);
+	SpacialHashTuning sparse_tuning = collision_spacial_hash_tune(far_array, far_bound, SPACIAL_HASH_SPARSE);
+	ASSERT(sparse_tuning.cell_width < 2.0f && dense_tuning.cell_width > 100.0f);
+	SpacialHash far_hash = collision_spacial_hash_create_with_cell_width(&collision_arena, far_array, far_bound, SPACIAL_HASH_DENSE, dense_tuning.cell_width);
+	ASSERT(far_hash.slot_count <= 2 * 16);
+
+	/* Every cell lands in the bucket of its count */
+	SpacialHash small_hash = collision_spacial_hash_create_with_cell_width(&collision_arena, small, collision_get_world_bounding_box(small), SPACIAL_HASH_DENSE, 2.5f);
+	i64 buckets[SPACIAL_HASH_HISTOGRAM_SIZE];
+	collision_spacial_hash_occupancy_histogram(&small_hash, buckets);
+	i64 expected[SPACIAL_HASH_HISTOGRAM_SIZE] = {0};
+	for (int slot = 0; slot < small_hash.slot_count; slot++) {
+		int count = small_hash.cells[slot].count;
+		int bucket = 0;
+		while (count > 0 && bucket < SPACIAL_HASH_HISTOGRAM_SIZE - 1) { count >>= 1; bucket++; }
+		expected[bucket]++;
+	}
+	for (int i = 0; i < SPACIAL_HASH_HISTOGRAM_SIZE; i++) {
+		ASSERT(buckets[i] == expected[i]);
+	}
+
+	/* Started far too coarse, the online tuner brings the width back down and queries still agree */
+	BoundingBox small_bound = collision_get_world_bounding_box(small);
+	SpacialHash reference = collision_spacial_hash_create_with_bounds(&collision_arena, small, small_bound);
+	SpacialHashTuner tuner = { .mode = SPACIAL_HASH_DENSE };
+	collision_spacial_hash_create_tuned(&collision_arena, &tuner, small, small_bound);
+	ASSERT(tuner.cell_width == small_tuning.cell_width);
+	tuner.cell_width *= 4.0f;
+	tuner.stats = (SpacialHashQueryStats) {0};
+
+	/* Counted on the side like a frame state's hash, then collected */
+	SpacialHashQueryStats frame_stats = {0};
+	u32 seed = 99;
+	int rounds = 0;
+	bool changed = true;
+	while (changed && rounds < 8) {
+		SpacialHash tuned = collision_spacial_hash_create_tuned(&collision_arena, &tuner, small, small_bound);
+		tuned.query_stats = &frame_stats;
+		for (int i = 0; i < 300; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			Vector3 start = { (f32)(seed % 2400) / 100.0f, 3.0f, (f32)((seed >> 12) % 2400) / 100.0f };
+			Vector3 direction = { (f32)((seed >> 4) % 200) - 100.0f, -60.0f, (f32)((seed >> 16) % 200) - 100.0f };
+
+			RaycastHit hit = collision_raycast(&tuned, MASK_ALL, start, direction, 100.0f);
+			ASSERT(hit.collider == collision_raycast(&reference, MASK_ALL, start, direction, 100.0f).collider);
+		}
+		ASSERT(frame_stats.query_count == 300 && tuner.stats.query_count == 0);
+		collision_spacial_hash_tuner_collect(&tuner, &frame_stats);
+		ASSERT(tuner.stats.query_count == 300 && frame_stats.query_count == 0);
+
+		changed = collision_spacial_hash_tuner_update(&tuner);
+		ASSERT(tuner.stats.query_count == 0);
+		rounds++;
+	}
+	ASSERT(!changed && tuner.retune_count > 0);
+	ASSERT(tuner.cell_width < small_tuning.cell_width * 2.0f && tuner.cell_width > small_tuning.cell_width * 0.5f);
+
+	arena_free(&collision_arena);
+}
+
+void test_spacial_hash_layer_masks() {
+	Arena collision_arena = { .name = "test_layer_masks" };
+
+	/* Static terrain with a few enemy triangles hovering over one corner of it */
+	TriangleColliderArray arr = test_create_terrain(&collision_arena, 24, 1.0f);
+	int static_count = arr.length;
+	TriangleCollider* enemies = arena_array_push_n(&collision_arena, arr.colliders, arr.length, arr.capacity, 20);
+	for (int i = 0; i < 20; i++) {
+		f32 x = (f32)(i % 5) * 1.7f + 0.3f;
+		f32 z = (f32)(i / 5) * 1.9f + 0.2f;
+		enemies[i] = (TriangleCollider) { .mask = MASK_ENEMIES, .vert_1 = {x, 2.0f, z}, .vert_2 = {x, 2.5f, z + 1.0f}, .vert_3 = {x + 1.0f, 2.0f, z} };
+	}
+	SpacialHash hash = collision_spacial_hash_create(&collision_arena, arr);
+
+	for (int slot = 0; slot < hash.slot_count; slot++) {
+		const SpaceCell* cell = &hash.cells[slot];
+		LayerMask mask = MASK_NO_COLLISIONS;
+		for (int i = 0; i < cell->count; i++) {
+			ASSERT(cell->entries[i].mask == cell->entries[i].collider->mask);
+			mask |= cell->entries[i].mask;
+		}
+		ASSERT(cell->mask == mask);
+	}
+
+	/* Each layer only ever hits its own triangles */
+	u32 seed = 3;
+	LayerMask query_masks[3] = { MASK_ENEMIES, MASK_STATIC_GEOMETRY, MASK_ALL };
+	for (int i = 0; i < 600; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 start = { (f32)(seed % 2400) / 100.0f, 4.0f, (f32)((seed >> 12) % 2400) / 100.0f };
+		Vector3 direction = { (f32)((seed >> 4) % 200) - 100.0f, -100.0f, (f32)((seed >> 16) % 200) - 100.0f };
+		LayerMask query_mask = query_masks[i % 3];
+
+		f32 expected = INFINITY;
+		for (int j = 0; j < arr.length; j++) {
+			TriangleCollider* col = &arr.colliders[j];
+			if (!(col->mask & query_mask)) { continue; }
+			f32 t = math_ray_triangle_distance(col->vert_1, col->vert_2, col->vert_3, start, Vector3Normalize(direction));
+			if (t <= 100.0f && t < expected) { expected = t; }
+		}
+
+		RaycastHit hit = collision_raycast(&hash, query_mask, start, direction, 100.0f);
+		ASSERT((hit.collider == NULL) == (expected == INFINITY));
+		ASSERT(hit.collider == NULL || ((hit.collider->mask & query_mask) && math_f32_abs(Vector3Distance(start, hit.point) - expected) < 0.001f));
+	}
+
+	/* Away from the enemies, an enemy query doesn't look at a single cell or triangle */
+	SpacialHashQueryStats stats = {0};
+	hash.query_stats = &stats;
+	for (int i = 0; i < 50; i++) {
+		Vector3 start = { 14.0f + (f32)(i % 10), 4.0f, 14.0f + (f32)(i / 10) };
+		ASSERT(collision_raycast(&hash, MASK_ENEMIES, start, (Vector3) {0.3f, -1.0f, 0.2f}, 100.0f).collider == NULL);
+		ASSERT(collision_ground_height(&hash, start.x, start.z, start.y, MASK_ENEMIES).collider == NULL);
+		ASSERT(collision_ground_height(&hash, start.x, start.z, start.y, MASK_STATIC_GEOMETRY).collider - arr.colliders < static_count);
+	}
+	ASSERT(stats.query_count == 150);
+	ASSERT(stats.cell_count == 50);
+
+	arena_free(&collision_arena);
+}
+
+/* Distance between a capsule moved t along motion and a triangle */
+f32 test_capsule_triangle_distance(Vector3 start, Vector3 end, Vector3 motion, f32 t, const Vector3* triangle) {
+	Vector3 segment_point; Vector3 triangle_point;
+	math_closest_points_segment_triangle(
+		Vector3Add(start, Vector3Scale(motion, t)), Vector3Add(end, Vector3Scale(motion, t)),
+		triangle[0], triangle[1], triangle[2], &segment_point, &triangle_point
+	);
+	return Vector3Distance(segment_point, triangle_point);
+}
+
+f32 test_random_f32(u32* seed, f32 min, f32 max) {
+	*seed = *seed * 1664525u + 1013904223u;
+	return min + (max - min) * (f32)(*seed >> 8) / (f32)(1 << 24);
+}
+
+Vector3 test_random_vector3(u32* seed, f32 min, f32 max) {
+	f32 x = test_random_f32(seed, min, max);
+	f32 y = test_random_f32(seed, min, max);
+	f32 z = test_random_f32(seed, min, max);
+	return (Vector3) { x, y, z };
+}
+
+void test_sweeps() {
+	Arena arena = { .name = "test_sweeps" };
+
+	/* Against random triangles, the time the capsule first gets radius close by walking along the motion */
+	u32 seed = 5;
+	int hit_count = 0;
+	for (int i = 0; i < 2000; i++) {
+		Vector3 triangle[3] = { test_random_vector3(&seed, -2.0f, 2.0f), test_random_vector3(&seed, -2.0f, 2.0f), test_random_vector3(&seed, -2.0f, 2.0f) };
+		const Vector3* triangle_pointer = triangle;
+		f32 radius = test_random_f32(&seed, 0.1f, 0.6f);
+		Vector3 start = test_random_vector3(&seed, -4.0f, 4.0f);
+		Vector3 end = (i % 2 == 0) ? start : Vector3Add(start, test_random_vector3(&seed, -1.5f, 1.5f));
+		Vector3 motion = Vector3Subtract(test_random_vector3(&seed, -1.0f, 1.0f), start);
+		if (test_capsule_triangle_distance(start, end, motion, 0.0f, triangle) <= radius + 0.001f) { continue; }
+
+		f32 t;
+		math_batch_sweep_capsule_triangles_scalar(&t, start, end, radius, motion, &triangle_pointer, 1);
+
+		/* Nothing closer than radius before t, and exactly radius at t */
+		int steps = 400;
+		for (int step = 0; step <= steps; step++) {
+			f32 s = (f32)step / (f32)steps;
+			if (s > t - 0.002f) { break; }
+			ASSERT(test_capsule_triangle_distance(start, end, motion, s, triangle) > radius - 0.001f);
+		}
+		if (t != INFINITY) {
+			ASSERT(t >= 0.0f && t <= 1.0f);
+			ASSERT(math_f32_abs(test_capsule_triangle_distance(start, end, motion, t, triangle) - radius) < 0.001f);
+			hit_count++;
+		}
+	}
+	ASSERT(hit_count > 200);
+
+	/* The SIMD version agrees with the scalar one, including a capsule already through the triangles */
+	int batch_count = 203;
+	Vector3* batch_vertices = arena_alloc(&arena, sizeof(*batch_vertices) * 3 * batch_count);
+	const Vector3** batch_triangles = arena_alloc(&arena, sizeof(*batch_triangles) * batch_count);
+	for (int i = 0; i < batch_count; i++) {
+		for (int v = 0; v < 3; v++) { batch_vertices[3 * i + v] = test_random_vector3(&seed, -2.0f, 2.0f); }
+		batch_triangles[i] = &batch_vertices[3 * i];
+	}
+	f32* times = arena_alloc(&arena, sizeof(*times) * batch_count);
+	f32* scalar_times = arena_alloc(&arena, sizeof(*scalar_times) * batch_count);
+	Vector3 capsules[3][2] = { { {-3, 0, 0}, {-3, 0, 0} }, { {-3, -1, 0}, {-3, 1, 0.5f} }, { {0, -3, 0}, {0, 3, 0} } };
+	for (int c = 0; c < 3; c++) {
+		Vector3 motion = { 6.0f, 0.5f, 0.3f };
+		math_batch_sweep_capsule_triangles(times, capsules[c][0], capsules[c][1], 0.3f, motion, batch_triangles, batch_count);
+		math_batch_sweep_capsule_triangles_scalar(scalar_times, capsules[c][0], capsules[c][1], 0.3f, motion, batch_triangles, batch_count);
+		for (int i = 0; i < batch_count; i++) {
+			ASSERT((times[i] == INFINITY) == (scalar_times[i] == INFINITY));
+			ASSERT(times[i] == INFINITY || math_f32_abs(times[i] - scalar_times[i]) < 0.0001f);
+		}
+	}
+
+	/* A ball dropped on flat ground lands on it, and can roll along it once it's there */
+	TriangleColliderArray ground = {0};
+	TriangleCollider* floor_triangles = arena_array_push_n(&arena, ground.colliders, ground.length, ground.capacity, 2);
+	floor_triangles[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {-10, 0, -10}, .vert_2 = {-10, 0, 10}, .vert_3 = {10, 0, -10} };
+	floor_triangles[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {10, 0, -10}, .vert_2 = {-10, 0, 10}, .vert_3 = {10, 0, 10} };
+	SpacialHash floor_hash = collision_spacial_hash_create(&arena, ground);
+
+	SweepHit hit = collision_sweep_sphere(&floor_hash, MASK_ALL, (Vector3) {1, 5, 1}, 1.0f, (Vector3) {0, -10, 0});
+	ASSERT(hit.collider != NULL && math_f32_abs(hit.time - 0.4f) < 0.0001f);
+	ASSERT(test_vector3_near(hit.normal, VECTOR3_UP) && test_vector3_near(hit.point, (Vector3) {1, 0, 1}));
+	ASSERT(collision_sweep_sphere(&floor_hash, MASK_ALL, (Vector3) {1, 1, 1}, 1.0f, (Vector3) {3, 0, 2}).collider == NULL);
+	ASSERT(collision_sweep_sphere(&floor_hash, MASK_ALL, (Vector3) {1, 1, 1}, 1.0f, (Vector3) {3, 1, 2}).collider == NULL);
+	/* Sunk into it a little, it can still get out but not further in */
+	ASSERT(collision_sweep_sphere(&floor_hash, MASK_ALL, (Vector3) {1, 0.9f, 1}, 1.0f, (Vector3) {3, 0.5f, 2}).collider == NULL);
+	hit = collision_sweep_sphere(&floor_hash, MASK_ALL, (Vector3) {1, 0.9f, 1}, 1.0f, (Vector3) {3, -0.5f, 2});
+	ASSERT(hit.collider != NULL && hit.time == 0.0f && test_vector3_near(hit.normal, VECTOR3_UP));
+	ASSERT(collision_sweep_sphere(&floor_hash, MASK_ENEMIES, (Vector3) {1, 5, 1}, 1.0f, (Vector3) {0, -10, 0}).collider == NULL);
+
+	/* A capsule lying down, hanging over the edge of the floor, lands on it with its middle */
+	hit = collision_sweep_capsule(&floor_hash, MASK_ALL, (Vector3) {8, 3, 0}, (Vector3) {14, 3, 0}, 0.5f, (Vector3) {0, -4, 0});
+	ASSERT(hit.collider != NULL && math_f32_abs(hit.time - 0.625f) < 0.0001f && test_vector3_near(hit.normal, VECTOR3_UP));
+
+	/* Already through the floor, it gets stopped right away and pushed back up */
+	hit = collision_sweep_capsule(&floor_hash, MASK_ALL, (Vector3) {0, -1, 0}, (Vector3) {0, 1, 0}, 0.5f, (Vector3) {0, -1, 0});
+	ASSERT(hit.collider != NULL && hit.time == 0.0f && test_vector3_near(hit.normal, VECTOR3_UP));
+
+	/* Through the spacial hash, the same as trying every triangle, on terrain with walls scattered over it */
+	TriangleColliderArray terrain = test_create_terrain(&arena, 24, 1.0f);
+	TriangleCollider* walls = arena_array_push_n(&arena, terrain.colliders, terrain.length, terrain.capacity, 60);
+	for (int i = 0; i < 60; i++) {
+		Vector3 corner = { test_random_f32(&seed, 0.0f, 22.0f), -1.0f, test_random_f32(&seed, 0.0f, 22.0f) };
+		Vector3 along = (i % 2 == 0) ? (Vector3) {2, 0, 0.3f} : (Vector3) {0.2f, 0, 2};
+		walls[i] = (TriangleCollider) {
+			.mask = (i % 3 == 0) ? MASK_ENEMIES : MASK_STATIC_GEOMETRY,
+			.vert_1 = corner, .vert_2 = Vector3Add(corner, along), .vert_3 = Vector3Add(corner, (Vector3) {along.x * 0.5f, 3.0f, along.z * 0.5f}),
+		};
+	}
+	SpacialHashQueryStats stats = {0};
+	SpacialHash hash = collision_spacial_hash_create(&arena, terrain);
+	hash.query_stats = &stats;
+
+	int sweep_count = 300;
+	CapsuleSweep* sweeps = arena_alloc(&arena, sizeof(*sweeps) * sweep_count);
+	SweepHit* hits = arena_alloc(&arena, sizeof(*hits) * sweep_count);
+	for (int i = 0; i < sweep_count; i++) {
+		Vector3 start = { test_random_f32(&seed, -2.0f, 26.0f), test_random_f32(&seed, 1.5f, 3.0f), test_random_f32(&seed, -2.0f, 26.0f) };
+		sweeps[i] = (CapsuleSweep) {
+			.start = start,
+			.end = (i % 3 == 0) ? start : Vector3Add(start, (Vector3) {0, 1.0f, 0}),
+			.radius = test_random_f32(&seed, 0.2f, 0.5f),
+			.motion = { test_random_f32(&seed, -5.0f, 5.0f), test_random_f32(&seed, -3.0f, 1.0f), test_random_f32(&seed, -5.0f, 5.0f) },
+		};
+	}
+	collision_sweep_capsule_batch(&hash, MASK_STATIC_GEOMETRY, sweeps, sweep_count, hits);
+	ASSERT(stats.query_count == (u64)sweep_count);
+
+	hit_count = 0;
+	for (int i = 0; i < sweep_count; i++) {
+		/* Starting out stuck in something is checked above */
+		bool starts_touching = false;
+		f32 expected = INFINITY;
+		for (int j = 0; j < terrain.length; j++) {
+			if (!(terrain.colliders[j].mask & MASK_STATIC_GEOMETRY)) { continue; }
+			const Vector3* triangle = &terrain.colliders[j].vert_1;
+			starts_touching |= test_capsule_triangle_distance(sweeps[i].start, sweeps[i].end, sweeps[i].motion, 0.0f, triangle) <= sweeps[i].radius;
+			f32 t;
+			math_batch_sweep_capsule_triangles_scalar(&t, sweeps[i].start, sweeps[i].end, sweeps[i].radius, sweeps[i].motion, &triangle, 1);
+			expected = MIN2(expected, t);
+		}
+		if (starts_touching) { continue; }
+
+		ASSERT((hits[i].collider == NULL) == (expected == INFINITY));
+		if (hits[i].collider == NULL) {
+			ASSERT(hits[i].time == 1.0f);
+			continue;
+		}
+		hit_count++;
+		ASSERT(math_f32_abs(hits[i].time - expected) < 0.0001f);
+		ASSERT(hits[i].collider->mask & MASK_STATIC_GEOMETRY);
+		ASSERT(math_f32_abs(Vector3Length(hits[i].normal) - 1.0f) < 0.001f);
+		ASSERT(Vector3DotProduct(hits[i].normal, sweeps[i].motion) <= 0.0001f);
+
+		SweepHit single = collision_sweep_capsule(&hash, MASK_STATIC_GEOMETRY, sweeps[i].start, sweeps[i].end, sweeps[i].radius, sweeps[i].motion);
+		ASSERT(single.collider == hits[i].collider && single.time == hits[i].time);
+	}
+	ASSERT(hit_count > sweep_count / 4);
+
+	arena_free(&arena);
+}
+
+/* The sides and top of a box, the bottom is left out */
+void test_push_box(Arena* arena, TriangleColliderArray* array, Vector3 min, Vector3 max) {
+	Vector3 c[8];
+	for (int i = 0; i < 8; i++) {
+		c[i] = (Vector3) { (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z };
+	}
+	int quads[5][4] = { {2, 3, 6, 7}, {0, 1, 2, 3}, {4, 5, 6, 7}, {0, 2, 4, 6}, {1, 3, 5, 7} };
+	TriangleCollider* tris = arena_array_push_n(arena, array->colliders, array->length, array->capacity, 10);
+	for (int q = 0; q < 5; q++) {
+		const int* v = quads[q];
+		tris[2 * q + 0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = c[v[0]], .vert_2 = c[v[1]], .vert_3 = c[v[2]] };
+		tris[2 * q + 1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = c[v[1]], .vert_2 = c[v[3]], .vert_3 = c[v[2]] };
+	}
+}
+
+/* Walks by step every move for count moves, with a little gravity so it stays on the ground */
+void test_character_walk(CharacterController* controller, const SpacialHash* hash, Vector3 step, int count) {
+	for (int i = 0; i < count; i++) {
+		character_controller_move(controller, hash, Vector3Add(step, (Vector3) { 0.0f, -0.05f, 0.0f }));
+	}
+}
+
+void test_character_controller() {
+	Arena arena = { .name = "test_character_controller" };
+
+	/* A floor with a lane for every test, along x */
+	TriangleColliderArray scene = {0};
+	TriangleCollider* floor_triangles = arena_array_push_n(&arena, scene.colliders, scene.length, scene.capacity, 2);
+	floor_triangles[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {-20, 0, -20}, .vert_2 = {-20, 0, 20}, .vert_3 = {20, 0, -20} };
+	floor_triangles[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {20, 0, -20}, .vert_2 = {-20, 0, 20}, .vert_3 = {20, 0, 20} };
+	/* A wall, a low step, a block too tall to step on, and a platform to walk off of */
+	test_push_box(&arena, &scene, (Vector3) {3, 0, -18}, (Vector3) {4, 3, -10});
+	test_push_box(&arena, &scene, (Vector3) {2, 0, -8}, (Vector3) {6, 0.2f, -4});
+	test_push_box(&arena, &scene, (Vector3) {2, 0, -2}, (Vector3) {6, 1.0f, 2});
+	test_push_box(&arena, &scene, (Vector3) {-6, 0, 10}, (Vector3) {3, 0.15f, 14});
+	/* A slope at 60 degrees, too steep to walk up */
+	TriangleCollider* ramp = arena_array_push_n(&arena, scene.colliders, scene.length, scene.capacity, 2);
+	Vector3 ramp_top = { 4.0f, 2.0f * tanf(60.0f * DEG2RAD), 0.0f };
+	ramp[0] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {2, 0, 4}, .vert_2 = {2, 0, 8}, .vert_3 = {ramp_top.x, ramp_top.y, 4} };
+	ramp[1] = (TriangleCollider) { .mask = MASK_STATIC_GEOMETRY, .vert_1 = {2, 0, 8}, .vert_2 = {ramp_top.x, ramp_top.y, 8}, .vert_3 = {ramp_top.x, ramp_top.y, 4} };
+	SpacialHash hash = collision_spacial_hash_create(&arena, scene);
+
+	f32 radius = 0.4f;
+	f32 skin = CHARACTER_SKIN_WIDTH;
+
+	/* Dropped, it lands on the floor and stands on it */
+	CharacterController controller = character_controller_create((Vector3) {0, 1, -14}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	character_controller_move(&controller, &hash, (Vector3) {0, -2, 0});
+	ASSERT(controller.grounded && test_vector3_near(controller.ground_normal, VECTOR3_UP));
+	ASSERT(controller.position.y >= 0.0f && controller.position.y <= 2.0f * skin);
+
+	/* Into the wall at an angle, it stops at the wall and slides along it */
+	character_controller_move(&controller, &hash, (Vector3) {5, 0, 2});
+	ASSERT(controller.position.x <= 3.0f - radius && controller.position.x > 3.0f - radius - 2.0f * skin);
+	ASSERT(controller.position.z > -12.5f && controller.grounded);
+	ASSERT(controller.contact_count == 1 && test_vector3_near(controller.contacts[0].normal, (Vector3) {-1, 0, 0}));
+	/* It's still touching the wall, so the next move starts out sliding along it without finding it again */
+	Vector3 before = controller.position;
+	character_controller_move(&controller, &hash, (Vector3) {1, 0, 1});
+	ASSERT(controller.sweep_count == 2);
+	ASSERT(math_f32_abs(controller.position.x - before.x) < 0.0001f && math_f32_abs(controller.position.z - (before.z + 1.0f)) < 0.0001f);
+	/* Walking away lets go of it */
+	character_controller_move(&controller, &hash, (Vector3) {-1, 0, 0});
+	ASSERT(controller.contact_count == 0 && math_f32_abs(controller.position.x - (before.x - 1.0f)) < 0.0001f);
+
+	/* Up onto the low step */
+	controller = character_controller_create((Vector3) {0, 0, -6}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	test_character_walk(&controller, &hash, (Vector3) {0.1f, 0, 0}, 50);
+	ASSERT(controller.grounded && controller.position.x > 3.9f);
+	ASSERT(controller.position.y > 0.2f - 0.001f && controller.position.y < 0.2f + 2.0f * skin);
+
+	/* Not onto the tall block */
+	controller = character_controller_create((Vector3) {0, 0, 0}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	test_character_walk(&controller, &hash, (Vector3) {0.1f, 0, 0}, 40);
+	ASSERT(controller.grounded && controller.position.y < 2.0f * skin);
+	ASSERT(controller.position.x <= 2.0f - radius && controller.position.x > 2.0f - radius - 2.0f * skin);
+
+	/* Not up the steep slope, not even a little */
+	controller = character_controller_create((Vector3) {0, 0, 6}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	test_character_walk(&controller, &hash, (Vector3) {0.1f, 0, 0}, 40);
+	ASSERT(controller.grounded && controller.position.y < 2.0f * skin && controller.position.x < 2.5f);
+
+	/* Off the platform, it snaps down the small drop instead of flying off it */
+	controller = character_controller_create((Vector3) {0, 0.15f, 12}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	character_controller_move(&controller, &hash, (Vector3) {0, -0.1f, 0});
+	for (int i = 0; i < 60; i++) {
+		character_controller_move(&controller, &hash, (Vector3) {0.1f, 0, 0});
+		ASSERT(controller.grounded);
+	}
+	ASSERT(controller.position.x > 5.9f && controller.position.y < 2.0f * skin);
+	/* Without snapping it leaves the platform flying */
+	controller = character_controller_create((Vector3) {0, 0.15f, 12}, radius, 1.8f, MASK_STATIC_GEOMETRY);
+	controller.snap_distance = 0.0f;
+	character_controller_move(&controller, &hash, (Vector3) {0, -0.1f, 0});
+	for (int i = 0; i < 60; i++) { character_controller_move(&controller, &hash, (Vector3) {0.1f, 0, 0}); }
+	ASSERT(!controller.grounded && controller.position.y > 0.15f);
+	/* Jumping isn't standing */
+	character_controller_move(&controller, &hash, (Vector3) {0, 0.5f, 0});
+	ASSERT(!controller.grounded && controller.position.y > 0.6f);
+
+	/* Many at once over the job system end up where moving them one at a time does */
+	job_system_init(4);
+	u32 seed = 11;
+	int count = 300;
+	CharacterController* batch = arena_alloc(&arena, sizeof(*batch) * count);
+	CharacterController* single = arena_alloc(&arena, sizeof(*single) * count);
+	Vector3* motions = arena_alloc(&arena, sizeof(*motions) * count);
+	for (int i = 0; i < count; i++) {
+		Vector3 spawn = { test_random_f32(&seed, -15.0f, 15.0f), test_random_f32(&seed, 0.0f, 2.0f), test_random_f32(&seed, -15.0f, 15.0f) };
+		batch[i] = character_controller_create(spawn, radius, 1.8f, MASK_STATIC_GEOMETRY);
+		single[i] = batch[i];
+	}
+	for (int frame = 0; frame < 10; frame++) {
+		for (int i = 0; i < count; i++) {
+			motions[i] = (Vector3) { test_random_f32(&seed, -0.5f, 0.5f), -0.1f, test_random_f32(&seed, -0.5f, 0.5f) };
+			character_controller_move(&single[i], &hash, motions[i]);
+		}
+		character_controllers_move(batch, motions, count, &hash);
+		for (int i = 0; i < count; i++) {
+			Vector3 a = batch[i].position; Vector3 b = single[i].position;
+			ASSERT(a.x == b.x && a.y == b.y && a.z == b.z && batch[i].grounded == single[i].grounded);
+		}
+	}
+	job_system_shutdown();
+
+	arena_free(&arena);
+}
+
+bool test_frustum_contains(const Frustum* frustum, Vector3 point) {
+	for (int i = 0; i < 6; i++) {
+		Vector4 plane = frustum->planes[i];
+		if ((plane.x * point.x) + (plane.y * point.y) + (plane.z * point.z) + plane.w < 0.0f) { return false; }
+	}
+	return true;
+}
+
+/* Points spread over a triangle, corners included */
+#define TEST_TRIANGLE_SAMPLES 8
+
+Vector3 test_triangle_sample(const TriangleCollider* tri, int u, int v) {
+	f32 a = (f32)u / TEST_TRIANGLE_SAMPLES;
+	f32 b = (f32)v / TEST_TRIANGLE_SAMPLES;
+	return Vector3Add(tri->vert_1, Vector3Add(Vector3Scale(Vector3Subtract(tri->vert_2, tri->vert_1), a), Vector3Scale(Vector3Subtract(tri->vert_3, tri->vert_1), b)));
+}
+
+/* What an overlap query found, each entity only once, and the first of them in out_entities */
+void test_check_overlap_results(const EntityHandle* entities, int found, int max_entities, u8* seen, int entity_count) {
+	for (int i = 0; i < entity_count; i++) { seen[i] = 0; }
+	for (int i = 0; i < MIN2(found, max_entities); i++) {
+		u32 index = entity_handle_index(entities[i]);
+		ASSERT(entities[i] != ENTITY_HANDLE_NONE && index < (u32)entity_count);
+		ASSERT(!seen[index]);
+		seen[index] = 1;
+	}
+}
+
+void test_overlaps() {
+	Arena arena = { .name = "test_overlaps" };
+
+	/* A triangle cutting through a box with every corner outside it, and one next to it that only its bounds overlap */
+	BoundingBox unit = { {0, 0, 0}, {1, 1, 1} };
+	ASSERT(math_triangle_aabb_overlap((Vector3) {-10, 0.5f, -10}, (Vector3) {10, 0.5f, -10}, (Vector3) {0, 0.5f, 10}, unit));
+	ASSERT(!math_triangle_aabb_overlap((Vector3) {0.9f, 2.5f, 0.5f}, (Vector3) {2.5f, 0.9f, 0.5f}, (Vector3) {2.5f, 2.5f, 0.5f}, unit));
+	ASSERT(!math_triangle_aabb_overlap((Vector3) {-10, 1.5f, -10}, (Vector3) {10, 1.5f, -10}, (Vector3) {0, 1.5f, 10}, unit));
+
+	/* Against points spread over random triangles, any of them in the box means they overlap */
+	u32 seed = 17;
+	for (int i = 0; i < 500; i++) {
+		TriangleCollider tri = { .vert_1 = test_random_vector3(&seed, -2.0f, 3.0f), .vert_2 = test_random_vector3(&seed, -2.0f, 3.0f), .vert_3 = test_random_vector3(&seed, -2.0f, 3.0f) };
+		bool inside = false;
+		for (int u = 0; u <= TEST_TRIANGLE_SAMPLES; u++) {
+			for (int v = 0; u + v <= TEST_TRIANGLE_SAMPLES; v++) {
+				Vector3 p = test_triangle_sample(&tri, u, v);
+				inside |= p.x >= 0.0f && p.y >= 0.0f && p.z >= 0.0f && p.x <= 1.0f && p.y <= 1.0f && p.z <= 1.0f;
+			}
+		}
+		if (inside) { ASSERT(math_triangle_aabb_overlap(tri.vert_1, tri.vert_2, tri.vert_3, unit)); }
+	}
+
+	/* A 90 degree camera looking down -z from the origin, with its near plane at 1 and far plane at 100 */
+	Matrix view = MatrixLookAt((Vector3) {0, 0, 0}, (Vector3) {0, 0, -1}, VECTOR3_UP);
+	Frustum frustum = math_frustum_from_matrix(MatrixMultiply(view, MatrixPerspective(90.0 * DEG2RAD, 1.0, 1.0, 100.0)));
+	ASSERT(test_frustum_contains(&frustum, (Vector3) {0, 0, -10}) && test_frustum_contains(&frustum, (Vector3) {9, -9, -10}));
+	ASSERT(!test_frustum_contains(&frustum, (Vector3) {0, 0, 10}) && !test_frustum_contains(&frustum, (Vector3) {11, 0, -10}));
+	ASSERT(!test_frustum_contains(&frustum, (Vector3) {0, 0, -0.5f}) && !test_frustum_contains(&frustum, (Vector3) {0, 0, -101}));
+	BoundingBox frustum_bounds = math_frustum_bounds(&frustum);
+	ASSERT(Vector3Distance(frustum_bounds.min, (Vector3) {-100, -100, -100}) < 0.01f && Vector3Distance(frustum_bounds.max, (Vector3) {100, 100, -1}) < 0.01f);
+	ASSERT(math_frustum_aabb_overlap(&frustum, (BoundingBox) { {-1, -1, -6}, {1, 1, -4} }));
+	ASSERT(!math_frustum_aabb_overlap(&frustum, (BoundingBox) { {-1, -1, 4}, {1, 1, 6} }));
+	ASSERT(!math_frustum_triangle_overlap(&frustum, (Vector3) {20, 0, -10}, (Vector3) {30, 0, -10}, (Vector3) {20, 5, -10}));
+
+	/* Terrain where every 6 triangles are an entity, big walls over many cells, and some triangles with no entity */
+	TriangleColliderArray scene = test_create_terrain(&arena, 24, 1.0f);
+	for (int i = 0; i < scene.length; i++) { scene.colliders[i].entity_id = (EntityHandle)((i / 6) + 1); }
+	int wall_count = 40;
+	TriangleCollider* walls = arena_array_push_n(&arena, scene.colliders, scene.length, scene.capacity, wall_count);
+	for (int i = 0; i < wall_count; i++) {
+		Vector3 corner = { test_random_f32(&seed, 0.0f, 20.0f), -1.0f, test_random_f32(&seed, 0.0f, 20.0f) };
+		Vector3 along = { test_random_f32(&seed, -4.0f, 4.0f), 0.0f, test_random_f32(&seed, -4.0f, 4.0f) };
+		walls[i] = (TriangleCollider) {
+			.mask = (i % 3 == 0) ? MASK_ENEMIES : MASK_STATIC_GEOMETRY,
+			.entity_id = (i % 5 == 0) ? ENTITY_HANDLE_NONE : (EntityHandle)(1000 + i),
+			.vert_1 = corner, .vert_2 = Vector3Add(corner, along), .vert_3 = Vector3Add(corner, (Vector3) {along.x * 0.5f, 4.0f, along.z * 0.5f}),
+		};
+	}
+	int entity_count = 1000 + wall_count;
+	BoundingBox world = collision_get_world_bounding_box(scene);
+
+	OverlapStamps stamps = collision_overlap_stamps_create(&arena, scene.length, entity_count);
+	int max_entities = 512;
+	EntityHandle* entities = arena_alloc(&arena, sizeof(*entities) * max_entities);
+	u8* seen = arena_alloc(&arena, (u64)entity_count);
+	u8* expected = arena_alloc(&arena, (u64)entity_count);
+	TriangleCollider** triangles = arena_alloc(&arena, sizeof(*triangles) * scene.length);
+	u8* triangle_seen = arena_alloc(&arena, (u64)scene.length);
+
+	SpacialHashMode modes[2] = { SPACIAL_HASH_DENSE, SPACIAL_HASH_SPARSE };
+	for (int m = 0; m < 2; m++) {
+		/* Cells smaller than the triangles, so they're in several each */
+		SpacialHash hash = collision_spacial_hash_create_with_cell_width(&arena, scene, world, modes[m], 0.6f);
+		SpacialHashQueryStats stats = {0};
+		hash.query_stats = &stats;
+
+		/* AABBs and spheres, the same as testing every triangle */
+		for (int q = 0; q < 200; q++) {
+			Vector3 center = { test_random_f32(&seed, -2.0f, 26.0f), test_random_f32(&seed, -1.5f, 3.0f), test_random_f32(&seed, -2.0f, 26.0f) };
+			f32 size = test_random_f32(&seed, 0.1f, 4.0f);
+			LayerMask mask = (q % 4 == 0) ? MASK_ENEMIES : MASK_ALL;
+			bool sphere = (q % 2 == 1);
+			BoundingBox box = { Vector3SubtractValue(center, size), Vector3AddValue(center, size) };
+
+			int found = sphere
+				? collision_overlap_sphere(&hash, &stamps, mask, center, size, entities, max_entities)
+				: collision_overlap_aabb(&hash, &stamps, mask, box, entities, max_entities);
+			ASSERT(found <= max_entities);
+			test_check_overlap_results(entities, found, max_entities, seen, entity_count);
+
+			int expected_count = 0;
+			for (int i = 0; i < entity_count; i++) { expected[i] = 0; }
+			for (int i = 0; i < scene.length; i++) {
+				const TriangleCollider* tri = &scene.colliders[i];
+				if (!(tri->mask & mask) || tri->entity_id == ENTITY_HANDLE_NONE || expected[tri->entity_id]) { continue; }
+				bool touches = sphere
+					? Vector3Distance(math_closest_point_triangle(center, tri->vert_1, tri->vert_2, tri->vert_3), center) <= size
+					: math_triangle_aabb_overlap(tri->vert_1, tri->vert_2, tri->vert_3, box);
+				if (touches) {
+					expected[tri->entity_id] = 1;
+					expected_count++;
+				}
+			}
+			ASSERT(found == expected_count);
+			for (int i = 0; i < found; i++) { ASSERT(expected[entities[i]]); }
+		}
+
+		/* A box around everything tests every triangle once, however many cells it's in */
+		stats = (SpacialHashQueryStats) {0};
+		int everything = collision_overlap_aabb(&hash, &stamps, MASK_ALL, world, entities, max_entities);
+		ASSERT(stats.entry_count <= (u64)scene.length);
+		ASSERT(everything == (24 * 24 * 2) / 6 + (wall_count - wall_count / 5));
+		/* Only room for 3, it still says how many there are */
+		ASSERT(collision_overlap_aabb(&hash, &stamps, MASK_ALL, world, entities, 3) == everything);
+		test_check_overlap_results(entities, everything, 3, seen, entity_count);
+		/* Triangles come back with an entity or without, each once */
+		for (int q = 0; q < 100; q++) {
+			Vector3 center = { test_random_f32(&seed, -2.0f, 26.0f), test_random_f32(&seed, -1.5f, 3.0f), test_random_f32(&seed, -2.0f, 26.0f) };
+			f32 size = test_random_f32(&seed, 0.1f, 4.0f);
+			bool sphere = (q % 2 == 1);
+			BoundingBox box = { Vector3SubtractValue(center, size), Vector3AddValue(center, size) };
+
+			int found = sphere
+				? collision_overlap_sphere_triangles(&hash, &stamps, MASK_ALL, center, size, triangles, scene.length)
+				: collision_overlap_aabb_triangles(&hash, &stamps, MASK_ALL, box, triangles, scene.length);
+			for (int i = 0; i < scene.length; i++) { triangle_seen[i] = 0; }
+			for (int i = 0; i < found; i++) {
+				i64 index = triangles[i] - scene.colliders;
+				ASSERT(index >= 0 && index < scene.length && !triangle_seen[index]);
+				triangle_seen[index] = 1;
+			}
+
+			int expected_count = 0;
+			for (int i = 0; i < scene.length; i++) {
+				const TriangleCollider* tri = &scene.colliders[i];
+				bool touches = sphere
+					? Vector3Distance(math_closest_point_triangle(center, tri->vert_1, tri->vert_2, tri->vert_3), center) <= size
+					: math_triangle_aabb_overlap(tri->vert_1, tri->vert_2, tri->vert_3, box);
+				if (touches) {
+					ASSERT(triangle_seen[i]);
+					expected_count++;
+				}
+			}
+			ASSERT(found == expected_count);
+		}
+		ASSERT(collision_overlap_aabb_triangles(&hash, &stamps, MASK_ALL, world, triangles, scene.length) == scene.length);
+		/* The walls without an entity are only found as triangles */
+		int entityless = 0;
+		for (int i = 0; i < scene.length; i++) { entityless += (triangles[i]->entity_id == ENTITY_HANDLE_NONE); }
+		ASSERT(entityless == wall_count / 5);
+
+		/* The stamp wrapping around clears what the old ones saw */
+		stamps.stamp = 0xFFFFFFFFu;
+		ASSERT(collision_overlap_aabb(&hash, &stamps, MASK_ALL, world, entities, max_entities) == everything);
+		ASSERT(collision_overlap_aabb(&hash, &stamps, MASK_ALL, world, entities, max_entities) == everything);
+
+		/* Frustums miss nothing inside them, and only find what's at least nearly inside */
+		for (int q = 0; q < 50; q++) {
+			Vector3 eye = { test_random_f32(&seed, -5.0f, 29.0f), test_random_f32(&seed, 1.0f, 8.0f), test_random_f32(&seed, -5.0f, 29.0f) };
+			Vector3 target = { test_random_f32(&seed, 0.0f, 24.0f), 0.0f, test_random_f32(&seed, 0.0f, 24.0f) };
+			Matrix projection = MatrixPerspective(test_random_f32(&seed, 20.0f, 90.0f) * DEG2RAD, 1.5, 0.5, test_random_f32(&seed, 5.0f, 40.0f));
+			Frustum camera = math_frustum_from_matrix(MatrixMultiply(MatrixLookAt(eye, target, VECTOR3_UP), projection));
+
+			int found = collision_overlap_frustum(&hash, &stamps, MASK_ALL, &camera, entities, max_entities);
+			ASSERT(found <= max_entities);
+			test_check_overlap_results(entities, found, max_entities, seen, entity_count);
+
+			for (int i = 0; i < entity_count; i++) { expected[i] = 0; }
+			for (int i = 0; i < scene.length; i++) {
+				const TriangleCollider* tri = &scene.colliders[i];
+				if (tri->entity_id == ENTITY_HANDLE_NONE) { continue; }
+				if (math_frustum_triangle_overlap(&camera, tri->vert_1, tri->vert_2, tri->vert_3)) { expected[tri->entity_id] = 1; }
+
+				for (int u = 0; u <= TEST_TRIANGLE_SAMPLES; u++) {
+					for (int v = 0; u + v <= TEST_TRIANGLE_SAMPLES; v++) {
+						if (test_frustum_contains(&camera, test_triangle_sample(tri, u, v))) { ASSERT(seen[tri->entity_id]); }
+					}
+				}
+			}
+			for (int i = 0; i < found; i++) { ASSERT(expected[entities[i]]); }
+		}
+	}
+
+	arena_free(&arena);
+}
+
+int test_compare_dynamic_pairs(const void* a, const void* b) {
+	const DynamicPair* pair_a = a;
+	const DynamicPair* pair_b = b;
+	if (pair_a->a != pair_b->a) { return pair_a->a - pair_b->a; }
+	return pair_a->b - pair_b->b;
+}
+
+DynamicShape test_random_dynamic_shape(u32* seed, Vector3 center) {
+	*seed = *seed * 1664525u + 1013904223u;
+	f32 size = 0.2f + (f32)((*seed >> 8) % 100) / 100.0f;
+	switch ((*seed >> 20) % 3) {
+		case 0:  return dynamic_shape_sphere(center, size);
+		case 1:  return dynamic_shape_capsule(center, Vector3Add(center, (Vector3) {0.0f, 1.5f, size}), size * 0.5f);
+		default: return dynamic_shape_aabb((BoundingBox) { center, Vector3Add(center, (Vector3) {size, size * 2.0f, size}) });
+	}
+}
+
+void test_dynamic_colliders() {
+	Arena arena = { .name = "test_dynamic_colliders" };
+
+	BoundingBox box = dynamic_shape_bounds(dynamic_shape_capsule((Vector3) {1, 2, 3}, (Vector3) {0, 4, 3}, 0.5f));
+	ASSERT(test_vector3_near(box.min, (Vector3) {-0.5f, 1.5f, 2.5f}));
+	ASSERT(test_vector3_near(box.max, (Vector3) {1.5f, 4.5f, 3.5f}));
+
+	int max_count = 300;
+	DynamicColliderSet set;
+	dynamic_colliders_init(&set, max_count);
+
+	LayerMask layers[3] = { MASK_PLAYER, MASK_ENEMIES, MASK_ENEMIES };
+	LayerMask collide_masks[3] = { MASK_ALL, MASK_PLAYER, MASK_NO_COLLISIONS };
+	Vector3* positions = arena_alloc(&arena, sizeof(*positions) * max_count);
+	bool* live = arena_alloc(&arena, sizeof(*live) * max_count);
+	for (int i = 0; i < max_count; i++) { live[i] = false; }
+
+	u32 seed = 11;
+	for (int i = 0; i < 200; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		Vector3 position = { (f32)(seed % 3000) / 100.0f, (f32)((seed >> 8) % 400) / 100.0f, (f32)((seed >> 16) % 3000) / 100.0f };
+		int id = dynamic_collider_add(&set, (DynamicCollider) {
+			.shape = test_random_dynamic_shape(&seed, position),
+			.layer = layers[i % 3],
+			.collide_mask = collide_masks[i % 3],
+		});
+		ASSERT(id == i);
+		positions[id] = position;
+		live[id] = true;
+	}
+
+	for (int step = 0; step < 40; step++) {
+		/* Everything drifts a little, a few teleport, some leave and some come back */
+		for (int id = 0; id < set.id_count; id++) {
+			if (!live[id]) { continue; }
+			seed = seed * 1664525u + 1013904223u;
+			if (seed % 50 == 0) {
+				positions[id] = (Vector3) { (f32)((seed >> 8) % 3000) / 100.0f, 1.0f, (f32)((seed >> 16) % 3000) / 100.0f };
+			} else {
+				positions[id].x += (f32)((seed >> 8) % 41 - 20) / 100.0f;
+				positions[id].z += (f32)((seed >> 16) % 41 - 20) / 100.0f;
+			}
+			dynamic_collider_set_shape(&set, id, test_random_dynamic_shape(&seed, positions[id]));
+
+			if ((seed >> 24) % 40 == 0) {
+				dynamic_collider_remove(&set, id);
+				live[id] = false;
+			}
+		}
+		for (int i = 0; i < 5; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			Vector3 position = { (f32)(seed % 3000) / 100.0f, 1.0f, (f32)((seed >> 16) % 3000) / 100.0f };
+			int id = dynamic_collider_add(&set, (DynamicCollider) {
+				.shape = test_random_dynamic_shape(&seed, position),
+				.layer = layers[i % 3],
+				.collide_mask = collide_masks[i % 3],
+			});
+			ASSERT(id >= 0 && !live[id]);
+			positions[id] = position;
+			live[id] = true;
+		}
+
+		dynamic_colliders_update(&set);
+		for (int i = 1; i < set.proxy_count; i++) {
+			ASSERT(set.proxies[i - 1].box.min.x <= set.proxies[i].box.min.x);
+		}
+
+		int live_count = 0;
+		for (int id = 0; id < set.id_count; id++) { live_count += live[id]; }
+		ASSERT(set.live_count == live_count && set.proxy_count == live_count);
+
+		u64 mark = arena_save(&arena);
+		DynamicPairArray pairs = dynamic_colliders_find_pairs(&arena, &set);
+		qsort(pairs.pairs, pairs.length, sizeof(*pairs.pairs), test_compare_dynamic_pairs);
+
+		int expected_count = 0;
+		for (int a = 0; a < set.id_count; a++) {
+			for (int b = a + 1; b < set.id_count; b++) {
+				if (!live[a] || !live[b]) { continue; }
+				DynamicCollider* collider_a = &set.colliders[a];
+				DynamicCollider* collider_b = &set.colliders[b];
+				if (!((collider_a->layer & collider_b->collide_mask) || (collider_b->layer & collider_a->collide_mask))) { continue; }
+				if (!dynamic_boxes_overlap_internal(dynamic_shape_bounds(collider_a->shape), dynamic_shape_bounds(collider_b->shape))) { continue; }
+
+				ASSERT(expected_count < pairs.length);
+				ASSERT(pairs.pairs[expected_count].a == a && pairs.pairs[expected_count].b == b);
+				expected_count++;
+			}
+		}
+		ASSERT(pairs.length == expected_count);
+		arena_restore(&arena, mark);
+	}
+	ASSERT(set.last_sort_moves > 0 && !set.last_sort_fell_back);
+
+	/* Against static geometry, the same as checking every triangle */
+	TriangleColliderArray terrain = test_create_terrain(&arena, 32, 1.0f);
+	for (int i = 0; i < terrain.length; i += 7) {
+		terrain.colliders[i].mask = MASK_ENEMIES;
+	}
+	SpacialHash hash = collision_spacial_hash_create(&arena, terrain);
+	DynamicStaticPairArray static_pairs = dynamic_colliders_find_static_pairs(&arena, &set, &hash);
+
+	int expected_count = 0;
+	for (int id = 0; id < set.id_count; id++) {
+		if (!live[id]) { continue; }
+		BoundingBox collider_box = dynamic_shape_bounds(set.colliders[id].shape);
+		for (int t = 0; t < terrain.length; t++) {
+			TriangleCollider* tri = &terrain.colliders[t];
+			if (!(tri->mask & set.colliders[id].collide_mask)) { continue; }
+			BoundingBox tri_box = {
+				{ MIN3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x), MIN3(tri->vert_1.y, tri->vert_2.y, tri->vert_3.y), MIN3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) },
+				{ MAX3(tri->vert_1.x, tri->vert_2.x, tri->vert_3.x), MAX3(tri->vert_1.y, tri->vert_2.y, tri->vert_3.y), MAX3(tri->vert_1.z, tri->vert_2.z, tri->vert_3.z) },
+			};
+			if (!dynamic_boxes_overlap_internal(collider_box, tri_box)) { continue; }
+
+			expected_count++;
+			int found = 0;
+			for (int p = 0; p < static_pairs.length; p++) {
+				found += static_pairs.pairs[p].id == id && static_pairs.pairs[p].triangle == tri;
+			}
+			ASSERT(found == 1);
+		}
+	}
+	ASSERT(expected_count > 0 && static_pairs.length == expected_count);
+
+	dynamic_colliders_free(&set);
+	arena_free(&arena);
+}
+
+void test_world_bounding_box() {
+	Arena collision_arena = { .name = "test_world_bounds" };
+
+	/* Far from the origin, spread out enough to take the parallel path */
+	int count = 3 * 4096 + 17;
+	TriangleColliderArray arr = {0};
+	TriangleCollider* tris = arena_array_push_n(&collision_arena, arr.colliders, arr.length, arr.capacity, count);
+	for (int i = 0; i < count; i++) {
+		f32 x = 1000.0f + (f32)(i % 101);
+		f32 z = -2000.0f - (f32)(i % 37);
+		tris[i] = (TriangleCollider) {
+			.mask = MASK_STATIC_GEOMETRY,
+			.vert_1 = (Vector3) {x, 50.0f, z},
+			.vert_2 = (Vector3) {x + 1.0f, 50.0f + (f32)(i % 7), z},
+			.vert_3 = (Vector3) {x, 50.0f, z - 1.0f},
+		};
+	}
+
+	BoundingBox box = collision_get_world_bounding_box(arr);
+	ASSERT(test_vector3_near(box.min, (Vector3) {1000.0f, 50.0f, -2037.0f}));
+	ASSERT(test_vector3_near(box.max, (Vector3) {1101.0f, 56.0f, -2000.0f}));
+
+	/* The grid only covers the colliders, not the origin */
+	SpacialHash hash = collision_spacial_hash_create(&collision_arena, arr);
+	ASSERT(hash.x_axis_cell_count == (int)(101.0f / hash.cell_width) + 1);
+	RaycastHit hit = collision_raycast(&hash, MASK_ALL, (Vector3) {1000.5f, 100.0f, -2000.2f}, VECTOR3_DOWN, 100.0f);
+	ASSERT(hit.collider != NULL);
+
+	/* Nothing at all */
+	TriangleColliderArray empty = {0};
+	box = collision_get_world_bounding_box(empty);
+	ASSERT(box.min.x == INFINITY && box.max.x == -INFINITY);
+	hash = collision_spacial_hash_create(&collision_arena, empty);
+	ASSERT(hash.x_axis_cell_count == 1 && hash.z_axis_cell_count == 1);
+
+	arena_free(&collision_arena);
+}
+
+void test_collider_bounds() {
+	Arena model_arena = { .name = "test_collider_bounds_models" };
+	Arena collider_arena = { .name = "test_collider_bounds" };
+
+	/* One triangle per model, placed away from the origin */
+	Model models[MODEL_ID_COUNT] = {0};
+	Mesh mesh = { .vertexCount = 3 };
+	mesh.vertices = arena_alloc(&model_arena, sizeof(f32) * 9);
+	f32 vertices[9] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f };
+	for (int i = 0; i < 9; i++) { mesh.vertices[i] = vertices[i]; }
+	for (int i = 0; i < MODEL_ID_COUNT; i++) {
+		models[i] = (Model) { .meshCount = 1, .meshes = &mesh };
+	}
+
+	StaticObject objects[3];
+	for (int i = 0; i < 3; i++) {
+		objects[i] = (StaticObject) { .transform = default_transform(), .id = (i % 2) ? MODEL_BOX : MODEL_TORUS };
+		objects[i].transform.translation = (Vector3) {-500.0f + 10.0f * i, 20.0f, 300.0f};
+	}
+
+	BoundingBox generated = {0};
+	TriangleColliderArray colliders = static_object_loop(&collider_arena, (StaticObjectArray) { .objects = objects, .len = 3 }, models, &generated);
+	BoundingBox expected = collision_get_world_bounding_box(colliders);
+	ASSERT(test_vector3_near(generated.min, expected.min) && test_vector3_near(generated.max, expected.max));
+	ASSERT(test_vector3_near(generated.min, (Vector3) {-500.0f, 20.0f, 300.0f}));
+
+	EntityStore store;
+	entity_store_init(&store);
+	for (int i = 0; i < 3; i++) {
+		entity_create(&store, (Entity) { .transform = objects[i].transform, .collider_model_id = objects[i].id, .layer = MASK_ENEMIES });
+	}
+	entity_store_update_hierarchy(&store);
+	colliders = entity_collider_loop(&collider_arena, &store, models, &generated);
+	ASSERT(colliders.length == 3);
+	ASSERT(test_vector3_near(generated.min, expected.min) && test_vector3_near(generated.max, expected.max));
+
+	entity_store_free(&store);
+	arena_free(&collider_arena);
+	arena_free(&model_arena);
+}
+
+void test_batch_math() {
+	/* Odd count so the SIMD loops and the scalar leftovers both run */
+	#define TEST_BATCH_COUNT 37
+	Vector3 a[TEST_BATCH_COUNT], b[TEST_BATCH_COUNT], out[TEST_BATCH_COUNT];
+	Quaternion qa[TEST_BATCH_COUNT], qb[TEST_BATCH_COUNT], q_out[TEST_BATCH_COUNT];
+	f32 dots[TEST_BATCH_COUNT];
+
+	u32 seed = 12345;
+	f32 values[TEST_BATCH_COUNT * 14];
+	for (int i = 0; i < TEST_BATCH_COUNT * 14; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		/* Everything negative, so a box that wrongly starts at the origin would show */
+		values[i] = -1.0f - (f32)(seed >> 8) / (f32)(1 << 24) * 9.0f;
+	}
+	for (int i = 0; i < TEST_BATCH_COUNT; i++) {
+		const f32* v = values + 14 * i;
+		a[i] = (Vector3) {v[0], v[1], v[2]};
+		b[i] = (Vector3) {v[3], v[4], v[5]};
+		qa[i] = QuaternionNormalize((Quaternion) {v[6], v[7], v[8], v[9]});
+		qb[i] = QuaternionNormalize((Quaternion) {v[10], v[11], v[12], v[13]});
+	}
+
+	Transform transform = {
+		.translation = (Vector3) {3.0f, -2.0f, 1.0f},
+		.rotation = QuaternionFromAxisAngle(Vector3Normalize((Vector3) {1.0f, 2.0f, 3.0f}), 0.7f),
+		.scale = (Vector3) {2.0f, 0.5f, 1.5f},
+	};
+	Matrix matrix = math_transform_to_matrix(transform);
+
+	math_batch_transform_points(out, a, TEST_BATCH_COUNT, matrix);
+	for (int i = 0; i < TEST_BATCH_COUNT; i++) {
+		ASSERT(test_vector3_near(out[i], Vector3Transform(a[i], matrix)));
+	}
+
+	/* Straight into colliders, without touching the fields around the vertices */
+	TriangleCollider colliders[TEST_BATCH_COUNT / 3];
+	for (int i = 0; i < TEST_BATCH_COUNT / 3; i++) {
+		colliders[i] = (TriangleCollider) { .mask = MASK_ENEMIES, .entity_id = (EntityHandle)i };
+	}
+	math_batch_transform_triangles(&colliders[0].vert_1, sizeof(colliders[0]), a, TEST_BATCH_COUNT / 3, matrix);
+	for (int i = 0; i < TEST_BATCH_COUNT / 3; i++) {
+		ASSERT(colliders[i].mask == MASK_ENEMIES && colliders[i].entity_id == (EntityHandle)i);
+		ASSERT(test_vector3_near(colliders[i].vert_1, Vector3Transform(a[3 * i + 0], matrix)));
+		ASSERT(test_vector3_near(colliders[i].vert_2, Vector3Transform(a[3 * i + 1], matrix)));
+		ASSERT(test_vector3_near(colliders[i].vert_3, Vector3Transform(a[3 * i + 2], matrix)));
+	}
+
+	math_batch_quaternion_multiply(q_out, qa, qb, TEST_BATCH_COUNT);
+	for (int i = 0; i < TEST_BATCH_COUNT; i++) {
+		Quaternion expected = QuaternionMultiply(qa[i], qb[i]);
+		ASSERT(test_vector3_near((Vector3) {q_out[i].x, q_out[i].y, q_out[i].z}, (Vector3) {expected.x, expected.y, expected.z}));
+		ASSERT(math_f32_abs(q_out[i].w - expected.w) < 0.0001f);
+	}
+
+	math_batch_dot(dots, a, b, TEST_BATCH_COUNT);
+	math_batch_cross(out, a, b, TEST_BATCH_COUNT);
+	for (int i = 0; i < TEST_BATCH_COUNT; i++) {
+		ASSERT(math_f32_abs(dots[i] - Vector3DotProduct(a[i], b[i])) < 0.001f);
+		ASSERT(test_vector3_near(out[i], Vector3CrossProduct(a[i], b[i])));
+	}
+
+	/* Min and max are exact, and every prefix length has to agree with the scalar version */
+	for (int count = 0; count <= TEST_BATCH_COUNT; count++) {
+		BoundingBox box = math_batch_aabb(a, count);
+		BoundingBox expected = math_batch_aabb_scalar(a, count);
+		ASSERT(box.min.x == expected.min.x && box.min.y == expected.min.y && box.min.z == expected.min.z);
+		ASSERT(box.max.x == expected.max.x && box.max.y == expected.max.y && box.max.z == expected.max.z);
+	}
+	BoundingBox box = math_batch_aabb(a, TEST_BATCH_COUNT);
+	ASSERT(box.max.x < 0.0f && box.max.y < 0.0f && box.max.z < 0.0f);
+	box = math_batch_aabb(a, 0);
+	ASSERT(box.min.x == INFINITY && box.max.x == -INFINITY);
+
+	Matrix other = math_transform_to_matrix((Transform) { .translation = (Vector3) {0.0f, 4.0f, 0.0f}, .rotation = qa[0], .scale = (Vector3) {1.0f, 1.0f, 1.0f} });
+	Matrix product = math_matrix_multiply(matrix, other);
+	Matrix expected_product = MatrixMultiply(matrix, other);
+	const f32* product_floats = &product.m0;
+	const f32* expected_floats = &expected_product.m0;
+	for (int i = 0; i < 16; i++) {
+		ASSERT(math_f32_abs(product_floats[i] - expected_floats[i]) < 0.0001f);
+	}
+	#undef TEST_BATCH_COUNT
+}
+
+void test_fixed_timestep() {
+	const u64 second = 1000000000ULL;
+	FixedStepClock clock = fixed_step_clock_create(120, 8);
+
+	/* The first frame only starts the clock */
+	ASSERT(fixed_step_clock_advance(&clock, 5 * second) == 0);
+
+	/* A 60 fps frame is two steps, with nothing left over */
+	ASSERT(fixed_step_clock_advance(&clock, 5 * second + second / 60) == 2);
+	ASSERT(fixed_step_clock_alpha(&clock) < 0.01f);
+
+	/* Half a step carries over into alpha, and the next half completes it */
+	u64 now = 5 * second + second / 60;
+	now += clock.step_ns / 2;
+	ASSERT(fixed_step_clock_advance(&clock, now) == 0);
+	ASSERT(math_f32_abs(fixed_step_clock_alpha(&clock) - 0.5f) < 0.01f);
+	now += clock.step_ns / 2 + 1;
+	ASSERT(fixed_step_clock_advance(&clock, now) == 1);
+
+	/* A one second hitch runs at most 8 steps and drops the rest */
+	now += second;
+	ASSERT(fixed_step_clock_advance(&clock, now) == 8);
+	ASSERT(clock.clamped_frame_count == 1);
+	ASSERT(clock.dropped_ns >= second - 9 * clock.step_ns);
+	ASSERT(fixed_step_clock_alpha(&clock) < 1.0f);
+	ASSERT(clock.step_count == 11);
+	ASSERT(clock.steps_histogram[8] == 1);
+
+	/* Rendering between steps blends local transforms, children follow the blended parent */
+	EntityStore store;
+	entity_store_init(&store);
+
+	Entity entity = { .transform = default_transform() };
+	entity.transform.translation = VECTOR3_ZERO;
+	EntityHandle parent = entity_create(&store, entity);
+	entity.parent = parent;
+	entity.transform.translation = (Vector3) {0.0f, 1.0f, 0.0f};
+	EntityHandle child = entity_create(&store, entity);
+	entity_store_update_hierarchy(&store);
+
+	/* Nothing moved, so there's nothing to blend */
+	ASSERT(entity_store_interpolate(&store, 0.5f) == store.world_matrices);
+
+	Transform moved = default_transform();
+	moved.translation = (Vector3) {4.0f, 0.0f, 0.0f};
+	entity_set_transform(&store, parent, moved);
+	/* Only the first change since the last update counts as where it came from */
+	moved.translation = (Vector3) {10.0f, 0.0f, 0.0f};
+	entity_set_transform(&store, parent, moved);
+	entity_store_update_hierarchy(&store);
+
+	const Matrix* render = entity_store_interpolate(&store, 0.5f);
+	ASSERT(test_vector3_near(test_matrix_translation(render[entity_dense_index(&store, parent)]), (Vector3) {5.0f, 0.0f, 0.0f}));
+	ASSERT(test_vector3_near(test_matrix_translation(render[entity_dense_index(&store, child)]), (Vector3) {5.0f, 1.0f, 0.0f}));
+	render = entity_store_interpolate(&store, 1.0f);
+	ASSERT(test_vector3_near(test_matrix_translation(render[entity_dense_index(&store, child)]), (Vector3) {10.0f, 1.0f, 0.0f}));
+
+	/* A step where nothing moves stops the blending */
+	entity_store_update_hierarchy(&store);
+	ASSERT(entity_store_interpolate(&store, 0.5f) == store.world_matrices);
+
+	/* Reparenting snaps instead of blending */
+	entity_set_parent(&store, child, ENTITY_HANDLE_NONE);
+	entity_store_update_hierarchy(&store);
+	render = entity_store_interpolate(&store, 0.5f);
+	ASSERT(test_vector3_near(test_matrix_translation(render[entity_dense_index(&store, child)]), (Vector3) {0.0f, 1.0f, 0.0f}));
+
+	entity_store_free(&store);
+}
+
+thread_global bool test_pipeline_is_main_thread = false;
+
+typedef struct TestPipelineData {
+	int produced;
+	int produced_off_main_thread;
+} TestPipelineData;
+
+void test_pipeline_produce(void* user_data, FrameState* state) {
+	TestPipelineData* data = user_data;
+	data->produced++;
+	if (!test_pipeline_is_main_thread) data->produced_off_main_thread++;
+
+	/* Each state only ever sees its own arena */
+	int* steps = arena_alloc(&state->arena, sizeof(*steps));
+	*steps = state->steps;
+	state->colliders.length = *steps;
+}
+
+void test_frame_pipeline() {
+	test_pipeline_is_main_thread = true;
+	TestPipelineData data = {0};
+	FramePipeline pipeline;
+	frame_pipeline_start(&pipeline, 1024 * 1024, test_pipeline_produce, &data);
+	ASSERT(data.produced == 1);
+
+	/* The first swap gets the state produced on start */
+	FrameState* state = frame_pipeline_swap(&pipeline, 1, 0.25f);
+	ASSERT(state->frame_index == 0);
+	ASSERT(state->steps == 0);
+
+	/* Every swap after that draws what the previous one asked for, while the next one is simulated */
+	for (int i = 2; i < 10; i++) {
+		FrameState* next = frame_pipeline_swap(&pipeline, i, 0.5f);
+		ASSERT(next != state);
+		ASSERT(next->steps == i - 1);
+		ASSERT(next->colliders.length == i - 1);
+		ASSERT(next->frame_index == (u64)(i - 1));
+		state = next;
+	}
+	ASSERT(state->alpha == 0.5f);
+
+	bool threaded = pipeline.threaded;
+	frame_pipeline_stop(&pipeline);
+	ASSERT(data.produced == 10);
+	if (threaded) {
+		ASSERT(data.produced_off_main_thread == 9);
+	}
+	test_pipeline_is_main_thread = false;
+}
+
+#define TEST_INPUT_FRAME_COUNT 240
+#define TEST_INPUT_LOG_PATH "test_input_log.ahin"
+
+/* Two seconds of a scripted session: idle, orbit with the right mouse button, then a few keys and the wheel */
+InputFrame test_input_frame(int i) {
+	InputFrame frame = {
+		/* Uneven frame times, so steps per frame vary */
+		.time_ns = (u64)i * 8333333ULL + (u64)(i % 3) * 1000000ULL,
+	};
+	if (i >= 60 && i < 120) {
+		frame.keys_down = (1u << INPUT_KEY_MOUSE_RIGHT);
+		frame.mouse_delta = (Vector2) {(f32)(i % 7) - 3.0f, 0.5f};
+	}
+	if (i >= 120 && i < 180) {
+		frame.keys_down = (1u << INPUT_KEY_W) | (1u << INPUT_KEY_LEFT);
+		if (i == 120) frame.keys_pressed = frame.keys_down;
+	}
+	if (i == 200) frame.mouse_wheel = -1.0f;
+	return frame;
+}
+
+void test_input_replay() {
+	TempArena scratch = scratch_begin(NULL, 0);
+
+	/* Round trip through the encoding */
+	u8* log = arena_alloc(scratch.arena, INPUT_LOG_HEADER_SIZE + TEST_INPUT_FRAME_COUNT * INPUT_RECORD_MAX_SIZE);
+	input_log_header_internal(log);
+	u64 length = INPUT_LOG_HEADER_SIZE;
+	InputFrame previous = {0};
+	for (int i = 0; i < TEST_INPUT_FRAME_COUNT; i++) {
+		InputFrame frame = test_input_frame(i);
+		length += (u64)input_record_encode(log + length, &frame, &previous);
+		previous = frame;
+	}
+	/* Mostly idle frames cost a handful of bytes */
+	ASSERT(length < TEST_INPUT_FRAME_COUNT * 12);
+
+	InputReplay replay;
+	ASSERT(input_replay_from_bytes(&replay, log, length));
+	InputFrame decoded;
+	for (int i = 0; i < TEST_INPUT_FRAME_COUNT; i++) {
+		InputFrame expected = test_input_frame(i);
+		ASSERT(input_replay_next(&replay, &decoded));
+		ASSERT(decoded.time_ns == expected.time_ns);
+		ASSERT(decoded.keys_down == expected.keys_down);
+		ASSERT(decoded.keys_pressed == expected.keys_pressed);
+		ASSERT(decoded.mouse_delta.x == expected.mouse_delta.x && decoded.mouse_delta.y == expected.mouse_delta.y);
+		ASSERT(decoded.mouse_wheel == expected.mouse_wheel);
+	}
+	ASSERT(!input_replay_next(&replay, &decoded));
+
+	/* Cut off logs stop cleanly, and other files are rejected */
+	ASSERT(input_replay_from_bytes(&replay, log, length - 1));
+	int frames = 0;
+	while (input_replay_next(&replay, &decoded)) { frames++; }
+	ASSERT(frames < TEST_INPUT_FRAME_COUNT);
+	ASSERT(!input_replay_from_bytes(&replay, (const u8*)"not a log", 9));
+
+	/* Two headless replays of the same recording run the same steps on the same frames */
+	InputRecorder recorder;
+	ASSERT(input_recorder_open(&recorder, TEST_INPUT_LOG_PATH));
+	for (int i = 0; i < TEST_INPUT_FRAME_COUNT; i++) {
+		InputFrame frame = test_input_frame(i);
+		input_recorder_write(&recorder, &frame);
+	}
+	ASSERT(recorder.byte_count == length);
+	input_recorder_close(&recorder);
+
+	FrameTrace traces[2] = {0};
+	for (int run = 0; run < 2; run++) {
+		AfterhoursOptions options = {
+			.replay_path = TEST_INPUT_LOG_PATH,
+			.headless = true,
+			.trace = &traces[run],
+			.trace_arena = scratch.arena,
+		};
+		ASSERT(afterhours_main(options) == 0);
+		ASSERT(traces[run].length == TEST_INPUT_FRAME_COUNT);
+	}
+
+	int total_steps = 0;
+	for (int i = 0; i < TEST_INPUT_FRAME_COUNT; i++) {
+		ASSERT(traces[0].frames[i].steps == traces[1].frames[i].steps);
+		total_steps += traces[0].frames[i].steps;
+	}
+	/* The clock starts on the first frame, the rest is all time divided into 120 Hz steps */
+	u64 step_ns = 1000000000ULL / SIM_DEFAULT_TICK_RATE;
+	ASSERT(total_steps == (int)((test_input_frame(TEST_INPUT_FRAME_COUNT - 1).time_ns - test_input_frame(0).time_ns) / step_ns));
+
+	remove(TEST_INPUT_LOG_PATH);
+	scratch_end(scratch);
 }
 
 int main() {
@@ -131,7 +2056,107 @@ int main() {
 	printf("string ends with test passed\n");
 
 
+	printf("Testing arena registry\n");
+	test_arena_registry();
+	printf("Arena registry test passed\n");
+
+	printf("Testing arena commit growth\n");
+	test_arena_commit_growth();
+	printf("Arena commit growth test passed\n");
+
+	printf("Testing pool allocator\n");
+	test_pool();
+	printf("Pool allocator test passed\n");
+
+	printf("Testing arena arrays\n");
+	test_arena_arrays();
+	printf("Arena array test passed\n");
+
+	printf("Testing scratch arenas\n");
+	test_scratch_arenas();
+	printf("Scratch arena test passed\n");
+
+	printf("Testing entity store\n");
+	test_entity_store();
+	printf("Entity store test passed\n");
+
+	printf("Testing batch math\n");
+	test_batch_math();
+	printf("Batch math test passed\n");
+
+	printf("Testing transform hierarchy\n");
+	test_transform_hierarchy();
+	printf("Transform hierarchy test passed\n");
+
+	printf("Testing fixed timestep\n");
+	test_fixed_timestep();
+	printf("Fixed timestep test passed\n");
+
+	printf("Testing frame pipeline\n");
+	test_frame_pipeline();
+	printf("Frame pipeline test passed\n");
+
+	printf("Testing input replay\n");
+	test_input_replay();
+	printf("Input replay test passed\n");
+
+	printf("Testing job system\n");
+	test_job_system();
+	printf("Job system test passed\n");
+
+	printf("Testing system scheduler\n");
+	test_scheduler();
+	printf("System scheduler test passed\n");
+
 	printf("Testing raycasting\n");
 	test_raycasting();
 	printf("Raycasting test passed\n");
+
+	printf("Testing spacial hash rasterization\n");
+	test_spacial_hash_rasterize();
+	printf("Spacial hash rasterization test passed\n");
+
+	printf("Testing spacial hash columns\n");
+	test_spacial_hash_columns();
+	printf("Spacial hash column test passed\n");
+
+	printf("Testing ground height\n");
+	test_ground_height();
+	printf("Ground height test passed\n");
+
+	printf("Testing sparse spacial hash\n");
+	test_spacial_hash_sparse();
+	printf("Sparse spacial hash test passed\n");
+
+	printf("Testing spacial hash tuning\n");
+	test_spacial_hash_tuning();
+	printf("Spacial hash tuning test passed\n");
+
+	printf("Testing spacial hash layer masks\n");
+	test_spacial_hash_layer_masks();
+	printf("Spacial hash layer masks test passed\n");
+
+	printf("Testing dynamic colliders\n");
+	test_dynamic_colliders();
+	printf("Dynamic colliders test passed\n");
+
+	printf("Testing sweeps\n");
+	test_sweeps();
+	printf("Sweeps test passed\n");
+
+	printf("Testing character controller\n");
+	test_character_controller();
+	printf("Character controller test passed\n");
+
+	printf("Testing overlaps\n");
+	test_overlaps();
+	printf("Overlaps test passed\n");
+
+	printf("Testing world bounding box\n");
+	test_world_bounding_box();
+	printf("World bounding box test passed\n");
+
+	printf("Testing collider bounds\n");
+	test_collider_bounds();
+	printf("Collider bounds test passed\n");
 }
\ No newline at end of file
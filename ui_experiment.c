@@ -455,6 +455,7 @@ void eui_draw_context(UiContext* context) {
 
 UiContext eui_context_create() {
 	UiContext new_context = {0};
+	new_context.arena.name = "eui_context";
 
 	new_context.region_stack = arena_alloc(&new_context.arena, sizeof(*new_context.region_stack) * UI_REGION_STACK_DEPTH);
 	new_context.elements = NULL;